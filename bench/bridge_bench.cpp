@@ -0,0 +1,527 @@
+/**
+ * @file bridge_bench.cpp
+ * @brief Jetson -> CANFD forwarding benchmark for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Usage: bridge_bench [--rate HZ] [--duration S] [--loop-cost-us US]
+ *                     [--max-p99-us US] [--feedback-rate HZ] [--background-rate HZ]
+ *                     [--diag-rate HZ] [--estop-at S] [--reset-at S] [--disarm-at S] [--max-estop-us US]
+ *                     [--summary-budget B]
+ *                     [--max-boot-ms MS] [--steady] [--compact] [--spi-per-frame] [--shaping]
+ *                     [--brownout] [--debug-strap] [--serial] [--set NAME=VALUE]...
+ *                     [--jetson-fault-at S] [--periph-fault-at S] [--fault-ms MS] [--periph-reset-at S]
+ *
+ *   --rate          Jetson drive frames per second, per wheel (default 100)
+ *   --duration      Simulated seconds of traffic (default 10)
+ *   --loop-cost-us  Simulated time charged for each loop() pass (default 2)
+ *   --max-p99-us    Exit non-zero if p99 latency exceeds this bound
+ *   --feedback-rate ODrive encoder estimates per second, per node (default 100, 0 = off)
+ *   --background-rate  Unrelated Jetson-bus frames per second (default 0)
+ *   --diag-rate     Diagnostic requests per second from the Jetson (default 10, 0 = off)
+ *   --estop-at      Send an emergency stop this many seconds in (default 50 ms before
+ *                   the end, negative = never)
+ *   --reset-at      Send a state RESET this many seconds in, after the stop; the run
+ *                   then fails unless the stop is released and setpoints flow again
+ *   --disarm-at     Send a state DISARM this many seconds in, and do not arm again; the
+ *                   run fails if steering moves past the last setpoint it took
+ *   --max-estop-us  Bound on stop frame arrival to the last ODrive Estop on the wire
+ *                   (default: the longest frame already on the wire plus one Estop per node)
+ *   --summary-budget  Byte budget per second for every telemetry summary signal,
+ *                   in place of the hat_config.h defaults (0 = unlimited); set in the
+ *                   parameter table before boot
+ *   --max-boot-ms   Exit non-zero if reset to the first forwarded setpoint takes longer
+ *   --steady        Repeat one unchanging command instead of a ramp
+ *   --compact       Send the compact drive frames, two wheels each, instead of one
+ *                   float frame per wheel; telemetry follows (HAT_JETSON_FORMAT_AUTO)
+ *   --spi-per-frame Leave MCP2517FD transfers to the library, one message per
+ *                   call, instead of the batched transport (for comparison)
+ *   --shaping       Interpolate and rate limit setpoints (setpoint_shaper.h). Off by
+ *                   default: latency is measured by matching output to Jetson values.
+ *   --brownout      Jetson traffic and ODrive reports start at reset, while setup() runs,
+ *                   instead of after it
+ *   --debug-strap   Pull PIN_DEBUG_STRAP low, so setup() waits for a serial monitor
+ *   --serial        Echo the firmware's Serial output to stderr (the monitor is open)
+ *   --set           Change a runtime parameter (param_registry.h, e.g.
+ *                   TELEMETRY_INTERVAL_MS=50) over CAN once traffic starts, then save
+ *                   the table; repeatable
+ *   --jetson-fault-at  Fail the Jetson bus (the controller goes bus-off) this many
+ *                   seconds in, for --fault-ms
+ *   --periph-fault-at  The same on the peripheral bus
+ *   --fault-ms      Length of an injected bus fault (default 50)
+ *   --periph-reset-at  Reset the MCP2517FD this many seconds in; it waits in
+ *                   configuration mode until the firmware sets it up again
+ *   With any fault the run fails if a bus is still down at the end.
+ *
+ * "bridge_bench replay LOG ..." replays a candump or ASC capture instead
+ * (see can_replay.cpp).
+ */
+
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SPI.h"
+#include "EEPROM.h"
+#include "bridge_rig.h"
+#include "can_replay.h"
+#include "can_interface.h"
+#include "component_ctrl.h"
+#include "diagnostics.h"
+#include "bus_supervisor.h"
+#include "filter_planner.h"
+#include "hardware_map.h"
+#include "message_construction.h"
+#include "param_registry.h"
+#include "scheduler.h"
+#include "state_machine.h"
+
+// Defined by the sketch
+extern TaskScheduler scheduler;
+extern ComponentController componentController;
+extern CANInterface canInterface;
+extern HATStateMachine stateMachine;
+
+// Left out of unit test builds, which bring their own main() (pio test)
+#ifndef PIO_UNIT_TESTING
+
+static void printFilterPlan(const char* label, const FilterPlan_t& plan, uint8_t dedicated) {
+    printf("%-21s: %u dedicated + %u mask, %u IDs handled, %u extra accepted, "
+           "%.2f%% of ID space rejected\n",
+           label, dedicated, plan.count, plan.handledIds, plan.extraIds,
+           100.0 * filterPlanRejectionRate(plan, dedicated));
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [--rate HZ] [--duration S] [--loop-cost-us US] [--max-p99-us US] "
+            "[--feedback-rate HZ] [--background-rate HZ] [--diag-rate HZ] [--estop-at S] [--reset-at S] "
+            "[--disarm-at S] [--max-estop-us US] [--summary-budget B] [--max-boot-ms MS] [--steady] [--compact] [--spi-per-frame] "
+            "[--shaping] [--brownout] [--debug-strap] [--serial] [--set NAME=VALUE]... "
+            "[--jetson-fault-at S] [--periph-fault-at S] [--fault-ms MS] [--periph-reset-at S]\n"
+            "       %s replay LOG [options]\n",
+            program, program);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "replay") == 0) {
+        return runReplay(argc - 1, argv + 1);
+    }
+
+    double rateHz = 100.0;
+    double durationSeconds = 10.0;
+    uint32_t loopCostMicros = 2;
+    uint64_t maxP99Micros = 0;
+    double feedbackHz = 100.0;
+    double backgroundHz = 0.0;
+    double diagHz = 10.0;
+    double estopAtSeconds = 0.0;
+    bool estopAtGiven = false;
+    double resetAtSeconds = -1.0;
+    double disarmAtSeconds = -1.0;
+    uint64_t maxEstopMicros = 0;
+    bool steady = false;
+    bool spiPerFrame = false;
+    bool shaping = false;
+    bool compact = false;
+    long summaryBudget = -1;
+    double maxBootMillis = 0.0;
+    bool brownout = false;
+    std::vector<std::pair<uint8_t, uint32_t>> settings;     // Parameter index, raw value
+    double jetsonFaultAt = -1.0;
+    double periphFaultAt = -1.0;
+    double periphResetAt = -1.0;
+    double faultMillis = 50.0;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--rate") == 0 && hasValue) {
+            rateHz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && hasValue) {
+            durationSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--loop-cost-us") == 0 && hasValue) {
+            loopCostMicros = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--max-p99-us") == 0 && hasValue) {
+            maxP99Micros = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--feedback-rate") == 0 && hasValue) {
+            feedbackHz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--background-rate") == 0 && hasValue) {
+            backgroundHz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--diag-rate") == 0 && hasValue) {
+            diagHz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--estop-at") == 0 && hasValue) {
+            estopAtSeconds = atof(argv[++i]);
+            estopAtGiven = true;
+        } else if (strcmp(argv[i], "--reset-at") == 0 && hasValue) {
+            resetAtSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--disarm-at") == 0 && hasValue) {
+            disarmAtSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-estop-us") == 0 && hasValue) {
+            maxEstopMicros = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--summary-budget") == 0 && hasValue) {
+            summaryBudget = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--max-boot-ms") == 0 && hasValue) {
+            maxBootMillis = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--steady") == 0) {
+            steady = true;
+        } else if (strcmp(argv[i], "--spi-per-frame") == 0) {
+            spiPerFrame = true;
+        } else if (strcmp(argv[i], "--shaping") == 0) {
+            shaping = true;
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        } else if (strcmp(argv[i], "--brownout") == 0) {
+            brownout = true;
+        } else if (strcmp(argv[i], "--debug-strap") == 0) {
+            sim::drivePin(PIN_DEBUG_STRAP, LOW);
+        } else if (strcmp(argv[i], "--set") == 0 && hasValue) {
+            char name[32];
+            const char* arg = argv[++i];
+            const char* equals = strchr(arg, '=');
+            const size_t length = equals != nullptr ? (size_t)(equals - arg) : 0;
+            int8_t index = -1;
+            if (length > 0 && length < sizeof(name)) {
+                memcpy(name, arg, length);
+                name[length] = '\0';
+                index = ParamRegistry::findByName(name);
+            }
+            if (index < 0) {
+                fprintf(stderr, "unknown parameter in --set %s\n", arg);
+                return 2;
+            }
+            settings.push_back({(uint8_t)index, ParamRegistry::encode((uint8_t)index, (float)atof(equals + 1))});
+        } else if (strcmp(argv[i], "--jetson-fault-at") == 0 && hasValue) {
+            jetsonFaultAt = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--periph-fault-at") == 0 && hasValue) {
+            periphFaultAt = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--fault-ms") == 0 && hasValue) {
+            faultMillis = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--periph-reset-at") == 0 && hasValue) {
+            periphResetAt = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--serial") == 0) {
+            Serial.setEcho(true);
+            Serial.setConnected(true);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (rateHz <= 0.0 || durationSeconds <= 0.0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    BridgeRig rig;
+    rig.setODriveFeedbackRate(feedbackHz);
+    componentController.setSpiBatching(!spiPerFrame);
+    componentController.setSetpointShaping(shaping);
+    if (summaryBudget >= 0) {
+        // Staged now, taken over by setup() (the simulated EEPROM starts empty)
+        const uint32_t budget = (uint32_t)std::min(summaryBudget, 0xFFFFL);
+        paramRegistry.set(PARAM_AGG_STEER_BUDGET, budget);
+        paramRegistry.set(PARAM_AGG_DRIVE_BUDGET, budget);
+    }
+    if (!brownout) {
+        rig.boot();
+    }
+
+    const uint64_t start = sim::nowMicros();
+    const uint64_t duration = (uint64_t)(durationSeconds * 1e6);
+    DriveTrafficSource drive(rateHz, start, duration, steady, compact);
+    BackgroundTrafficSource background(backgroundHz, start, duration);
+    DiagnosticPollSource poll(diagHz, start, duration);
+    MergedFrameSource commands(drive, background);
+    MergedFrameSource polled(commands, poll);
+    if (!estopAtGiven) {
+        estopAtSeconds = durationSeconds > 0.1 ? durationSeconds - 0.05 : durationSeconds / 2;
+    }
+    EmergencyStopSource estop(estopAtSeconds >= 0.0 ? start + (uint64_t)(estopAtSeconds * 1e6) : UINT64_MAX);
+    MergedFrameSource stopped(polled, estop);
+    if (resetAtSeconds >= 0.0 && (estopAtSeconds < 0.0 || resetAtSeconds <= estopAtSeconds)) {
+        fprintf(stderr, "--reset-at must come after the stop (--estop-at)\n");
+        return 2;
+    }
+    StateRequestSource reset(resetAtSeconds >= 0.0 ? start + (uint64_t)(resetAtSeconds * 1e6) : UINT64_MAX,
+                             MSG_TYPE_STATE_RESET);
+    MergedFrameSource released(stopped, reset);
+    ConfigRequestSource config(start + 1000, 1000);
+    for (const auto& setting : settings) {
+        config.add(ParamRegistry::info(setting.first).id, setting.second);
+    }
+    MergedFrameSource configured(released, config);
+    // Setpoints are only taken while armed, so the Jetson arms the bridge
+    // first, once its parameter changes (refused once armed) are answered
+    ArmRequestSource arm(stateMachine, start, 200, 1000);
+    if (!settings.empty()) {
+        arm.waitFor(rig.configResponses, (uint32_t)settings.size() + 1);
+    }
+    const uint64_t disarmAt = disarmAtSeconds >= 0.0 ? start + (uint64_t)(disarmAtSeconds * 1e6) : UINT64_MAX;
+    StateRequestSource disarm(disarmAt, MSG_TYPE_STATE_DISARM);
+    arm.stopAt(disarmAt);
+    MergedFrameSource disarmed(configured, disarm);
+    MergedFrameSource traffic(arm, disarmed);
+    const uint64_t faultDuration = (uint64_t)(faultMillis * 1e3);
+    if (jetsonFaultAt >= 0.0) {
+        rig.scheduleJetsonFault(start + (uint64_t)(jetsonFaultAt * 1e6), faultDuration);
+    }
+    if (periphFaultAt >= 0.0) {
+        rig.schedulePeripheralFault(start + (uint64_t)(periphFaultAt * 1e6), faultDuration);
+    }
+    if (periphResetAt >= 0.0) {
+        rig.schedulePeripheralReset(start + (uint64_t)(periphResetAt * 1e6));
+    }
+    if (brownout) {
+        rig.boot(&traffic);
+    }
+    SPI.resetStatistics();      // Traffic from here on only, not controller setup
+    rig.run(traffic, start + duration, loopCostMicros);
+
+    const LatencySummary_t latency = summarizeLatency(rig.latencyMicros);
+    ACAN2517FD* controller = ACAN2517FD::instance();
+    const uint32_t fifoRejects = controller != nullptr ? controller->getRejectedCount() : 0;
+    const double hostNanosPerLoop = rig.loopIterations ? (double)rig.hostLoopNanos / rig.loopIterations : 0.0;
+
+    printf("=== Bridge forwarding benchmark ===\n");
+    printf("jetson rate          : %.1f Hz per wheel (%.1f frames/s), %.3f s simulated\n",
+           rateHz, rateHz * 4, durationSeconds);
+    printf("jetson drive format  : %s commands (%u frames per command set), %s telemetry\n",
+           compact ? "compact" : "float", compact ? HatProfile::compactFrameCount : HatProfile::wheelCount,
+           CANInterfaceBase::getTelemetryFormat() == HAT_JETSON_FORMAT_COMPACT ? "compact" : "float");
+    printf("jetson frames        : %u injected (%.1f frames/s background), %u accepted by filters "
+           "(receive interrupts), %u unrouted\n",
+           rig.injectedFrames, backgroundHz, rig.acceptedFrames, canInterface.getUnroutedCount());
+    printFilterPlan("jetson filters", canInterface.getFilterPlan(), canInterface.getDedicatedMailboxCount());
+    printFilterPlan("jetson ext filters", canInterface.getExtFilterPlan(), 0);
+    printFilterPlan("peripheral filters", componentController.getFilterPlan(), 0);
+    printf("canfd frames         : %u enqueued (%.1f frames/s), %u refused (controller FIFO full, left queued)\n",
+           rig.forwardedFrames, rig.forwardedFrames / durationSeconds, fifoRejects);
+    printf("setpoint frames      : %u sent, %u suppressed (unchanged), %u coalesced, %u expired, "
+           "%u refused (queue full)\n",
+           componentController.getFramesSent(), componentController.getFramesSuppressed(),
+           componentController.getFramesCoalesced(), componentController.getFramesExpired(),
+           componentController.getFramesFailed());
+    printf("peripheral bus       : %.1f%% utilised (arbitration %u bps, data x%u)\n",
+           100.0 * rig.peripheralWireMicros / (durationSeconds * 1e6), CAN_BAUDRATE,
+           (unsigned)CAN_FD_DATA_BITRATE_FACTOR);
+    if (controller != nullptr) {
+        PackedSetpoint_t entries[PACKED_SETPOINT_MAX_ENTRIES] = {};
+        const CANFDMessage packed = buildPackedSetpointMsg(entries, PACKED_SETPOINT_MAX_ENTRIES);
+        const CANFDMessage classic = buildVelocityMsg(NODE_DRIVE_FL, 0.0f);
+        printf("frame wire time      : classic 8 B %llu us, packed FD %u B (%u setpoints) %llu us\n",
+               (unsigned long long)controller->frameWireMicros(classic), packed.len,
+               PACKED_SETPOINT_MAX_ENTRIES, (unsigned long long)controller->frameWireMicros(packed));
+    }
+    if (controller != nullptr) {
+        // Per frame moved through the MCP2517FD FIFOs (both directions)
+        const SpiTransportStats_t spi = componentController.getSpiStats();
+        const uint32_t moved = controller->getSentCount() + rig.feedbackAccepted;
+        printf("mcp2517fd spi        : %s, %u B in %u chip selects (%u B by DMA), %.1f B and %.2f us CPU "
+               "per frame moved (%u sent, %u received)",
+               componentController.isSpiBatched() ? "batched" : "per frame (library)",
+               SPI.bytesTransferred(), SPI.chipSelectCount(), SPI.dmaBytesTransferred(),
+               moved ? (double)SPI.bytesTransferred() / moved : 0.0,
+               moved ? SPI.cpuNanos() / 1000.0 / moved : 0.0, controller->getSentCount(), rig.feedbackAccepted);
+        if (componentController.isSpiBatched()) {
+            printf(", %.2f frames per transmit batch, %.2f per receive burst",
+                   spi.txBatches ? (double)spi.txFrames / spi.txBatches : 0.0,
+                   spi.rxBursts ? (double)spi.rxFrames / spi.rxBursts : 0.0);
+        }
+        printf("\n");
+    }
+    printf("setpoints            : %u forwarded, %u superseded before forwarding\n",
+           latency.count, rig.supersededSetpoints);
+    printf("setpoint shaping     : %s, largest step between frames %.3f rad/s drive, %.3f rad steering",
+           componentController.isSetpointShaping() ? "on" : "off", rig.maxVelocityStep, rig.maxPositionStep);
+    if (componentController.isSetpointShaping()) {
+        const SetpointShaper& shaper = componentController.getSetpointShaper();
+        uint32_t limited = 0;
+        for (uint8_t wheel = 0; wheel < HatProfile::wheelCount; wheel++) {
+            limited += shaper.getLimitedCount(wheel);
+        }
+        printf(" (limits %.1f rad/s^2, %.1f rad/s, %.1f rad/s^2; %u wheel cycles limited)",
+               shaper.getLimits(0).maxDriveAccel, shaper.getLimits(0).maxSteerRate,
+               shaper.getLimits(0).maxSteerAccel, limited);
+    }
+    printf("\n");
+    printf("latency arrival->enq : p50 %llu us, p99 %llu us, max %llu us, mean %.1f us\n",
+           (unsigned long long)latency.p50, (unsigned long long)latency.p99,
+           (unsigned long long)latency.max, latency.mean);
+    printf("odrive feedback      : %u encoder frames sent, %u accepted by filters, %u decoded, %u unrouted\n",
+           rig.feedbackInjected, rig.feedbackAccepted, componentController.getFramesReceived(),
+           componentController.getFramesUnrouted());
+    printf("jetson telemetry     : %u encoder frames in %u four-wheel bursts (max spread %llu us), "
+           "%u not matching a recent report\n",
+           rig.telemetryFrames, rig.telemetryBursts, (unsigned long long)rig.maxBurstSpreadMicros,
+           rig.telemetryMismatched);
+    if (HAT_TELEMETRY_AGGREGATION) {
+        uint32_t held = 0;
+        double peakBytes = 0.0;
+        for (uint8_t signal = 0; signal < TELEMETRY_SIGNAL_COUNT; signal++) {
+            held += telemetryAggregator.getDeferredCount(signal);
+            peakBytes = std::max(peakBytes, telemetryAggregator.getSentBytes(signal) / durationSeconds);
+        }
+        printf("telemetry summaries  : %u frames covering %u samples (%.1f per frame), %u inconsistent; "
+               "busiest signal %.0f B/s (budgets steer %u, drive %u B/s), %u windows held by a budget\n",
+               rig.summaryFrames, rig.summarySamples,
+               rig.summaryFrames ? (double)rig.summarySamples / rig.summaryFrames : 0.0, rig.summaryInconsistent,
+               peakBytes, telemetryAggregator.getSignalConfig(TELEMETRY_SIGNAL_STEER_ANGLE).budgetBytes,
+               telemetryAggregator.getSignalConfig(TELEMETRY_SIGNAL_DRIVE_VEL).budgetBytes, held);
+    }
+    printf("diagnostics          : %u requests, %u response frames, %u IDs counted\n",
+           rig.diagnosticRequests, rig.diagnosticResponses, diagnostics.getIdCount());
+    bool configOk = true;
+    if (!settings.empty()) {
+        // A fresh table loaded from the saved image must match the live one
+        ParamRegistry reloaded;
+        bool matches = reloaded.load() == CONFIG_STATUS_OK;
+        for (uint8_t index = 0; index < HAT_PARAM_COUNT && matches; index++) {
+            matches = reloaded.getStaged(index) == paramRegistry.getStaged(index);
+        }
+        configOk = matches && rig.configRefused == 0 && rig.configResponses == rig.configRequests;
+        printf("parameters           : %u requests, %u responses (%u refused), %u applied, "
+               "%u EEPROM bytes written, saved image %s\n",
+               rig.configRequests, rig.configResponses, rig.configRefused, paramRegistry.getApplyCount(),
+               EEPROM.bytesWritten(), matches ? "reloads" : "does not reload");
+    }
+    printf("bus utilisation      : jetson %.1f%%, peripheral %.1f%% (last %u ms window)\n",
+           diagnostics.getUtilisationPermille(DIAG_BUS_JETSON) / 10.0,
+           diagnostics.getUtilisationPermille(DIAG_BUS_PERIPH) / 10.0, HAT_DIAG_WINDOW_MS);
+    printf("isr cycles max       : jetson rx %u, mcp2517fd %u (host clock, %u MHz)\n",
+           diagnostics.getIsrMaxCycles(DIAG_ISR_JETSON_RX), diagnostics.getIsrMaxCycles(DIAG_ISR_PERIPH),
+           (unsigned)(F_CPU_ACTUAL / 1000000));
+    printf("tx failures          : jetson %u, peripheral %u\n",
+           diagnostics.getTxFailures(DIAG_BUS_JETSON), diagnostics.getTxFailures(DIAG_BUS_PERIPH));
+    static const char* const BUS_STATES[BUS_STATE_COUNT] = { "active", "warning", "passive", "bus-off", "offline" };
+    static const uint8_t HEALTH_BUSES[] = { DIAG_BUS_JETSON, DIAG_BUS_PERIPH };
+    bool busesUp = true;
+    printf("bus health           :");
+    for (uint8_t i = 0; i < sizeof(HEALTH_BUSES); i++) {
+        const uint8_t bus = HEALTH_BUSES[i];
+        busesUp = busesUp && busSupervisor.getState(bus) < BUS_STATE_BUS_OFF;
+        printf("%s %s %s, %u down (%u recoveries, %u reinit, %u failed), down %u ms (longest %u), "
+               "degraded %u ms, %u frames lost",
+               i ? ";" : "", bus == DIAG_BUS_JETSON ? "jetson" : "peripheral", BUS_STATES[busSupervisor.getState(bus)],
+               busSupervisor.getBusOffCount(bus), busSupervisor.getRecoveryCount(bus),
+               busSupervisor.getReinitCount(bus), busSupervisor.getRecoveryFailures(bus),
+               busSupervisor.getDownMillis(bus), busSupervisor.getLongestDownMillis(bus),
+               busSupervisor.getDegradedMillis(bus), busSupervisor.getFramesLost(bus));
+    }
+    printf(" (%u fault events)\n", rig.faultEvents);
+    printf("queue peaks          : periph rx %u, periph tx %u, jetson rx %u, jetson tx %u\n",
+           diagnostics.getQueuePeak(DIAG_QUEUE_PERIPH_RX), diagnostics.getQueuePeak(DIAG_QUEUE_PERIPH_TX),
+           diagnostics.getQueuePeak(DIAG_QUEUE_JETSON_RX), diagnostics.getQueuePeak(DIAG_QUEUE_JETSON_TX));
+    printf("setpoint age at use  :");
+    for (uint8_t wheel = 0; wheel < DRIVE_WHEEL_COUNT; wheel++) {
+        printf("%s wheel %u mean %u us max %u us, %u stale", wheel ? ";" : "", wheel,
+               diagnostics.getSetpointMeanAge(wheel), diagnostics.getSetpointMaxAge(wheel),
+               diagnostics.getSetpointStaleEvents(wheel));
+    }
+    printf(" (after %u ms)\n", componentController.getSetpointTuning().staleMs);
+    bool estopOk = true;
+    if (rig.estopArrivalMicros != UINT64_MAX && controller != nullptr) {
+        // Worst case: the longest frame the bridge sends is already on the
+        // wire, then one Estop per node from the TXQ
+        PackedSetpoint_t entries[PACKED_SETPOINT_MAX_ENTRIES] = {};
+        const uint64_t longest = controller->frameWireMicros(buildPackedSetpointMsg(entries, PACKED_SETPOINT_MAX_ENTRIES));
+        const uint64_t bound = maxEstopMicros != 0
+            ? maxEstopMicros
+            : longest + ComponentController::frameCount * controller->frameWireMicros(buildEstopMsg(NODE_DRIVE_FL));
+        // Held until the end, or released by the RESET and driving again
+        const bool released = rig.resetArrivalMicros != UINT64_MAX;
+        const bool heldOk = released
+            ? !componentController.isEmergencyStopped() && rig.framesAfterReset > 0
+            : stateMachine.getCurrentState() == STATE_EMERGENCY_STOP;
+        // Frames finished since the firmware last looked are reported now
+        controller->pendingTransmitCount();
+        estopOk = rig.estopFrames >= ComponentController::frameCount &&
+                  rig.estopFramesSent >= ComponentController::frameCount && rig.framesAfterStop == 0 &&
+                  rig.staleFramesOnWire == 0 && rig.estopMaxDoneMicros <= bound && heldOk;
+        printf("emergency stop       : %u estop frames (%u failed, %u sent), enqueued within %llu us, on the wire "
+               "within %llu us (bound %llu us), %u zero velocity, %u other frames after the stop, "
+               "%u dropped from the transmit FIFO, %u sent after zero velocity",
+               rig.estopFrames, componentController.getEstopFramesFailed(), rig.estopFramesSent,
+               (unsigned long long)rig.estopMaxEnqueueMicros, (unsigned long long)rig.estopMaxDoneMicros,
+               (unsigned long long)bound, rig.zeroVelocityFrames, rig.framesAfterStop,
+               controller->getAbortedCount(), rig.staleFramesOnWire);
+        if (released) {
+            printf("; reset %.3f ms later, %s, %u frames after it",
+                   (rig.resetArrivalMicros - rig.estopArrivalMicros) / 1000.0,
+                   componentController.isEmergencyStopped() ? "still latched" : "released", rig.framesAfterReset);
+        }
+        printf("\n");
+    }
+    // Steering holds on disarm; it may only finish the move already commanded
+    bool disarmOk = true;
+    if (disarmAtSeconds >= 0.0) {
+        disarmOk = rig.disarmArrivalMicros != UINT64_MAX && rig.maxSteerMoveAfterDisarm <= 1e-6f;
+        printf("disarm               : %s, %u steering frames after it, moved at most %.6f rad past the last setpoint\n",
+               rig.disarmArrivalMicros != UINT64_MAX ? "accepted" : "not accepted", rig.steerFramesAfterDisarm,
+               rig.maxSteerMoveAfterDisarm);
+    }
+    static const char* const BOOT_PHASES[DIAG_BOOT_PHASE_COUNT] = {
+        "setup", "serial", "jetson up", "periph up", "scheduled", "first command", "first forward"
+    };
+    printf("boot timeline        :");
+    for (uint8_t phase = 0; phase < DIAG_BOOT_PHASE_COUNT; phase++) {
+        const uint32_t at = diagnostics.getBootMicros(phase);
+        if (at != 0) {
+            printf("%s %s %.3f ms", phase ? "," : "", BOOT_PHASES[phase], at / 1000.0);
+        } else {
+            printf("%s %s -", phase ? "," : "", BOOT_PHASES[phase]);
+        }
+    }
+    const uint32_t firstForward = diagnostics.getBootMicros(DIAG_BOOT_FIRST_FORWARD);
+    printf(" (%s traffic, %s boot)\n", brownout ? "brown-out" : "post-boot",
+           HAT_FAST_BOOT ? "fast" : "serial wait");
+    printf("state machine        : %s, %u transitions, %u events rejected\n",
+           stateMachine.getCurrentStateName(), stateMachine.getTransitionCount(),
+           stateMachine.getRejectedEvents());
+    printf("control loop         : %u iterations, %.0f ns host time each (%.0f loops/s host)\n",
+           rig.loopIterations, hostNanosPerLoop, hostNanosPerLoop > 0 ? 1e9 / hostNanosPerLoop : 0.0);
+    printf("setpoint store       : %u publishes, %u snapshots, %u torn reads\n",
+           driveSetpoints.getPublishCount(), driveSetpoints.getSnapshotCount(),
+           driveSetpoints.getTornReadCount());
+    for (uint8_t i = 0; i < scheduler.getTaskCount(); i++) {
+        const TaskStats_t& stats = scheduler.getStats(i);
+        printf("task %-15s: %u runs, period %u us, interval %u-%u us, late max %u us mean %.1f us, "
+               "exec max %u us, %u overruns\n",
+               scheduler.getTaskName(i), stats.runs, scheduler.getPeriod(i),
+               stats.runs > 1 ? stats.minIntervalMicros : 0, stats.maxIntervalMicros,
+               stats.maxLatenessMicros, stats.runs ? (double)stats.totalLatenessMicros / stats.runs : 0.0,
+               stats.maxExecMicros, stats.overruns);
+    }
+
+    if (maxP99Micros != 0 && latency.p99 > maxP99Micros) {
+        printf("FAIL: p99 latency %llu us exceeds bound %llu us\n",
+               (unsigned long long)latency.p99, (unsigned long long)maxP99Micros);
+        return 1;
+    }
+    if (maxBootMillis > 0.0 && (firstForward == 0 || firstForward / 1000.0 > maxBootMillis)) {
+        printf("FAIL: first setpoint forwarded %.3f ms after reset, bound %.3f ms\n",
+               firstForward / 1000.0, maxBootMillis);
+        return 1;
+    }
+    if (!estopOk) {
+        printf("FAIL: emergency stop did not reach every node within the bound, left setpoints in the "
+               "transmit FIFO, or was not %s\n",
+               rig.resetArrivalMicros != UINT64_MAX ? "released by the reset" : "held");
+        return 1;
+    }
+    if (!disarmOk) {
+        printf("FAIL: steering moved after the disarm, or the disarm was not accepted\n");
+        return 1;
+    }
+    if (rig.faultEvents > 0 && !busesUp) {
+        printf("FAIL: a bus was still down at the end of the run\n");
+        return 1;
+    }
+    if (!configOk) {
+        printf("FAIL: parameter changes were refused or the saved image does not reload\n");
+        return 1;
+    }
+    return 0;
+}
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,733 @@
+/**
+ * @file bridge_rig.cpp
+ * @brief Host-side test rig that runs the bridge firmware against simulated buses
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "bridge_rig.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include "hardware_map.h"
+#include "message_construction.h"
+
+// Sketch entry points, compiled in by bridge_sketch.cpp
+void setup();
+void loop();
+
+BridgeRig* BridgeRig::active = nullptr;
+
+LatencySummary_t summarizeLatency(std::vector<uint64_t> samples) {
+    LatencySummary_t summary = { 0, 0, 0, 0, 0.0 };
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    summary.count = (uint32_t)samples.size();
+    summary.p50 = samples[(samples.size() - 1) / 2];
+    summary.p99 = samples[(samples.size() - 1) * 99 / 100];
+    summary.max = samples.back();
+    double total = 0.0;
+    for (uint64_t s : samples) {
+        total += (double)s;
+    }
+    summary.mean = total / (double)samples.size();
+    return summary;
+}
+
+// --- DriveTrafficSource ---
+
+// Compact angle field: 8 LSB (0.8 mrad) per frame, up to 32767
+#define RIG_COMPACT_RAMP_FRAMES 4095
+
+DriveTrafficSource::DriveTrafficSource(double perWheelHz, uint64_t startMicros, uint64_t durationMicros,
+                                       bool steady, bool compact)
+    : periodMicros(1000000.0 / perWheelHz), start(startMicros), end(startMicros + durationMicros), index(0),
+      steady(steady), compact(compact) {
+}
+
+uint64_t DriveTrafficSource::nextArrivalMicros() {
+    // Four wheels (or the compact frames) evenly staggered inside each period
+    const uint64_t frames = compact ? HatProfile::compactFrameCount : 4;
+    const uint64_t period = index / frames;
+    const uint64_t slot = index % frames;
+    const uint64_t t = start + (uint64_t)(periodMicros * ((double)period + (double)slot / (double)frames));
+    return t < end ? t : UINT64_MAX;
+}
+
+void DriveTrafficSource::next(CAN_message_t& msg) {
+    if (compact) {
+        // Both wheels carry the same values. Each step is above the setpoint
+        // epsilons; the ramp tops out after RIG_COMPACT_RAMP_FRAMES frames
+        // and then holds, as a 16-bit field has nowhere further to go.
+        const uint8_t frame = (uint8_t)(index % HatProfile::compactFrameCount);
+        const uint64_t step = steady ? 12 : std::min<uint64_t>(index + 1, RIG_COMPACT_RAMP_FRAMES);
+        const DrivePayload_t wheel = { decodeCompactField((int16_t)(step * 8), DRIVE_COMPACT_ANGLE_SCALE),
+                                       decodeCompactField((int16_t)step, DRIVE_COMPACT_VEL_SCALE) };
+        const DrivePayload_t wheels[DRIVE_COMPACT_WHEELS_PER_FRAME] = { wheel, wheel };
+        msg = CAN_message_t();
+        msg.id = HatProfile::compactCommandIds[frame];
+        msg.len = encodeCompactDrivePayload(wheels, DRIVE_COMPACT_WHEELS_PER_FRAME, msg.buf);
+        index++;
+        return;
+    }
+
+    const uint8_t wheel = (uint8_t)(index % 4);
+    const float value = steady ? 1.0f : (float)(index + 1);
+
+    msg = CAN_message_t();
+    msg.id = PRIORITY_DRIVE | (MESSAGE_DRIVE_FRONT_LEFT + wheel);
+    msg.len = 8;
+    floatToBytes(value, msg.buf);      // theta
+    floatToBytes(value, msg.buf + 4);  // omega
+    index++;
+}
+
+// --- BackgroundTrafficSource ---
+
+#define RIG_HANDLED_ID(name, id, handler, arg, mailbox) (uint32_t)(id),
+static const uint32_t RIG_HANDLED_IDS[] = { JETSON_STD_MESSAGES(RIG_HANDLED_ID) };
+#undef RIG_HANDLED_ID
+
+BackgroundTrafficSource::BackgroundTrafficSource(double hz, uint64_t startMicros, uint64_t durationMicros,
+                                                 uint32_t seed)
+    : periodMicros(hz > 0.0 ? 1000000.0 / hz : 0.0), start(startMicros), end(startMicros + durationMicros),
+      index(0), state(seed ? seed : 1) {
+}
+
+uint64_t BackgroundTrafficSource::nextArrivalMicros() {
+    if (periodMicros <= 0.0) {
+        return UINT64_MAX;
+    }
+    const uint64_t t = start + (uint64_t)(periodMicros * (double)index);
+    return t < end ? t : UINT64_MAX;
+}
+
+void BackgroundTrafficSource::next(CAN_message_t& msg) {
+    msg = CAN_message_t();
+    bool handled = true;
+    while (handled) {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        msg.id = state & 0x7FF;
+        handled = false;
+        for (uint32_t id : RIG_HANDLED_IDS) {
+            handled = handled || msg.id == id;
+        }
+    }
+    msg.len = 8;
+    memcpy(msg.buf, &state, sizeof(state));
+    index++;
+}
+
+// --- DiagnosticPollSource ---
+
+DiagnosticPollSource::DiagnosticPollSource(double hz, uint64_t startMicros, uint64_t durationMicros)
+    : periodMicros(hz > 0.0 ? 1000000.0 / hz : 0.0), start(startMicros), end(startMicros + durationMicros),
+      index(0) {
+}
+
+uint64_t DiagnosticPollSource::nextArrivalMicros() {
+    if (periodMicros <= 0.0) {
+        return UINT64_MAX;
+    }
+    const uint64_t t = start + (uint64_t)(periodMicros * (double)index);
+    return t < end ? t : UINT64_MAX;
+}
+
+void DiagnosticPollSource::next(CAN_message_t& msg) {
+    msg = CAN_message_t();
+    msg.id = encodeHatId(CAN_PRIORITY_TEMPLATE, RIG_JETSON_NODE, HAT_NODE_ID, MSG_TYPE_DIAGNOSTIC_REQ);
+    msg.flags.extended = 1;
+    msg.len = 3;
+    msg.buf[0] = (uint8_t)(index % (DIAG_PAGE_QUEUE + 1));   // page
+    msg.buf[1] = 0;                                        // first record
+    msg.buf[2] = 0;                                        // as many as allowed
+    index++;
+}
+
+// --- EmergencyStopSource ---
+
+EmergencyStopSource::EmergencyStopSource(uint64_t atMicros) : at(atMicros), sent(false) {
+}
+
+uint64_t EmergencyStopSource::nextArrivalMicros() {
+    return sent ? UINT64_MAX : at;
+}
+
+void EmergencyStopSource::next(CAN_message_t& msg) {
+    msg = CAN_message_t();
+    msg.id = MSG_TYPE_EMERGENCY_STOP;
+    msg.len = 8;
+    sent = true;
+}
+
+// --- StateRequestSource ---
+
+StateRequestSource::StateRequestSource(uint64_t atMicros, uint8_t type) : at(atMicros), type(type), sent(false) {
+}
+
+uint64_t StateRequestSource::nextArrivalMicros() {
+    return sent ? UINT64_MAX : at;
+}
+
+void StateRequestSource::next(CAN_message_t& msg) {
+    msg = CAN_message_t();
+    msg.flags.extended = 1;
+    msg.id = encodeHatId(CAN_PRIORITY_TEMPLATE, RIG_JETSON_NODE, HAT_NODE_ID, type);
+    msg.len = 0;
+    sent = true;
+}
+
+// --- ConfigRequestSource ---
+
+ConfigRequestSource::ConfigRequestSource(uint64_t startMicros, uint64_t periodMicros)
+    : start(startMicros), period(periodMicros), index(0) {
+}
+
+void ConfigRequestSource::add(uint8_t id, uint32_t raw) {
+    settings.push_back({id, raw});
+}
+
+uint64_t ConfigRequestSource::nextArrivalMicros() {
+    // Every SET, then the SAVE
+    if (settings.empty() || index > settings.size()) {
+        return UINT64_MAX;
+    }
+    return start + period * index;
+}
+
+void ConfigRequestSource::next(CAN_message_t& msg) {
+    msg = CAN_message_t();
+    msg.flags.extended = 1;
+    if (index < settings.size()) {
+        msg.id = encodeHatId(CAN_PRIORITY_TEMPLATE, RIG_JETSON_NODE, HAT_NODE_ID, MSG_TYPE_CONFIG_SET);
+        msg.len = 5;
+        msg.buf[0] = settings[index].id;
+        memcpy(msg.buf + 1, &settings[index].raw, sizeof(uint32_t));
+    } else {
+        msg.id = encodeHatId(CAN_PRIORITY_TEMPLATE, RIG_JETSON_NODE, HAT_NODE_ID, MSG_TYPE_CONFIG_SAVE);
+        msg.len = 0;
+    }
+    index++;
+}
+
+// --- ArmRequestSource ---
+
+ArmRequestSource::ArmRequestSource(const HATStateMachine& hat, uint64_t startMicros, uint64_t periodMicros,
+                                   uint64_t retryMicros)
+    : hat(hat), answered(nullptr), answersNeeded(0), attempt(startMicros), stop(UINT64_MAX), period(periodMicros),
+      retry(retryMicros), armNext(false) {
+}
+
+void ArmRequestSource::waitFor(const uint32_t& answeredCount, uint32_t count) {
+    answered = &answeredCount;
+    answersNeeded = count;
+}
+
+void ArmRequestSource::stopAt(uint64_t atMicros) {
+    stop = atMicros;
+}
+
+uint64_t ArmRequestSource::nextArrivalMicros() {
+    if (armNext) {
+        return attempt + period;
+    }
+    if (answered != nullptr && *answered < answersNeeded) {
+        return UINT64_MAX;
+    }
+    const HAT_State_t state = hat.getCurrentState();
+    if (state != STATE_DISARMED && state != STATE_LOCKED && state != STATE_UNLOCKED) {
+        return UINT64_MAX;
+    }
+    // Armed a while, then dropped back (e.g. timed out): try again from now
+    if (attempt < sim::nowMicros()) {
+        attempt = sim::nowMicros();
+    }
+    return attempt < stop ? attempt : UINT64_MAX;
+}
+
+void ArmRequestSource::next(CAN_message_t& msg) {
+    msg = CAN_message_t();
+    msg.flags.extended = 1;
+    msg.id = encodeHatId(CAN_PRIORITY_TEMPLATE, RIG_JETSON_NODE, HAT_NODE_ID,
+                         armNext ? MSG_TYPE_STATE_ARM : MSG_TYPE_STATE_UNLOCK);
+    msg.len = 0;
+    if (armNext) {
+        attempt += retry;
+    }
+    armNext = !armNext;
+}
+
+// --- MergedFrameSource ---
+
+MergedFrameSource::MergedFrameSource(JetsonFrameSource& first, JetsonFrameSource& second)
+    : first(first), second(second) {
+}
+
+uint64_t MergedFrameSource::nextArrivalMicros() {
+    const uint64_t a = first.nextArrivalMicros();
+    const uint64_t b = second.nextArrivalMicros();
+    return a <= b ? a : b;
+}
+
+void MergedFrameSource::next(CAN_message_t& msg) {
+    if (first.nextArrivalMicros() <= second.nextArrivalMicros()) {
+        first.next(msg);
+    } else {
+        second.next(msg);
+    }
+}
+
+// --- BridgeRig ---
+
+BridgeRig::BridgeRig()
+    : injectedFrames(0), acceptedFrames(0), forwardedFrames(0),
+      supersededSetpoints(0), loopIterations(0), hostLoopNanos(0), peripheralWireMicros(0),
+      maxVelocityStep(0.0f), maxPositionStep(0.0f),
+      feedbackInjected(0), feedbackAccepted(0), telemetryFrames(0), telemetryBursts(0),
+      telemetryMismatched(0), maxBurstSpreadMicros(0), summaryFrames(0), summarySamples(0),
+      summaryInconsistent(0), diagnosticRequests(0), diagnosticResponses(0),
+      configRequests(0), configResponses(0), configRefused(0),
+      estopArrivalMicros(UINT64_MAX), estopFrames(0), estopMaxEnqueueMicros(0), estopFramesSent(0),
+      estopMaxDoneMicros(0),
+      zeroVelocityFrames(0), zeroVelocityMicros(UINT64_MAX), framesAfterStop(0), staleFramesOnWire(0), resetArrivalMicros(UINT64_MAX), framesAfterReset(0),
+      disarmArrivalMicros(UINT64_MAX), steerFramesAfterDisarm(0), maxSteerMoveAfterDisarm(0.0f), faultEvents(0),
+      onForward(nullptr), activeSource(nullptr), faultNext(0), feedbackPeriodMicros(0.0), feedbackStart(0),
+      feedbackIndex(0), commandedVelocity(), commandedPosition(), reportedVelocity(),
+      reportedPosition(), injectedPosition(), disarmLow(), disarmHigh(), burstNext(0), burstStartMicros(0) {
+    active = this;
+    ACAN2517FD::txHook = forwardHook;
+    ACAN2517FD::wireHook = wireHook;
+    FlexCANSimBus::txHook = jetsonTxHook;
+    setODriveFeedbackRate(100.0);
+}
+
+BridgeRig::~BridgeRig() {
+    if (active == this) {
+        active = nullptr;
+        ACAN2517FD::txHook = nullptr;
+        ACAN2517FD::wireHook = nullptr;
+        FlexCANSimBus::txHook = nullptr;
+        sim::setInterruptSource(nullptr);
+    }
+}
+
+void BridgeRig::boot(JetsonFrameSource* source) {
+    if (source != nullptr) {
+        attach(*source);
+    }
+    setup();
+}
+
+void BridgeRig::attach(JetsonFrameSource& source) {
+    activeSource = &source;
+    feedbackStart = sim::nowMicros();
+    feedbackIndex = 0;
+    sim::setInterruptSource(this);
+}
+
+void BridgeRig::setODriveFeedbackRate(double hz) {
+    feedbackPeriodMicros = hz > 0.0 ? 1000000.0 / hz : 0.0;
+}
+
+void BridgeRig::run(JetsonFrameSource& source, uint64_t endMicros, uint32_t loopCostMicros) {
+    if (activeSource != &source) {
+        attach(source);
+    }
+
+    while (sim::nowMicros() < endMicros) {
+        const auto t0 = std::chrono::steady_clock::now();
+        loop();
+        const auto t1 = std::chrono::steady_clock::now();
+        hostLoopNanos += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        loopIterations++;
+
+        // Frames arriving between iterations are delivered inside this step
+        sim::advanceMicros(loopCostMicros);
+    }
+
+    sim::setInterruptSource(nullptr);
+    activeSource = nullptr;
+}
+
+uint64_t BridgeRig::nextFeedbackMicros() const {
+    if (activeSource == nullptr || feedbackPeriodMicros <= 0.0) {
+        return UINT64_MAX;
+    }
+    // Eight nodes evenly staggered inside each period
+    const uint64_t period = feedbackIndex / 8;
+    const uint64_t slot = feedbackIndex % 8;
+    return feedbackStart + (uint64_t)(feedbackPeriodMicros * ((double)period + (double)slot / 8.0));
+}
+
+void BridgeRig::scheduleJetsonFault(uint64_t atMicros, uint64_t durationMicros) {
+    scheduleFault(atMicros, FAULT_JETSON_ON);
+    scheduleFault(atMicros + durationMicros, FAULT_JETSON_OFF);
+}
+
+void BridgeRig::schedulePeripheralFault(uint64_t atMicros, uint64_t durationMicros) {
+    scheduleFault(atMicros, FAULT_PERIPH_ON);
+    scheduleFault(atMicros + durationMicros, FAULT_PERIPH_OFF);
+}
+
+void BridgeRig::schedulePeripheralReset(uint64_t atMicros) {
+    scheduleFault(atMicros, FAULT_PERIPH_RESET);
+}
+
+void BridgeRig::scheduleFault(uint64_t atMicros, FaultAction action) {
+    const FaultEvent event = { atMicros, action };
+    faults.insert(std::upper_bound(faults.begin() + faultNext, faults.end(), event,
+                                   [](const FaultEvent& a, const FaultEvent& b) { return a.atMicros < b.atMicros; }),
+                  event);
+}
+
+void BridgeRig::applyFault(FaultAction action) {
+    FlexCANSimBus* jetson = FlexCANSimBus::find(CAN3);
+    ACAN2517FD* controller = ACAN2517FD::instance();
+    faultEvents++;
+    switch (action) {
+        case FAULT_JETSON_ON:
+        case FAULT_JETSON_OFF:
+            if (jetson != nullptr) {
+                jetson->setBusFault(action == FAULT_JETSON_ON);
+            }
+            break;
+        case FAULT_PERIPH_ON:
+        case FAULT_PERIPH_OFF:
+            if (controller != nullptr) {
+                controller->setBusFault(action == FAULT_PERIPH_ON);
+            }
+            break;
+        case FAULT_PERIPH_RESET:
+            if (controller != nullptr) {
+                controller->resetChip();
+            }
+            break;
+    }
+}
+
+uint64_t BridgeRig::nextEventMicros() {
+    const uint64_t jetson = activeSource != nullptr ? activeSource->nextArrivalMicros() : UINT64_MAX;
+    const uint64_t feedback = nextFeedbackMicros();
+    const uint64_t fault = faultNext < faults.size() ? faults[faultNext].atMicros : UINT64_MAX;
+    return std::min(std::min(jetson, feedback), fault);
+}
+
+void BridgeRig::injectFeedback() {
+    const uint8_t slot = (uint8_t)(feedbackIndex % 8);
+    const uint8_t wheel = slot % 4;
+    feedbackIndex++;
+
+    // Perfect tracking: each ODrive reports exactly what it was last told
+    CANFDMessage msg;
+    if (slot < 4) {
+        reportedVelocity[wheel][1] = reportedVelocity[wheel][0];
+        reportedVelocity[wheel][0] = commandedVelocity[wheel];
+        msg = buildEncoderEstimatesMsg(HatProfile::wheels[wheel].driveNode, 0.0f, commandedVelocity[wheel]);
+    } else {
+        reportedPosition[wheel][1] = reportedPosition[wheel][0];
+        reportedPosition[wheel][0] = commandedPosition[wheel];
+        msg = buildEncoderEstimatesMsg(HatProfile::wheels[wheel].steerNode, commandedPosition[wheel], 0.0f);
+    }
+
+    feedbackInjected++;
+    ACAN2517FD* controller = ACAN2517FD::instance();
+    if (controller != nullptr && controller->injectReceive(msg)) {
+        feedbackAccepted++;
+    }
+}
+
+void BridgeRig::fire(uint64_t nowMicros) {
+    if (faultNext < faults.size() && faults[faultNext].atMicros <= nowMicros) {
+        applyFault(faults[faultNext++].action);
+        return;
+    }
+    if (nextFeedbackMicros() <= nowMicros) {
+        injectFeedback();
+        return;
+    }
+
+    CAN_message_t msg;
+    activeSource->next(msg);
+    injectedFrames++;
+
+    // The stop is acted on inside deliver(), so its arrival is noted first
+    if (!msg.flags.extended && msg.id == MSG_TYPE_EMERGENCY_STOP && estopArrivalMicros == UINT64_MAX) {
+        estopArrivalMicros = nowMicros;
+    }
+
+    FlexCANSimBus* bus = FlexCANSimBus::find(CAN3);
+    if (bus != nullptr && bus->deliver(msg)) {
+        acceptedFrames++;
+        if (msg.flags.extended && hatIdType(msg.id) == MSG_TYPE_STATE_RESET &&
+            estopArrivalMicros != UINT64_MAX && resetArrivalMicros == UINT64_MAX) {
+            resetArrivalMicros = nowMicros;
+        }
+        if (msg.flags.extended && hatIdType(msg.id) == MSG_TYPE_STATE_DISARM && disarmArrivalMicros == UINT64_MAX) {
+            // Steering may still finish the move to the last setpoint it
+            // took, but no further
+            disarmArrivalMicros = nowMicros;
+            for (uint8_t wheel = 0; wheel < 4; wheel++) {
+                disarmLow[wheel] = std::min(commandedPosition[wheel], injectedPosition[wheel]);
+                disarmHigh[wheel] = std::max(commandedPosition[wheel], injectedPosition[wheel]);
+            }
+        }
+        trackInjected(msg, nowMicros);
+    }
+}
+
+void BridgeRig::trackInjected(const CAN_message_t& msg, uint64_t nowMicros) {
+    if (msg.flags.extended && hatIdType(msg.id) == MSG_TYPE_DIAGNOSTIC_REQ) {
+        diagnosticRequests++;
+    }
+    if (msg.flags.extended && hatIdType(msg.id) >= MSG_TYPE_CONFIG_SET && hatIdType(msg.id) <= MSG_TYPE_CONFIG_LOAD) {
+        configRequests++;
+    }
+
+    if (msg.flags.extended) {
+        return;
+    }
+    for (uint8_t frame = 0; frame < HatProfile::compactFrameCount; frame++) {
+        if (msg.id == HatProfile::compactCommandIds[frame]) {
+            DrivePayload_t payload[DRIVE_COMPACT_WHEELS_PER_FRAME];
+            const uint8_t count = decodeCompactDrivePayload(msg.buf, msg.len, payload);
+            for (uint8_t i = 0; i < count; i++) {
+                trackCommand((uint8_t)(frame * DRIVE_COMPACT_WHEELS_PER_FRAME + i), payload[i], nowMicros);
+            }
+            return;
+        }
+    }
+
+    const uint32_t first = PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_LEFT;
+    if (msg.id < first || msg.id > first + 3) {
+        return;
+    }
+    trackCommand((uint8_t)(msg.id - first), decodeDrivePayload(msg.buf), nowMicros);
+}
+
+void BridgeRig::trackCommand(uint8_t wheel, const DrivePayload_t& payload, uint64_t nowMicros) {
+    if (wheel >= 4) {
+        return;
+    }
+    pendingVelocity[wheel].push_back({ payload.angular_vel, nowMicros });
+    pendingPosition[wheel].push_back({ payload.steering_angle, nowMicros });
+    if (disarmArrivalMicros == UINT64_MAX) {
+        injectedPosition[wheel] = payload.steering_angle;
+    }
+}
+
+void BridgeRig::match(std::deque<Pending>& pending, float value, uint64_t enqueueMicros) {
+    // Older setpoints overwritten before they reached the output never will
+    while (!pending.empty() && pending.front().value < value) {
+        pending.pop_front();
+        supersededSetpoints++;
+    }
+    if (!pending.empty() && pending.front().value == value) {
+        latencyMicros.push_back(enqueueMicros - pending.front().arrivalMicros);
+        pending.pop_front();
+    }
+}
+
+void BridgeRig::trackForwarded(const CANFDMessage& msg, uint64_t enqueueMicros) {
+    forwardedFrames++;
+    if (ACAN2517FD::instance() != nullptr) {
+        peripheralWireMicros += ACAN2517FD::instance()->frameWireMicros(msg);
+    }
+    if (onForward != nullptr) {
+        onForward(msg, enqueueMicros);
+    }
+    if (estopArrivalMicros != UINT64_MAX && resetArrivalMicros == UINT64_MAX) {
+        trackAfterStop(msg, enqueueMicros);
+        return;
+    }
+    if (resetArrivalMicros != UINT64_MAX) {
+        framesAfterReset++;
+    }
+    if (msg.ext || msg.len < 4) {
+        return;
+    }
+
+    const uint8_t node = (uint8_t)(msg.id & 0x1F);
+    const uint8_t cmd = (uint8_t)(msg.id >> 5);
+    float value = 0.0f;
+    memcpy(&value, msg.data, sizeof(float));
+
+    for (uint8_t wheel = 0; wheel < 4; wheel++) {
+        if (cmd == ODRIVE_CMD_SET_INPUT_VEL && node == HatProfile::wheels[wheel].driveNode) {
+            maxVelocityStep = std::max(maxVelocityStep, fabsf(value - commandedVelocity[wheel]));
+            commandedVelocity[wheel] = value;
+            match(pendingVelocity[wheel], value, enqueueMicros);
+        } else if (cmd == ODRIVE_CMD_SET_INPUT_POS && node == HatProfile::wheels[wheel].steerNode) {
+            maxPositionStep = std::max(maxPositionStep, fabsf(value - commandedPosition[wheel]));
+            commandedPosition[wheel] = value;
+            if (disarmArrivalMicros != UINT64_MAX) {
+                trackAfterDisarm(wheel, value);
+            }
+            match(pendingPosition[wheel], value, enqueueMicros);
+        }
+    }
+}
+
+void BridgeRig::trackAfterStop(const CANFDMessage& msg, uint64_t enqueueMicros) {
+    const uint8_t cmd = (uint8_t)(msg.id >> 5);
+    float value = 0.0f;
+    memcpy(&value, msg.data, sizeof(float));
+
+    if (!msg.ext && cmd == ODRIVE_CMD_ESTOP) {
+        estopFrames++;
+        estopMaxEnqueueMicros = std::max(estopMaxEnqueueMicros, enqueueMicros - estopArrivalMicros);
+    } else if (!msg.ext && cmd == ODRIVE_CMD_SET_INPUT_VEL && value == 0.0f) {
+        zeroVelocityFrames++;
+        zeroVelocityMicros = std::min(zeroVelocityMicros, enqueueMicros);
+    } else {
+        framesAfterStop++;
+    }
+}
+
+void BridgeRig::trackAfterDisarm(uint8_t wheel, float position) {
+    steerFramesAfterDisarm++;
+    const float outside = std::max(disarmLow[wheel] - position, position - disarmHigh[wheel]);
+    maxSteerMoveAfterDisarm = std::max(maxSteerMoveAfterDisarm, outside);
+}
+
+// What a value reads back as after the compact encoding
+static float compactRoundTrip(float value, float scale) {
+    return decodeCompactField(encodeCompactField(value, scale), scale);
+}
+
+void BridgeRig::trackTelemetry(const CAN_message_t& msg) {
+    if (msg.flags.extended) {
+        return;
+    }
+    for (uint8_t frame = 0; frame < HatProfile::compactFrameCount; frame++) {
+        if (msg.id == HatProfile::compactEncoderIds[frame]) {
+            telemetryFrames++;
+            DrivePayload_t payload[DRIVE_COMPACT_WHEELS_PER_FRAME];
+            const uint8_t count = decodeCompactDrivePayload(msg.buf, msg.len, payload);
+            for (uint8_t i = 0; i < count; i++) {
+                trackTelemetryWheel((uint8_t)(frame * DRIVE_COMPACT_WHEELS_PER_FRAME + i), payload[i], true);
+            }
+            return;
+        }
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        if (msg.id == HatProfile::wheels[i].encoderId) {
+            telemetryFrames++;
+            trackTelemetryWheel(i, decodeDrivePayload(msg.buf), false);
+            return;
+        }
+    }
+}
+
+void BridgeRig::trackTelemetryWheel(uint8_t wheel, const DrivePayload_t& payload, bool compact) {
+    // A report may land between the firmware's drain and its snapshot, so
+    // the previous report is accepted too
+    float velocity[2] = { reportedVelocity[wheel][0], reportedVelocity[wheel][1] };
+    float position[2] = { reportedPosition[wheel][0], reportedPosition[wheel][1] };
+    if (compact) {
+        for (uint8_t i = 0; i < 2; i++) {
+            velocity[i] = compactRoundTrip(velocity[i], DRIVE_COMPACT_VEL_SCALE);
+            position[i] = compactRoundTrip(position[i], DRIVE_COMPACT_ANGLE_SCALE);
+        }
+    }
+    const bool velocityOk = payload.angular_vel == velocity[0] || payload.angular_vel == velocity[1];
+    const bool positionOk = payload.steering_angle == position[0] || payload.steering_angle == position[1];
+    if (!velocityOk || !positionOk) {
+        telemetryMismatched++;
+    }
+
+    const uint64_t now = sim::nowMicros();
+    if (wheel == 0) {
+        burstStartMicros = now;
+        burstNext = 1;
+    } else if (wheel == burstNext) {
+        burstNext++;
+        if (burstNext == 4) {
+            telemetryBursts++;
+            if (now - burstStartMicros > maxBurstSpreadMicros) {
+                maxBurstSpreadMicros = now - burstStartMicros;
+            }
+            burstNext = 0;
+        }
+    } else {
+        burstNext = 0;
+    }
+}
+
+void BridgeRig::trackSummary(const CAN_message_t& msg) {
+    if (!msg.flags.extended || hatIdType(msg.id) != MSG_TYPE_TELEMETRY_SENSOR) {
+        return;
+    }
+    summaryFrames++;
+    TelemetrySummary_t summary;
+    if (!decodeTelemetrySummary(msg.buf, msg.len, summary) || summary.count == 0) {
+        summaryInconsistent++;
+        return;
+    }
+    summarySamples += summary.count;
+
+    // One LSB of rounding either way
+    const float lsb = telemetrySignalScale(summary.signal);
+    const bool hasRange = (summary.fields & (TELEMETRY_FIELD_MIN | TELEMETRY_FIELD_MAX)) ==
+                          (TELEMETRY_FIELD_MIN | TELEMETRY_FIELD_MAX);
+    if (hasRange && (summary.min > summary.max ||
+                     ((summary.fields & TELEMETRY_FIELD_MEAN) &&
+                      (summary.mean < summary.min - lsb || summary.mean > summary.max + lsb)))) {
+        summaryInconsistent++;
+    }
+}
+
+void BridgeRig::trackDiagnostics(const CAN_message_t& msg) {
+    if (msg.flags.extended && hatIdType(msg.id) == MSG_TYPE_DIAGNOSTIC_RESP &&
+        hatIdTarget(msg.id) == RIG_JETSON_NODE) {
+        diagnosticResponses++;
+    }
+}
+
+void BridgeRig::trackConfig(const CAN_message_t& msg) {
+    if (msg.flags.extended && hatIdType(msg.id) == MSG_TYPE_PARAM_RESPONSE &&
+        hatIdTarget(msg.id) == RIG_JETSON_NODE) {
+        configResponses++;
+        if (msg.len < 2 || msg.buf[1] != CONFIG_STATUS_OK) {
+            configRefused++;
+        }
+    }
+}
+
+void BridgeRig::jetsonTxHook(CAN_DEV_TABLE bus, const CAN_message_t& msg) {
+    if (active != nullptr && bus == CAN3) {
+        active->trackTelemetry(msg);
+        active->trackSummary(msg);
+        active->trackDiagnostics(msg);
+        active->trackConfig(msg);
+    }
+}
+
+void BridgeRig::forwardHook(const CANFDMessage& msg, uint64_t enqueueMicros) {
+    if (active != nullptr) {
+        active->trackForwarded(msg, enqueueMicros);
+    }
+}
+
+void BridgeRig::wireHook(const CANFDMessage& msg, uint64_t enqueueMicros, uint64_t startMicros, uint64_t doneMicros) {
+    if (active == nullptr || active->estopArrivalMicros == UINT64_MAX) {
+        return;
+    }
+    if (enqueueMicros >= active->estopArrivalMicros) {
+        if (!msg.ext && (uint8_t)(msg.id >> 5) == ODRIVE_CMD_ESTOP) {
+            active->estopFramesSent++;
+            active->estopMaxDoneMicros = std::max(active->estopMaxDoneMicros, doneMicros - active->estopArrivalMicros);
+        }
+        return;
+    }
+
+    // A setpoint left in the transmit FIFO by the stop goes out after the Estops
+    if (active->zeroVelocityMicros != UINT64_MAX && startMicros > active->zeroVelocityMicros) {
+        active->staleFramesOnWire++;
+    }
+}
@@ -0,0 +1,350 @@
+/**
+ * @file bridge_rig.h
+ * @brief Host-side test rig that runs the bridge firmware against simulated buses
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The rig boots the real sketch (setup()/loop()) on the simulated clock,
+ * delivers Jetson frames through the FlexCAN stand-in at their scheduled
+ * arrival times and timestamps every frame the firmware hands to the
+ * MCP2517FD, so forwarding latency can be measured end to end. It also
+ * plays the ODrives: every node reports Get_Encoder_Estimates at a fixed
+ * rate, echoing the last setpoint it was sent, and the encoder frames the
+ * firmware forwards to the Jetson are checked against those reports. The
+ * telemetry summaries are counted and checked for consistency, and so are
+ * the answers to diagnostic and parameter requests.
+ * After an emergency stop it records when each ODrive Estop frame is
+ * enqueued and when it finishes on the wire, and any frame from before the
+ * stop that still starts on the wire once zero velocity is queued. Bus faults and resets of the
+ * MCP2517FD can be scheduled to exercise bus recovery.
+ */
+
+#ifndef BRIDGE_RIG_H
+#define BRIDGE_RIG_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "FlexCAN_T4.h"
+#include "ACAN2517FD.h"
+#include "message_construction.h"
+#include "state_machine.h"
+#include "sim_clock.h"
+
+// Summary statistics over a set of latency samples
+typedef struct {
+    uint32_t count;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+    double mean;
+} LatencySummary_t;
+
+LatencySummary_t summarizeLatency(std::vector<uint64_t> samples);
+
+// Source of timed Jetson-bus frames
+class JetsonFrameSource {
+public:
+    virtual ~JetsonFrameSource() {}
+    // Arrival time of the next frame, UINT64_MAX when exhausted
+    virtual uint64_t nextArrivalMicros() = 0;
+    virtual void next(CAN_message_t& msg) = 0;
+};
+
+// Drive setpoints for all four wheels at a fixed per-wheel rate, staggered
+// evenly inside each period. Every frame carries a unique, increasing value
+// so the rig can tell which Jetson frame a CANFD frame was built from. In
+// steady mode every frame repeats the same command instead. Compact mode
+// sends the compact frames, two wheels each, with values on the compact
+// scale so they arrive at the ODrives unchanged; its ramp holds at the top
+// of the angle field after about 4000 frames.
+class DriveTrafficSource : public JetsonFrameSource {
+public:
+    DriveTrafficSource(double perWheelHz, uint64_t startMicros, uint64_t durationMicros,
+                       bool steady = false, bool compact = false);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    double periodMicros;
+    uint64_t start;
+    uint64_t end;
+    uint64_t index;
+    bool steady;
+    bool compact;
+};
+
+// Unrelated Jetson-bus traffic (other subsystems): random standard IDs the
+// bridge does not handle, at a fixed total rate
+class BackgroundTrafficSource : public JetsonFrameSource {
+public:
+    BackgroundTrafficSource(double hz, uint64_t startMicros, uint64_t durationMicros, uint32_t seed = 1);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    double periodMicros;
+    uint64_t start;
+    uint64_t end;
+    uint64_t index;
+    uint32_t state;
+};
+
+// Jetson polling the bridge diagnostics: one MSG_TYPE_DIAGNOSTIC_REQ per
+// period from RIG_JETSON_NODE, cycling through the pages
+#define RIG_JETSON_NODE 0x01
+
+class DiagnosticPollSource : public JetsonFrameSource {
+public:
+    DiagnosticPollSource(double hz, uint64_t startMicros, uint64_t durationMicros);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    double periodMicros;
+    uint64_t start;
+    uint64_t end;
+    uint64_t index;
+};
+
+// One MSG_TYPE_EMERGENCY_STOP frame at a fixed time
+class EmergencyStopSource : public JetsonFrameSource {
+public:
+    explicit EmergencyStopSource(uint64_t atMicros);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    uint64_t at;
+    bool sent;
+};
+
+// One extended MSG_TYPE_STATE_* request from RIG_JETSON_NODE at a fixed time
+class StateRequestSource : public JetsonFrameSource {
+public:
+    StateRequestSource(uint64_t atMicros, uint8_t type);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    uint64_t at;
+    uint8_t type;
+    bool sent;
+};
+
+// Jetson tuning the bridge: one MSG_TYPE_CONFIG_SET per added parameter
+// from RIG_JETSON_NODE, one period apart, then a MSG_TYPE_CONFIG_SAVE
+class ConfigRequestSource : public JetsonFrameSource {
+public:
+    ConfigRequestSource(uint64_t startMicros, uint64_t periodMicros);
+
+    // Parameter wire ID and raw value (param_registry.h)
+    void add(uint8_t id, uint32_t raw);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    struct Setting {
+        uint8_t id;
+        uint32_t raw;
+    };
+
+    std::vector<Setting> settings;
+    uint64_t start;
+    uint64_t period;
+    size_t index;
+};
+
+// Jetson arming the bridge before it drives: MSG_TYPE_STATE_UNLOCK, then
+// MSG_TYPE_STATE_ARM one period later, from RIG_JETSON_NODE. Tried again
+// every retry period while the HAT is disarmed, locked or unlocked (read
+// from the state machine, where a Jetson would go by the heartbeat), and
+// held off until a count of answers is reached, e.g. to parameter changes
+// that are only accepted while disarmed. Gives up from a stop time on, so
+// a disarm the run sends on purpose is not undone.
+class ArmRequestSource : public JetsonFrameSource {
+public:
+    ArmRequestSource(const HATStateMachine& hat, uint64_t startMicros, uint64_t periodMicros,
+                     uint64_t retryMicros);
+
+    // Hold off until answered reaches count
+    void waitFor(const uint32_t& answered, uint32_t count);
+    // No UNLOCK from atMicros on
+    void stopAt(uint64_t atMicros);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    const HATStateMachine& hat;
+    const uint32_t* answered;
+    uint32_t answersNeeded;
+    uint64_t attempt;           // Time of the next UNLOCK
+    uint64_t stop;
+    uint64_t period;
+    uint64_t retry;
+    bool armNext;               // UNLOCK sent, ARM follows
+};
+
+// Interleaves two sources by arrival time
+class MergedFrameSource : public JetsonFrameSource {
+public:
+    MergedFrameSource(JetsonFrameSource& first, JetsonFrameSource& second);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+private:
+    JetsonFrameSource& first;
+    JetsonFrameSource& second;
+};
+
+class BridgeRig : public sim::InterruptSource {
+public:
+    BridgeRig();
+    ~BridgeRig();
+
+    // Runs setup() on the simulated clock. With a source, its frames and the
+    // ODrive reports already arrive during setup(), as after a brown-out
+    // reset with the Jetson still publishing; run() then carries on with it.
+    void boot(JetsonFrameSource* source = nullptr);
+
+    // Per-node ODrive encoder estimate rate, 0 to disable (default 100 Hz)
+    void setODriveFeedbackRate(double hz);
+
+    // Fault injection: the bus fails (bus-off) from atMicros for durationMicros,
+    // or the MCP2517FD is reset at atMicros and waits in configuration mode
+    void scheduleJetsonFault(uint64_t atMicros, uint64_t durationMicros);
+    void schedulePeripheralFault(uint64_t atMicros, uint64_t durationMicros);
+    void schedulePeripheralReset(uint64_t atMicros);
+
+    // Runs loop() until simulated time reaches endMicros, delivering frames
+    // from source as they arrive
+    void run(JetsonFrameSource& source, uint64_t endMicros, uint32_t loopCostMicros);
+
+    // sim::InterruptSource
+    uint64_t nextEventMicros() override;
+    void fire(uint64_t nowMicros) override;
+
+    // Results
+    uint32_t injectedFrames;
+    uint32_t acceptedFrames;
+    uint32_t forwardedFrames;
+    uint32_t supersededSetpoints;
+    uint32_t loopIterations;
+    uint64_t hostLoopNanos;
+    uint64_t peripheralWireMicros;   // Bus time of every enqueued CANFD frame
+    std::vector<uint64_t> latencyMicros;
+    float maxVelocityStep;           // Largest change between two frames to one ODrive
+    float maxPositionStep;
+
+    // Peripheral -> Jetson telemetry
+    uint32_t feedbackInjected;       // Encoder estimate frames offered to the MCP2517FD
+    uint32_t feedbackAccepted;       // ... that passed its acceptance filters
+    uint32_t telemetryFrames;        // Encoder frames written to the Jetson bus
+    uint32_t telemetryBursts;        // Complete four-wheel groups, in wheel order
+    uint32_t telemetryMismatched;    // Frames not carrying any recent ODrive report
+    uint64_t maxBurstSpreadMicros;   // First to last frame of one burst
+    uint32_t summaryFrames;          // Telemetry summary frames written to the Jetson bus
+    uint32_t summarySamples;         // Samples they cover
+    uint32_t summaryInconsistent;    // Undecodable, or mean outside min..max
+
+    // Diagnostics protocol
+    uint32_t diagnosticRequests;     // Requests injected on the Jetson bus
+    uint32_t diagnosticResponses;    // Response frames addressed to RIG_JETSON_NODE
+
+    // Runtime parameters
+    uint32_t configRequests;         // MSG_TYPE_CONFIG_* requests injected on the Jetson bus
+    uint32_t configResponses;        // MSG_TYPE_PARAM_RESPONSE frames addressed to RIG_JETSON_NODE
+    uint32_t configRefused;          // ... with a status other than CONFIG_STATUS_OK
+
+    // Emergency stop: from the stop frame's arrival
+    uint64_t estopArrivalMicros;     // UINT64_MAX until a stop frame was accepted
+    uint32_t estopFrames;            // ODrive Estop frames enqueued
+    uint64_t estopMaxEnqueueMicros;  // Arrival to the last Estop handed to the MCP2517FD
+    uint32_t estopFramesSent;        // ... and completed on the wire
+    uint64_t estopMaxDoneMicros;     // Arrival to the last Estop completed on the wire
+    uint32_t zeroVelocityFrames;     // Zero velocity frames after the stop
+    uint64_t zeroVelocityMicros;     // UINT64_MAX until the first of them was enqueued
+    uint32_t framesAfterStop;        // Any other frame after the stop (should be none)
+    uint32_t staleFramesOnWire;      // Queued before the stop, started on the wire after zero velocity (should be none)
+    uint64_t resetArrivalMicros;     // UINT64_MAX until a MSG_TYPE_STATE_RESET after the stop was accepted
+    uint32_t framesAfterReset;       // Frames enqueued from then on
+
+    // Disarm: steering must hold while the wheels slow down
+    uint64_t disarmArrivalMicros;    // UINT64_MAX until a MSG_TYPE_STATE_DISARM was accepted
+    uint32_t steerFramesAfterDisarm; // Steering setpoints enqueued from then on
+    float maxSteerMoveAfterDisarm;   // Furthest one lay outside last commanded..last accepted
+
+    // Fault injection
+    uint32_t faultEvents;            // Faults raised, cleared, chip resets
+
+    // Optional observer for every frame enqueued to the MCP2517FD
+    void (*onForward)(const CANFDMessage& msg, uint64_t enqueueMicros);
+
+private:
+    struct Pending {
+        float value;
+        uint64_t arrivalMicros;
+    };
+
+    JetsonFrameSource* activeSource;
+    void attach(JetsonFrameSource& source);
+
+    // Scheduled fault changes, in time order
+    enum FaultAction : uint8_t { FAULT_JETSON_ON, FAULT_JETSON_OFF, FAULT_PERIPH_ON, FAULT_PERIPH_OFF, FAULT_PERIPH_RESET };
+    struct FaultEvent {
+        uint64_t atMicros;
+        FaultAction action;
+    };
+    std::vector<FaultEvent> faults;
+    size_t faultNext;
+
+    void scheduleFault(uint64_t atMicros, FaultAction action);
+    void applyFault(FaultAction action);
+
+    // ODrive model: last commanded value per wheel and the reports sent back
+    double feedbackPeriodMicros;
+    uint64_t feedbackStart;
+    uint64_t feedbackIndex;
+    float commandedVelocity[4];
+    float commandedPosition[4];
+    float reportedVelocity[4][2];    // Latest and previous report per wheel
+    float reportedPosition[4][2];
+    float injectedPosition[4];       // Last steering setpoint sent by the Jetson
+    float disarmLow[4];              // Steering range allowed after the disarm
+    float disarmHigh[4];
+    uint8_t burstNext;
+    uint64_t burstStartMicros;
+
+    // Per wheel: drive velocity and steering position setpoints not yet seen on the output
+    std::deque<Pending> pendingVelocity[4];
+    std::deque<Pending> pendingPosition[4];
+
+    void trackInjected(const CAN_message_t& msg, uint64_t nowMicros);
+    void trackForwarded(const CANFDMessage& msg, uint64_t enqueueMicros);
+    void match(std::deque<Pending>& pending, float value, uint64_t enqueueMicros);
+    uint64_t nextFeedbackMicros() const;
+    void injectFeedback();
+    void trackAfterStop(const CANFDMessage& msg, uint64_t enqueueMicros);
+    void trackAfterDisarm(uint8_t wheel, float position);
+    void trackTelemetry(const CAN_message_t& msg);
+    void trackSummary(const CAN_message_t& msg);
+    void trackTelemetryWheel(uint8_t wheel, const DrivePayload_t& payload, bool compact);
+    void trackCommand(uint8_t wheel, const DrivePayload_t& payload, uint64_t nowMicros);
+    void trackDiagnostics(const CAN_message_t& msg);
+    void trackConfig(const CAN_message_t& msg);
+
+    static BridgeRig* active;
+    static void forwardHook(const CANFDMessage& msg, uint64_t enqueueMicros);
+    static void wireHook(const CANFDMessage& msg, uint64_t enqueueMicros, uint64_t startMicros, uint64_t doneMicros);
+    static void jetsonTxHook(CAN_DEV_TABLE bus, const CAN_message_t& msg);
+};
+
+#endif // BRIDGE_RIG_H
@@ -0,0 +1,12 @@
+/**
+ * @file bridge_sketch.cpp
+ * @brief Builds the firmware sketch as an ordinary translation unit for the host
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The native environment excludes src/motor_control.ino from the source
+ * filter (there is no Arduino .ino preprocessing on the host) and pulls it
+ * in here instead, so the rig drives the exact setup()/loop() that ships.
+ */
+
+#include "../src/motor_control.ino"
@@ -0,0 +1,656 @@
+/**
+ * @file can_replay.cpp
+ * @brief Replays recorded CAN traffic (candump / Vector ASC) through the bridge firmware
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Usage: program replay LOG [--speed X] [--iface NAME] [--record FILE]
+ *                           [--loop-cost-us US] [--feedback-rate HZ] [--max-dropped N]
+ *                           [--shaping] [--serial]
+ *
+ *   --speed         Timing scale: 1 = as recorded (default), 2 = twice as fast,
+ *                   0 = as fast as possible (back to back at the Jetson bit rate)
+ *   --iface         Replay only frames from this candump interface or ASC channel
+ *                   (default: every classic frame in the capture)
+ *   --record        Write every frame sent to the peripheral bus to FILE (candump -l format)
+ *   --loop-cost-us  Simulated time charged for each loop() pass (default 2)
+ *   --feedback-rate ODrive encoder estimates per second, per node (default 0 = off)
+ *   --max-dropped   Exit non-zero if more setpoint changes than this never reach the output
+ *   --shaping       Interpolate and rate limit setpoints as the firmware does by default;
+ *                   a change then only counts once the output settles on it
+ *   --serial        Echo the firmware's Serial output to stderr
+ *
+ * The bridge is armed before the first frame, as the capture's Jetson had it.
+ *
+ * Setpoint fidelity: a drive or steering setpoint that differs from the
+ * previous one for its wheel by more than the bridge's epsilon is a change.
+ * It is delivered when a frame with exactly that value is handed to the
+ * MCP2517FD before the next change for the same wheel arrives; otherwise it
+ * was dropped (superseded inside the bridge or lost to a full queue).
+ */
+
+#include "can_replay.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "can_interface.h"
+#include "component_ctrl.h"
+#include "hardware_map.h"
+#include "hat_config.h"
+#include "message_construction.h"
+
+// Defined by the sketch
+extern ComponentController componentController;
+extern CANInterface canInterface;
+extern HATStateMachine stateMachine;
+
+// Time after the last frame for the bridge to drain its queues
+#define REPLAY_DRAIN_MICROS 100000
+
+// --- Capture parsing ---
+
+static const uint8_t FD_DLC_LENGTHS[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseHexBytes(const char* text, LoggedFrame_t& frame) {
+    frame.len = 0;
+    while (text[0] != '\0' && text[0] != ' ' && text[0] != '\n' && text[0] != '\r') {
+        const int high = hexDigit(text[0]);
+        const int low = hexDigit(text[1]);
+        if (high < 0 || low < 0 || frame.len >= sizeof(frame.data)) {
+            return false;
+        }
+        frame.data[frame.len++] = (uint8_t)(high << 4 | low);
+        text += 2;
+    }
+    return true;
+}
+
+static void splitTokens(char* line, std::vector<char*>& tokens) {
+    tokens.clear();
+    for (char* token = strtok(line, " \t\r\n"); token != nullptr; token = strtok(nullptr, " \t\r\n")) {
+        tokens.push_back(token);
+    }
+}
+
+static uint64_t secondsToMicros(const char* text) {
+    return (uint64_t)llround(strtod(text, nullptr) * 1e6);
+}
+
+// candump -l:   (1436509052.249713) can0 123#DEADBEEF      FD: 123##1DEADBEEF
+// candump -ta:  (1436509052.249713)  can0  123   [4]  DE AD BE EF
+static bool parseCandumpLine(char* line, LoggedFrame_t& frame) {
+    std::vector<char*> tokens;
+    splitTokens(line, tokens);
+    if (tokens.size() < 3 || tokens[0][0] != '(') {
+        return false;
+    }
+    frame = LoggedFrame_t();
+    frame.timestampMicros = secondsToMicros(tokens[0] + 1);
+    frame.iface = tokens[1];
+
+    char* hash = strchr(tokens[2], '#');
+    if (hash == nullptr) {
+        // Console format: ID [len] bytes...
+        if (tokens.size() < 4 || tokens[3][0] != '[') {
+            return false;
+        }
+        frame.id = (uint32_t)strtoul(tokens[2], nullptr, 16);
+        frame.extended = strlen(tokens[2]) > 3;
+        frame.fd = strlen(tokens[3]) == 4;   // Two-digit lengths ([08], [64]) are CAN FD
+        const unsigned len = (unsigned)strtoul(tokens[3] + 1, nullptr, 10);
+        if (tokens.size() >= 5 && strcmp(tokens[4], "remote") == 0) {
+            frame.remote = true;
+            frame.len = (uint8_t)len;
+            return len <= 8;
+        }
+        if (len > 64 || tokens.size() < 4 + len) {
+            return false;
+        }
+        frame.len = (uint8_t)len;
+        for (unsigned i = 0; i < len; i++) {
+            frame.data[i] = (uint8_t)strtoul(tokens[4 + i], nullptr, 16);
+        }
+        return true;
+    }
+
+    *hash = '\0';
+    frame.id = (uint32_t)strtoul(tokens[2], nullptr, 16);
+    frame.extended = strlen(tokens[2]) > 3;
+    const char* payload = hash + 1;
+    if (payload[0] == '#') {
+        const int flags = hexDigit(payload[1]);
+        if (flags < 0) {
+            return false;
+        }
+        frame.fd = true;
+        frame.brs = (flags & 1) != 0;
+        return parseHexBytes(payload + 2, frame);
+    }
+    if (payload[0] == 'R' || payload[0] == 'r') {
+        frame.remote = true;
+        frame.len = (uint8_t)(payload[1] != '\0' ? hexDigit(payload[1]) : 0);
+        return frame.len <= 8;
+    }
+    return parseHexBytes(payload, frame) && frame.len <= 8;
+}
+
+typedef struct {
+    bool hexBase;
+    bool relative;
+    uint64_t previousMicros;
+} AscState_t;
+
+// Vector ASC:   0.002300 1  123x  Rx   d 8 01 02 03 04 05 06 07 08
+//   CAN FD:     0.010000 CANFD 1 Rx 123 [name] 1 0 9 12 01 02 ...
+static bool parseAscLine(char* line, AscState_t& state, LoggedFrame_t& frame) {
+    std::vector<char*> tokens;
+    splitTokens(line, tokens);
+    if (tokens.size() >= 2 && strcmp(tokens[0], "base") == 0) {
+        state.hexBase = strcmp(tokens[1], "hex") == 0;
+        for (size_t i = 2; i + 1 < tokens.size(); i++) {
+            if (strcmp(tokens[i], "timestamps") == 0) {
+                state.relative = strcmp(tokens[i + 1], "relative") == 0;
+            }
+        }
+        return false;
+    }
+    if (tokens.size() < 4 || hexDigit(tokens[0][0]) < 0 || strchr(tokens[0], '.') == nullptr) {
+        return false;
+    }
+
+    frame = LoggedFrame_t();
+    uint64_t stamp = secondsToMicros(tokens[0]);
+    if (state.relative) {
+        stamp += state.previousMicros;
+    }
+    state.previousMicros = stamp;
+    frame.timestampMicros = stamp;
+
+    size_t at = 1;
+    if (strcmp(tokens[1], "CANFD") == 0) {
+        frame.fd = true;
+        at = 2;
+    }
+    if (tokens.size() < at + 4) {
+        return false;
+    }
+    frame.iface = tokens[at];
+    char* idText = tokens[at + 1];
+    const char* direction = tokens[at + 2];
+    if (frame.fd) {
+        // Channel, direction, then ID
+        idText = tokens[at + 2];
+        direction = tokens[at + 1];
+    }
+    if (strcmp(direction, "Rx") != 0 && strcmp(direction, "Tx") != 0) {
+        return false;   // Error frames, statistics, events
+    }
+    const size_t idLength = strlen(idText);
+    if (idLength == 0 || hexDigit(idText[0]) < 0) {
+        return false;
+    }
+    frame.extended = idText[idLength - 1] == 'x' || idText[idLength - 1] == 'X';
+    frame.id = (uint32_t)strtoul(idText, nullptr, state.hexBase ? 16 : 10);
+
+    const int base = state.hexBase ? 16 : 10;
+    size_t next = at + 3;
+    if (frame.fd) {
+        // Optional symbolic name, then BRS, ESI, DLC, data length
+        if (next < tokens.size() && strcmp(tokens[next], "0") != 0 && strcmp(tokens[next], "1") != 0) {
+            next++;
+        }
+        if (tokens.size() < next + 4) {
+            return false;
+        }
+        frame.brs = strcmp(tokens[next], "1") == 0;
+        const unsigned dlc = (unsigned)strtoul(tokens[next + 2], nullptr, 16);
+        const unsigned len = (unsigned)strtoul(tokens[next + 3], nullptr, 10);
+        if (dlc > 15 || len != FD_DLC_LENGTHS[dlc] || tokens.size() < next + 4 + len) {
+            return false;
+        }
+        frame.len = (uint8_t)len;
+        for (unsigned i = 0; i < len; i++) {
+            frame.data[i] = (uint8_t)strtoul(tokens[next + 4 + i], nullptr, base);
+        }
+        return true;
+    }
+
+    if (tokens.size() < next + 1) {
+        return false;
+    }
+    if (strcmp(tokens[next], "r") == 0) {
+        frame.remote = true;
+        return true;
+    }
+    if (strcmp(tokens[next], "d") != 0 || tokens.size() < next + 2) {
+        return false;
+    }
+    const unsigned len = (unsigned)strtoul(tokens[next + 1], nullptr, base);
+    if (len > 8 || tokens.size() < next + 2 + len) {
+        return false;
+    }
+    frame.len = (uint8_t)len;
+    for (unsigned i = 0; i < len; i++) {
+        frame.data[i] = (uint8_t)strtoul(tokens[next + 2 + i], nullptr, base);
+    }
+    return true;
+}
+
+bool readCanLog(const char* path, std::vector<LoggedFrame_t>& frames, int& format,
+                uint32_t& skippedLines, std::string& error) {
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+
+    frames.clear();
+    skippedLines = 0;
+    format = CAN_LOG_CANDUMP;
+    bool formatKnown = false;
+    AscState_t asc = { true, false, 0 };
+    char line[1024];
+    char scratch[1024];
+
+    while (fgets(line, sizeof(line), in) != nullptr) {
+        const char* text = line + strspn(line, " \t");
+        if (text[0] == '\n' || text[0] == '\r' || text[0] == '\0') {
+            continue;
+        }
+        // candump lines start with "(timestamp)"; anything else frame-like is ASC
+        if (!formatKnown) {
+            format = text[0] == '(' ? CAN_LOG_CANDUMP : CAN_LOG_ASC;
+            formatKnown = text[0] == '(' || hexDigit(text[0]) >= 0 || strncmp(text, "base", 4) == 0 ||
+                          strncmp(text, "date", 4) == 0;
+        }
+
+        LoggedFrame_t frame;
+        strncpy(scratch, text, sizeof(scratch) - 1);
+        scratch[sizeof(scratch) - 1] = '\0';
+        const bool ok = format == CAN_LOG_CANDUMP ? parseCandumpLine(scratch, frame)
+                                                  : parseAscLine(scratch, asc, frame);
+        if (ok) {
+            frames.push_back(frame);
+        } else {
+            skippedLines++;
+        }
+    }
+    fclose(in);
+
+    // Some tools write captures slightly out of order
+    std::stable_sort(frames.begin(), frames.end(), [](const LoggedFrame_t& a, const LoggedFrame_t& b) {
+        return a.timestampMicros < b.timestampMicros;
+    });
+    return true;
+}
+
+void writeCandumpLine(FILE* out, uint64_t timestampMicros, const char* iface, const CANFDMessage& msg) {
+    fprintf(out, "(%llu.%06llu) %s ", (unsigned long long)(timestampMicros / 1000000),
+            (unsigned long long)(timestampMicros % 1000000), iface);
+    fprintf(out, msg.ext ? "%08X" : "%03X", msg.id);
+    if (msg.type == CANFDMessage::CAN_REMOTE) {
+        fprintf(out, "#R\n");
+        return;
+    }
+    if (msg.type == CANFDMessage::CAN_DATA) {
+        fputc('#', out);
+    } else {
+        fprintf(out, "##%X", msg.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ? 1 : 0);
+    }
+    for (uint8_t i = 0; i < msg.len; i++) {
+        fprintf(out, "%02X", msg.data[i]);
+    }
+    fputc('\n', out);
+}
+
+// --- ReplayFrameSource ---
+
+// Classic frame on the Jetson bus, worst-case stuffing, as the diagnostics count it
+static uint64_t jetsonWireMicros(const LoggedFrame_t& frame) {
+    const uint32_t idBits = frame.extended ? 29 + 2 : 11;
+    const uint32_t stuffable = 23 + idBits + (frame.remote ? 0 : 8u * frame.len);
+    const uint32_t bits = stuffable + stuffable / 4 + 13;
+    return ((uint64_t)bits * 1000000 + CAN_BAUDRATE - 1) / CAN_BAUDRATE;
+}
+
+ReplayFrameSource::ReplayFrameSource(const std::vector<LoggedFrame_t>& frames, uint64_t startMicros,
+                                     double speed)
+    : onInject(nullptr), frames(frames), arrivals(), index(0) {
+    arrivals.reserve(frames.size());
+    const uint64_t first = frames.empty() ? 0 : frames.front().timestampMicros;
+    uint64_t busFree = startMicros;
+    for (const LoggedFrame_t& frame : frames) {
+        uint64_t arrival = busFree;
+        if (speed > 0.0) {
+            arrival = startMicros + (uint64_t)((double)(frame.timestampMicros - first) / speed);
+        }
+        arrivals.push_back(arrival);
+        busFree = std::max(busFree, arrival) + jetsonWireMicros(frame);
+    }
+}
+
+uint64_t ReplayFrameSource::nextArrivalMicros() {
+    return index < arrivals.size() ? arrivals[index] : UINT64_MAX;
+}
+
+void ReplayFrameSource::next(CAN_message_t& msg) {
+    const LoggedFrame_t& frame = frames[index];
+    msg = CAN_message_t();
+    msg.id = frame.id;
+    msg.flags.extended = frame.extended;
+    msg.flags.remote = frame.remote;
+    msg.len = frame.len;
+    memcpy(msg.buf, frame.data, frame.len);
+    if (onInject != nullptr) {
+        onInject(msg, arrivals[index]);
+    }
+    index++;
+}
+
+uint64_t ReplayFrameSource::lastArrivalMicros() const {
+    return arrivals.empty() ? 0 : arrivals.back();
+}
+
+// --- Output fidelity ---
+
+typedef struct {
+    bool seen;
+    float lastInput;
+    float pendingValue;
+    uint64_t pendingArrival;
+    bool pending;
+    uint32_t inputFrames;
+    uint32_t changes;
+    uint32_t delivered;
+    uint32_t dropped;
+    uint32_t outputFrames;
+    float lastOutput;
+} ReplayChannel_t;
+
+typedef struct {
+    ReplayChannel_t channels[ComponentController::frameCount];
+    std::vector<uint64_t> latencyMicros;
+    FILE* record;
+    uint64_t startMicros;
+    uint32_t outputFrames;
+} ReplayState_t;
+
+static ReplayState_t replay;
+
+static void replayInput(uint8_t slot, float value, float epsilon, uint64_t arrivalMicros) {
+    ReplayChannel_t& channel = replay.channels[slot];
+    channel.inputFrames++;
+    // The first setpoint is compared with what the bridge already sends
+    if (!channel.seen && channel.outputFrames > 0) {
+        channel.lastInput = channel.lastOutput;
+        channel.seen = true;
+    }
+    if (channel.seen && fabsf(value - channel.lastInput) <= epsilon) {
+        return;
+    }
+    channel.seen = true;
+    if (channel.pending) {
+        channel.dropped++;
+    }
+    channel.lastInput = value;
+    channel.pendingValue = value;
+    channel.pendingArrival = arrivalMicros;
+    channel.pending = true;
+    channel.changes++;
+}
+
+static void replayWheelInput(uint8_t wheel, const DrivePayload_t& payload, uint64_t arrivalMicros) {
+    if (wheel >= HatProfile::wheelCount) {
+        return;
+    }
+    replayInput(ComponentController::velocitySlot(wheel), payload.angular_vel, HAT_SETPOINT_VEL_EPSILON, arrivalMicros);
+    replayInput(ComponentController::positionSlot(wheel), payload.steering_angle, HAT_SETPOINT_POS_EPSILON, arrivalMicros);
+}
+
+static void onReplayInject(const CAN_message_t& msg, uint64_t arrivalMicros) {
+    if (msg.flags.extended || msg.flags.remote) {
+        return;
+    }
+    for (uint8_t frame = 0; frame < HatProfile::compactFrameCount; frame++) {
+        if (msg.id == HatProfile::compactCommandIds[frame]) {
+            DrivePayload_t payload[DRIVE_COMPACT_WHEELS_PER_FRAME];
+            const uint8_t count = decodeCompactDrivePayload(msg.buf, msg.len, payload);
+            for (uint8_t i = 0; i < count; i++) {
+                replayWheelInput((uint8_t)(frame * DRIVE_COMPACT_WHEELS_PER_FRAME + i), payload[i], arrivalMicros);
+            }
+            return;
+        }
+    }
+
+    const uint32_t first = PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_LEFT;
+    if (msg.len < 8 || msg.id < first || msg.id >= first + DRIVE_WHEEL_COUNT) {
+        return;
+    }
+    replayWheelInput((uint8_t)(msg.id - first), decodeDrivePayload(msg.buf), arrivalMicros);
+}
+
+static void onReplayForward(const CANFDMessage& msg, uint64_t enqueueMicros) {
+    replay.outputFrames++;
+    if (replay.record != nullptr) {
+        writeCandumpLine(replay.record, enqueueMicros - replay.startMicros, "can1", msg);
+    }
+    if (msg.ext || msg.type != CANFDMessage::CAN_DATA || msg.len < 4) {
+        return;
+    }
+
+    const int8_t driveWheel = driveWheelOfNode(odriveIdNode(msg.id));
+    const int8_t steerWheel = steerWheelOfNode(odriveIdNode(msg.id));
+    int slot = -1;
+    if (odriveIdCmd(msg.id) == ODRIVE_CMD_SET_INPUT_VEL && driveWheel >= 0) {
+        slot = ComponentController::velocitySlot(driveWheel);
+    } else if (odriveIdCmd(msg.id) == ODRIVE_CMD_SET_INPUT_POS && steerWheel >= 0) {
+        slot = ComponentController::positionSlot(steerWheel);
+    }
+    if (slot < 0) {
+        return;
+    }
+
+    ReplayChannel_t& channel = replay.channels[slot];
+    channel.outputFrames++;
+    float value = 0.0f;
+    memcpy(&value, msg.data, sizeof(float));
+    channel.lastOutput = value;
+    if (channel.pending && value == channel.pendingValue && enqueueMicros >= channel.pendingArrival) {
+        channel.pending = false;
+        channel.delivered++;
+        replay.latencyMicros.push_back(enqueueMicros - channel.pendingArrival);
+    }
+}
+
+// --- Entry point ---
+
+static void replayUsage(const char* program) {
+    fprintf(stderr,
+            "usage: %s replay LOG [--speed X] [--iface NAME] [--record FILE] [--loop-cost-us US] "
+            "[--feedback-rate HZ] [--max-dropped N] [--shaping] [--serial]\n",
+            program);
+}
+
+int runReplay(int argc, char** argv) {
+    const char* logPath = nullptr;
+    const char* iface = nullptr;
+    const char* recordPath = nullptr;
+    double speed = 1.0;
+    uint32_t loopCostMicros = 2;
+    double feedbackHz = 0.0;
+    long maxDropped = -1;
+    bool shaping = false;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--speed") == 0 && hasValue) {
+            speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--iface") == 0 && hasValue) {
+            iface = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && hasValue) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--loop-cost-us") == 0 && hasValue) {
+            loopCostMicros = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--feedback-rate") == 0 && hasValue) {
+            feedbackHz = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-dropped") == 0 && hasValue) {
+            maxDropped = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--shaping") == 0) {
+            shaping = true;
+        } else if (strcmp(argv[i], "--serial") == 0) {
+            Serial.setEcho(true);
+        } else if (argv[i][0] != '-' && logPath == nullptr) {
+            logPath = argv[i];
+        } else {
+            replayUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (logPath == nullptr || speed < 0.0) {
+        replayUsage(argv[0]);
+        return 2;
+    }
+
+    std::vector<LoggedFrame_t> captured;
+    int format = CAN_LOG_CANDUMP;
+    uint32_t skippedLines = 0;
+    std::string error;
+    if (!readCanLog(logPath, captured, format, skippedLines, error)) {
+        fprintf(stderr, "replay: %s\n", error.c_str());
+        return 2;
+    }
+
+    // FlexCAN on the Jetson bus is classic CAN only
+    std::vector<LoggedFrame_t> frames;
+    uint32_t otherIface = 0;
+    uint32_t fdFrames = 0;
+    for (const LoggedFrame_t& frame : captured) {
+        if (iface != nullptr && frame.iface != iface) {
+            otherIface++;
+        } else if (frame.fd) {
+            fdFrames++;
+        } else {
+            frames.push_back(frame);
+        }
+    }
+    if (frames.empty()) {
+        fprintf(stderr, "replay: no classic frames to replay in %s\n", logPath);
+        return 2;
+    }
+
+    replay = ReplayState_t();
+    if (recordPath != nullptr) {
+        replay.record = fopen(recordPath, "w");
+        if (replay.record == nullptr) {
+            fprintf(stderr, "replay: cannot write %s\n", recordPath);
+            return 2;
+        }
+    }
+
+    BridgeRig rig;
+    rig.setODriveFeedbackRate(feedbackHz);
+    componentController.setSetpointShaping(shaping);
+    rig.boot();
+    rig.onForward = onReplayForward;
+
+    // A capture starts mid-drive, so the bridge is armed as its Jetson had
+    // it; state requests in the capture still go through
+    stateMachine.processEvent(EVENT_UNLOCK, AUTHORITY_BASE_STATION);
+    stateMachine.processEvent(EVENT_ARM, AUTHORITY_BASE_STATION);
+
+    const uint64_t start = sim::nowMicros();
+    replay.startMicros = start;
+    ReplayFrameSource source(frames, start, speed);
+    source.onInject = onReplayInject;
+    const uint64_t end = source.lastArrivalMicros() + REPLAY_DRAIN_MICROS;
+
+    const auto hostStart = std::chrono::steady_clock::now();
+    rig.run(source, end, loopCostMicros);
+    const auto hostEnd = std::chrono::steady_clock::now();
+    if (replay.record != nullptr) {
+        fclose(replay.record);
+    }
+
+    // A change still pending at the end never made it out
+    uint32_t changes = 0;
+    uint32_t delivered = 0;
+    uint32_t dropped = 0;
+    for (ReplayChannel_t& channel : replay.channels) {
+        if (channel.pending) {
+            channel.dropped++;
+            channel.pending = false;
+        }
+        changes += channel.changes;
+        delivered += channel.delivered;
+        dropped += channel.dropped;
+    }
+
+    const double spanSeconds = (double)(source.lastArrivalMicros() - start) / 1e6;
+    const double recordedSeconds = (double)(frames.back().timestampMicros - frames.front().timestampMicros) / 1e6;
+    const double simSeconds = (double)(end - start) / 1e6;
+    const double hostSeconds = std::chrono::duration<double>(hostEnd - hostStart).count();
+    const LatencySummary_t latency = summarizeLatency(replay.latencyMicros);
+    ACAN2517FD* controller = ACAN2517FD::instance();
+
+    printf("=== Bridge replay ===\n");
+    printf("capture              : %s (%s), %zu frames, %u other lines skipped, %u on other interfaces, "
+           "%u CAN FD not replayed\n",
+           logPath, format == CAN_LOG_ASC ? "Vector ASC" : "candump", captured.size(), skippedLines,
+           otherIface, fdFrames);
+    if (speed > 0.0) {
+        printf("timing               : %.3f s recorded, replayed at %.2fx in %.3f s\n",
+               recordedSeconds, speed, spanSeconds);
+    } else {
+        printf("timing               : %.3f s recorded, replayed as fast as possible in %.3f s (%.1fx)\n",
+               recordedSeconds, spanSeconds, spanSeconds > 0 ? recordedSeconds / spanSeconds : 0.0);
+    }
+    printf("jetson frames        : %u injected, %u accepted by filters, %u unrouted\n",
+           rig.injectedFrames, rig.acceptedFrames, canInterface.getUnroutedCount());
+    printf("sustained rate       : %.1f frames/s in, %.1f frames/s out (simulated); host %.0f frames/s "
+           "(%.1fx real time)\n",
+           spanSeconds > 0 ? rig.injectedFrames / spanSeconds : 0.0,
+           simSeconds > 0 ? replay.outputFrames / simSeconds : 0.0,
+           hostSeconds > 0 ? rig.injectedFrames / hostSeconds : 0.0,
+           hostSeconds > 0 ? simSeconds / hostSeconds : 0.0);
+    printf("peripheral output    : %u frames, %u refused by the controller FIFO, setpoints %u coalesced, "
+           "%u expired, %u refused (queue full)\n",
+           replay.outputFrames, controller != nullptr ? controller->getRejectedCount() : 0,
+           componentController.getFramesCoalesced(), componentController.getFramesExpired(),
+           componentController.getFramesFailed());
+    printf("setpoint changes     : %u in, %u delivered, %u dropped (%.2f%%), latency p50 %llu us, "
+           "p99 %llu us, max %llu us\n",
+           changes, delivered, dropped, changes ? 100.0 * dropped / changes : 0.0,
+           (unsigned long long)latency.p50, (unsigned long long)latency.p99, (unsigned long long)latency.max);
+    for (uint8_t wheel = 0; wheel < DRIVE_WHEEL_COUNT; wheel++) {
+        const ReplayChannel_t& vel = replay.channels[ComponentController::velocitySlot(wheel)];
+        const ReplayChannel_t& pos = replay.channels[ComponentController::positionSlot(wheel)];
+        printf("wheel %u fidelity     : velocity %.1f -> %.1f changes/s (%u of %u delivered, %.1f frames/s out), "
+               "steering %.1f -> %.1f changes/s (%u of %u delivered, %.1f frames/s out)\n",
+               wheel, spanSeconds > 0 ? vel.changes / spanSeconds : 0.0,
+               spanSeconds > 0 ? vel.delivered / spanSeconds : 0.0, vel.delivered, vel.changes,
+               simSeconds > 0 ? vel.outputFrames / simSeconds : 0.0,
+               spanSeconds > 0 ? pos.changes / spanSeconds : 0.0,
+               spanSeconds > 0 ? pos.delivered / spanSeconds : 0.0, pos.delivered, pos.changes,
+               simSeconds > 0 ? pos.outputFrames / simSeconds : 0.0);
+    }
+    if (recordPath != nullptr) {
+        printf("output recorded      : %s (%u frames, candump -l, seconds from replay start)\n",
+               recordPath, replay.outputFrames);
+    }
+
+    if (maxDropped >= 0 && dropped > (uint32_t)maxDropped) {
+        printf("FAIL: %u setpoint changes dropped, bound %ld\n", dropped, maxDropped);
+        return 1;
+    }
+    return 0;
+}
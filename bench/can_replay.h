@@ -0,0 +1,77 @@
+/**
+ * @file can_replay.h
+ * @brief Replays recorded CAN traffic (candump / Vector ASC) through the bridge firmware
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * A capture of the Jetson bus is read into memory, then fed to the real
+ * sketch through the bridge rig with its original timing, scaled timing,
+ * or back to back at the Jetson bus bit rate ("as fast as possible").
+ * Every frame the firmware hands to the MCP2517FD can be written out again
+ * in candump log format with simulated timestamps, so two firmware builds
+ * replaying the same capture can be compared with diff.
+ *
+ * Run as: program replay LOG [options], see runReplay().
+ */
+
+#ifndef CAN_REPLAY_H
+#define CAN_REPLAY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "ACAN2517FD.h"
+#include "bridge_rig.h"
+
+// One frame read from a capture
+typedef struct {
+    uint64_t timestampMicros;   // As recorded (absolute, or from the start of the ASC measurement)
+    std::string iface;          // candump interface name or ASC channel number
+    uint32_t id;
+    bool extended;
+    bool remote;
+    bool fd;
+    bool brs;
+    uint8_t len;
+    uint8_t data[64];
+} LoggedFrame_t;
+
+// Capture formats
+#define CAN_LOG_CANDUMP 0       // candump -l log lines, or candump's default console format
+#define CAN_LOG_ASC 1           // Vector ASCII log
+
+// Reads a capture, picking the format from its first lines; false with a
+// message in error when the file cannot be read. Lines that are not frames
+// (headers, comments, error frames, events) are skipped and counted.
+bool readCanLog(const char* path, std::vector<LoggedFrame_t>& frames, int& format,
+                uint32_t& skippedLines, std::string& error);
+
+// Writes one frame as a candump -l log line: (seconds.micros) iface ID#DATA
+void writeCandumpLine(FILE* out, uint64_t timestampMicros, const char* iface, const CANFDMessage& msg);
+
+// Classic frames from a capture, with their replay arrival times. speed
+// scales the recorded gaps (2 = twice as fast); 0 sends each frame as soon
+// as the previous one has left the Jetson bus.
+class ReplayFrameSource : public JetsonFrameSource {
+public:
+    ReplayFrameSource(const std::vector<LoggedFrame_t>& frames, uint64_t startMicros, double speed);
+
+    uint64_t nextArrivalMicros() override;
+    void next(CAN_message_t& msg) override;
+
+    uint64_t lastArrivalMicros() const;
+
+    // Optional observer for every frame, called with its arrival time
+    void (*onInject)(const CAN_message_t& msg, uint64_t arrivalMicros);
+
+private:
+    const std::vector<LoggedFrame_t>& frames;
+    std::vector<uint64_t> arrivals;
+    size_t index;
+};
+
+// Entry point for "program replay ..."; returns the process exit code
+int runReplay(int argc, char** argv);
+
+#endif // CAN_REPLAY_H
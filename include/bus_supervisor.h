@@ -0,0 +1,147 @@
+/**
+ * @file bus_supervisor.h
+ * @brief CAN error state tracking and rate-limited bus recovery
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Every HAT_BUS_POLL_INTERVAL_MS the sketch reads the error counters and
+ * fault state of each controller (FlexCAN for the Jetson links, the
+ * MCP2517FD for the ODrives) and hands them to update(). The supervisor
+ * classifies the bus (ISO 11898-1 error states), counts transitions and
+ * decides when the owner of the controller should step in:
+ *
+ *  - Error passive: nothing to do, the controller still takes part.
+ *  - Bus-off: both controllers rejoin by themselves after 128 x 11
+ *    recessive bits once the fault is gone. Only a bus still off after
+ *    HAT_BUS_OFF_HOLDOFF_MS is recovered.
+ *  - Offline: the MCP2517FD left normal mode (restricted operation after
+ *    a system error, or configuration mode after a reset of the chip).
+ *    Recovered at once.
+ *
+ * A recovery episode starts with BUS_ACTION_RESTART (back to normal mode,
+ * configuration kept) and escalates to BUS_ACTION_REINIT (the controller
+ * set up again from scratch) if the bus is still down at the next attempt.
+ * Attempts are spaced HAT_BUS_RECOVERY_MIN_MS apart, doubling up to
+ * HAT_BUS_RECOVERY_MAX_MS while they fail, so a wiring fault that persists
+ * does not keep the loop in controller set-up; the spacing starts over once
+ * the bus has stayed up for HAT_BUS_RECOVERY_STABLE_MS.
+ *
+ * Time spent error passive or worse, time spent down (bus-off or offline)
+ * and frames the link could not send meanwhile are accumulated per bus,
+ * so link availability can be read back on DIAG_PAGE_BUS_HEALTH (layout in
+ * message_construction.h). Buses are the DIAG_BUS_* numbers. Loop context
+ * only.
+ */
+
+#ifndef BUS_SUPERVISOR_H
+#define BUS_SUPERVISOR_H
+
+#include <stdint.h>
+#include "diagnostics.h"
+#include "hat_config.h"
+
+// Error states, in order of severity
+#define BUS_STATE_ACTIVE 0        // Both counters below 96
+#define BUS_STATE_WARNING 1       // A counter at 96 or above
+#define BUS_STATE_PASSIVE 2       // A counter at 128 or above
+#define BUS_STATE_BUS_OFF 3       // Transmit counter past 255, off the bus
+#define BUS_STATE_OFFLINE 4       // Controller not in a mode that takes part in traffic
+#define BUS_STATE_COUNT 5
+
+// What the owner of the controller should do now
+#define BUS_ACTION_NONE 0
+#define BUS_ACTION_RESTART 1      // Back to normal mode, configuration kept
+#define BUS_ACTION_REINIT 2       // Set the controller up again
+
+// One reading of a controller
+typedef struct {
+    uint8_t tec;                  // Transmit error counter
+    uint8_t rec;                  // Receive error counter
+    bool busOff;
+    bool offline;
+} BusErrorState_t;
+
+class BusSupervisor {
+public:
+    // Constructor - every bus error active, nothing counted
+    BusSupervisor();
+
+    // One poll of one bus. lostFrames is a running count of frames the
+    // link could not send (refused or expired); the increase while the
+    // bus is degraded counts as lost to the fault. Returns BUS_ACTION_*.
+    uint8_t update(uint8_t bus, const BusErrorState_t& state, uint32_t lostFrames, uint32_t nowMicros);
+
+    // Outcome of the action update() returned
+    void recoveryDone(uint8_t bus, uint8_t action, bool ok, uint32_t nowMicros);
+
+    // update() and recoveryDone() for one link: anything with
+    // readBusErrors(BusErrorState_t&) and recoverBus(action), which
+    // CANBusInterface and ComponentController both provide. A link that
+    // cannot be read right now is skipped until the next poll.
+    template <typename Link>
+    void poll(uint8_t bus, Link& link, uint32_t lostFrames, uint32_t nowMicros) {
+        BusErrorState_t state;
+        if (!link.readBusErrors(state)) {
+            return;
+        }
+        const uint8_t action = update(bus, state, lostFrames, nowMicros);
+        if (action != BUS_ACTION_NONE) {
+            recoveryDone(bus, action, link.recoverBus(action), nowMicros);
+        }
+    }
+
+    // Record access for DIAG_PAGE_BUS_HEALTH; false past the end of the page
+    bool getRecord(uint8_t index, uint32_t& value, uint16_t& aux) const;
+
+    // Statistics
+    uint8_t getState(uint8_t bus) const;
+    uint8_t getPeakTec(uint8_t bus) const;
+    uint8_t getPeakRec(uint8_t bus) const;
+    uint32_t getTransitionCount(uint8_t bus) const;
+    uint32_t getBusOffCount(uint8_t bus) const;        // Times the bus went off or offline
+    uint32_t getRecoveryCount(uint8_t bus) const;      // Attempts, either action
+    uint32_t getReinitCount(uint8_t bus) const;
+    uint32_t getRecoveryFailures(uint8_t bus) const;   // Attempts after which the bus was still down
+    uint32_t getDegradedMillis(uint8_t bus) const;     // Error passive or worse
+    uint32_t getDownMillis(uint8_t bus) const;         // Bus-off or offline
+    uint32_t getLongestDownMillis(uint8_t bus) const;  // Longest single episode
+    uint32_t getFramesLost(uint8_t bus) const;
+
+    static uint8_t classify(const BusErrorState_t& state);
+
+private:
+    typedef struct {
+        uint8_t state;
+        uint8_t tec;
+        uint8_t rec;
+        uint8_t peakTec;
+        uint8_t peakRec;
+        bool polled;
+        uint32_t lastPollMicros;
+        uint32_t lastLost;
+        uint32_t downSinceMicros;
+        uint32_t upSinceMicros;
+        uint32_t lastAttemptMicros;
+        uint32_t spacingMs;       // Wait after the last attempt
+        uint32_t backoffMs;       // Wait after the next one
+        uint8_t episodeAttempts;  // Recovery attempts since the bus went down
+        uint32_t transitions;
+        uint32_t busOffs;
+        uint32_t recoveries;
+        uint32_t reinits;
+        uint32_t failures;
+        uint64_t degradedMicros;
+        uint64_t downMicros;
+        uint32_t longestDownMicros;
+        uint32_t framesLost;
+    } BusHealth_t;
+
+    BusHealth_t buses[DIAG_BUS_COUNT];
+
+    static bool isDown(uint8_t state);
+    uint8_t nextAction(BusHealth_t& health, uint32_t nowMicros);
+};
+
+extern BusSupervisor busSupervisor;
+
+#endif // BUS_SUPERVISOR_H
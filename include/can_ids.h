@@ -0,0 +1,123 @@
+/**
+ * @file can_ids.h
+ * @brief Compile-time CAN identifier codecs and constant-time dispatch tables
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#ifndef CAN_IDS_H
+#define CAN_IDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Standard (11-bit) identifier space
+#define CAN_STD_ID_COUNT 2048
+#define CAN_STD_ID_MASK 0x7FF
+#define CAN_EXT_ID_MASK 0x1FFFFFFF
+
+// --- HAT 29-bit extended identifier (layout in message_construction.h) ---
+
+typedef struct {
+    uint8_t priority;   // 5 bits
+    uint8_t source;     // Source node ID
+    uint8_t target;     // Target node ID, CAN_BROADCAST_ADDR for broadcast
+    uint8_t type;       // MSG_TYPE_*
+} HatCanId_t;
+
+constexpr uint32_t encodeHatId(uint8_t priority, uint8_t source, uint8_t target, uint8_t type) {
+    return ((uint32_t)(priority & 0x1F) << 24) | ((uint32_t)source << 16) |
+           ((uint32_t)target << 8) | (uint32_t)type;
+}
+
+constexpr uint32_t encodeHatId(const HatCanId_t& id) {
+    return encodeHatId(id.priority, id.source, id.target, id.type);
+}
+
+constexpr uint8_t hatIdPriority(uint32_t id) { return (uint8_t)((id >> 24) & 0x1F); }
+constexpr uint8_t hatIdSource(uint32_t id) { return (uint8_t)(id >> 16); }
+constexpr uint8_t hatIdTarget(uint32_t id) { return (uint8_t)(id >> 8); }
+constexpr uint8_t hatIdType(uint32_t id) { return (uint8_t)id; }
+
+constexpr HatCanId_t decodeHatId(uint32_t id) {
+    return HatCanId_t{ hatIdPriority(id), hatIdSource(id), hatIdTarget(id), hatIdType(id) };
+}
+
+// --- ODrive CAN Simple identifier: cmd << 5 | node_id ---
+
+#define ODRIVE_NODE_BITS 5
+#define ODRIVE_NODE_MASK 0x1F
+#define ODRIVE_CMD_COUNT 64
+
+constexpr uint32_t encodeODriveId(uint8_t cmd, uint8_t node) {
+    return ((uint32_t)(cmd & 0x3F) << ODRIVE_NODE_BITS) | (uint32_t)(node & ODRIVE_NODE_MASK);
+}
+
+constexpr uint8_t odriveIdNode(uint32_t id) { return (uint8_t)(id & ODRIVE_NODE_MASK); }
+constexpr uint8_t odriveIdCmd(uint32_t id) { return (uint8_t)((id >> ODRIVE_NODE_BITS) & 0x3F); }
+
+// --- Constant-time dispatch ---
+//
+// Routes a key (a standard ID, a HAT message type, an ODrive command...) to
+// a handler with one array lookup, however many routes there are. Tables
+// are built at compile time from a route list:
+//
+//   static constexpr MyTable::Route ROUTES[] = { { key, handler, arg }, ... };
+//   static constexpr MyTable TABLE(ROUTES);
+//
+// and live in read-only memory. Duplicate or out-of-range keys fail the
+// build.
+template <typename Frame, size_t KeySpace, size_t RouteCount>
+class CanDispatchTable {
+public:
+    static_assert(RouteCount > 0 && RouteCount < 255, "route count must fit the uint8_t index");
+
+    typedef void (*Handler)(const Frame& frame, uint8_t arg);
+
+    typedef struct {
+        uint32_t key;
+        Handler handler;
+        uint8_t arg;
+    } Route;
+
+    constexpr explicit CanDispatchTable(const Route (&table)[RouteCount]) : routes(), index() {
+        for (size_t i = 0; i < RouteCount; i++) {
+            routes[i] = table[i];
+            // Not a constant expression (so a build error) for a bad key
+            if (table[i].key >= KeySpace || index[table[i].key] != 0) {
+                invalidRoute();
+            }
+            index[table[i].key] = (uint8_t)(i + 1);
+        }
+    }
+
+    // Runs the handler for key; false if nothing is routed there
+    bool dispatch(uint32_t key, const Frame& frame) const {
+        if (key >= KeySpace) {
+            return false;
+        }
+        const uint8_t slot = index[key];
+        if (slot == 0) {
+            return false;
+        }
+        const Route& route = routes[slot - 1];
+        route.handler(frame, route.arg);
+        return true;
+    }
+
+    // Route number for key (0 .. size()-1), or -1 when unrouted
+    constexpr int routeOf(uint32_t key) const {
+        return (key < KeySpace && index[key] != 0) ? (int)index[key] - 1 : -1;
+    }
+
+    constexpr size_t size() const { return RouteCount; }
+    constexpr uint32_t keyAt(size_t route) const { return routes[route].key; }
+
+private:
+    Route routes[RouteCount];
+    uint8_t index[KeySpace];
+
+    static void invalidRoute() {}
+};
+
+#endif // CAN_IDS_H
@@ -3,33 +3,381 @@
  * @brief CAN network interface header
  * @author SIRI Electrical Team
  * @date 2025
+ *
+ * One CANBusInterface per Jetson link, each on its own FlexCAN controller
+ * (CAN1, CAN2 or CAN3) with its own queue sizes. Everything that does not
+ * depend on the controller - dispatch, filter planning, diagnostics, frame
+ * layout - lives in CANInterfaceBase; the template only owns the FlexCAN_T4
+ * object and the receive trampoline, which is per instantiation, so two
+ * links never share a callback. One object per controller.
  */
 
 #ifndef CAN_INTERFACE_H
 #define CAN_INTERFACE_H
 
 #include <stdint.h>
+#include <atomic>
 #include "message_construction.h"
 #include "state_machine.h"
+#include "telemetry_store.h"
+#include "filter_planner.h"
+#include "diagnostics.h"
+#include "bus_supervisor.h"
+#include "hat_profile.h"
+#include "trace.h"
+#include "hat_config.h"
 #include <FlexCAN_T4.h>
+#include "Arduino.h"
 
-class CANInterface {
+// ESR1 fault confinement (FLTCONF, bits 5:4): 1x is bus off. ECR holds
+// TXERRCNT in 7:0 and RXERRCNT in 15:8.
+#define FLEXCAN_ESR1_FLTCONF_BUS_OFF 0x20
+
+// Jetson links; each has its own diagnostics bus, ISR and queue slots
+#define CAN_LINK_PRIMARY 0
+#define CAN_LINK_AUX 1
+#define CAN_LINK_COUNT 2
+
+// How one FlexCAN mailbox is programmed
+typedef enum {
+    MAILBOX_RX_STD_EXACT,       // One standard ID (id)
+    MAILBOX_RX_STD_MASK,        // Standard ID/mask filter
+    MAILBOX_RX_EXT_MASK,        // Extended ID/mask filter
+    MAILBOX_RX_STD_CLOSED,      // Receive, rejects everything
+    MAILBOX_RX_EXT_CLOSED,
+    MAILBOX_TX
+} MailboxMode_t;
+
+typedef struct {
+    MailboxMode_t mode;
+    uint32_t id;
+    uint32_t mask;
+} MailboxSetup_t;
+
+// FlexCAN_T4 reports CAN1..CAN3 as msg.bus 1..3
+constexpr uint8_t flexcanBusNumber(CAN_DEV_TABLE bus) {
+    return bus == CAN1 ? 1 : (bus == CAN2 ? 2 : 3);
+}
+
+// NVIC interrupt of a FlexCAN controller, for SPI.usingInterrupt()
+constexpr IRQ_NUMBER_t flexcanIrq(CAN_DEV_TABLE bus) {
+    return bus == CAN1 ? IRQ_CAN1 : (bus == CAN2 ? IRQ_CAN2 : IRQ_CAN3);
+}
+
+class CANInterfaceBase {
 public:
-    // Constructor/Destructor
-    CANInterface();
-    ~CANInterface();
-    
+    // Message Reception - runs in the FlexCAN interrupt
+    bool receiveMessage(CAN_message_t& message);
+
+    // Statistics
+    uint8_t getLink() const { return link; }
+    uint32_t getUnroutedCount() const;
+    const FilterPlan_t& getFilterPlan() const;
+    const FilterPlan_t& getExtFilterPlan() const;
+    uint8_t getDedicatedMailboxCount() const;
+
+    // Link receiving on FlexCAN bus number 1..3, nullptr if none
+    static CANInterfaceBase* forBus(uint8_t busNumber);
+
+    // Latest diagnostic request on this link, answered from loop context
+    void postDiagnosticRequest(const CAN_message_t& msg);
+
+    // Config requests on this link, queued for loop context in arrival order
+    void postConfigRequest(const CAN_message_t& msg);
+    uint32_t getDroppedConfigCount() const;
+
+    // Drive frame format (HAT_JETSON_FORMAT_*): a drive command handler
+    // notes the one the Jetson used, telemetry on every link follows it
+    // under HAT_JETSON_FORMAT_AUTO
+    static void notePeerFormat(uint8_t format);
+    static uint8_t getTelemetryFormat();
+
+protected:
+    CANInterfaceBase(uint8_t busNumber, uint8_t link, uint8_t txRoles);
+    ~CANInterfaceBase();
+
+    // Mailbox layout for the Jetson messages; false if the filters do not fit
+    bool planMailboxes(MailboxSetup_t (&mailboxes)[HAT_JETSON_MAILBOXES]);
+    void registerDiagnostics();
+
+    // Frame layout; returns the number of telemetry frames filled
+    uint8_t buildDriveTelemetry(const DriveTelemetry_t& telemetry, CAN_message_t (&frames)[HatProfile::wheelCount]) const;
+    void buildTelemetrySummary(const TelemetrySummary_t& summary, CAN_message_t& frame) const;
+    void buildHeartbeat(HAT_State_t state, uint32_t uptimeMs, CAN_message_t& heartbeat) const;
+
+    // Takes the pending diagnostic request, then fills one response frame
+    // per record until it returns false
+    bool takeDiagnosticRequest(uint8_t& page, uint8_t& first, uint8_t& count, uint8_t& requester);
+    bool buildDiagnosticResponse(uint8_t page, uint8_t index, uint8_t requester, CAN_message_t& response) const;
+
+    // Takes the oldest config request, then carries it out against the
+    // parameter registry and fills its response frames (at most max)
+    bool takeConfigRequest(CAN_message_t& request);
+    uint8_t handleConfigRequest(const CAN_message_t& request, CAN_message_t* responses, uint8_t max) const;
+    // The answer to a CONFIG_SAVE from this link, once the save has finished
+    bool takeSaveResponse(CAN_message_t& response) const;
+
+    void countTx(const CAN_message_t& msg, bool ok);
+
+    const uint8_t busNumber;
+    const uint8_t link;
+    const uint8_t txRoles;          // HAT_LINK_TX_* frames this link sends
+    const uint8_t diagBus;
+    const uint8_t diagIsr;
+    const uint8_t diagRxQueue;
+    const uint8_t diagTxQueue;
+
+private:
+    FilterPlan_t filterPlan;        // Shared receive mailboxes
+    FilterPlan_t extFilterPlan;     // Extended-ID receive mailboxes, on target << 8 | type
+    uint8_t dedicatedMailboxes;     // One exact ID each, from MB0
+    volatile uint32_t unroutedFrames;    // Passed the mailbox filters, no handler
+    std::atomic<uint32_t> pendingDiagRequest;
+
+    // Config request ring: the receive interrupt writes at head, loop() reads at tail
+    CAN_message_t configRequests[HAT_CONFIG_REQUEST_QUEUE];
+    std::atomic<uint8_t> configHead;
+    std::atomic<uint8_t> configTail;
+    volatile uint32_t droppedConfigRequests;
+
+    static CANInterfaceBase* links[4];
+    static std::atomic<uint8_t> peerFormat;
+};
+
+template <CAN_DEV_TABLE Bus, FLEXCAN_RXQUEUE_TABLE RxSize, FLEXCAN_TXQUEUE_TABLE TxSize>
+class CANBusInterface : public CANInterfaceBase {
+public:
+    // No hardware access here; the controller starts in initialize()
+    explicit CANBusInterface(uint8_t link = CAN_LINK_PRIMARY,
+                             uint8_t txRoles = HAT_LINK_TX_TELEMETRY | HAT_LINK_TX_HEARTBEAT)
+        : CANInterfaceBase(flexcanBusNumber(Bus), link, txRoles) {
+        instance = this;
+    }
+
+    ~CANBusInterface() {
+        instance = nullptr;
+    }
+
     // Initialization
-    bool initialize();
-    
+    bool initialize() {
+        const bool ok = configureController();
+        can.mailboxStatus();
+
+        registerDiagnostics();
+        return ok;
+    }
+
+    // Bus Recovery (see bus_supervisor.h) - loop context
+    // Counters and fault state as the controller last reported them
+    bool readBusErrors(BusErrorState_t& state) {
+        // The registers themselves: error() only hands over what the error
+        // interrupt queued, so it has nothing once the bus has gone quiet
+        const uint32_t ecr = FLEXCANb_ECR(Bus);
+        const uint32_t esr1 = FLEXCANb_ESR1(Bus);
+        state.tec = (uint8_t)ecr;
+        state.rec = (uint8_t)(ecr >> 8);
+        state.busOff = (esr1 & FLEXCAN_ESR1_FLTCONF_BUS_OFF) != 0;
+        state.offline = false;
+        return true;
+    }
+
+    // FlexCAN has no lighter way off the bus than its own recovery, which
+    // the holdoff has already waited for: either action is a soft reset
+    // and the mailbox set-up of initialize() again. True once the
+    // controller is no longer bus-off.
+    bool recoverBus(uint8_t action) {
+        (void)action;
+        can.reset();
+        configureController();
+
+        BusErrorState_t state;
+        return readBusErrors(state) && !state.busOff;
+    }
+
     // Message Transmission
-    bool sendMessage(const CAN_message_t& message);
-    
-    // Message Reception
-    bool receiveMessage(CAN_message_t& message);
+    bool sendMessage(const CAN_message_t& message) {
+        const bool ok = writeFrame(message);
+        TRACE_FRAME(TRACE_EVENT_JETSON_TX, message.id, message.buf, message.len);
+        return ok;
+    }
+
+    // No-ops (true) on a link without the matching HAT_LINK_TX_* role
+    bool sendDriveTelemetry(const DriveTelemetry_t& telemetry) {
+        if ((txRoles & HAT_LINK_TX_TELEMETRY) == 0) {
+            return true;
+        }
+
+        // Every wheel from one snapshot, queued back to back
+        CAN_message_t frames[HatProfile::wheelCount];
+        const uint8_t count = buildDriveTelemetry(telemetry, frames);
+        bool ok = true;
+        for (uint8_t i = 0; i < count; ++i) {
+            ok = writeFrame(frames[i]) && ok;
+        }
+
+        for (uint8_t i = 0; i < count; ++i) {
+            TRACE_FRAME(TRACE_EVENT_JETSON_TX, frames[i].id, frames[i].buf, frames[i].len);
+        }
+        return ok;
+    }
+
+    bool sendTelemetrySummaries(const TelemetrySummary_t* summaries, uint8_t count) {
+        if ((txRoles & HAT_LINK_TX_TELEMETRY) == 0) {
+            return true;
+        }
+
+        bool ok = true;
+        CAN_message_t frame;
+        for (uint8_t i = 0; i < count; ++i) {
+            buildTelemetrySummary(summaries[i], frame);
+            ok = writeFrame(frame) && ok;
+            TRACE_FRAME(TRACE_EVENT_JETSON_TX, frame.id, frame.buf, frame.len);
+        }
+        return ok;
+    }
+
+    bool sendHeartbeat(HAT_State_t state, uint32_t uptimeMs) {
+        if ((txRoles & HAT_LINK_TX_HEARTBEAT) == 0) {
+            return true;
+        }
+
+        CAN_message_t heartbeat;
+        buildHeartbeat(state, uptimeMs, heartbeat);
+        const bool ok = writeFrame(heartbeat);
+        TRACE_EVENT(TRACE_EVENT_JETSON_TX, heartbeat.id, heartbeat.buf, heartbeat.len);
+        return ok;
+    }
+
+    // Diagnostics - loop context
+    uint8_t serviceDiagnostics() {
+        // Answers the latest request on this link; returns frames sent
+        uint8_t page, first, count, requester;
+        if (!takeDiagnosticRequest(page, first, count, requester)) {
+            return 0;
+        }
 
+        CAN_message_t response;
+        uint8_t sent = 0;
+        for (uint16_t index = first; index < (uint16_t)first + count && index <= 0xFF; ++index) {
+            if (!buildDiagnosticResponse(page, (uint8_t)index, requester, response) || !writeFrame(response)) {
+                break;
+            }
+            TRACE_FRAME(TRACE_EVENT_JETSON_TX, response.id, response.buf, response.len);
+            sent++;
+        }
+        return sent;
+    }
+
+    // Configuration - loop context; carries out every queued request and
+    // returns the response frames sent
+    uint8_t serviceConfig() {
+        CAN_message_t request;
+        CAN_message_t responses[HAT_DIAG_MAX_RECORDS];
+        uint8_t sent = 0;
+        while (takeConfigRequest(request)) {
+            const uint8_t count = handleConfigRequest(request, responses, HAT_DIAG_MAX_RECORDS);
+            for (uint8_t i = 0; i < count && writeFrame(responses[i]); ++i) {
+                TRACE_FRAME(TRACE_EVENT_JETSON_TX, responses[i].id, responses[i].buf, responses[i].len);
+                sent++;
+            }
+        }
+        if (takeSaveResponse(responses[0]) && writeFrame(responses[0])) {
+            TRACE_FRAME(TRACE_EVENT_JETSON_TX, responses[0].id, responses[0].buf, responses[0].len);
+            sent++;
+        }
+        return sent;
+    }
+
+    void recordQueueDepths() {
+        diagnostics.recordQueueDepth(diagRxQueue, can.getRXQueueCount(), RxSize);
+        diagnostics.recordQueueDepth(diagTxQueue, can.getTXQueueCount(), TxSize);
+    }
+
+private:
+    FlexCAN_T4<Bus, RxSize, TxSize> can;
+
+    // One per controller, so each bus has its own trampoline
+    static CANBusInterface* instance;
+
+    static void onReceive(const CAN_message_t& msg) {
+        const uint32_t start = ARM_DWT_CYCCNT;
+        CAN_message_t msg_copy = msg;
+        msg_copy.bus = flexcanBusNumber(Bus);
+        CANBusInterface* self = instance;
+        if (self != nullptr) {
+            self->receiveMessage(msg_copy);
+            diagnostics.recordIsr(self->diagIsr, ARM_DWT_CYCCNT - start);
+        }
+    }
+
+    // Clocks, bit rate and mailboxes; no diagnostics registration, so
+    // recoverBus() can run it again
+    bool configureController() {
+        can.begin();
+        can.setBaudRate(CAN_BAUDRATE);
+
+        // Mailbox layout is set explicitly; the library default makes MB4-7
+        // extended-ID mailboxes
+        can.setMaxMB(HAT_JETSON_MAILBOXES);
+        can.setMBFilter(REJECT_ALL);
+
+        MailboxSetup_t mailboxes[HAT_JETSON_MAILBOXES];
+        const bool ok = planMailboxes(mailboxes);
+        for (uint8_t i = 0; i < HAT_JETSON_MAILBOXES; ++i) {
+            const FLEXCAN_MAILBOX mb = (FLEXCAN_MAILBOX)i;
+            switch (mailboxes[i].mode) {
+                case MAILBOX_RX_STD_EXACT:
+                    can.setMB(mb, RX, STD);
+                    can.setMBFilter(mb, mailboxes[i].id);
+                    break;
+                case MAILBOX_RX_STD_MASK:
+                    can.setMB(mb, RX, STD);
+                    can.setMBUserFilter(mb, mailboxes[i].id, mailboxes[i].mask);
+                    break;
+                case MAILBOX_RX_EXT_MASK:
+                    can.setMB(mb, RX, EXT);
+                    can.setMBUserFilter(mb, mailboxes[i].id, mailboxes[i].mask);
+                    break;
+                case MAILBOX_RX_STD_CLOSED:
+                    can.setMB(mb, RX, STD);
+                    can.setMBFilter(mb, REJECT_ALL);
+                    break;
+                case MAILBOX_RX_EXT_CLOSED:
+                    can.setMB(mb, RX, EXT);
+                    can.setMBFilter(mb, REJECT_ALL);
+                    break;
+                case MAILBOX_TX:
+                    can.setMB(mb, TX);
+                    break;
+            }
+        }
+
+        can.enableMBInterrupts();
+
+        // Every link at one priority, so no receive interrupt preempts
+        // another: driveSetpoints takes one writer at a time
+        NVIC_SET_PRIORITY(flexcanIrq(Bus), HAT_JETSON_IRQ_PRIORITY);
+        can.onReceive(onReceive);
+        return ok;
+    }
+
+    // Every transmit on this link goes through here so it is counted
+    bool writeFrame(const CAN_message_t& msg) {
+        const bool ok = can.write(msg) > 0;
+        countTx(msg, ok);
+        return ok;
+    }
 };
 
-extern CANInterface *CANInterfaceInstance;
+template <CAN_DEV_TABLE Bus, FLEXCAN_RXQUEUE_TABLE RxSize, FLEXCAN_TXQUEUE_TABLE TxSize>
+CANBusInterface<Bus, RxSize, TxSize>* CANBusInterface<Bus, RxSize, TxSize>::instance = nullptr;
+
+// The Jetson links this build uses
+typedef CANBusInterface<HAT_JETSON_CAN_BUS, HAT_JETSON_RX_QUEUE, HAT_JETSON_TX_QUEUE> CANInterface;
+
+#if HAT_JETSON_AUX_ENABLED
+static_assert(HAT_JETSON_AUX_CAN_BUS != HAT_JETSON_CAN_BUS, "each Jetson link needs its own FlexCAN controller");
+typedef CANBusInterface<HAT_JETSON_AUX_CAN_BUS, HAT_JETSON_AUX_RX_QUEUE, HAT_JETSON_AUX_TX_QUEUE> AuxCANInterface;
+#endif
 
-#endif // CAN_INTERFACE_H
\ No newline at end of file
+#endif // CAN_INTERFACE_H
@@ -3,28 +3,173 @@
  * @brief Component controller header
  * @author SIRI Electrical Team
  * @date 2025
+ *
+ * ComponentControllerT is specialised on a HAT profile (hat_profile.h):
+ * node IDs, the frame table size and every per-wheel loop bound come from
+ * the profile at compile time. ComponentController is the instantiation
+ * for this build's HatProfile.
  */
 
 #ifndef COMPONENT_CTRL_H
 #define COMPONENT_CTRL_H
 
 #include <stdint.h>
-#include <array>
+#include <atomic>
 #include "ACAN2517FD.h"
 #include "hardware_map.h"
+#include "hat_profile.h"
+#include "message_construction.h"
+#include "filter_planner.h"
+#include "tx_queue.h"
+#include "setpoint_shaper.h"
+#include "mcp2517fd_transport.h"
+#include "bus_supervisor.h"
 
-class ComponentController {
+// Setpoint TX suppression and staleness (defaults in hat_config.h)
+typedef struct {
+    float velocityEpsilon;      // rad/s
+    float positionEpsilon;      // rad
+    uint16_t refreshMs;         // Keep-alive while holding a command
+    uint16_t staleMs;           // Setpoint age that makes a wheel stale
+    float staleDecel;           // rad/s^2, HAT_STALE_POLICY_RAMP
+} SetpointTuning_t;
+
+template <typename Profile>
+class ComponentControllerT {
 public:
+    // ODrive frame table layout: velocity frames first, then steering position
+    static constexpr uint8_t frameCount = 2 * Profile::wheelCount;
+    static constexpr uint8_t velocitySlot(uint8_t wheel) { return wheel; }
+    static constexpr uint8_t positionSlot(uint8_t wheel) { return Profile::wheelCount + wheel; }
+
+    static_assert(frameCount <= 32, "frame slots are tracked in a 32-bit tag mask");
+    static_assert(HAT_PERIPH_TXQ_DEPTH >= frameCount && HAT_PERIPH_TXQ_DEPTH <= 32,
+                  "HAT_PERIPH_TXQ_DEPTH must hold an Estop for every node");
+
     // Constructor/Destructor
-    ComponentController();
-    ~ComponentController();
+    ComponentControllerT();
+    ~ComponentControllerT();
     
     // Initialization
+    // Before initialize(): false leaves every MCP2517FD transfer to the
+    // library, one message per call (HAT_PERIPH_SPI_BATCHED by default)
+    void setSpiBatching(bool batched);
     bool initialize();
-    void update(std::array<CANFDMessage, 8> msg);
+    void update(const DriveSetpoints_t& setpoints);
+
+    // Decode up to maxFrames received peripheral frames; returns the number read
+    uint8_t drainReceive(uint8_t maxFrames);
+
+    // Publish receive buffer and transmit queue peaks to the diagnostics
+    void recordQueueDepths();
+
+    // Packed CAN FD setpoints for peripherals that support them
+    bool sendPackedSetpoints(const PackedSetpoint_t* entries, uint8_t count);
     
     // Safety Functions
+    // Latches the stop and puts an ODrive Estop for every drive and steer
+    // node into the MCP2517FD TXQ, ahead of queued setpoints. Safe from the
+    // FlexCAN interrupt; update() then drops pending drive frames and sends
+    // zero velocity, and nothing else, while latched.
     void emergencyStop();
+    // Loop context, once the state machine has left STATE_EMERGENCY_STOP
+    // (a RESET): unlatches and sends setpoints again from the next cycle.
+    // The state check and the clear run with interrupts held off, so a stop
+    // arriving meanwhile keeps the latch; returns false then.
+    bool clearEmergencyStop();
+    bool isEmergencyStopped() const;
+    uint32_t getEstopFramesSent() const;
+    uint32_t getEstopFramesFailed() const;
+
+    // Bus Recovery (see bus_supervisor.h)
+    // False while a transmit batch holds the SPI bus; try at the next poll.
+    // A recovery keeps the setpoint store and shaper, sends every setpoint
+    // again on the next cycle and repeats the Estops if the stop is latched.
+    // REINIT sets the MCP2517FD up again as initialize() did.
+    bool readBusErrors(BusErrorState_t& state);
+    bool recoverBus(uint8_t action);
+
+    // TX Statistics
+    uint32_t getFramesSent() const;         // Handed to the MCP2517FD
+    uint32_t getFramesSuppressed() const;   // Unchanged setpoints not queued
+    uint32_t getFramesFailed() const;       // Refused by a full transmit queue
+    uint32_t getFramesCoalesced() const;    // Replaced by a newer setpoint while queued
+    uint32_t getFramesExpired() const;      // Dropped at their deadline
+
+    // Staleness: a wheel whose Jetson setpoint is older than
+    // SetpointTuning_t::staleMs is handled by HAT_SETPOINT_STALE_POLICY
+    bool isSetpointStale(uint8_t wheel) const;
+
+    // Suppression and staleness thresholds - may change between drive cycles
+    void setSetpointTuning(const SetpointTuning_t& tuning);
+    const SetpointTuning_t& getSetpointTuning() const;
+
+    // Shaping: false forwards Jetson setpoints unchanged (HAT_SETPOINT_SHAPING
+    // by default). Limits start from the profile and may change between
+    // drive cycles.
+    void setSetpointShaping(bool enabled);
+    bool isSetpointShaping() const;
+    void setWheelLimits(uint8_t wheel, const WheelLimits_t& limits);
+    const SetpointShaper& getSetpointShaper() const;
+
+    // SPI Statistics - zero while the library does the transfers
+    bool isSpiBatched() const;
+    SpiTransportStats_t getSpiStats() const;
+
+    // Receive Statistics
+    uint32_t getFramesReceived() const;
+    uint32_t getFramesUnrouted() const;
+    const FilterPlan_t& getFilterPlan() const;
+
+private:
+    // Per-frame change tracking, indexed like driveFrames
+    typedef struct {
+        float lastSentValue;
+        uint32_t lastSentMicros;
+        bool sentOnce;
+    } SetpointTxState_t;
+
+    // Preassembled ODrive frames (velocitySlot/positionSlot). IDs,
+    // lengths and flags are fixed at construction; only the setpoint float
+    // in data[0..3] is patched, and frames are sent straight from here.
+    CANFDMessage driveFrames[frameCount];
+    CANFDMessage estopFrames[frameCount];   // Same slots, sent through the TXQ
+    SetpointTxState_t txState[frameCount];
+
+    // Per wheel: arrival stamp last seen, latched stale until a newer one,
+    // and the drive velocity last commanded (the start of a ramp to zero)
+    uint32_t setpointReceived[Profile::wheelCount];
+    bool setpointStale[Profile::wheelCount];
+    float outputVelocity[Profile::wheelCount];
+    uint32_t lastUpdateMicros;
+    SetpointShaper shaper;
+    SetpointTuning_t tuning;
+    bool shaping;
+    bool spiBatching;
+    PeripheralTxQueue txQueue;
+    uint32_t framesSuppressed;
+    uint32_t framesFailed;
+    uint32_t framesReceived;
+    uint32_t framesUnrouted;
+    FilterPlan_t filterPlan;        // MCP2517FD acceptance filters
+    std::atomic<bool> estopLatched;
+    std::atomic<uint32_t> estopFramesSent;
+    std::atomic<uint32_t> estopFramesFailed;
+    bool estopHandled;              // update() has flushed and zeroed after the latch
+
+    bool startController();
+    bool shouldSend(const SetpointTxState_t& state, float value, float epsilon, uint32_t nowMicros) const;
+    void buildDriveFrameTable();
+    void sendSetpoint(uint8_t slot, float value, float epsilon, uint32_t nowMicros);
+    bool checkFreshness(uint8_t wheel, uint32_t receivedMicros, uint32_t nowMicros);
+    float staleVelocity(uint8_t wheel, uint32_t elapsedMicros) const;
+    void placeSteering(uint8_t wheel);
+    void holdEmergencyStop(uint32_t nowMicros);
 };
 
+// Instantiated in component_ctrl.cpp
+typedef ComponentControllerT<HatProfile> ComponentController;
+
+extern ComponentController *ComponentControllerInstance;
+
 #endif // COMPONENT_CTRL_H
\ No newline at end of file
@@ -0,0 +1,158 @@
+/**
+ * @file diagnostics.h
+ * @brief Bridge metrics: per-ID counters, bus load, ISR timing, queue peaks, setpoint ages
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Counters are updated from both interrupt and loop() context with relaxed
+ * atomics, so nothing here ever blocks. The CAN IDs worth counting are
+ * registered once at initialisation (from the receive schemas and the
+ * frames the bridge sends) into a small hash table; frames on unregistered
+ * IDs land in a per-bus "other" counter. Extended HAT IDs are counted by
+ * target and type, whatever their priority and source. Setpoint ages are
+ * recorded by the drive cycle and kept in plain loop-context fields. Boot
+ * phases are stamped once each, with micros() since reset.
+ *
+ * Everything is readable over the Jetson bus with MSG_TYPE_DIAGNOSTIC_REQ,
+ * one record per MSG_TYPE_DIAGNOSTIC_RESP frame (layout in
+ * message_construction.h).
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdint.h>
+#include <atomic>
+#include "hat_config.h"
+#include "setpoint_store.h"
+
+// Buses
+#define DIAG_BUS_JETSON 0
+#define DIAG_BUS_PERIPH 1
+#define DIAG_BUS_JETSON_AUX 2     // Second Jetson link (HAT_JETSON_AUX_ENABLED)
+#define DIAG_BUS_COUNT 3
+
+// Instrumented interrupt handlers
+#define DIAG_ISR_JETSON_RX 0      // FlexCAN receive callback
+#define DIAG_ISR_PERIPH 1         // MCP2517FD interrupt
+#define DIAG_ISR_JETSON_AUX_RX 2  // FlexCAN receive callback, second Jetson link
+#define DIAG_ISR_COUNT 3
+
+// Histogram bucket b counts runs of [2^(b+DIAG_ISR_BUCKET_SHIFT), 2^(b+1+SHIFT))
+// cycles; the first and last buckets are open ended
+#define DIAG_ISR_BUCKETS 12
+#define DIAG_ISR_BUCKET_SHIFT 6
+
+// Queues whose peak occupancy is tracked
+#define DIAG_QUEUE_PERIPH_RX 0    // MCP2517FD driver receive buffer
+#define DIAG_QUEUE_PERIPH_TX 1    // Peripheral transmit queue (tx_queue.h)
+#define DIAG_QUEUE_JETSON_RX 2    // FlexCAN receive queue
+#define DIAG_QUEUE_JETSON_TX 3    // FlexCAN transmit queue
+#define DIAG_QUEUE_JETSON_AUX_RX 4    // Second Jetson link
+#define DIAG_QUEUE_JETSON_AUX_TX 5
+#define DIAG_QUEUE_COUNT 6
+
+// Boot phases, in the order setup() reaches them
+#define DIAG_BOOT_SETUP 0         // setup() entered
+#define DIAG_BOOT_SERIAL 1        // Serial monitor wait over (or skipped)
+#define DIAG_BOOT_JETSON_UP 2     // Jetson link(s) receiving
+#define DIAG_BOOT_PERIPH_UP 3     // MCP2517FD in normal mode
+#define DIAG_BOOT_SCHEDULED 4     // Tasks released
+#define DIAG_BOOT_FIRST_COMMAND 5 // First Jetson drive command received
+#define DIAG_BOOT_FIRST_FORWARD 6 // First setpoint built from it handed to the MCP2517FD
+#define DIAG_BOOT_PHASE_COUNT 7
+
+class BridgeDiagnostics {
+public:
+    // Constructor
+    BridgeDiagnostics();
+
+    // Setup - register an ID before traffic on it is counted individually
+    bool registerId(uint8_t bus, uint32_t id, bool extended);
+    void setBitRate(uint8_t bus, uint32_t nominalBitRate, uint8_t dataBitRateFactor);
+
+    // Counting - interrupt or loop context
+    void countRx(uint8_t bus, uint32_t id, bool extended, uint8_t len, bool fd = false);
+    void countTx(uint8_t bus, uint32_t id, bool extended, uint8_t len, bool ok, bool fd = false);
+    void recordIsr(uint8_t isr, uint32_t cycles);
+    void recordQueueDepth(uint8_t queue, uint16_t depth, uint16_t capacity);
+
+    // Age of a wheel's setpoint at the drive cycle that used it - loop context
+    void recordSetpointAge(uint8_t wheel, uint32_t ageMicros, bool stale);
+    void setSetpointStaleLimit(uint16_t staleMs);    // Reported with the ages
+
+    // First time a boot phase is reached - interrupt or loop context
+    void markBoot(uint8_t phase, uint32_t nowMicros);
+
+    // Close the utilisation window if HAT_DIAG_WINDOW_MS has passed - loop context
+    void sample(uint32_t nowMicros);
+
+    // Record access for the diagnostic protocol; false past the end of a page
+    bool getRecord(uint8_t page, uint8_t index, uint32_t& value, uint16_t& aux) const;
+
+    // Statistics
+    uint8_t getIdCount() const;
+    uint16_t getUtilisationPermille(uint8_t bus) const;
+    uint32_t getIsrMaxCycles(uint8_t isr) const;
+    uint32_t getTxFailures(uint8_t bus) const;
+    uint16_t getQueuePeak(uint8_t queue) const;
+    uint32_t getSetpointMeanAge(uint8_t wheel) const;
+    uint32_t getSetpointMaxAge(uint8_t wheel) const;
+    uint32_t getSetpointStaleEvents(uint8_t wheel) const;
+    uint32_t getSetpointStaleCycles(uint8_t wheel) const;
+    uint32_t getBootMicros(uint8_t phase) const;      // 0 until reached
+
+private:
+    typedef struct {
+        uint32_t key;                    // bus << 31 | extended << 30 | id
+        std::atomic<uint32_t> rx;
+        std::atomic<uint32_t> tx;
+        std::atomic<uint32_t> txFailed;
+    } IdCounters_t;
+
+    typedef struct {
+        std::atomic<uint32_t> wireBits;  // Nominal-rate bit times, wraps
+        std::atomic<uint32_t> otherRx;
+        std::atomic<uint32_t> otherTx;
+        std::atomic<uint32_t> txFailed;
+        uint32_t bitRate;
+        uint8_t dataFactor;
+        uint32_t windowStartBits;
+        uint16_t utilisationPermille;    // Over the last complete window
+    } BusCounters_t;
+
+    typedef struct {
+        std::atomic<uint32_t> buckets[DIAG_ISR_BUCKETS];
+        std::atomic<uint32_t> maxCycles;
+    } IsrHistogram_t;
+
+    typedef struct {
+        uint64_t totalAgeMicros;         // Over fresh cycles
+        uint32_t freshCycles;
+        uint32_t maxAgeMicros;
+        uint32_t staleCycles;
+        uint32_t staleEvents;
+        bool stale;
+    } SetpointAge_t;
+
+    IdCounters_t ids[HAT_DIAG_MAX_IDS];
+    std::atomic<uint8_t> idCount;
+    std::atomic<uint8_t> slots[HAT_DIAG_HASH_SLOTS];   // ids[] index + 1, 0 = empty
+    BusCounters_t buses[DIAG_BUS_COUNT];
+    IsrHistogram_t isrs[DIAG_ISR_COUNT];
+    std::atomic<uint16_t> queuePeak[DIAG_QUEUE_COUNT];
+    uint16_t queueCapacity[DIAG_QUEUE_COUNT];
+    SetpointAge_t setpointAges[DRIVE_WHEEL_COUNT];
+    uint16_t setpointStaleMs;
+    std::atomic<uint32_t> bootMicros[DIAG_BOOT_PHASE_COUNT];
+    uint32_t windowStartMicros;
+    bool windowOpen;
+
+    static uint32_t makeKey(uint8_t bus, uint32_t id, bool extended);
+    int findIndex(uint32_t key) const;
+    uint32_t frameBits(uint8_t bus, uint8_t len, bool extended, bool fd) const;
+};
+
+extern BridgeDiagnostics diagnostics;
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,53 @@
+/**
+ * @file filter_planner.h
+ * @brief Acceptance-filter planning for the FlexCAN mailboxes and MCP2517FD
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Turns the set of CAN IDs the bridge handles into as few ID/mask filters
+ * as the hardware has room for, so frames nobody reads are dropped by the
+ * controller instead of costing an interrupt.
+ *
+ * IDs differing in one bit are merged first; those merges are free, as
+ * they accept nothing extra. If the result still needs more filters than
+ * are available, the pair whose merge admits the fewest unhandled IDs is
+ * merged until it fits. The plan reports how many unhandled IDs it lets
+ * through and what share of the ID space it rejects.
+ */
+
+#ifndef FILTER_PLANNER_H
+#define FILTER_PLANNER_H
+
+#include <stdint.h>
+
+#define FILTER_PLAN_MAX_IDS 64
+
+typedef struct {
+    uint32_t id;     // Acceptance value (already masked)
+    uint32_t mask;   // 1 = bit must match
+} CanFilter_t;
+
+typedef struct {
+    CanFilter_t filters[FILTER_PLAN_MAX_IDS];
+    uint8_t count;
+    uint8_t idBits;          // 11 (standard) or 29 (extended)
+    uint16_t handledIds;     // Distinct IDs the plan was built for
+    uint32_t extraIds;       // Unhandled IDs the filters also accept
+} FilterPlan_t;
+
+// Plan at most maxFilters filters covering ids[0..count-1]. Returns false
+// (and an empty plan) if there are no IDs, too many, or no filters.
+bool planFilters(const uint32_t* ids, uint8_t count, uint8_t idBits, uint8_t maxFilters,
+                 FilterPlan_t& plan);
+
+// True if the plan accepts id
+bool filterPlanAccepts(const FilterPlan_t& plan, uint32_t id);
+
+// Share of the whole ID space rejected, assuming uniform traffic, by the
+// plan plus dedicatedIds exact filters programmed alongside it
+float filterPlanRejectionRate(const FilterPlan_t& plan, uint16_t dedicatedIds = 0);
+
+// Print a one-line summary to Serial (debug builds only)
+void reportFilterPlan(const char* bus, const FilterPlan_t& plan, uint8_t dedicated);
+
+#endif // FILTER_PLANNER_H
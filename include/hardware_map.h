@@ -10,21 +10,26 @@
 
 #include <stdint.h>
 #include "hat_config.h"
+#include "setpoint_store.h"
+#include "telemetry_store.h"
+#include "telemetry_aggregator.h"
+#include "hat_profile.h"
 
 
-// Desired locations for drive and steer
-extern float angular_vel[4];
-extern float steering_angle[4];
+// Desired locations for drive and steer (written by the FlexCAN ISR)
+extern DriveSetpointStore driveSetpoints;
 
-// Actual locations for drive and steer
-//float angular_vel_telemetry[4];
-//float wheel_pos_telemetry[4];
-//float steering_angle_telemetry[4];
+// Actual locations for drive and steer (ODrive encoder feedback)
+extern DriveTelemetryStore driveTelemetry;
+
+// Windows over the same feedback, summarised for the Jetson
+extern TelemetryAggregator telemetryAggregator;
 
 // GPIO Pin Definitions (Teensy 4.1)
 #define PIN_CAN_TX 28
 #define PIN_CAN_RX 29
 #define PIN_LED_STATUS 13
+#define PIN_DEBUG_STRAP 3       // Jumper to GND: wait for a serial monitor at boot
 
 // SPI Pins
 #define SPI_CS 10
@@ -33,35 +38,68 @@ extern float steering_angle[4];
 #define SPI_SCK 13
 #define INT_PIN 2
 
-#define PRIORITY_ZERO 0x00 << 8
-#define PRIORITY_JETSON 0x01 << 8
-#define PRIORITY_DRIVE 0x02 << 8
-#define PRIORITY_ARM 0x03 << 8
-#define PRIORITY_BPS 0x04 << 8
-#define PRIORITY_SCIENCE 0x05 << 8
-#define PRIORITY_SENSE 0x06 << 8
+// Jetson bus receive schema (standard IDs): X(name, id, handler, arg, mailbox)
+// The dispatch table in can_interface.cpp and the FlexCAN acceptance
+// filters are generated from this list, so a new message is one entry here
+// plus its handler. mailbox is JETSON_RX_DEDICATED for IDs that get a
+// mailbox of their own, JETSON_RX_SHARED for IDs left to the filter planner.
+#define JETSON_RX_SHARED 0
+#define JETSON_RX_DEDICATED 1
+
+#define JETSON_STD_MESSAGES(X) \
+    X(EMERGENCY_STOP,    MSG_TYPE_EMERGENCY_STOP,                    onEmergencyStop,    0, JETSON_RX_DEDICATED) \
+    X(EMERGENCY_BATTERY, MSG_TYPE_EMERGENCY_BATTERY,                 onEmergencyMessage, 0, JETSON_RX_DEDICATED) \
+    X(EMERGENCY_THERMAL, MSG_TYPE_EMERGENCY_THERMAL,                 onEmergencyMessage, 0, JETSON_RX_DEDICATED) \
+    X(SYSTEM_SHUTDOWN,   MSG_TYPE_SYSTEM_SHUTDOWN,                   onEmergencyStop,    0, JETSON_RX_DEDICATED) \
+    X(DRIVE_FRONT_LEFT,  PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_LEFT,  onDriveCommand,     0, JETSON_RX_SHARED) \
+    X(DRIVE_FRONT_RIGHT, PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_RIGHT, onDriveCommand,     1, JETSON_RX_SHARED) \
+    X(DRIVE_REAR_LEFT,   PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_LEFT,   onDriveCommand,     2, JETSON_RX_SHARED) \
+    X(DRIVE_REAR_RIGHT,  PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_RIGHT,  onDriveCommand,     3, JETSON_RX_SHARED) \
+    X(DRIVE_COMPACT_FRONT, PRIORITY_DRIVE | MESSAGE_DRIVE_COMPACT_FRONT, onCompactDriveCommand, 0, JETSON_RX_SHARED) \
+    X(DRIVE_COMPACT_REAR,  PRIORITY_DRIVE | MESSAGE_DRIVE_COMPACT_REAR,  onCompactDriveCommand, 1, JETSON_RX_SHARED)
+
+// Jetson bus receive schema (extended HAT IDs to HAT_NODE_ID, by message
+// type): X(name, type, handler, arg). Routed by the second dispatch table in
+// can_interface.cpp, filtered into the HAT_JETSON_EXT_RX_MAILBOXES.
+#define JETSON_EXT_MESSAGES(X) \
+    X(DIAGNOSTIC_REQ,  MSG_TYPE_DIAGNOSTIC_REQ,  onDiagnosticRequest, 0) \
+    X(CONFIG_SET,      MSG_TYPE_CONFIG_SET,      onConfigRequest,     0) \
+    X(CONFIG_GET,      MSG_TYPE_CONFIG_GET,      onConfigRequest,     0) \
+    X(CONFIG_SAVE,     MSG_TYPE_CONFIG_SAVE,     onConfigRequest,     0) \
+    X(CONFIG_LOAD,     MSG_TYPE_CONFIG_LOAD,     onConfigRequest,     0) \
+    X(STATE_UNLOCK,    MSG_TYPE_STATE_UNLOCK,    onStateRequest,      EVENT_UNLOCK) \
+    X(STATE_DISARM,    MSG_TYPE_STATE_DISARM,    onStateRequest,      EVENT_DISARM) \
+    X(STATE_ARM,       MSG_TYPE_STATE_ARM,       onStateRequest,      EVENT_ARM) \
+    X(STATE_LOCK,      MSG_TYPE_STATE_LOCK,      onStateRequest,      EVENT_LOCK) \
+    X(STATE_EMERGENCY, MSG_TYPE_STATE_EMERGENCY, onEmergencyStop,     0) \
+    X(STATE_RESET,     MSG_TYPE_STATE_RESET,     onStateRequest,      EVENT_RESET)
 
-// note 0x00 - 0x10 reserved for future use/high priority drive messages
-// for drive messages upper four byte is used for "traction", lower four bytes for "steering"
-#define MESSAGE_DRIVE_FRONT_LEFT 0x10
-#define MESSAGE_DRIVE_FRONT_RIGHT 0x11
-#define MESSAGE_DRIVE_REAR_LEFT 0x12
-#define MESSAGE_DRIVE_REAR_RIGHT 0x13
+// Peripheral bus receive schema (ODrive commands, any node): X(name, cmd, handler, arg)
+// The MCP2517FD acceptance filters and the dispatch table in
+// component_ctrl.cpp are generated from this list.
+#define PERIPH_ODRIVE_MESSAGES(X) \
+    X(ENCODER_ESTIMATES, ODRIVE_CMD_GET_ENCODER_ESTIMATES, onEncoderEstimates, 0)
 
-#define MESSAGE_DRIVE_FRONT_LEFT_ENCODER 0x20
-#define MESSAGE_DRIVE_FRONT_RIGHT_ENCODER 0x21
-#define MESSAGE_DRIVE_REAR_LEFT_ENCODER 0x22
-#define MESSAGE_DRIVE_REAR_RIGHT_ENCODER 0x23
+#define JETSON_MESSAGE_ENUM(name, id, handler, arg, mailbox) JETSON_MSG_##name,
+typedef enum {
+    JETSON_STD_MESSAGES(JETSON_MESSAGE_ENUM)
+    JETSON_STD_MESSAGE_COUNT
+} JetsonMessage_t;
+#undef JETSON_MESSAGE_ENUM
 
-static constexpr uint8_t NODE_DRIVE_FL = 4;
-static constexpr uint8_t NODE_DRIVE_FR = 2;
-static constexpr uint8_t NODE_DRIVE_RL = 3;
-static constexpr uint8_t NODE_DRIVE_RR = 1;
+#define JETSON_EXT_MESSAGE_ENUM(name, type, handler, arg) JETSON_EXT_MSG_##name,
+typedef enum {
+    JETSON_EXT_MESSAGES(JETSON_EXT_MESSAGE_ENUM)
+    JETSON_EXT_MESSAGE_COUNT
+} JetsonExtMessage_t;
+#undef JETSON_EXT_MESSAGE_ENUM
 
-static constexpr uint8_t NODE_STEER_FL = 5;
-static constexpr uint8_t NODE_STEER_FR = 6;
-static constexpr uint8_t NODE_STEER_RL = 7;
-static constexpr uint8_t NODE_STEER_RR = 8;
+#define PERIPH_MESSAGE_ENUM(name, cmd, handler, arg) PERIPH_MSG_##name,
+typedef enum {
+    PERIPH_ODRIVE_MESSAGES(PERIPH_MESSAGE_ENUM)
+    PERIPH_ODRIVE_MESSAGE_COUNT
+} PeriphMessage_t;
+#undef PERIPH_MESSAGE_ENUM
 
 
 
@@ -92,13 +130,6 @@ static constexpr uint8_t NODE_STEER_RR = 8;
 #define ADDR_COMPONENT_4 (HAT_COMPONENT_BASE_ADDR + 0x03)
 
 // Hardware Configuration Structures
-typedef struct {
-    uint8_t pin;
-    bool inverted;
-    uint32_t address;
-    const char* name;
-} ComponentConfig_t;
-
 typedef struct {
     uint8_t txPin;
     uint8_t rxPin;
@@ -116,6 +147,5 @@ typedef struct {
 // Hardware Configuration Constants
 extern const CANConfig_t CAN_CONFIG;
 extern const StatusConfig_t STATUS_CONFIG;
-extern const ComponentConfig_t COMPONENT_CONFIGS[];
 
 #endif // HARDWARE_MAP_H
\ No newline at end of file
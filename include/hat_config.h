@@ -22,17 +22,156 @@
 #define HAT_POWER_VOLTAGE_5V 5.0f
 #define HAT_POWER_VOLTAGE_3V3 3.3f
 
-// Component Configuration
-#define HAT_MAX_COMPONENTS 16
+// Component Configuration (see hat_profile.h)
+#define HAT_PROFILE_DRIVE 0                // Four-wheel swerve drive
+#define HAT_PROFILE HAT_PROFILE_DRIVE
 #define HAT_COMPONENT_BASE_ADDR (HAT_BASE_ADDRESS + 0x10)
 
 // Timing Configuration
+#define HAT_DRIVE_TX_INTERVAL_US 1000    // ODrive command rate (1 kHz)
 #define HAT_HEARTBEAT_INTERVAL_MS 1000
 #define HAT_TELEMETRY_INTERVAL_MS 100
-#define HAT_STATE_TIMEOUT_MS 5000
+#define HAT_STATE_INTERVAL_MS 10        // State change hooks and timeout check
+#define HAT_STATE_TIMEOUT_MS 5000        // No activity: UNLOCKED/POWER_ARMED fall back to LOCKED
+#define HAT_STATUS_LED_INTERVAL_MS 10
+
+// Setpoint TX Suppression
+// A setpoint frame goes out as soon as its value moves more than the
+// epsilon from what was last sent, otherwise only every refresh interval
+#define HAT_SETPOINT_VEL_EPSILON 0.01f     // rad/s
+#define HAT_SETPOINT_POS_EPSILON 0.001f    // rad
+#define HAT_SETPOINT_REFRESH_MS 50         // Keep-alive rate while holding a command
+
+// Setpoint Staleness
+// A wheel whose last Jetson setpoint arrived more than HAT_SETPOINT_STALE_MS
+// ago is handled by HAT_SETPOINT_STALE_POLICY until the next one arrives
+#define HAT_STALE_POLICY_RAMP 0            // Ramp drive velocity to zero, steering holds
+#define HAT_STALE_POLICY_ZERO 1            // Zero drive velocity at once, steering holds
+#define HAT_STALE_POLICY_SUPPRESS 2        // Send nothing for the wheel (ODrive watchdog takes over)
+#define HAT_SETPOINT_STALE_MS 100
+#define HAT_SETPOINT_STALE_POLICY HAT_STALE_POLICY_RAMP
+#define HAT_SETPOINT_STALE_DECEL 20.0f     // rad/s^2, HAT_STALE_POLICY_RAMP
+
+// Setpoint Shaping (see setpoint_shaper.h)
+// Every drive cycle moves each wheel's command toward the Jetson setpoint
+// within its limits (HatWheel_t::limits in hat_profile.h), so the Jetson
+// can publish well below the ODrive command rate
+#define HAT_SETPOINT_SHAPING 1             // 0 = forward Jetson setpoints unchanged
+#define HAT_SHAPER_INTERPOLATE 1           // Spread each change over the Jetson frame interval
+#define HAT_SHAPER_INTERP_MAX_US 100000    // Longer intervals are not spread
+#define HAT_SHAPER_MAX_STEP_US 10000       // Longest cycle one shaping step covers
+#define HAT_SHAPER_DRIVE_ACCEL 40.0f       // rad/s^2, default drive limit
+#define HAT_SHAPER_STEER_RATE 6.0f         // rad/s, default steering limits
+#define HAT_SHAPER_STEER_ACCEL 60.0f       // rad/s^2
+
+// Peripheral Transmit (see tx_queue.h)
+#define HAT_PERIPH_TX_QUEUE_SIZE 16        // Frames waiting for the MCP2517FD
+#define HAT_PERIPH_TX_HW_DEPTH 8           // Controller transmit FIFO, one full set of setpoints
+#define HAT_PERIPH_TX_SETPOINT_DEADLINE_US 2000   // Setpoints older than this are dropped
+#define HAT_PERIPH_TXQ_DEPTH 8             // Controller TXQ (emergency stop frames), at least one per node
+
+// Peripheral Receive (ODrive feedback on the MCP2517FD)
+#define HAT_PERIPH_RX_BUFFER_SIZE 64       // Driver receive buffer, frames
+#define HAT_PERIPH_RX_DRAIN_BUDGET 16      // Frames decoded per drive cycle
+
+// Peripheral SPI (see mcp2517fd_transport.h)
+#define HAT_PERIPH_SPI_BATCHED 1           // 0 = one library call per frame
+#define HAT_PERIPH_SPI_DMA 1               // Transmit batches by LPSPI DMA (Teensy 4.x)
+#define HAT_PERIPH_SPI_CLOCK_HZ 8000000    // At most 0.85 x SYSCLK / 2 (20 MHz crystal)
+#define HAT_PERIPH_RX_BURST_BYTES 256      // Receive FIFO objects read in one burst
+
+// Jetson CAN Links (see can_interface.h)
+// Every link receives and acts on Jetson commands, and answers diagnostic
+// requests on the link they came in on. The TX roles pick which periodic
+// frames a link sends, so telemetry can move off the command bus (primary
+// HEARTBEAT, aux TELEMETRY) or go out on both for a redundant link.
+#define HAT_LINK_TX_TELEMETRY 0x01         // Drive encoder telemetry
+#define HAT_LINK_TX_HEARTBEAT 0x02         // Heartbeat broadcast
+#define HAT_JETSON_CAN_BUS CAN3
+#define HAT_JETSON_RX_QUEUE RX_SIZE_256
+#define HAT_JETSON_TX_QUEUE TX_SIZE_16
+#define HAT_JETSON_TX_ROLES (HAT_LINK_TX_TELEMETRY | HAT_LINK_TX_HEARTBEAT)
+#define HAT_JETSON_AUX_ENABLED 0           // 1 = second link, needs its own transceiver
+#define HAT_JETSON_AUX_CAN_BUS CAN1
+#define HAT_JETSON_AUX_RX_QUEUE RX_SIZE_64
+#define HAT_JETSON_AUX_TX_QUEUE TX_SIZE_32
+#define HAT_JETSON_AUX_TX_ROLES HAT_LINK_TX_TELEMETRY
+#define HAT_JETSON_IRQ_PRIORITY 128        // NVIC priority of every Jetson link (Teensy default), see setpoint_store.h
+
+// Jetson Drive Frame Format (see message_construction.h)
+// Drive setpoints are accepted in both formats. Encoder telemetry goes out
+// in HAT_JETSON_TELEMETRY_FORMAT; AUTO answers in the format of the last
+// drive command received on any link, float until the first one arrives.
+#define HAT_JETSON_FORMAT_FLOAT 0          // One frame per wheel, two floats
+#define HAT_JETSON_FORMAT_COMPACT 1        // Two wheels per frame, scaled int16
+#define HAT_JETSON_FORMAT_AUTO 2
+#define HAT_JETSON_TELEMETRY_FORMAT HAT_JETSON_FORMAT_AUTO
+
+// Telemetry Aggregation (see telemetry_aggregator.h)
+// Every ODrive estimate is folded into a window per signal; one summary per
+// window goes to the Jetson at the signal's interval, within its budget.
+// Fields: 0x01 min, 0x02 max, 0x04 mean, 0x08 last, at most three.
+#define HAT_TELEMETRY_AGGREGATION 1        // 0 = snapshot frames only
+#define HAT_AGG_TICK_MS 10                 // Summary task period, finest interval
+#define HAT_AGG_STEER_INTERVAL_MS 100      // Steering angle, per wheel
+#define HAT_AGG_STEER_FIELDS 0x0C          // Mean, last
+#define HAT_AGG_STEER_BUDGET 200           // Bytes/s on the wire, 0 = unlimited
+#define HAT_AGG_DRIVE_INTERVAL_MS 50       // Drive velocity, per wheel
+#define HAT_AGG_DRIVE_FIELDS 0x07          // Min, max, mean
+#define HAT_AGG_DRIVE_BUDGET 400
+#define HAT_AGG_BUDGET_BURST 2             // Frames of credit a signal can bank
+
+// Acceptance Filters (see filter_planner.h)
+#define HAT_JETSON_MAILBOXES 16            // FlexCAN mailboxes in use
+#define HAT_JETSON_RX_MAILBOXES 8          // MB0.. receive (dedicated IDs first), the rest transmit
+#define HAT_JETSON_EXT_RX_MAILBOXES 1      // Last receive mailboxes, extended IDs to this node
+#define HAT_PERIPH_RX_FILTERS 8            // MCP2517FD filter objects to use (at most 32)
+
+// Diagnostics (see diagnostics.h)
+#define HAT_DIAG_INTERVAL_MS 10            // Request service and queue sampling
+#define HAT_DIAG_WINDOW_MS 1000            // Bus utilisation window
+#define HAT_DIAG_MAX_IDS 64                // Individually counted CAN IDs
+#define HAT_DIAG_HASH_SLOTS 128            // Power of two, above HAT_DIAG_MAX_IDS
+#define HAT_DIAG_MAX_RECORDS 8             // Response frames per request
+
+// Bus Error Supervision (see bus_supervisor.h)
+// A bus-off is left to the controller's own recovery for the holdoff, then
+// recovered by the firmware; attempts are spaced from MIN, doubling to MAX
+// while they fail, back to MIN once the bus has stayed up for STABLE
+#define HAT_BUS_POLL_INTERVAL_MS 2         // Error counters of every controller
+#define HAT_BUS_OFF_HOLDOFF_MS 5           // 128 x 11 recessive bits is 1.4 ms at 1 Mbit/s
+#define HAT_BUS_RECOVERY_MIN_MS 10
+#define HAT_BUS_RECOVERY_MAX_MS 1000
+#define HAT_BUS_RECOVERY_STABLE_MS 1000
+
+// Runtime Parameters (see param_registry.h)
+// The rates and thresholds above are the defaults of a parameter table the
+// Jetson reads and changes over CAN (MSG_TYPE_CONFIG_*). Saved values are
+// loaded from EEPROM at boot.
+#define HAT_PARAM_EEPROM_ADDR 0            // Start of the saved image
+#define HAT_PARAM_EEPROM_SIZE 4284         // Teensy 4.1 emulated EEPROM, bytes
+#define HAT_CONFIG_REQUEST_QUEUE 4         // Config requests waiting per link, power of two
+
+// Boot (see setup() in motor_control.ino)
+// After a reset the bridge goes straight onto both buses. It only waits for
+// a serial monitor when PIN_DEBUG_STRAP (hardware_map.h) is pulled low.
+#define HAT_FAST_BOOT 1                    // 0 = always wait for the monitor
+#define HAT_BOOT_SERIAL_WAIT_MS 10000      // Longest wait for the monitor
+
+// Scheduler Configuration
+// initializeScheduler() registers up to 8 tasks and fails setup() if one
+// does not fit
+#define HAT_SCHEDULER_MAX_TASKS 12
 
 // Debug Configuration
 #define HAT_DEBUG_ENABLED 1
 #define HAT_SERIAL_BAUD_RATE 115200
 
+// Trace Configuration (see trace.h)
+// 0 = off, 1 = errors, 2 = + events, 3 = + every CAN frame with payload
+#define HAT_TRACE_LEVEL 2
+#define HAT_TRACE_RING_SIZE 256        // Records, must be a power of two
+#define HAT_TRACE_DRAIN_BUDGET 8       // Records formatted per loop() pass
+#define HAT_TRACE_STREAM_BINARY 0      // 1 = write raw records instead of text
+
 #endif // HAT_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,172 @@
+/**
+ * @file hat_profile.h
+ * @brief Compile-time HAT profile: components, node IDs, command types and rates
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Everything that differs between HATs built from this template lives in
+ * one traits struct. ComponentControllerT is specialised on it, so node
+ * IDs, frame tables and loop bounds are constants of the build and the
+ * tables sit in flash. A new HAT adds a profile here and selects it with
+ * HAT_PROFILE in hat_config.h; the Jetson receive schema in
+ * hardware_map.h is checked against the profile at compile time.
+ *
+ * A profile provides:
+ *   wheels[]       HatWheel_t per steerable wheel, in setpoint store order,
+ *                  with its setpoint shaping limits
+ *   wheelCount     Entries in wheels[], at most DRIVE_WHEEL_COUNT
+ *   compactFrameCount    Compact drive frames per command set, two wheels each
+ *   compactCommandIds[]  Jetson compact setpoint frames (message_construction.h)
+ *   compactEncoderIds[]  Jetson compact encoder telemetry frames
+ *   velocityCmd    ODrive command carrying the drive setpoint
+ *   positionCmd    ODrive command carrying the steering setpoint
+ *   commandIntervalUs    ODrive command rate
+ *   telemetryIntervalMs  Encoder telemetry rate to the Jetson
+ */
+
+#ifndef HAT_PROFILE_H
+#define HAT_PROFILE_H
+
+#include <stdint.h>
+#include "hat_config.h"
+#include "setpoint_store.h"
+#include "message_construction.h"
+#include "setpoint_shaper.h"
+
+#define PRIORITY_ZERO 0x00 << 8
+#define PRIORITY_JETSON 0x01 << 8
+#define PRIORITY_DRIVE 0x02 << 8
+#define PRIORITY_ARM 0x03 << 8
+#define PRIORITY_BPS 0x04 << 8
+#define PRIORITY_SCIENCE 0x05 << 8
+#define PRIORITY_SENSE 0x06 << 8
+
+// note 0x00 - 0x10 reserved for future use/high priority drive messages
+// for drive messages upper four byte is used for "traction", lower four bytes for "steering"
+#define MESSAGE_DRIVE_FRONT_LEFT 0x10
+#define MESSAGE_DRIVE_FRONT_RIGHT 0x11
+#define MESSAGE_DRIVE_REAR_LEFT 0x12
+#define MESSAGE_DRIVE_REAR_RIGHT 0x13
+
+#define MESSAGE_DRIVE_FRONT_LEFT_ENCODER 0x20
+#define MESSAGE_DRIVE_FRONT_RIGHT_ENCODER 0x21
+#define MESSAGE_DRIVE_REAR_LEFT_ENCODER 0x22
+#define MESSAGE_DRIVE_REAR_RIGHT_ENCODER 0x23
+
+// Compact drive frames, two wheels each (layout version 1)
+#define MESSAGE_DRIVE_COMPACT_FRONT 0x18          // FL, FR
+#define MESSAGE_DRIVE_COMPACT_REAR 0x19           // RL, RR
+#define MESSAGE_DRIVE_COMPACT_FRONT_ENCODER 0x28
+#define MESSAGE_DRIVE_COMPACT_REAR_ENCODER 0x29
+
+static constexpr uint8_t NODE_DRIVE_FL = 4;
+static constexpr uint8_t NODE_DRIVE_FR = 2;
+static constexpr uint8_t NODE_DRIVE_RL = 3;
+static constexpr uint8_t NODE_DRIVE_RR = 1;
+
+static constexpr uint8_t NODE_STEER_FL = 5;
+static constexpr uint8_t NODE_STEER_FR = 6;
+static constexpr uint8_t NODE_STEER_RL = 7;
+static constexpr uint8_t NODE_STEER_RR = 8;
+
+// One steerable wheel: a drive ODrive (velocity) and a steer ODrive (position)
+typedef struct {
+    uint8_t driveNode;
+    uint8_t steerNode;
+    uint32_t commandId;     // Jetson setpoint frame (standard ID)
+    uint32_t encoderId;     // Jetson encoder telemetry frame (standard ID)
+    WheelLimits_t limits;   // Setpoint shaping (HAT_SETPOINT_SHAPING)
+} HatWheel_t;
+
+#define HAT_WHEEL_DEFAULT_LIMITS { HAT_SHAPER_DRIVE_ACCEL, HAT_SHAPER_STEER_RATE, HAT_SHAPER_STEER_ACCEL }
+
+// Four-wheel swerve drive HAT
+struct DriveHatProfile {
+    static constexpr uint8_t wheelCount = 4;
+    static constexpr HatWheel_t wheels[wheelCount] = {
+        { NODE_DRIVE_FL, NODE_STEER_FL, PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_LEFT, PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_LEFT_ENCODER,
+          HAT_WHEEL_DEFAULT_LIMITS },
+        { NODE_DRIVE_FR, NODE_STEER_FR, PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_RIGHT, PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_RIGHT_ENCODER,
+          HAT_WHEEL_DEFAULT_LIMITS },
+        { NODE_DRIVE_RL, NODE_STEER_RL, PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_LEFT, PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_LEFT_ENCODER,
+          HAT_WHEEL_DEFAULT_LIMITS },
+        { NODE_DRIVE_RR, NODE_STEER_RR, PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_RIGHT, PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_RIGHT_ENCODER,
+          HAT_WHEEL_DEFAULT_LIMITS },
+    };
+    static constexpr uint8_t compactFrameCount = 2;
+    static constexpr uint32_t compactCommandIds[compactFrameCount] = {
+        PRIORITY_DRIVE | MESSAGE_DRIVE_COMPACT_FRONT, PRIORITY_DRIVE | MESSAGE_DRIVE_COMPACT_REAR
+    };
+    static constexpr uint32_t compactEncoderIds[compactFrameCount] = {
+        PRIORITY_DRIVE | MESSAGE_DRIVE_COMPACT_FRONT_ENCODER, PRIORITY_DRIVE | MESSAGE_DRIVE_COMPACT_REAR_ENCODER
+    };
+    static constexpr uint8_t velocityCmd = ODRIVE_CMD_SET_INPUT_VEL;
+    static constexpr uint8_t positionCmd = ODRIVE_CMD_SET_INPUT_POS;
+    static constexpr uint32_t commandIntervalUs = HAT_DRIVE_TX_INTERVAL_US;
+    static constexpr uint32_t telemetryIntervalMs = HAT_TELEMETRY_INTERVAL_MS;
+};
+
+// --- Lookups, evaluated at compile time wherever the node is a constant ---
+
+// Wheel driven or steered by an ODrive node, -1 if it is neither
+template <typename Profile>
+constexpr int8_t profileDriveWheelOfNode(uint8_t node) {
+    for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+        if (Profile::wheels[i].driveNode == node) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+template <typename Profile>
+constexpr int8_t profileSteerWheelOfNode(uint8_t node) {
+    for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+        if (Profile::wheels[i].steerNode == node) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+// Node IDs unique across drive and steer axes
+template <typename Profile>
+constexpr bool profileNodesUnique() {
+    for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+        const HatWheel_t& wheel = Profile::wheels[i];
+        if (wheel.driveNode == wheel.steerNode || wheel.driveNode > ODRIVE_NODE_MASK ||
+            wheel.steerNode > ODRIVE_NODE_MASK ||
+            profileDriveWheelOfNode<Profile>(wheel.driveNode) != (int8_t)i ||
+            profileSteerWheelOfNode<Profile>(wheel.steerNode) != (int8_t)i ||
+            profileDriveWheelOfNode<Profile>(wheel.steerNode) >= 0 ||
+            profileSteerWheelOfNode<Profile>(wheel.driveNode) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Profile for this build (HAT_PROFILE in hat_config.h) ---
+
+#if HAT_PROFILE == HAT_PROFILE_DRIVE
+typedef DriveHatProfile HatProfile;
+#else
+#error "unknown HAT_PROFILE"
+#endif
+
+static_assert(HatProfile::wheelCount >= 1 && HatProfile::wheelCount <= DRIVE_WHEEL_COUNT,
+              "the setpoint and telemetry stores hold DRIVE_WHEEL_COUNT wheels");
+static_assert(profileNodesUnique<HatProfile>(), "every ODrive node must appear once in the HAT profile");
+static_assert(HatProfile::compactFrameCount * DRIVE_COMPACT_WHEELS_PER_FRAME >= HatProfile::wheelCount &&
+              HatProfile::compactFrameCount <= HatProfile::wheelCount,
+              "compact drive frames must cover every wheel of the HAT profile");
+
+constexpr int8_t driveWheelOfNode(uint8_t node) {
+    return profileDriveWheelOfNode<HatProfile>(node);
+}
+
+constexpr int8_t steerWheelOfNode(uint8_t node) {
+    return profileSteerWheelOfNode<HatProfile>(node);
+}
+
+#endif // HAT_PROFILE_H
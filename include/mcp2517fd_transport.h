@@ -0,0 +1,157 @@
+/**
+ * @file mcp2517fd_transport.h
+ * @brief Batched SPI access to the MCP2517FD transmit and receive FIFOs
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The ACAN2517FD library moves one message per call: a status read, a user
+ * address read, the message object and a FIFO increment, each its own
+ * chip-select frame, all blocking. Once the library has configured the
+ * controller, this transport takes over the FIFO traffic of the drive loop:
+ *
+ *  - Transmit: one read of the transmit FIFO status and user address per
+ *    batch gives the free slots and the head. Each object is then written
+ *    to message RAM by LPSPI DMA and followed by UINC|TXREQ, the next
+ *    transfer chained from the DMA completion interrupt, so sendBatch()
+ *    returns once the first transfer has started.
+ *  - Receive: the MCP2517FD interrupt reads status and user address in one
+ *    frame, then every pending object that is contiguous in RAM in one
+ *    burst, into a buffer that receive() empties from loop context.
+ *
+ * The TXQ (emergency stops) stays with the library. Without batching, or
+ * if the FIFOs cannot be located, every call goes to the library instead.
+ */
+
+#ifndef MCP2517FD_TRANSPORT_H
+#define MCP2517FD_TRANSPORT_H
+
+#include <stdint.h>
+#include <atomic>
+#include "SPI.h"
+#include "ACAN2517FD.h"
+#include "hat_config.h"
+#if HAT_PERIPH_SPI_DMA
+#include <EventResponder.h>
+#endif
+
+#define MCP2517FD_MAX_PAYLOAD 64
+
+// SPI traffic of the transport itself (none while it defers to the library)
+typedef struct {
+    uint32_t txFrames;          // Written to the transmit FIFO
+    uint32_t txBatches;
+    uint32_t rxFrames;          // Read from the receive FIFO
+    uint32_t rxBursts;
+    uint32_t rxDropped;         // Receive buffer full
+    uint32_t spiBytes;          // Clocked, blocking and DMA
+    uint32_t dmaBytes;          // Of which by DMA
+    uint32_t chipSelects;
+} SpiTransportStats_t;
+
+class MCP2517FDTransport {
+public:
+    // interruptHandler is the routine given to ACAN2517FD::begin() for
+    // intPin; the transport detaches and re-attaches it (see isr())
+    MCP2517FDTransport(ACAN2517FD& controller, uint8_t csPin, SPIClass& spi, uint8_t intPin,
+                       void (*interruptHandler)(void));
+
+    // After ACAN2517FD::begin(). Locates the transmit and receive FIFOs in
+    // message RAM; returns false, and keeps using the library, if batched
+    // is false or they are not found (abortTransmit() still uses them).
+    bool begin(bool batched);
+    bool isBatched() const;
+
+    // Hands frames[0..count) to the controller in order, as many as the
+    // transmit FIFO has room for; returns how many were taken. Nothing is
+    // taken while the previous batch is still on the SPI bus. Loop context.
+    uint8_t sendBatch(const CANFDMessage* const* frames, uint8_t count);
+
+    // MCP2517FD interrupt. INT is level-triggered, so an interrupt that
+    // finds the bus claimed masks itself before returning, or it would be
+    // taken again at once for as long as the holder is preempted; the
+    // release re-enables it after running the drain.
+    void isr();
+
+    // Next received frame, oldest first; loop context
+    bool receive(CANFDMessage& frame);
+    uint16_t getReceivePeakCount() const;
+
+    const SpiTransportStats_t& getStats() const;
+
+    // The SPI bus for a library call between batches (error counters, a
+    // mode change): acquireBus() is false while a transmit batch or a
+    // receive drain holds it, and otherwise masks INT until releaseBus(),
+    // which runs a drain the interrupt left meanwhile. Keep each section to
+    // one call; nothing in it may wait on the controller. Loop context.
+    bool acquireBus();
+    void releaseBus();
+
+    // Hands the FIFOs back to the library ahead of end() and a new
+    // ACAN2517FD::begin(); begin() takes them again. Bus acquired.
+    void suspend();
+
+    // Drops every frame in the transmit FIFO that has not reached the wire,
+    // whether queued by sendBatch() or the library; one already being sent
+    // completes. The TXQ is untouched. False while the bus is held, so try
+    // again later; loop context.
+    bool abortTransmit();
+
+private:
+    typedef struct {
+        uint16_t control;       // FIFOCON address; FIFOSTA and FIFOUA follow
+        uint16_t ramBase;       // SPI address of object 0
+        uint8_t depth;
+        uint8_t objectSize;
+        uint8_t dataOffset;     // 8, or 12 with a receive timestamp
+    } FifoLayout_t;
+
+    ACAN2517FD& controller;
+    const uint8_t csPin;
+    SPIClass& spi;
+    const SPISettings settings;
+    bool batched;
+    FifoLayout_t txFifo;
+    FifoLayout_t rxFifo;
+
+    // The bus is claimed by a transmit batch until its last object is
+    // written, or by a receive drain; a drain refused meanwhile is run by
+    // whoever releases it
+    std::atomic<bool> busy;
+    std::atomic<bool> drainPending;
+    const uint8_t intPin;
+    void (*const interruptHandler)(void);
+    std::atomic<bool> intMasked;
+
+    // Transmit batch: one RAM write instruction per object
+    uint8_t txSegments[HAT_PERIPH_TX_HW_DEPTH][2 + 8 + MCP2517FD_MAX_PAYLOAD];
+    uint8_t txSegmentLength[HAT_PERIPH_TX_HW_DEPTH];
+    uint8_t txSegmentCount;
+    volatile uint8_t txSegmentNext;
+#if HAT_PERIPH_SPI_DMA
+    EventResponder dmaEvent;
+    static void onDmaComplete(EventResponder& event);
+#endif
+
+    // Receive burst, and the buffer between interrupt and loop
+    uint8_t rxBurst[2 + HAT_PERIPH_RX_BURST_BYTES];
+    CANFDMessage rxBuffer[HAT_PERIPH_RX_BUFFER_SIZE];
+    std::atomic<uint16_t> rxHead;   // Free-running; written by the interrupt
+    std::atomic<uint16_t> rxTail;   // Free-running; written by receive()
+    uint16_t rxPeak;
+
+    SpiTransportStats_t stats;
+
+    void transfer(uint8_t* buffer, uint16_t length);
+    void readRegisters(uint16_t address, uint8_t* data, uint8_t length);
+    void writeFifoControl(const FifoLayout_t& fifo, uint8_t flags);   // FIFOCON byte 1
+    bool locateFifos();
+    void writeSegment();
+    void segmentWritten();
+    void drainReceiveFifo();
+    bool claim();
+    void release();
+    void maskInterrupt();
+    void unmaskInterrupt();
+};
+
+#endif // MCP2517FD_TRANSPORT_H
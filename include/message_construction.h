@@ -10,10 +10,12 @@
 
 #include <stdint.h>
 #include "ACAN2517FD.h"
+#include "can_ids.h"
 
 // CAN Network Configuration
 #define CAN_BAUDRATE 1000000  // 1 Mbps
-#define CAN_FD_BAUDRATE 2000000
+#define CAN_FD_BAUDRATE 2000000  // CAN FD data phase (BRS): 1, 2 or 4 x CAN_BAUDRATE
+#define CAN_FD_DATA_BITRATE_FACTOR (CAN_FD_BAUDRATE / CAN_BAUDRATE)
 #define CAN_MAX_NODES 32
 #define CAN_MAX_DATA_LENGTH 8
 
@@ -22,6 +24,7 @@
 // Bits 23-16: Source Node ID (8 bits)
 // Bits 15-8:  Target Node ID (8 bits) - 0xFF for broadcast
 // Bits 7-0:   Message Type/Register (8 bits)
+// Encode/decode with encodeHatId() / decodeHatId() (can_ids.h)
 
 // Priority Levels
 #define CAN_PRIORITY_JETSON 1
@@ -42,6 +45,7 @@
 #define MSG_TYPE_CONTROL_ENABLE 0x03
 #define MSG_TYPE_CONTROL_DISABLE 0x04
 #define MSG_TYPE_CONTROL_SET_PARAM 0x05
+#define MSG_TYPE_PACKED_SETPOINTS 0x06
 
 // Message Types - Status Requests (0x10-0x1F)
 #define MSG_TYPE_STATUS_REQUEST 0x10
@@ -80,9 +84,158 @@
 #define MSG_TYPE_EMERGENCY_COMM 0xF3
 #define MSG_TYPE_SYSTEM_SHUTDOWN 0xFF
 
+// Diagnostics (extended IDs, classic 8-byte frames, see diagnostics.h)
+// Request  MSG_TYPE_DIAGNOSTIC_REQ to HAT_NODE_ID:
+//   [0] page (0x00-0x7F), [1] first index, [2] record count (0 or above HAT_DIAG_MAX_RECORDS = as many as allowed)
+// Response MSG_TYPE_DIAGNOSTIC_RESP to the requester, one frame per record:
+//   [0] page, [1] index, [2-5] uint32 value, [6-7] uint16 aux (little endian)
+// Indexes past the end of a page produce no frame.
+#define DIAG_PAGE_SUMMARY 0x00  // 0: value uptime ms, aux registered IDs
+#define DIAG_PAGE_ID 0x01       // value CAN ID (bit 31 peripheral bus, bit 30 extended); both Jetson links count together
+#define DIAG_PAGE_ID_RX 0x02    // value frames received
+#define DIAG_PAGE_ID_TX 0x03    // value frames sent, aux failed sends (saturating)
+#define DIAG_PAGE_BUS 0x04      // 3 records per bus (Jetson, peripheral, Jetson aux):
+                                //   +0 value utilisation permille, aux nominal kbit/s
+                                //   +1 value TX failures (FIFO/queue full)
+                                //   +2 value RX on unregistered IDs, aux TX on unregistered IDs
+#define DIAG_PAGE_ISR 0x05      // DIAG_ISR_BUCKETS + 1 records per ISR (Jetson RX, MCP2517FD, Jetson aux RX):
+                                //   bucket b: value count, aux log2 of its lower bound in cycles
+                                //   last: value max cycles, aux CPU MHz
+#define DIAG_PAGE_QUEUE 0x06    // per queue (diagnostics.h): value peak depth, aux capacity
+#define DIAG_PAGE_SETPOINT_AGE 0x07  // 3 records per wheel (FL, FR, RL, RR), ages at use in us:
+                                     //   +0 value mean age of fresh setpoints, aux 1 while stale
+                                     //   +1 value max age of fresh setpoints, aux times gone stale
+                                     //   +2 value drive cycles spent stale, aux stale limit in ms
+#define DIAG_PAGE_BOOT 0x08     // per boot phase (DIAG_BOOT_* in diagnostics.h): value us since reset
+                                //   when first reached (0 = not yet), aux 1 with HAT_FAST_BOOT
+#define DIAG_PAGE_BUS_HEALTH 0x09  // 5 records per bus (Jetson, peripheral, Jetson aux), see bus_supervisor.h:
+                                   //   +0 value BUS_STATE_*, aux TEC << 8 | REC
+                                   //   +1 value ms error passive or worse, aux peak TEC << 8 | peak REC
+                                   //   +2 value ms down (bus-off or offline), aux times gone down
+                                   //   +3 value longest time down in ms, aux recovery attempts
+                                   //   +4 value frames lost while degraded, aux failed recoveries
+
+// Configuration (extended IDs, classic 8-byte frames, see param_registry.h)
+// Requests to HAT_NODE_ID:
+//   MSG_TYPE_CONFIG_SET   [0] parameter ID, [1-4] value (uint32 little endian, a float as its bits)
+//   MSG_TYPE_CONFIG_GET   [0] first parameter ID, [1] count (0 or above HAT_DIAG_MAX_RECORDS = as many as allowed)
+//   MSG_TYPE_CONFIG_SAVE  no payload: the current values to EEPROM, answered once written and
+//                         verified (one word per diagnostics period); DENIED while a save is under way
+//   MSG_TYPE_CONFIG_LOAD  [0] CONFIG_LOAD_STORED or CONFIG_LOAD_DEFAULTS
+// Response MSG_TYPE_PARAM_RESPONSE to the requester, one frame per parameter:
+//   [0] parameter ID (CONFIG_ID_STORE for SAVE/LOAD), [1] CONFIG_STATUS_*, [2] PARAM_TYPE_*,
+//   [3] request type, [4-7] value (after the request)
+// GET answers for the parameters from the first ID up, in ID order. A request
+// the state machine does not allow in the current state is answered
+// CONFIG_STATUS_DENIED. Accepted changes take effect from the next drive cycle.
+#define PARAM_TYPE_U8 0
+#define PARAM_TYPE_U16 1
+#define PARAM_TYPE_U32 2
+#define PARAM_TYPE_F32 3
+#define CONFIG_STATUS_OK 0
+#define CONFIG_STATUS_UNKNOWN 1    // No such parameter
+#define CONFIG_STATUS_RANGE 2      // Value outside the parameter's range
+#define CONFIG_STATUS_DENIED 3     // Not allowed in the current state
+#define CONFIG_STATUS_STORE 4      // No valid EEPROM image, or the write did not verify
+#define CONFIG_ID_STORE 0xFF
+#define CONFIG_LOAD_STORED 0
+#define CONFIG_LOAD_DEFAULTS 1
+
+// ODrive CAN Simple command IDs (id = encodeODriveId(cmd, node_id))
+#define ODRIVE_CMD_ESTOP 0x02                  // No payload; disarms the axis
+#define ODRIVE_CMD_GET_ENCODER_ESTIMATES 0x09  // [0-3] float pos, [4-7] float vel
+#define ODRIVE_CMD_SET_INPUT_POS 0x0B
+#define ODRIVE_CMD_SET_INPUT_VEL 0x0C
+
+// Packed Setpoint Frame (CAN FD with BRS, peripheral bus)
+// Carries setpoints for several nodes in one frame, for peripherals that
+// support it. ODrives keep receiving one classic 8-byte frame per command.
+// Byte 0: PACKED_SETPOINT_VERSION
+// Byte 1: entry count
+// Then PACKED_SETPOINT_ENTRY_SIZE bytes per entry:
+//   [0] node ID, [1] command ID, [2-5] float value, [6-9] float feed-forward
+#define PACKED_SETPOINT_VERSION 1
+#define PACKED_SETPOINT_HEADER_SIZE 2
+#define PACKED_SETPOINT_ENTRY_SIZE 10
+#define PACKED_SETPOINT_MAX_ENTRIES 6
+
+typedef struct {
+    uint8_t node_id;
+    uint8_t cmd;
+    float value;
+    float feedforward;
+} PackedSetpoint_t;
+
+// Jetson drive command and encoder payload (classic 8 bytes)
+// [0-3] float steering angle, [4-7] float wheel angular velocity
+typedef struct {
+    float steering_angle;
+    float angular_vel;
+} DrivePayload_t;
+
+// Compact Jetson drive frame (classic, layout version 1)
+// Two wheels per frame as scaled int16 fields, little endian:
+//   [0-1] steering angle A, [2-3] angular velocity A,
+//   [4-5] steering angle B, [6-7] angular velocity B
+// A 4-byte frame carries wheel A only. value = raw * scale; anything out of
+// range saturates and NaN is sent as 0. Setpoints and encoder telemetry use
+// the same layout on their own IDs (MESSAGE_DRIVE_COMPACT_* in
+// hat_profile.h). The version is in the ID: a new layout gets new IDs, so
+// the HAT never misreads a frame laid out for another version.
+#define DRIVE_COMPACT_VERSION 1
+#define DRIVE_COMPACT_WHEELS_PER_FRAME 2
+#define DRIVE_COMPACT_WHEEL_SIZE 4
+#define DRIVE_COMPACT_ANGLE_SCALE 1.0e-4f   // rad per LSB
+#define DRIVE_COMPACT_VEL_SCALE 1.0e-2f     // rad/s per LSB
+#define DRIVE_COMPACT_ANGLE_MAX (32767 * DRIVE_COMPACT_ANGLE_SCALE)   // +-3.2767 rad
+#define DRIVE_COMPACT_VEL_MAX (32767 * DRIVE_COMPACT_VEL_SCALE)       // +-327.67 rad/s
+
+// Telemetry summary frame (extended ID MSG_TYPE_TELEMETRY_SENSOR from
+// HAT_NODE_ID to CAN_BROADCAST_ADDR, see telemetry_aggregator.h)
+// One window of one signal, self-describing:
+//   [0] signal (low nibble) | TELEMETRY_FIELD_* mask (high nibble)
+//   [1] samples in the window (saturates at 255)
+//   then one int16 per field in the mask, little endian, in the order
+//   min, max, mean, last, on the signal's compact scale
+// At most TELEMETRY_SUMMARY_MAX_FIELDS fields, so the length is 2 + 2 x fields.
+#define TELEMETRY_SIGNAL_STEER_ANGLE 0      // + wheel, DRIVE_COMPACT_ANGLE_SCALE
+#define TELEMETRY_SIGNAL_DRIVE_VEL 4        // + wheel, DRIVE_COMPACT_VEL_SCALE
+#define TELEMETRY_SIGNAL_COUNT 8
+#define TELEMETRY_FIELD_MIN 0x01
+#define TELEMETRY_FIELD_MAX 0x02
+#define TELEMETRY_FIELD_MEAN 0x04
+#define TELEMETRY_FIELD_LAST 0x08
+#define TELEMETRY_SUMMARY_HEADER_SIZE 2
+#define TELEMETRY_SUMMARY_MAX_FIELDS 3
+
+typedef struct {
+    uint8_t signal;
+    uint8_t fields;         // TELEMETRY_FIELD_*
+    uint16_t count;         // Samples in the window
+    float min;
+    float max;
+    float mean;
+    float last;
+} TelemetrySummary_t;
+
 // Function prototypes
 void floatToBytes(float f, uint8_t *out);
+void encodeDrivePayload(const DrivePayload_t &payload, uint8_t *out);
+DrivePayload_t decodeDrivePayload(const uint8_t *in);
+int16_t encodeCompactField(float value, float scale);
+float decodeCompactField(int16_t raw, float scale);
+uint8_t encodeCompactDrivePayload(const DrivePayload_t *wheels, uint8_t count, uint8_t *out);
+uint8_t decodeCompactDrivePayload(const uint8_t *in, uint8_t len, DrivePayload_t *wheels);
+float telemetrySignalScale(uint8_t signal);
+uint8_t telemetrySummaryLength(uint8_t fields);
+uint8_t encodeTelemetrySummary(const TelemetrySummary_t &summary, uint8_t *out);
+bool decodeTelemetrySummary(const uint8_t *in, uint8_t len, TelemetrySummary_t &summary);
 CANFDMessage buildVelocityMsg(uint8_t node_id, float vel, float torque_ff = 0.0f);
 CANFDMessage buildPositionMsg(uint8_t node_id, float pos, float vel_ff = 0.0f);
+CANFDMessage buildEstopMsg(uint8_t node_id);
+CANFDMessage buildEncoderEstimatesMsg(uint8_t node_id, float pos, float vel);
+bool parseEncoderEstimatesMsg(const CANFDMessage &m, float &pos, float &vel);
+CANFDMessage buildPackedSetpointMsg(const PackedSetpoint_t *entries, uint8_t count);
+uint8_t parsePackedSetpointMsg(const CANFDMessage &m, PackedSetpoint_t *out, uint8_t max_entries);
 
 #endif // MESSAGE_CONSTRUCTION_H
\ No newline at end of file
@@ -12,26 +12,31 @@
 #define TEMPLATEHAT_FIRMWARE_H
 
 #include <Arduino.h>
-#include <array>
 #include "ACAN2517FD.h"
 #include "can_interface.h"
 #include "state_machine.h"
 #include "component_ctrl.h"
 #include "hardware_map.h"
 #include "hat_config.h"
+#include "scheduler.h"
 
 // --- Global objects ---
 extern CANInterface canInterface;
+#if HAT_JETSON_AUX_ENABLED
+extern AuxCANInterface auxCanInterface;
+#endif
 extern HATStateMachine stateMachine;
 extern ComponentController componentController;
-
-// --- Timing variables ---
-extern unsigned long lastHeartbeat;
-extern unsigned long lastTelemetry;
-extern unsigned long lastStateCheck;
+extern TaskScheduler scheduler;
 
 // --- Function declarations ---
 
+/**
+ * @brief Wait for a serial monitor: always without HAT_FAST_BOOT, else only
+ *        with PIN_DEBUG_STRAP pulled low; at most HAT_BOOT_SERIAL_WAIT_MS
+ */
+void waitForSerialMonitor();
+
 /**
  * @brief Initialize all hardware pins and peripherals
  */
@@ -43,22 +48,96 @@ void initializeHardware();
 void initializeSubsystems();
 
 /**
- * @brief Process CAN messages for drive and steering nodes
- * @return Array of CANFDMessage (8 messages)
+ * @brief Register the periodic tasks with the scheduler and release them
+ * @return false, with nothing released, if the task table is too small
+ */
+bool initializeScheduler();
+
+/**
+ * @brief Drain ODrive feedback, then send the setpoint frames (HAT_DRIVE_TX_INTERVAL_US)
+ * @param nowMicros Release time reported by the scheduler
+ */
+void driveTxTask(uint32_t nowMicros);
+
+/**
+ * @brief Run state change hooks and check timeouts (HAT_STATE_INTERVAL_MS)
+ * @param nowMicros Release time reported by the scheduler
+ */
+void stateTask(uint32_t nowMicros);
+
+/**
+ * @brief Forward ODrive encoder feedback to the Jetson (PARAM_TELEMETRY_INTERVAL_MS)
+ * @param nowMicros Release time reported by the scheduler
+ */
+void telemetryTask(uint32_t nowMicros);
+
+/**
+ * @brief Send the telemetry summaries that are due (HAT_AGG_TICK_MS)
+ * @param nowMicros Release time reported by the scheduler
+ */
+void telemetrySummaryTask(uint32_t nowMicros);
+
+/**
+ * @brief Send the HAT heartbeat (PARAM_HEARTBEAT_INTERVAL_MS)
+ * @param nowMicros Release time reported by the scheduler
+ */
+void heartbeatTask(uint32_t nowMicros);
+
+/**
+ * @brief Sample bus load and queue peaks, answer diagnostic requests (HAT_DIAG_INTERVAL_MS)
+ * @param nowMicros Release time reported by the scheduler
  */
-std::array<CANFDMessage, 8> processCANMessages();
+void diagnosticsTask(uint32_t nowMicros);
+
+/**
+ * @brief Poll the error state of every bus and recover one that is down (HAT_BUS_POLL_INTERVAL_MS)
+ * @param nowMicros Release time reported by the scheduler
+ */
+void busMonitorTask(uint32_t nowMicros);
+
+/**
+ * @brief Refresh the status LED (HAT_STATUS_LED_INTERVAL_MS)
+ * @param nowMicros Release time reported by the scheduler
+ */
+void statusLedTask(uint32_t nowMicros);
+
+/**
+ * @brief Print the boot phase timestamps to Serial, once the first setpoint is forwarded
+ */
+void reportBootTimeline();
+
+/**
+ * @brief Print per-task jitter and overrun statistics to Serial
+ */
+void reportSchedulerStats();
+
+/**
+ * @brief Take this cycle's snapshot of the Jetson drive setpoints
+ * @return Consistent setpoints for all four wheels (valid until the next call)
+ */
+const DriveSetpoints_t& processCANMessages();
+
+/**
+ * @brief Decode queued ODrive feedback from the peripheral bus
+ */
+void processPeripheralMessages();
 
 /**
  * @brief Update the state machine based on timeouts
- * @param currentTime Current millis()
  */
-void updateStateMachine(unsigned long currentTime);
+void updateStateMachine();
+
+/**
+ * @brief Update component controller with this cycle's setpoints
+ * @param setpoints Snapshot from processCANMessages()
+ */
+void updateComponents(const DriveSetpoints_t& setpoints);
 
 /**
- * @brief Update component controller with CAN messages
- * @param msg Array of CANFDMessage
+ * @brief Hand the active runtime parameters (param_registry.h) to the
+ *        scheduler, state machine, component controller and aggregator
  */
-void updateComponents(std::array<CANFDMessage, 8> msg);
+void applyParameters();
 
 /**
  * @brief Update status LEDs based on current system state
@@ -0,0 +1,134 @@
+/**
+ * @file param_registry.h
+ * @brief Runtime parameters: typed table, staged changes, EEPROM image
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The rates and thresholds the Jetson may tune live in one table
+ * (HAT_PARAMS). Each entry has a wire ID, a type, a range and its
+ * hat_config.h default. Values are kept as raw 32-bit words, floats as
+ * their bits, which is also how they travel in MSG_TYPE_CONFIG_* frames
+ * (layout in message_construction.h).
+ *
+ * set() and load() only change the staged copy. apply() moves every staged
+ * change into the active copy at once and is called at the start of a
+ * drive cycle, so a control cycle never sees half of a batch of changes.
+ * The sketch then hands the active values to the subsystems.
+ *
+ * save() writes the staged values to EEPROM as one image: header, values
+ * in table order, CRC-32. The header holds a store version and a signature
+ * of the table (IDs and types), so an image written by a build with a
+ * different table is ignored and the defaults stay. Teensy EEPROM is
+ * emulated in flash and a write can stall for milliseconds, while drive
+ * frames keep arriving in any state; so save() only takes a snapshot, and
+ * serviceStore() writes and verifies one word of it per call from a slow
+ * task. Loop context only.
+ */
+
+#ifndef PARAM_REGISTRY_H
+#define PARAM_REGISTRY_H
+
+#include <stdint.h>
+#include "hat_config.h"
+#include "hat_profile.h"
+
+// Parameter table: X(name, id, type, default, min, max)
+// Types and request results (PARAM_TYPE_*, CONFIG_STATUS_*) are in
+// message_construction.h. IDs ascend, grouped by subsystem, and are never
+// reused. Shaper limits apply to every wheel; a summary field set is a
+// TELEMETRY_FIELD_* mask.
+#define HAT_PARAMS(X) \
+    X(DRIVE_TX_INTERVAL_US,  0x00, PARAM_TYPE_U32, HatProfile::commandIntervalUs,   250, 20000) \
+    X(TELEMETRY_INTERVAL_MS, 0x01, PARAM_TYPE_U16, HatProfile::telemetryIntervalMs, 10, 10000) \
+    X(HEARTBEAT_INTERVAL_MS, 0x02, PARAM_TYPE_U16, HAT_HEARTBEAT_INTERVAL_MS,       100, 10000) \
+    X(STATE_TIMEOUT_MS,      0x03, PARAM_TYPE_U32, HAT_STATE_TIMEOUT_MS,            100, 600000) \
+    X(SETPOINT_REFRESH_MS,   0x10, PARAM_TYPE_U16, HAT_SETPOINT_REFRESH_MS,         1, 1000) \
+    X(SETPOINT_VEL_EPSILON,  0x11, PARAM_TYPE_F32, HAT_SETPOINT_VEL_EPSILON,        0, 10) \
+    X(SETPOINT_POS_EPSILON,  0x12, PARAM_TYPE_F32, HAT_SETPOINT_POS_EPSILON,        0, 1) \
+    X(SETPOINT_STALE_MS,     0x13, PARAM_TYPE_U16, HAT_SETPOINT_STALE_MS,           10, 10000) \
+    X(SETPOINT_STALE_DECEL,  0x14, PARAM_TYPE_F32, HAT_SETPOINT_STALE_DECEL,        0.1, 1000) \
+    X(SHAPER_DRIVE_ACCEL,    0x18, PARAM_TYPE_F32, HAT_SHAPER_DRIVE_ACCEL,          0, 1000) \
+    X(SHAPER_STEER_RATE,     0x19, PARAM_TYPE_F32, HAT_SHAPER_STEER_RATE,           0, 100) \
+    X(SHAPER_STEER_ACCEL,    0x1A, PARAM_TYPE_F32, HAT_SHAPER_STEER_ACCEL,          0, 1000) \
+    X(AGG_STEER_INTERVAL_MS, 0x20, PARAM_TYPE_U16, HAT_AGG_STEER_INTERVAL_MS,       0, 60000) \
+    X(AGG_STEER_FIELDS,      0x21, PARAM_TYPE_U8,  HAT_AGG_STEER_FIELDS,            1, 14) \
+    X(AGG_STEER_BUDGET,      0x22, PARAM_TYPE_U16, HAT_AGG_STEER_BUDGET,            0, 65535) \
+    X(AGG_DRIVE_INTERVAL_MS, 0x23, PARAM_TYPE_U16, HAT_AGG_DRIVE_INTERVAL_MS,       0, 60000) \
+    X(AGG_DRIVE_FIELDS,      0x24, PARAM_TYPE_U8,  HAT_AGG_DRIVE_FIELDS,            1, 14) \
+    X(AGG_DRIVE_BUDGET,      0x25, PARAM_TYPE_U16, HAT_AGG_DRIVE_BUDGET,            0, 65535)
+
+#define PARAM_ENUM(name, id, type, def, min, max) PARAM_##name,
+typedef enum {
+    HAT_PARAMS(PARAM_ENUM)
+    HAT_PARAM_COUNT
+} HatParam_t;
+#undef PARAM_ENUM
+
+// One table entry
+typedef struct {
+    const char* name;
+    uint8_t id;
+    uint8_t type;
+    float defaultValue;
+    float min;
+    float max;
+} ParamInfo_t;
+
+class ParamRegistry {
+public:
+    // Constructor - every parameter on its default, nothing staged
+    ParamRegistry();
+
+    // Table lookup: index of the parameter with this wire ID or name, -1 if none
+    static int8_t find(uint8_t id);
+    static int8_t findByName(const char* name);
+    static const ParamInfo_t& info(uint8_t index);
+
+    // Staged side - the values requests see; CONFIG_STATUS_*
+    uint8_t set(uint8_t index, uint32_t raw);
+    uint32_t getStaged(uint8_t index) const;
+    uint8_t load();                 // From EEPROM; CONFIG_STATUS_DENIED while saving
+    void loadDefaults();
+
+    // Staged values to EEPROM: CONFIG_STATUS_OK once the snapshot is
+    // taken, CONFIG_STATUS_DENIED while another save is under way. owner
+    // and requester are the caller's, handed back with the result.
+    uint8_t save(uint8_t owner, uint8_t requester);
+    bool serviceStore();            // One word; true when that finished the save
+    bool isSaving() const;
+    // The result of a finished save, once, to the owner that started it
+    bool takeSaveResult(uint8_t owner, uint8_t& requester, uint8_t& status);
+
+    // Active side - true if staged changes were taken over
+    bool apply();
+    uint32_t get(HatParam_t param) const;
+    float getFloat(HatParam_t param) const;
+
+    // Raw word for a value of the parameter's type
+    static uint32_t encode(uint8_t index, float value);
+
+    // Statistics
+    uint32_t getApplyCount() const;
+    uint32_t getRejectedCount() const;
+    bool isLoadedFromStore() const;     // The last load() found a valid image
+
+private:
+    uint32_t active[HAT_PARAM_COUNT];
+    uint32_t staged[HAT_PARAM_COUNT];
+    bool pending;
+    bool fromStore;
+    uint32_t applies;
+    uint32_t rejected;
+
+    // Save in progress: the image being written, word by word
+    uint32_t storeImage[HAT_PARAM_COUNT + 3];
+    uint8_t storeNext;              // Next word, or the word count when idle
+    uint8_t storeOwner;
+    uint8_t storeRequester;
+    uint8_t storeStatus;
+    bool storeDone;                 // Result not yet taken
+};
+
+extern ParamRegistry paramRegistry;
+
+#endif // PARAM_REGISTRY_H
@@ -0,0 +1,71 @@
+/**
+ * @file scheduler.h
+ * @brief Cooperative fixed-rate task scheduler
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Every task has its own period and an absolute release time that advances
+ * by exactly one period per run, so the rate never drifts with the time the
+ * rest of loop() takes. run() is called from loop() with the current
+ * micros() value and starts every task whose release time has passed, in
+ * the order the tasks were added (first added = highest priority). Nothing
+ * here waits: if no task is due, run() returns straight away.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "hat_config.h"
+
+typedef void (*TaskFunction_t)(uint32_t nowMicros);
+
+// Per-task timing statistics
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns;            // Release times skipped because the task ran a full period late
+    uint32_t maxLatenessMicros;   // Worst start time after the release time
+    uint64_t totalLatenessMicros;
+    uint32_t minIntervalMicros;   // Shortest/longest start-to-start interval
+    uint32_t maxIntervalMicros;
+    uint32_t maxExecMicros;       // Longest single run
+} TaskStats_t;
+
+class TaskScheduler {
+public:
+    // Constructor
+    TaskScheduler();
+
+    // Task Management - returns the task ID, or -1 if the table is full
+    int8_t addTask(const char* name, TaskFunction_t function, uint32_t periodMicros);
+    void setPeriod(uint8_t taskId, uint32_t periodMicros);
+    uint32_t getPeriod(uint8_t taskId) const;
+
+    // Execution
+    void start(uint32_t nowMicros);
+    uint8_t run(uint32_t nowMicros);
+    uint32_t microsUntilNextRelease(uint32_t nowMicros) const;
+
+    // Statistics
+    uint8_t getTaskCount() const;
+    const char* getTaskName(uint8_t taskId) const;
+    const TaskStats_t& getStats(uint8_t taskId) const;
+    void resetStats();
+
+private:
+    typedef struct {
+        const char* name;
+        TaskFunction_t function;
+        uint32_t periodMicros;
+        uint32_t nextReleaseMicros;
+        uint32_t lastStartMicros;
+        TaskStats_t stats;
+    } Task_t;
+
+    Task_t tasks[HAT_SCHEDULER_MAX_TASKS];
+    uint8_t taskCount;
+
+    void runTask(Task_t& task, uint32_t nowMicros);
+};
+
+#endif // SCHEDULER_H
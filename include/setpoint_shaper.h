@@ -0,0 +1,94 @@
+/**
+ * @file setpoint_shaper.h
+ * @brief Interpolation and rate limiting of Jetson setpoints at the ODrive rate
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The Jetson publishes at its planner rate; the drive loop commands the
+ * ODrives every HatProfile::commandIntervalUs. Between the two, each wheel
+ * gets a reference that moves from where it was to the newest Jetson
+ * setpoint over the interval between that setpoint and the one before
+ * (HAT_SHAPER_INTERPOLATE), so a step becomes a ramp at the cost of up to
+ * one Jetson interval of lag. The output then follows the reference within
+ * the wheel's limits:
+ *
+ *  - Drive velocity: at most maxDriveAccel.
+ *  - Steering position: at most maxSteerRate, reached and left at
+ *    maxSteerAccel, and slowed in time to stop on the reference.
+ *
+ * A limit of 0 leaves that term unlimited. Loop context only.
+ */
+
+#ifndef SETPOINT_SHAPER_H
+#define SETPOINT_SHAPER_H
+
+#include <stdint.h>
+#include "setpoint_store.h"
+
+// Per-wheel shaping limits (defaults in hat_profile.h)
+typedef struct {
+    float maxDriveAccel;    // rad/s^2
+    float maxSteerRate;     // rad/s
+    float maxSteerAccel;    // rad/s^2
+} WheelLimits_t;
+
+class SetpointShaper {
+public:
+    // Constructor
+    SetpointShaper();
+
+    // Limits - may change between control cycles
+    void setLimits(uint8_t wheel, const WheelLimits_t& limits);
+    const WheelLimits_t& getLimits(uint8_t wheel) const;
+
+    // Latest Jetson setpoint for a wheel, as in the store snapshot; a new
+    // receivedMicros starts a new interpolation segment. The first one
+    // places the steering output on it unless setPosition() came first.
+    void track(uint8_t wheel, float velocity, float position, uint32_t receivedMicros, uint32_t nowMicros);
+
+    // Advances a wheel's output by one control period
+    void step(uint8_t wheel, uint32_t nowMicros, uint32_t elapsedMicros);
+
+    // Shaped output for the ODrive frames
+    float getVelocity(uint8_t wheel) const;
+    float getPosition(uint8_t wheel) const;
+
+    // Overrides the drive output (staleness, emergency stop); shaping
+    // carries on from this velocity
+    void setVelocity(uint8_t wheel, float velocity);
+
+    // Places the steering output, e.g. on the measured position before the
+    // first setpoint, so the first move is shaped too
+    void setPosition(uint8_t wheel, float position);
+    bool isPrimed(uint8_t wheel) const;
+
+    // Statistics - control periods in which a limit held the output back
+    uint32_t getLimitedCount(uint8_t wheel) const;
+
+private:
+    typedef struct {
+        // Reference: from*Start to *Target over intervalMicros from startMicros
+        float velocityStart;
+        float velocityTarget;
+        float positionStart;
+        float positionTarget;
+        uint32_t startMicros;
+        uint32_t intervalMicros;    // 0 = at the target straight away
+        uint32_t receivedMicros;
+        bool primed;                // A setpoint has been tracked
+        bool positioned;            // The steering output is known
+
+        // Output
+        float velocity;
+        float position;
+        float steerRate;
+        uint32_t limitedCount;
+    } WheelShape_t;
+
+    WheelShape_t wheels[DRIVE_WHEEL_COUNT];
+    WheelLimits_t limits[DRIVE_WHEEL_COUNT];
+
+    float reference(float start, float target, const WheelShape_t& shape, uint32_t nowMicros) const;
+};
+
+#endif // SETPOINT_SHAPER_H
@@ -0,0 +1,66 @@
+/**
+ * @file setpoint_store.h
+ * @brief Lock-free seqlock store for Jetson drive setpoints
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The FlexCAN receive interrupts are the writers; loop() is the only
+ * reader. With the auxiliary link there are two of them, so every Jetson
+ * link runs at HAT_JETSON_IRQ_PRIORITY (set in configureController()):
+ * at equal NVIC priority neither preempts the other, and writes never
+ * overlap.
+ * clear() holds interrupts off instead.
+ *
+ * The writer never blocks: it bumps the sequence to an odd value,
+ * updates one wheel, and bumps it back to even. The reader copies the whole
+ * table and retries if the sequence moved underneath it, so every snapshot
+ * is one consistent set of all four wheels.
+ */
+
+#ifndef SETPOINT_STORE_H
+#define SETPOINT_STORE_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define DRIVE_WHEEL_COUNT 4
+
+// Wheel index order used throughout: 0 = FL, 1 = FR, 2 = RL, 3 = RR
+typedef struct {
+    float angular_vel[DRIVE_WHEEL_COUNT];     // Desired drive velocity (rad/s)
+    float steering_angle[DRIVE_WHEEL_COUNT];  // Desired steering position (rad)
+    uint32_t received_us[DRIVE_WHEEL_COUNT];  // micros() when the wheel's Jetson frame arrived
+} DriveSetpoints_t;
+
+class DriveSetpointStore {
+public:
+    // Constructor
+    DriveSetpointStore();
+
+    // Writer side - FlexCAN interrupt context only, one priority for all links
+    void publish(uint8_t wheel, float omega, float theta, uint32_t receivedMicros);
+
+    // Zero every setpoint (safe to call from loop context)
+    void clear();
+
+    // Reader side - loop context only
+    void snapshot(DriveSetpoints_t& out);
+
+    // Statistics
+    uint32_t getPublishCount() const;
+    uint32_t getSnapshotCount() const;
+    uint32_t getTornReadCount() const;
+
+private:
+    std::atomic<uint32_t> sequence;
+    DriveSetpoints_t data;
+
+    std::atomic<uint32_t> publishCount;
+    uint32_t snapshotCount;
+    uint32_t tornReadCount;
+
+    void beginWrite();
+    void endWrite();
+};
+
+#endif // SETPOINT_STORE_H
@@ -3,12 +3,32 @@
  * @brief HAT state machine interface and definitions
  * @author SIRI Electrical Team
  * @date 2025
+ *
+ * The state machine is three tables fixed at compile time: the next state
+ * for every (state, event) pair, the authorities allowed to raise each
+ * event, and the message types accepted in each state as a 256-bit mask.
+ * processEvent() is one table lookup and a compare-and-swap on the state,
+ * so it may be called from interrupt context (the FlexCAN receive callback
+ * raises EVENT_EMERGENCY). isCommandAllowed() is one bit test and is meant
+ * for the per-frame receive path.
+ *
+ * A specific HAT extends the base tables with the constexpr builders and
+ * hands the result to the constructor:
+ *
+ *   static constexpr HATStateTables MY_TABLES =
+ *       HATStateTables::base().allow(STATE_POWER_ARMED, MSG_TYPE_MY_COMMAND);
+ *   HATStateMachine stateMachine(MY_TABLES);
+ *
+ * onEnterState()/onExitState() stay virtual but run from update() in loop
+ * context only, never on the transition path.
  */
 
 #ifndef STATE_MACHINE_H
 #define STATE_MACHINE_H
 
 #include <stdint.h>
+#include <atomic>
+#include "message_construction.h"
 
 // HAT State Definitions
 typedef enum {
@@ -42,54 +62,244 @@ typedef enum {
     EVENT_TIMEOUT = 8
 } StateMachineEvent_t;
 
+// Table dimensions
+#define HAT_STATE_COUNT 6
+#define HAT_AUTHORITY_COUNT 5
+#define HAT_EVENT_COUNT 9
+
+// Transition table entry for an event the state does not accept
+#define HAT_STATE_NONE 0xFF
+
+// Authority bit for HATStateTables::permit()
+#define AUTHORITY_BIT(authority) (1U << (authority))
+
+// Allowed message types, one bit per MSG_TYPE_* value
+#define HAT_MSG_MASK_WORDS 8
+
+// Mask bit for the Jetson drive commands, which have standard IDs and so no
+// MSG_TYPE_* of their own; no HAT message type uses this value
+#define HAT_CMD_DRIVE 0xE0
+
+// Compile-time transition, authority and command tables
+class HATStateTables {
+public:
+    // Nothing allowed, no transitions
+    constexpr HATStateTables() : next(), authority(), allowed() {
+        for (uint8_t s = 0; s < HAT_STATE_COUNT; s++) {
+            for (uint8_t e = 0; e < HAT_EVENT_COUNT; e++) {
+                next[s][e] = HAT_STATE_NONE;
+            }
+        }
+    }
+
+    // Tables shared by every HAT
+    static constexpr HATStateTables base() {
+        return HATStateTables()
+            // Events and who may raise them
+            .permit(EVENT_POWER_ON, AUTHORITY_BIT(AUTHORITY_SYSTEM) | AUTHORITY_BIT(AUTHORITY_BPS))
+            .permit(EVENT_POWER_OFF, AUTHORITY_BIT(AUTHORITY_SYSTEM) | AUTHORITY_BIT(AUTHORITY_BPS))
+            .permit(EVENT_UNLOCK, AUTHORITY_BIT(AUTHORITY_BASE_STATION) | AUTHORITY_BIT(AUTHORITY_OPERATOR))
+            .permit(EVENT_ARM, AUTHORITY_BIT(AUTHORITY_BASE_STATION) | AUTHORITY_BIT(AUTHORITY_OPERATOR))
+            .permit(EVENT_DISARM, AUTHORITY_BIT(AUTHORITY_SYSTEM) | AUTHORITY_BIT(AUTHORITY_BASE_STATION) |
+                                  AUTHORITY_BIT(AUTHORITY_OPERATOR) | AUTHORITY_BIT(AUTHORITY_BPS))
+            .permit(EVENT_LOCK, AUTHORITY_BIT(AUTHORITY_SYSTEM) | AUTHORITY_BIT(AUTHORITY_BASE_STATION) |
+                                AUTHORITY_BIT(AUTHORITY_OPERATOR) | AUTHORITY_BIT(AUTHORITY_BPS))
+            .permit(EVENT_EMERGENCY, (1U << HAT_AUTHORITY_COUNT) - 1)
+            .permit(EVENT_RESET, AUTHORITY_BIT(AUTHORITY_SYSTEM) | AUTHORITY_BIT(AUTHORITY_BASE_STATION))
+            .permit(EVENT_TIMEOUT, AUTHORITY_BIT(AUTHORITY_SYSTEM))
+
+            // Transitions
+            .transition(STATE_POWER_OFF, EVENT_POWER_ON, STATE_DISARMED)
+            .transition(STATE_DISARMED, EVENT_LOCK, STATE_LOCKED)
+            .transition(STATE_DISARMED, EVENT_UNLOCK, STATE_UNLOCKED)
+            .transition(STATE_LOCKED, EVENT_UNLOCK, STATE_UNLOCKED)
+            .transition(STATE_LOCKED, EVENT_DISARM, STATE_DISARMED)
+            .transition(STATE_UNLOCKED, EVENT_ARM, STATE_POWER_ARMED)
+            .transition(STATE_UNLOCKED, EVENT_LOCK, STATE_LOCKED)
+            .transition(STATE_UNLOCKED, EVENT_DISARM, STATE_DISARMED)
+            .transition(STATE_UNLOCKED, EVENT_TIMEOUT, STATE_LOCKED)
+            .transition(STATE_POWER_ARMED, EVENT_LOCK, STATE_LOCKED)
+            .transition(STATE_POWER_ARMED, EVENT_DISARM, STATE_DISARMED)
+            .transition(STATE_POWER_ARMED, EVENT_TIMEOUT, STATE_LOCKED)
+            .transition(STATE_EMERGENCY_STOP, EVENT_RESET, STATE_DISARMED)
+            .transitionFromAll(EVENT_EMERGENCY, STATE_EMERGENCY_STOP)
+            .transitionFromAll(EVENT_POWER_OFF, STATE_POWER_OFF)
+
+            // Queries, state commands, telemetry and emergencies everywhere
+            .allowInAll(MSG_TYPE_STATUS_REQUEST, MSG_TYPE_DIAGNOSTIC_RESP)
+            .allowInAll(MSG_TYPE_TELEMETRY_SENSOR, MSG_TYPE_HEARTBEAT)
+            .allowInAll(MSG_TYPE_STATE_UNLOCK, MSG_TYPE_STATE_RESPONSE)
+            .allowInAll(MSG_TYPE_EMERGENCY_STOP, MSG_TYPE_SYSTEM_SHUTDOWN)
+            .allowInAll(MSG_TYPE_CONFIG_GET, MSG_TYPE_CONFIG_GET)
+            .deny(STATE_POWER_OFF, MSG_TYPE_STATE_UNLOCK, MSG_TYPE_STATE_RESPONSE)
+
+            // Configuration only while nothing can move
+            .allow(STATE_DISARMED, MSG_TYPE_CONFIG_SET, MSG_TYPE_CONFIG_LOAD)
+            .allow(STATE_LOCKED, MSG_TYPE_CONFIG_SET, MSG_TYPE_CONFIG_LOAD)
+
+            // Control commands and setpoints only when armed; stop and disable always
+            .allow(STATE_POWER_ARMED, MSG_TYPE_CONTROL_START, MSG_TYPE_PACKED_SETPOINTS)
+            .allow(STATE_POWER_ARMED, HAT_CMD_DRIVE)
+            .allowInAll(MSG_TYPE_CONTROL_STOP, MSG_TYPE_CONTROL_STOP)
+            .allowInAll(MSG_TYPE_CONTROL_DISABLE, MSG_TYPE_CONTROL_DISABLE);
+    }
+
+    // Builders - each returns a modified copy, for use in constant expressions
+    constexpr HATStateTables transition(uint8_t from, uint8_t event, uint8_t to) const {
+        HATStateTables tables = *this;
+        tables.next[check(from, HAT_STATE_COUNT)][check(event, HAT_EVENT_COUNT)] = to;
+        return tables;
+    }
+
+    constexpr HATStateTables transitionFromAll(uint8_t event, uint8_t to) const {
+        HATStateTables tables = *this;
+        for (uint8_t s = 0; s < HAT_STATE_COUNT; s++) {
+            tables.next[s][check(event, HAT_EVENT_COUNT)] = to;
+        }
+        return tables;
+    }
+
+    constexpr HATStateTables permit(uint8_t event, uint8_t authorityMask) const {
+        HATStateTables tables = *this;
+        tables.authority[check(event, HAT_EVENT_COUNT)] = authorityMask;
+        return tables;
+    }
+
+    constexpr HATStateTables allow(uint8_t state, uint8_t first, uint8_t last) const {
+        return setMessages(state, first, last, true);
+    }
+
+    constexpr HATStateTables allow(uint8_t state, uint8_t type) const {
+        return setMessages(state, type, type, true);
+    }
+
+    constexpr HATStateTables deny(uint8_t state, uint8_t first, uint8_t last) const {
+        return setMessages(state, first, last, false);
+    }
+
+    constexpr HATStateTables allowInAll(uint8_t first, uint8_t last) const {
+        HATStateTables tables = *this;
+        for (uint8_t s = 0; s < HAT_STATE_COUNT; s++) {
+            tables = tables.setMessages(s, first, last, true);
+        }
+        return tables;
+    }
+
+    // Lookups
+    constexpr uint8_t nextState(uint8_t state, uint8_t event) const {
+        return (state < HAT_STATE_COUNT && event < HAT_EVENT_COUNT) ? next[state][event] : HAT_STATE_NONE;
+    }
+
+    constexpr bool permits(uint8_t authorityLevel, uint8_t event) const {
+        return event < HAT_EVENT_COUNT && authorityLevel < HAT_AUTHORITY_COUNT &&
+               ((authority[event] >> authorityLevel) & 1U) != 0;
+    }
+
+    constexpr bool allows(uint8_t state, uint8_t type) const {
+        return ((allowed[state][type >> 5] >> (type & 31)) & 1U) != 0;
+    }
+
+private:
+    uint8_t next[HAT_STATE_COUNT][HAT_EVENT_COUNT];
+    uint8_t authority[HAT_EVENT_COUNT];
+    uint32_t allowed[HAT_STATE_COUNT][HAT_MSG_MASK_WORDS];
+
+    constexpr HATStateTables setMessages(uint8_t state, uint8_t first, uint8_t last, bool on) const {
+        HATStateTables tables = *this;
+        check(state, HAT_STATE_COUNT);
+        for (uint16_t type = first; type <= last; type++) {
+            const uint32_t bit = 1UL << (type & 31);
+            if (on) {
+                tables.allowed[state][type >> 5] |= bit;
+            } else {
+                tables.allowed[state][type >> 5] &= ~bit;
+            }
+        }
+        return tables;
+    }
+
+    // Not a constant expression (so a build error) for an out-of-range index
+    static constexpr uint8_t check(uint8_t value, uint8_t count) {
+        return value < count ? value : (invalidIndex(), value);
+    }
+
+    static void invalidIndex() {}
+};
+
+// Tables of the generic HAT
+extern const HATStateTables HAT_BASE_STATE_TABLES;
+
 // State Machine Class
 class HATStateMachine {
 public:
-    // Constructor/Destructor
-    HATStateMachine();
-    ~HATStateMachine();
-    
+    // Constructor/Destructor - tables must outlive the state machine
+    explicit HATStateMachine(const HATStateTables& tables = HAT_BASE_STATE_TABLES);
+    virtual ~HATStateMachine();
+
     // Initialization
     bool initialize();
-    
-    // State Management
-    HAT_State_t getCurrentState();
+
+    // Loop context: runs the hooks for transitions made since the last call,
+    // then checks the activity timeout
+    void update();
+
+    // State Management - interrupt or loop context
+    HAT_State_t getCurrentState() const {
+        return (HAT_State_t)currentState.load(std::memory_order_relaxed);
+    }
     bool transitionToState(HAT_State_t newState, Authority_t authority);
     bool processEvent(StateMachineEvent_t event, Authority_t authority);
-    
-    // Command Authorization
-    bool isCommandAllowed(uint8_t commandType);
-    bool validateAuthority(Authority_t authority, StateMachineEvent_t event);
-    
-    // Timeout Handling
+
+    // Command Authorization - one bit test, safe on the receive path
+    bool isCommandAllowed(uint8_t commandType) const {
+        return tables.allows(currentState.load(std::memory_order_relaxed), commandType);
+    }
+    bool validateAuthority(Authority_t authority, StateMachineEvent_t event) const;
+
+    // Timeout Handling - the timeout may change between update() calls
     void handleTimeout();
     void resetTimeout();
-    uint32_t getStateUptime();
-    
-    // Emergency Handling
+    void setTimeout(uint32_t timeoutMs);
+    uint32_t getTimeout() const;
+    uint32_t getStateUptime() const;
+
+    // Emergency Handling - interrupt or loop context
     void handleEmergency();
     void enterSafeMode();
-    
+
     // State Information
-    const char* getStateName(HAT_State_t state);
-    const char* getCurrentStateName();
-    
-    // Callbacks (virtual - to be overridden by specific HAT implementations)
+    const char* getStateName(HAT_State_t state) const;
+    const char* getCurrentStateName() const;
+
+    // Statistics
+    uint32_t getTransitionCount() const;
+    uint32_t getRejectedEvents() const;
+
+    // Callbacks (virtual - to be overridden by specific HAT implementations),
+    // called from update(); a burst of transitions between two update() calls
+    // is reported as one, from the last state entered to the current one
     virtual void onEnterState(HAT_State_t state);
     virtual void onExitState(HAT_State_t state);
-    virtual bool validateTransition(HAT_State_t from, HAT_State_t to);
 
 private:
-    HAT_State_t currentState;
-    HAT_State_t previousState;
-    uint32_t stateEntryTime;
-    uint32_t lastActivityTime;
-    bool emergencyFlag;
-    
+    const HATStateTables& tables;
+    std::atomic<uint8_t> currentState;
+    std::atomic<uint32_t> transitionCount;
+    std::atomic<uint32_t> rejectedEvents;
+    std::atomic<uint32_t> stateEntryTime;
+    std::atomic<uint32_t> lastActivityTime;
+    uint32_t timeoutMs;             // Loop side, HAT_STATE_TIMEOUT_MS by default
+
+    // Loop side: last state whose onEnterState() ran
+    HAT_State_t enteredState;
+    uint32_t handledTransitions;
+
     // Internal helper functions
-    bool isValidTransition(HAT_State_t from, HAT_State_t to);
     void updateStateTimestamp();
     void logStateTransition(HAT_State_t from, HAT_State_t to);
 };
 
-#endif // STATE_MACHINE_H
\ No newline at end of file
+// The state machine constructed last, for interrupt handlers
+extern HATStateMachine *HATStateMachineInstance;
+
+#endif // STATE_MACHINE_H
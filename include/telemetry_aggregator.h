@@ -0,0 +1,96 @@
+/**
+ * @file telemetry_aggregator.h
+ * @brief Per-signal windows over ODrive feedback, summarised for the Jetson
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The ODrives report encoder estimates far faster than the Jetson needs
+ * them. Every estimate is folded into a window for its signal (steering
+ * angle or drive velocity of one wheel) that keeps min, max, sum, last and
+ * sample count in place, with nothing allocated. collect() closes the
+ * windows that are due and hands back one summary each, for the Jetson
+ * links to send as telemetry summary frames (layout in
+ * message_construction.h).
+ *
+ * Each signal has its own interval, fields and byte budget. The budget
+ * (bytes per second, counted as worst-case frame bits on the wire) refills
+ * a credit of at most HAT_AGG_BUDGET_BURST frames; a window that falls due
+ * without credit stays open and keeps collecting samples, so a tight
+ * budget sends fewer, wider summaries instead of more bus load. Loop
+ * context only.
+ */
+
+#ifndef TELEMETRY_AGGREGATOR_H
+#define TELEMETRY_AGGREGATOR_H
+
+#include <stdint.h>
+#include "message_construction.h"
+#include "hat_config.h"
+
+// How one signal is summarised
+typedef struct {
+    uint16_t intervalMs;        // Window length, 0 = signal not summarised
+    uint8_t fields;             // TELEMETRY_FIELD_*, at most TELEMETRY_SUMMARY_MAX_FIELDS
+    uint16_t budgetBytes;       // Per second on the wire, 0 = unlimited
+} TelemetrySignalConfig_t;
+
+class TelemetryAggregator {
+public:
+    // Constructor - every signal starts on the hat_config.h defaults
+    TelemetryAggregator();
+
+    // Configuration - takes effect from the next window; false for an
+    // unknown signal or too many fields
+    bool setSignalConfig(uint8_t signal, const TelemetrySignalConfig_t& config);
+    const TelemetrySignalConfig_t& getSignalConfig(uint8_t signal) const;
+
+    // Writer side - one sample of one signal
+    void record(uint8_t signal, float value);
+
+    // Reader side - summaries of the windows that are due and within budget,
+    // at most max of them; each one closes its window
+    uint8_t collect(uint32_t nowMicros, TelemetrySummary_t* out, uint8_t max);
+
+    // Forget every open window
+    void clear();
+
+    // Statistics
+    uint32_t getSampleCount(uint8_t signal) const;
+    uint32_t getSummaryCount(uint8_t signal) const;
+    uint32_t getDeferredCount(uint8_t signal) const;   // Windows held open by the budget
+    uint32_t getSentBytes(uint8_t signal) const;       // Budgeted bytes of every summary
+
+    // Wire cost a summary with these fields is charged
+    static uint8_t frameBytes(uint8_t fields);
+
+private:
+    typedef struct {
+        // Open window
+        float min;
+        float max;
+        float sum;
+        float last;
+        uint32_t count;
+        uint32_t startMicros;
+        bool started;           // startMicros is set
+        bool deferred;          // Already counted as held by the budget
+
+        // Budget
+        float credit;           // Bytes
+        uint32_t creditMicros;
+
+        // Statistics
+        uint32_t samples;
+        uint32_t summaries;
+        uint32_t deferrals;
+        uint32_t sentBytes;
+    } Window_t;
+
+    TelemetrySignalConfig_t configs[TELEMETRY_SIGNAL_COUNT];
+    Window_t windows[TELEMETRY_SIGNAL_COUNT];
+
+    void resetWindow(Window_t& window);
+    bool spend(uint8_t signal, uint32_t nowMicros);
+};
+
+#endif // TELEMETRY_AGGREGATOR_H
@@ -0,0 +1,54 @@
+/**
+ * @file telemetry_store.h
+ * @brief Latest ODrive encoder feedback for the four drive wheels
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Filled from ODrive Get_Encoder_Estimates frames as the MCP2517FD receive
+ * buffer is drained, and read when telemetry is forwarded to the Jetson.
+ * Both happen in loop() context, so a snapshot is always one consistent set
+ * of all four wheels stamped with a single timestamp.
+ */
+
+#ifndef TELEMETRY_STORE_H
+#define TELEMETRY_STORE_H
+
+#include <stdint.h>
+#include "setpoint_store.h"
+
+// Wheel index order as DriveSetpoints_t: 0 = FL, 1 = FR, 2 = RL, 3 = RR
+typedef struct {
+    float angular_vel[DRIVE_WHEEL_COUNT];     // Drive node velocity estimate
+    float wheel_pos[DRIVE_WHEEL_COUNT];       // Drive node position estimate
+    float steering_angle[DRIVE_WHEEL_COUNT];  // Steer node position estimate
+    uint32_t timestampMicros;                 // When the snapshot was taken
+} DriveTelemetry_t;
+
+class DriveTelemetryStore {
+public:
+    // Constructor
+    DriveTelemetryStore();
+
+    // Writer side - one encoder estimate from a drive or steer node
+    void recordDrive(uint8_t wheel, float pos, float vel);
+    void recordSteer(uint8_t wheel, float pos);
+
+    // Forget everything received so far
+    void clear();
+
+    // Reader side - false until at least one estimate has arrived
+    bool snapshot(DriveTelemetry_t& out, uint32_t nowMicros);
+
+    // Latest steering estimate for one wheel, false if none yet
+    bool getSteerPosition(uint8_t wheel, float& pos) const;
+
+    // Statistics
+    uint32_t getUpdateCount() const;
+
+private:
+    DriveTelemetry_t data;
+    uint32_t updateCount;
+    uint8_t steerSeen;          // Bit per wheel
+};
+
+#endif // TELEMETRY_STORE_H
@@ -0,0 +1,81 @@
+/**
+ * @file trace.h
+ * @brief Binary trace ring for interrupt-safe logging
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Hot paths (the FlexCAN receive callback, the CANFD transmit loop) must not
+ * touch Serial. They write fixed-size records into a lock-free ring instead,
+ * and loop() drains a few records per pass when it has nothing better to do.
+ * Each TRACE_* macro compiles to nothing below its level, so a build with
+ * HAT_TRACE_LEVEL 0 (or HAT_DEBUG_ENABLED 0) carries no tracing cost at all.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "hat_config.h"
+
+// Trace Levels
+#define HAT_TRACE_LEVEL_OFF 0
+#define HAT_TRACE_LEVEL_ERROR 1
+#define HAT_TRACE_LEVEL_EVENT 2
+#define HAT_TRACE_LEVEL_FRAME 3
+
+#if !HAT_DEBUG_ENABLED
+#undef HAT_TRACE_LEVEL
+#define HAT_TRACE_LEVEL HAT_TRACE_LEVEL_OFF
+#endif
+
+// Trace Event IDs
+typedef enum {
+    TRACE_EVENT_JETSON_RX = 0x01,        // Frame received from the Jetson bus
+    TRACE_EVENT_JETSON_TX = 0x02,        // Frame written to the Jetson bus
+    TRACE_EVENT_PERIPH_TX = 0x10,        // Frame queued to the MCP2517FD
+    TRACE_EVENT_PERIPH_TX_FAIL = 0x11,   // MCP2517FD transmit FIFO full
+    TRACE_EVENT_PERIPH_RX = 0x12,        // Frame received from the peripheral bus
+    TRACE_EVENT_STATE = 0x20,            // State change: data = { from, to }
+    TRACE_EVENT_BUS = 0x21,              // Bus error state change: data = { bus, from, to, tec, rec }
+    TRACE_EVENT_BUS_RECOVERY = 0x22      // Bus recovery attempt: data = { bus, action, ok }
+} TraceEvent_t;
+
+// One trace record - 20 bytes, only the first 8 payload bytes are kept
+typedef struct {
+    uint32_t timestamp;   // micros() at the time of the event
+    uint32_t canId;
+    uint8_t event;        // TraceEvent_t
+    uint8_t len;          // Original payload length
+    uint16_t sequence;    // Record number, wraps at 65536
+    uint8_t data[8];
+} TraceRecord_t;
+
+// Writer side - safe from interrupt and loop context, never blocks
+void traceRecord(uint8_t event, uint32_t canId, const uint8_t* data, uint8_t len);
+
+// Reader side - loop context only. Formats (or streams) up to maxRecords
+// records to Serial and returns how many were written.
+uint16_t traceDrain(uint16_t maxRecords);
+
+// Records lost because the ring was full
+uint32_t traceDroppedCount();
+
+#if HAT_TRACE_LEVEL >= HAT_TRACE_LEVEL_ERROR
+#define TRACE_ERROR(event, id, data, len) traceRecord((event), (id), (data), (len))
+#else
+#define TRACE_ERROR(event, id, data, len) do {} while (0)
+#endif
+
+#if HAT_TRACE_LEVEL >= HAT_TRACE_LEVEL_EVENT
+#define TRACE_EVENT(event, id, data, len) traceRecord((event), (id), (data), (len))
+#else
+#define TRACE_EVENT(event, id, data, len) do {} while (0)
+#endif
+
+#if HAT_TRACE_LEVEL >= HAT_TRACE_LEVEL_FRAME
+#define TRACE_FRAME(event, id, data, len) traceRecord((event), (id), (data), (len))
+#else
+#define TRACE_FRAME(event, id, data, len) do {} while (0)
+#endif
+
+#endif // TRACE_H
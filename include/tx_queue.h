@@ -0,0 +1,88 @@
+/**
+ * @file tx_queue.h
+ * @brief Priority transmit queue with coalescing and deadlines for the MCP2517FD
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Frames wait here instead of in the controller FIFO, where they can no
+ * longer be replaced. A frame enqueued for an ID that is already pending
+ * overwrites the pending one (coalescing), so each ODrive node/command
+ * holds only its newest setpoint. flush() hands frames to the controller
+ * in priority class order, earliest deadline first inside a class, as one
+ * transport batch that stops when the controller FIFO is full; frames
+ * whose deadline has passed are dropped instead of being sent late. Loop
+ * context only.
+ */
+
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <stdint.h>
+#include "ACAN2517FD.h"
+#include "mcp2517fd_transport.h"
+#include "hat_config.h"
+
+// Priority classes, most urgent first
+#define TX_CLASS_EMERGENCY 0    // Emergency stop and state changes
+#define TX_CLASS_DRIVE 1        // Drive and steering setpoints
+#define TX_CLASS_TELEMETRY 2    // Feedback requests
+#define TX_CLASS_COUNT 3
+
+// Tags identify the owner of a frame in takeExpiredTags(); 0-31
+#define TX_TAG_NONE 0xFF
+
+class PeripheralTxQueue {
+public:
+    // Constructor
+    PeripheralTxQueue();
+
+    // Queue a frame until deadlineMicros. With coalesce, a pending frame on
+    // the same ID is replaced (and takes the new class, deadline and tag).
+    // When full, the least urgent pending frame is evicted if it is in a
+    // lower class; otherwise the new frame is refused and false returned.
+    bool enqueue(const CANFDMessage& frame, uint8_t txClass, uint32_t deadlineMicros,
+                 bool coalesce, uint8_t tag = TX_TAG_NONE);
+
+    // Drop expired frames, then send the rest, most urgent first, until the
+    // controller refuses one; returns the number handed to the controller
+    uint8_t flush(MCP2517FDTransport& transport, uint32_t nowMicros);
+
+    // Discard everything pending
+    void clear();
+
+    // Bit per tag whose frame was dropped or evicted since the last call
+    uint32_t takeExpiredTags();
+
+    // Statistics
+    uint8_t getPendingCount() const;
+    uint8_t getPeakCount() const;
+    uint32_t getSentCount() const;
+    uint32_t getCoalescedCount() const;
+    uint32_t getExpiredCount() const;
+    uint32_t getRejectedCount() const;
+
+private:
+    typedef struct {
+        CANFDMessage frame;
+        uint32_t deadlineMicros;
+        uint8_t txClass;
+        uint8_t tag;
+        bool coalesce;
+        bool pending;
+    } TxEntry_t;
+
+    TxEntry_t entries[HAT_PERIPH_TX_QUEUE_SIZE];
+    uint8_t pendingCount;
+    uint8_t peakCount;
+    uint32_t expiredTags;
+    uint32_t sentCount;
+    uint32_t coalescedCount;
+    uint32_t expiredCount;
+    uint32_t rejectedCount;
+
+    bool moreUrgent(const TxEntry_t& a, const TxEntry_t& b) const;
+    int findCoalescable(const CANFDMessage& frame) const;
+    void drop(uint8_t index);
+};
+
+#endif // TX_QUEUE_H
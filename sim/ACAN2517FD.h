@@ -0,0 +1,293 @@
+/**
+ * @file ACAN2517FD.h
+ * @brief In-process ACAN2517FD stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Models the MCP2517FD as a bounded transmit buffer drained at the wire
+ * rate implied by the configured bit rates, plus a receive FIFO the harness
+ * can fill. Frames with idx 255 go to the TXQ, which is modelled as the
+ * higher priority queue: it goes on the wire as soon as the frame in
+ * progress completes, ahead of everything waiting in the transmit FIFO.
+ * Every frame accepted into the transmit FIFO or TXQ is reported through
+ * txHook with the simulated enqueue time, and again through wireHook once
+ * it has been sent. Setting FRESET in the transmit
+ * FIFO control register drops the frames in it that have not started.
+ *
+ * Received frames land in the controller receive FIFO and raise the
+ * interrupt; isr() moves them into the driver receive buffer. The library
+ * calls are charged the SPI traffic of the library's register sequence.
+ * The chip is also attached to the SPI bus as a device, with the FIFO
+ * control registers and message RAM of the receive and transmit FIFOs
+ * modelled, so a transport can drive the FIFOs with READ and WRITE
+ * instructions as on the real part (DS20005688).
+ */
+
+#ifndef SIM_ACAN2517FD_H
+#define SIM_ACAN2517FD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SPI.h"
+
+class CANFDMessage {
+public:
+    typedef enum : uint8_t {
+        CAN_REMOTE,
+        CAN_DATA,
+        CANFD_NO_BIT_RATE_SWITCH,
+        CANFD_WITH_BIT_RATE_SWITCH
+    } Type;
+
+    CANFDMessage() : id(0), ext(false), type(CANFD_WITH_BIT_RATE_SWITCH), idx(0), len(0), data64() {}
+
+    uint32_t id;
+    bool ext;
+    Type type;
+    uint8_t idx;
+    uint8_t len;
+    union {
+        uint64_t data64[8];
+        uint32_t data32[16];
+        uint16_t data16[32];
+        float dataFloat[16];
+        uint8_t data[64];
+    };
+
+    void pad();
+    bool isValid() const;
+};
+
+typedef void (*ACANFDCallBackRoutine)(const CANFDMessage& inMessage);
+
+class ACAN2517FDSettings {
+public:
+    typedef enum {
+        OSC_4MHz, OSC_4MHz_DIVIDED_BY_2, OSC_4MHz10xPLL, OSC_4MHz10xPLL_DIVIDED_BY_2,
+        OSC_20MHz, OSC_20MHz_DIVIDED_BY_2, OSC_40MHz, OSC_40MHz_DIVIDED_BY_2
+    } Oscillator;
+
+    typedef enum {
+        DATA_BITRATE_x1 = 1, DATA_BITRATE_x2 = 2, DATA_BITRATE_x3 = 3,
+        DATA_BITRATE_x4 = 4, DATA_BITRATE_x5 = 5, DATA_BITRATE_x6 = 6,
+        DATA_BITRATE_x7 = 7, DATA_BITRATE_x8 = 8, DATA_BITRATE_x10 = 10
+    } DataBitRateFactor;
+
+    typedef enum {
+        NormalFD = 0, Sleep = 1, InternalLoopBack = 2, ListenOnly = 3,
+        Configuration = 4, ExternalLoopBack = 5, Normal20B = 6, RestrictedOperation = 7
+    } OperationMode;
+
+    typedef enum {
+        PAYLOAD_8 = 0, PAYLOAD_12 = 1, PAYLOAD_16 = 2, PAYLOAD_20 = 3,
+        PAYLOAD_24 = 4, PAYLOAD_32 = 5, PAYLOAD_48 = 6, PAYLOAD_64 = 7
+    } PayloadSize;
+
+    static uint32_t objectSizeForPayload(const PayloadSize inPayload);
+    uint32_t ramUsage() const;
+
+    ACAN2517FDSettings(const Oscillator inOscillator,
+                       const uint32_t inDesiredArbitrationBitRate,
+                       const DataBitRateFactor inDataBitRateFactor,
+                       const uint32_t inTolerancePPM = 1000);
+
+    uint32_t actualArbitrationBitRate() const { return mDesiredArbitrationBitRate; }
+    uint32_t actualDataBitRate() const { return mDesiredArbitrationBitRate * (uint32_t)mDataBitRateFactor; }
+
+    Oscillator mOscillator;
+    uint32_t mDesiredArbitrationBitRate;
+    DataBitRateFactor mDataBitRateFactor;
+    OperationMode mRequestedMode = NormalFD;
+    bool mISOCRCEnabled = true;
+    uint16_t mDriverTransmitFIFOSize = 16;
+    uint8_t mControllerTransmitFIFOSize = 20;
+    uint8_t mControllerTXQSize = 0;
+    uint8_t mControllerTXQBufferPriority = 31;
+    uint8_t mControllerTransmitFIFOPriority = 0;
+    uint16_t mDriverReceiveFIFOSize = 32;
+    uint8_t mControllerReceiveFIFOSize = 27;
+    PayloadSize mControllerTXQBufferPayload = PAYLOAD_64;
+    PayloadSize mControllerTransmitFIFOPayload = PAYLOAD_64;
+    PayloadSize mControllerReceiveFIFOPayload = PAYLOAD_64;
+};
+
+class ACAN2517FDFilters {
+public:
+    typedef enum { kStandard, kExtended, kAny } Format;
+
+    void appendPassAllFilter(const ACANFDCallBackRoutine inCallBackRoutine);
+    void appendFormatFilter(const Format inFormat, const ACANFDCallBackRoutine inCallBackRoutine);
+    void appendFrameFilter(const Format inFormat, const uint32_t inIdentifier,
+                           const ACANFDCallBackRoutine inCallBackRoutine);
+    void appendFilter(const Format inFormat, const uint32_t inMask, const uint32_t inAcceptance,
+                      const ACANFDCallBackRoutine inCallBackRoutine);
+
+    uint8_t filterCount() const { return count; }
+    bool matches(const CANFDMessage& msg, uint8_t& filterIndex) const;
+    ACANFDCallBackRoutine callBack(uint8_t index) const;
+
+private:
+    struct Filter {
+        Format format;
+        uint32_t mask;
+        uint32_t acceptance;
+        ACANFDCallBackRoutine callBack;
+    };
+    static const uint8_t kMaxFilters = 32;
+    Filter filters[kMaxFilters];
+    uint8_t count = 0;
+
+    void append(const Format inFormat, const uint32_t inMask, const uint32_t inAcceptance,
+                const ACANFDCallBackRoutine inCallBackRoutine);
+};
+
+#define SIM_ACAN_TX_CAPACITY 64
+#define SIM_ACAN_RX_CAPACITY 256
+#define SIM_ACAN_FIFO_CAPACITY 32          // Controller FIFO depth, FSIZE + 1
+#define SIM_ACAN_RAM_SIZE 2048
+
+// begin() timing model: the crystal starts at power-on (clock zero) and is
+// stable after SIM_ACAN_OSC_READY_US; reset, RAM init, bit timing and the
+// mode change then take SIM_ACAN_CONFIGURE_US of SPI traffic and polling
+#define SIM_ACAN_OSC_READY_US 3000
+#define SIM_ACAN_CONFIGURE_US 1500
+
+// FIFO numbers the library uses
+#define SIM_ACAN_RECEIVE_FIFO 1
+#define SIM_ACAN_TRANSMIT_FIFO 2
+
+class ACAN2517FD {
+public:
+    // begin() error, as the library reports it
+    static const uint32_t kControllerRamUsageGreaterThan2048 = (uint32_t)1 << 9;
+
+    ACAN2517FD(const uint8_t inCS, SPIClass& inSPI, const uint8_t inINT);
+
+    uint32_t begin(const ACAN2517FDSettings& inSettings, void (*inInterruptServiceRoutine)(void));
+    uint32_t begin(const ACAN2517FDSettings& inSettings, void (*inInterruptServiceRoutine)(void),
+                   const ACAN2517FDFilters& inFilters);
+    void end();
+
+    bool tryToSend(const CANFDMessage& inMessage);
+    bool available();
+    bool receive(CANFDMessage& outMessage);
+    bool dispatchReceivedMessage(const ACANFDCallBackRoutine inFilterMatchCallBack = nullptr);
+
+    void isr();
+    bool isr_core();
+    void poll();
+
+    uint32_t errorCounters();
+    ACAN2517FDSettings::OperationMode currentOperationMode();
+    bool recoverFromRestrictedOperationMode();
+    uint16_t driverTransmitBufferPeakCount() const { return txPeak; }
+    uint16_t driverReceiveFIFOPeakCount() const { return rxPeak; }
+
+    // Harness API
+    static ACAN2517FD* instance();
+    bool injectReceive(const CANFDMessage& msg);
+    uint16_t pendingTransmitCount();
+    uint32_t getReceiveOverflowCount() const { return rxOverflows; }    // Controller receive FIFO full
+    uint64_t lastTransmitDoneMicros() const { return lastDone; }   // Wire completion of the last frame sent
+    uint64_t frameWireMicros(const CANFDMessage& msg) const;
+    uint32_t getSentCount() const { return sent; }
+    uint32_t getRejectedCount() const { return rejected; }
+    uint32_t getAbortedCount() const { return aborted; }    // Dropped from the transmit FIFO by FRESET
+    void setErrorCounters(uint8_t tec, uint8_t rec);
+    void setOperationMode(ACAN2517FDSettings::OperationMode mode);
+    // A shorted or open bus: bus-off, frames not yet on the wire are held
+    // and nothing is received. Once it clears the controller rejoins by
+    // itself after 128 x 11 recessive bits, as the MCP2517FD does.
+    void setBusFault(bool faulted);
+    // Brown-out or reset of the chip: configuration mode, FIFOs empty, no
+    // error state; only begin() brings it back
+    void resetChip();
+
+    // Called for every frame accepted by tryToSend(), with simulated enqueue time
+    static void (*txHook)(const CANFDMessage& msg, uint64_t enqueueMicros);
+    // Called for every transmit FIFO or TXQ frame once it is off the wire,
+    // as the harness next looks at the controller
+    static void (*wireHook)(const CANFDMessage& msg, uint64_t enqueueMicros, uint64_t startMicros,
+                            uint64_t doneMicros);
+
+private:
+    SPIClass& spi;
+    const uint8_t intPin;
+    bool started = false;
+    uint32_t arbitrationBitRate = 1000000;
+    uint32_t dataBitRate = 1000000;
+    uint16_t txCapacity = 0;
+    uint16_t txqCapacity = 0;
+    ACAN2517FDSettings::OperationMode mode = ACAN2517FDSettings::Configuration;
+    ACAN2517FDFilters filters;
+    bool hasFilters = false;
+    void (*interruptRoutine)(void) = nullptr;
+    SPISettings spiSettings;
+    uint16_t driverRxCapacity = 0;
+
+    // Transmit buffer modelled by wire-completion times
+    uint64_t txStart[SIM_ACAN_TX_CAPACITY] = {};
+    uint64_t txDone[SIM_ACAN_TX_CAPACITY] = {};
+    uint64_t txEnqueued[SIM_ACAN_TX_CAPACITY] = {};
+    CANFDMessage txMessage[SIM_ACAN_TX_CAPACITY];
+    uint16_t txHead = 0;
+    uint16_t txCount = 0;
+    uint64_t txqDone[SIM_ACAN_TX_CAPACITY] = {};
+    uint64_t txqEnqueued[SIM_ACAN_TX_CAPACITY] = {};
+    CANFDMessage txqMessage[SIM_ACAN_TX_CAPACITY];
+    uint16_t txqHead = 0;
+    uint16_t txqCount = 0;
+    uint64_t wireFreeAt = 0;
+    uint64_t lastDone = 0;
+
+    // Driver receive buffer
+    CANFDMessage rxFifo[SIM_ACAN_RX_CAPACITY];
+    uint16_t rxHead = 0;
+    uint16_t rxCount = 0;
+
+    // Controller FIFOs as the SPI side sees them; the receive FIFO objects
+    // are also kept decoded, the transmit FIFO only needs its head index
+    uint8_t ram[SIM_ACAN_RAM_SIZE] = {};
+    uint16_t txqBase = 0;
+    uint16_t rxFifoBase = 0;
+    uint16_t txFifoBase = 0;
+    uint8_t txqPayload = 7;
+    uint8_t rxFifoPayload = 7;
+    uint8_t txFifoPayload = 7;
+    uint8_t rxFifoDepth = 1;
+    uint8_t txFifoDepth = 1;
+    uint8_t txFifoHead = 0;
+    CANFDMessage controllerRx[SIM_ACAN_FIFO_CAPACITY];
+    uint8_t controllerRxTail = 0;
+    uint8_t controllerRxCount = 0;
+    bool rxOverflowFlag = false;
+    uint32_t rxOverflows = 0;
+    bool rxInterruptEnabled = true;    // Off while the driver buffer is full
+
+    uint16_t txPeak = 0;
+    uint16_t rxPeak = 0;
+    uint32_t sent = 0;
+    uint32_t rejected = 0;
+    uint32_t aborted = 0;
+    uint8_t tec = 0;
+    uint8_t rec = 0;
+    bool busFault = false;
+    uint64_t busOffRecoveryAt = UINT64_MAX;
+
+    bool isBusOff();
+    void updateInterruptLine();
+    void retireTransmitted();
+    bool sendViaTXQ(const CANFDMessage& inMessage, bool onBus, uint64_t now);
+    bool enqueueTransmit(const CANFDMessage& inMessage);
+    void chargeLibraryTransfer(uint16_t ramBytes);
+
+    // SPI device side
+    static void spiExchange(void* context, const uint8_t* tx, uint8_t* rx, size_t count);
+    uint32_t readRegister(uint16_t address);
+    uint8_t readByte(uint16_t address);
+    void writeByte(uint16_t address, uint8_t value);
+    void commitTransmitObject();
+    void resetTransmitFifo();
+};
+
+#endif // SIM_ACAN2517FD_H
@@ -0,0 +1,120 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "sim_clock.h"
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+// Time
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// Cortex-M7 DWT cycle counter. Here it runs off the host clock, scaled to
+// F_CPU_ACTUAL, so cycle deltas measure the native code's own cost.
+#define F_CPU_ACTUAL 600000000
+uint32_t simCycleCount();
+#define ARM_DWT_CYCCNT (simCycleCount())
+
+// Interrupt numbers used with SPI.usingInterrupt()
+typedef enum {
+    IRQ_CAN1 = 36,
+    IRQ_CAN2 = 37,
+    IRQ_CAN3 = 154
+} IRQ_NUMBER_t;
+#define digitalPinToInterrupt(pin) (pin)
+
+// NVIC priorities, kept per interrupt number; nothing preempts here
+void simNvicSetPriority(uint32_t irq, uint8_t priority);
+uint8_t simNvicGetPriority(uint32_t irq);
+#define NVIC_SET_PRIORITY(irq, priority) simNvicSetPriority((irq), (priority))
+#define NVIC_GET_PRIORITY(irq) simNvicGetPriority(irq)
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+namespace sim {
+// Drive an input from outside the board, as a jumper or another chip
+// would. A driven pin keeps its level through pinMode(INPUT_PULLUP), and
+// raises the interrupt attached to it.
+void drivePin(uint8_t pin, uint8_t level);
+} // namespace sim
+
+// Interrupt masking (the harness runs "ISRs" synchronously, so these only nest)
+void noInterrupts();
+void interrupts();
+
+// Pin interrupts. LOW and HIGH are level-triggered as on the Teensy: the
+// handler runs again as long as the pin stays at that level and the
+// interrupt is attached, including when it is attached to a pin already
+// there. A handler that returns without clearing the source would spin
+// forever on hardware; the simulation aborts after
+// SIM_LEVEL_INTERRUPT_PASSES passes instead.
+#define CHANGE 4
+#define RISING 3
+#define FALLING 2
+#define SIM_LEVEL_INTERRUPT_PASSES 1000
+void attachInterrupt(uint8_t pin, void (*function)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// USB serial - silent unless echo is enabled by the harness
+class SimSerial {
+public:
+    void begin(uint32_t baud);
+    explicit operator bool() const;
+
+    size_t print(const char* s);
+    size_t print(char c);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println();
+    size_t println(const char* s);
+    size_t println(char c);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+    size_t println(double n, int digits = 2);
+
+    size_t write(const uint8_t* buf, size_t len);
+
+    // Harness controls
+    void setEcho(bool enabled);
+    void setConnected(bool isConnected);    // A monitor has the port open
+    uint32_t bytesWritten() const;
+
+private:
+    bool echo = false;
+    bool connected = false;
+    uint32_t written = 0;
+};
+
+extern SimSerial Serial;
+
+#endif // SIM_ARDUINO_H
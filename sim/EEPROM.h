@@ -0,0 +1,55 @@
+/**
+ * @file EEPROM.h
+ * @brief EEPROM stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * The Teensy 4.1 emulated EEPROM as a byte array, erased (0xFF) at start.
+ * Only the calls the firmware uses; writes take no simulated time.
+ */
+
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define SIM_EEPROM_SIZE 4284
+
+class EEPROMClass {
+public:
+    EEPROMClass();
+
+    uint8_t read(int idx) const;
+    void write(int idx, uint8_t value);
+    void update(int idx, uint8_t value);     // Writes only a changed byte
+    uint16_t length() const { return SIM_EEPROM_SIZE; }
+
+    template <typename T> T& get(int idx, T& t) const {
+        uint8_t* bytes = (uint8_t*)&t;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            bytes[i] = read(idx + (int)i);
+        }
+        return t;
+    }
+
+    template <typename T> const T& put(int idx, const T& t) {
+        const uint8_t* bytes = (const uint8_t*)&t;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            update(idx + (int)i, bytes[i]);
+        }
+        return t;
+    }
+
+    // Harness controls
+    void erase();
+    uint32_t bytesWritten() const;
+
+private:
+    uint8_t cells[SIM_EEPROM_SIZE];
+    uint32_t written;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // SIM_EEPROM_H
@@ -0,0 +1,46 @@
+/**
+ * @file EventResponder.h
+ * @brief EventResponder stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Only the immediate form is modelled: triggerEvent() calls the attached
+ * function at once, as the Teensy core does from the DMA interrupt.
+ */
+
+#ifndef SIM_EVENT_RESPONDER_H
+#define SIM_EVENT_RESPONDER_H
+
+#include <stddef.h>
+
+class EventResponder {
+public:
+    typedef void (*EventResponderFunction)(EventResponder&);
+
+    void attachImmediate(EventResponderFunction function) { this->function = function; }
+    void detach() { function = nullptr; }
+
+    void triggerEvent(int status = 0, void* data = nullptr) {
+        this->status = status;
+        this->data = data;
+        if (function != nullptr) {
+            function(*this);
+        }
+    }
+    void clearEvent() {}
+
+    int getStatus() const { return status; }
+    void* getData() const { return data; }
+    void setContext(void* context) { this->context = context; }
+    void* getContext() const { return context; }
+
+private:
+    EventResponderFunction function = nullptr;
+    int status = 0;
+    void* data = nullptr;
+    void* context = nullptr;
+};
+
+typedef EventResponder& EventResponderRef;
+
+#endif // SIM_EVENT_RESPONDER_H
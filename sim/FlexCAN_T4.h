@@ -0,0 +1,202 @@
+/**
+ * @file FlexCAN_T4.h
+ * @brief In-process FlexCAN_T4 stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Mirrors the subset of the FlexCAN_T4 API the firmware uses. Frames are
+ * injected by the harness through FlexCANSimBus::deliver(), which applies
+ * the mailbox filters and runs the receive callback synchronously, the same
+ * way the real mailbox interrupt would.
+ */
+
+#ifndef SIM_FLEXCAN_T4_H
+#define SIM_FLEXCAN_T4_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct CAN_message_t {
+    uint32_t id = 0;
+    uint16_t timestamp = 0;
+    uint8_t idhit = 0;
+    struct {
+        bool extended = 0;
+        bool remote = 0;
+        bool overrun = 0;
+        bool reserved = 0;
+    } flags;
+    uint8_t len = 8;
+    uint8_t buf[8] = { 0 };
+    int8_t mb = 0;
+    uint8_t bus = 0;
+    bool seq = 0;
+} CAN_message_t;
+
+typedef struct CAN_error_t {
+    char state[30] = "Idle";
+    bool BIT1_ERR = 0;
+    bool BIT0_ERR = 0;
+    bool ACK_ERR = 0;
+    bool CRC_ERR = 0;
+    bool FRM_ERR = 0;
+    bool STF_ERR = 0;
+    bool RX_WRN = 0;
+    bool TX_WRN = 0;
+    char FLT_CONF[14] = "Error Active";
+    uint8_t RX_ERR_COUNTER = 0;
+    uint8_t TX_ERR_COUNTER = 0;
+    uint32_t ESR1 = 0;
+    uint16_t ECR = 0;
+} CAN_error_t;
+
+typedef void (*_MB_ptr)(const CAN_message_t& msg);
+
+// Error and status registers, read live as on the controller; b is the
+// CAN_DEV_TABLE base address
+#define FLEXCANb_ECR(b) (FlexCANSimBus::find((CAN_DEV_TABLE)(b))->readECR())
+#define FLEXCANb_ESR1(b) (FlexCANSimBus::find((CAN_DEV_TABLE)(b))->readESR1())
+
+typedef enum CAN_DEV_TABLE {
+    CAN1 = (uint32_t)0x401D0000,
+    CAN2 = (uint32_t)0x401D4000,
+    CAN3 = (uint32_t)0x401D8000
+} CAN_DEV_TABLE;
+
+typedef enum FLEXCAN_RXQUEUE_TABLE {
+    RX_SIZE_2 = 2, RX_SIZE_4 = 4, RX_SIZE_8 = 8, RX_SIZE_16 = 16,
+    RX_SIZE_32 = 32, RX_SIZE_64 = 64, RX_SIZE_128 = 128, RX_SIZE_256 = 256,
+    RX_SIZE_512 = 512, RX_SIZE_1024 = 1024
+} FLEXCAN_RXQUEUE_TABLE;
+
+typedef enum FLEXCAN_TXQUEUE_TABLE {
+    TX_SIZE_2 = 2, TX_SIZE_4 = 4, TX_SIZE_8 = 8, TX_SIZE_16 = 16,
+    TX_SIZE_32 = 32, TX_SIZE_64 = 64, TX_SIZE_128 = 128, TX_SIZE_256 = 256,
+    TX_SIZE_512 = 512, TX_SIZE_1024 = 1024
+} FLEXCAN_TXQUEUE_TABLE;
+
+typedef enum FLEXCAN_MAILBOX {
+    MB0 = 0, MB1, MB2, MB3, MB4, MB5, MB6, MB7, MB8, MB9, MB10, MB11, MB12,
+    MB13, MB14, MB15, MB16, MB17, MB18, MB19, MB20, MB21, MB22, MB23, MB24,
+    MB25, MB26, MB27, MB28, MB29, MB30, MB31, MB32, MB33, MB34, MB35, MB36,
+    MB37, MB38, MB39, MB40, MB41, MB42, MB43, MB44, MB45, MB46, MB47, MB48,
+    MB49, MB50, MB51, MB52, MB53, MB54, MB55, MB56, MB57, MB58, MB59, MB60,
+    MB61, MB62, MB63,
+    FIFO = 99
+} FLEXCAN_MAILBOX;
+
+typedef enum FLEXCAN_FLTEN {
+    ACCEPT_ALL = 0,
+    REJECT_ALL = 1
+} FLEXCAN_FLTEN;
+
+typedef enum FLEXCAN_RXTX {
+    TX,
+    RX,
+    LISTEN_ONLY
+} FLEXCAN_RXTX;
+
+typedef enum FLEXCAN_IDE {
+    NONE = 0,
+    EXT = 1,
+    RTR = 2,
+    STD = 3,
+    INACTIVE
+} FLEXCAN_IDE;
+
+#define SIM_FLEXCAN_MAX_MB 64
+#define SIM_FLEXCAN_BEGIN_US 20            // Clock gating, soft reset, freeze mode
+
+// Non-template state shared by every FlexCAN_T4 instantiation. Literal type
+// with constant initialisers, so globals are ready before any constructor.
+class FlexCANSimBus {
+public:
+    constexpr explicit FlexCANSimBus(CAN_DEV_TABLE bus) : busAddress(bus) {}
+
+    // FlexCAN_T4 API subset
+    void begin();
+    void reset();
+    void setBaudRate(uint32_t baud);
+    void setMaxMB(uint8_t last);
+    int setMB(FLEXCAN_MAILBOX mb, FLEXCAN_RXTX mode, FLEXCAN_IDE ide = STD);
+    void enableMBInterrupts(bool status = 1);
+    void enableMBInterrupt(FLEXCAN_MAILBOX mb, bool status = 1);
+    void onReceive(_MB_ptr handler);
+    void onReceive(FLEXCAN_MAILBOX mb, _MB_ptr handler);
+    void setMBFilter(FLEXCAN_FLTEN input);
+    void setMBFilter(FLEXCAN_MAILBOX mb, FLEXCAN_FLTEN input);
+    bool setMBFilter(FLEXCAN_MAILBOX mb, uint32_t id1);
+    bool setMBFilter(FLEXCAN_MAILBOX mb, uint32_t id1, uint32_t id2);
+    bool setMBFilterRange(FLEXCAN_MAILBOX mb, uint32_t id1, uint32_t id2);
+    bool setMBUserFilter(FLEXCAN_MAILBOX mb, uint32_t id1, uint32_t mask);
+    void mailboxStatus();
+    int write(const CAN_message_t& msg);
+    int write(FLEXCAN_MAILBOX mb, const CAN_message_t& msg);
+    int read(CAN_message_t& msg);
+    uint64_t events();
+    uint16_t getRXQueueCount();
+    uint16_t getTXQueueCount();
+    // As the library: the state the error interrupt queued since the last
+    // call, if any; false, and error untouched, when nothing was queued
+    bool error(CAN_error_t& error, bool printDetails);
+    uint32_t readECR() const;      // TXERRCNT in 7:0, RXERRCNT in 15:8
+    uint32_t readESR1() const;     // FLTCONF in 5:4
+
+    // Harness API
+    static FlexCANSimBus* find(CAN_DEV_TABLE bus);
+    bool deliver(const CAN_message_t& msg);
+    void setErrorCounters(uint8_t tec, uint8_t rec);
+    // A shorted or open bus: the controller goes bus-off, writes fail and
+    // nothing is received. The model never recovers by itself; it stays
+    // bus-off after the fault clears until reset() or begin().
+    void setBusFault(bool faulted);
+    bool isBusOff() const { return tec == 255; }
+    CAN_DEV_TABLE getBus() const { return busAddress; }
+    uint32_t getBaudRate() const { return baudRate; }
+    uint32_t getAcceptedCount() const { return accepted; }
+    uint32_t getRejectedCount() const { return rejected; }
+    uint32_t getWrittenCount() const { return written; }
+
+    // Called for every frame the firmware writes to any FlexCAN bus
+    static void (*txHook)(CAN_DEV_TABLE bus, const CAN_message_t& msg);
+
+private:
+    enum FilterKind : uint8_t { FILTER_ACCEPT_ALL, FILTER_REJECT, FILTER_LIST, FILTER_RANGE, FILTER_MASK };
+
+    struct Mailbox {
+        FilterKind kind = FILTER_ACCEPT_ALL;
+        bool isTx = false;
+        bool extended = false;
+        bool interruptEnabled = true;
+        uint32_t a = 0;
+        uint32_t b = 0;
+        _MB_ptr handler = nullptr;
+    };
+
+    CAN_DEV_TABLE busAddress;
+    bool started = false;
+    bool mbInterrupts = false;
+    uint8_t maxMB = 16;
+    uint32_t baudRate = 0;
+    _MB_ptr mainHandler = nullptr;
+    Mailbox mailboxes[SIM_FLEXCAN_MAX_MB] = {};
+    uint8_t tec = 0;
+    uint8_t rec = 0;
+    bool errorQueued = false;
+    bool busFault = false;
+    uint32_t accepted = 0;
+    uint32_t rejected = 0;
+    uint32_t written = 0;
+
+    void resetMailboxes();
+    bool matches(const Mailbox& box, const CAN_message_t& msg) const;
+};
+
+template <CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize = RX_SIZE_16,
+          FLEXCAN_TXQUEUE_TABLE _txSize = TX_SIZE_16>
+class FlexCAN_T4 : public FlexCANSimBus {
+public:
+    constexpr FlexCAN_T4() : FlexCANSimBus(_bus) {}
+};
+
+#endif // SIM_FLEXCAN_T4_H
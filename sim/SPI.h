@@ -0,0 +1,79 @@
+/**
+ * @file SPI.h
+ * @brief SPI stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * Transfers go to an attached device model, if any, one chip-select frame
+ * per buffer transfer. The harness keeps a CPU-time model of the traffic:
+ * blocking transfers cost their clock time plus a fixed per-frame
+ * overhead, DMA transfers only the overhead of starting them.
+ */
+
+#ifndef SIM_SPI_H
+#define SIM_SPI_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "EventResponder.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0x00
+
+// CPU-time model (nanoseconds)
+#define SIM_SPI_FRAME_OVERHEAD_NS 400      // Chip select, LPSPI setup, call overhead
+#define SIM_SPI_DMA_START_NS 1200          // DMA channel setup plus completion interrupt
+
+class SPISettings {
+public:
+    SPISettings() {}
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+        : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+
+    uint32_t clock = 4000000;
+    uint8_t bitOrder = MSBFIRST;
+    uint8_t dataMode = SPI_MODE0;
+};
+
+class SPIClass {
+public:
+    void begin();
+    void end();
+    void beginTransaction(const SPISettings& settings);
+    void endTransaction();
+    void usingInterrupt(uint8_t interruptNumber);
+
+    uint8_t transfer(uint8_t data);
+    void transfer(const void* txBuffer, void* rxBuffer, size_t count);
+    // DMA transfer; the event is triggered once the last byte is clocked
+    bool transfer(const void* txBuffer, void* rxBuffer, size_t count, EventResponderRef event);
+
+    // Harness: device model behind the chip select. Transfers with a null
+    // transmit buffer are only counted.
+    typedef void (*DeviceExchange)(void* context, const uint8_t* tx, uint8_t* rx, size_t count);
+    void attachDevice(DeviceExchange exchange, void* context);
+
+    // Harness statistics
+    uint32_t bytesTransferred() const;
+    uint32_t transactionCount() const;
+    uint32_t chipSelectCount() const;      // Buffer transfers
+    uint32_t dmaBytesTransferred() const;
+    uint64_t cpuNanos() const;             // Modelled CPU time spent on SPI
+    void resetStatistics();
+
+private:
+    uint32_t clock = 4000000;
+    uint32_t bytes = 0;
+    uint32_t transactions = 0;
+    uint32_t chipSelects = 0;
+    uint32_t dmaBytes = 0;
+    uint64_t cpu = 0;
+    DeviceExchange device = nullptr;
+    void* deviceContext = nullptr;
+
+    void exchange(const void* txBuffer, void* rxBuffer, size_t count);
+};
+
+extern SPIClass SPI;
+
+#endif // SIM_SPI_H
@@ -0,0 +1,786 @@
+/**
+ * @file acan2517fd_sim.cpp
+ * @brief In-process ACAN2517FD stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "ACAN2517FD.h"
+#include "Arduino.h"
+#include "sim_clock.h"
+#include <string.h>
+
+static ACAN2517FD* lastController = nullptr;
+
+void (*ACAN2517FD::txHook)(const CANFDMessage& msg, uint64_t enqueueMicros) = nullptr;
+void (*ACAN2517FD::wireHook)(const CANFDMessage& msg, uint64_t enqueueMicros, uint64_t startMicros,
+                             uint64_t doneMicros) = nullptr;
+
+// --- CANFDMessage ---
+
+static const uint8_t FD_LENGTHS[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+void CANFDMessage::pad() {
+    for (uint8_t i = 0; i < sizeof(FD_LENGTHS); i++) {
+        if (FD_LENGTHS[i] >= len) {
+            memset(&data[len], 0, FD_LENGTHS[i] - len);
+            len = FD_LENGTHS[i];
+            return;
+        }
+    }
+}
+
+static uint8_t lengthOfDlc(uint8_t dlc, bool fd) {
+    if (!fd && dlc > 8) {
+        return 8;
+    }
+    return FD_LENGTHS[dlc & 0x0F];
+}
+
+static uint8_t dlcOfLength(uint8_t len) {
+    for (uint8_t i = 0; i < sizeof(FD_LENGTHS); i++) {
+        if (FD_LENGTHS[i] >= len) {
+            return i;
+        }
+    }
+    return 15;
+}
+
+bool CANFDMessage::isValid() const {
+    if (type == CAN_REMOTE || type == CAN_DATA) {
+        return len <= 8;
+    }
+    for (uint8_t i = 0; i < sizeof(FD_LENGTHS); i++) {
+        if (FD_LENGTHS[i] == len) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// --- ACAN2517FDSettings ---
+
+ACAN2517FDSettings::ACAN2517FDSettings(const Oscillator inOscillator,
+                                       const uint32_t inDesiredArbitrationBitRate,
+                                       const DataBitRateFactor inDataBitRateFactor,
+                                       const uint32_t inTolerancePPM)
+    : mOscillator(inOscillator),
+      mDesiredArbitrationBitRate(inDesiredArbitrationBitRate),
+      mDataBitRateFactor(inDataBitRateFactor) {
+    (void)inTolerancePPM;
+}
+
+uint32_t ACAN2517FDSettings::objectSizeForPayload(const PayloadSize inPayload) {
+    static const uint8_t PAYLOAD_BYTES[] = { 8, 12, 16, 20, 24, 32, 48, 64 };
+    return 8 + PAYLOAD_BYTES[inPayload & 7];
+}
+
+uint32_t ACAN2517FDSettings::ramUsage() const {
+    uint32_t usage = (uint32_t)mControllerTransmitFIFOSize * objectSizeForPayload(mControllerTransmitFIFOPayload) +
+                     (uint32_t)mControllerReceiveFIFOSize * objectSizeForPayload(mControllerReceiveFIFOPayload);
+    usage += (uint32_t)mControllerTXQSize * objectSizeForPayload(mControllerTXQBufferPayload);
+    return usage;
+}
+
+// --- ACAN2517FDFilters ---
+
+void ACAN2517FDFilters::append(const Format inFormat, const uint32_t inMask, const uint32_t inAcceptance,
+                               const ACANFDCallBackRoutine inCallBackRoutine) {
+    if (count < kMaxFilters) {
+        filters[count].format = inFormat;
+        filters[count].mask = inMask;
+        filters[count].acceptance = inAcceptance & inMask;
+        filters[count].callBack = inCallBackRoutine;
+        count++;
+    }
+}
+
+void ACAN2517FDFilters::appendPassAllFilter(const ACANFDCallBackRoutine inCallBackRoutine) {
+    append(kAny, 0, 0, inCallBackRoutine);
+}
+
+void ACAN2517FDFilters::appendFormatFilter(const Format inFormat, const ACANFDCallBackRoutine inCallBackRoutine) {
+    append(inFormat, 0, 0, inCallBackRoutine);
+}
+
+void ACAN2517FDFilters::appendFrameFilter(const Format inFormat, const uint32_t inIdentifier,
+                                          const ACANFDCallBackRoutine inCallBackRoutine) {
+    append(inFormat, inFormat == kExtended ? 0x1FFFFFFF : 0x7FF, inIdentifier, inCallBackRoutine);
+}
+
+void ACAN2517FDFilters::appendFilter(const Format inFormat, const uint32_t inMask, const uint32_t inAcceptance,
+                                     const ACANFDCallBackRoutine inCallBackRoutine) {
+    append(inFormat, inMask, inAcceptance, inCallBackRoutine);
+}
+
+bool ACAN2517FDFilters::matches(const CANFDMessage& msg, uint8_t& filterIndex) const {
+    for (uint8_t i = 0; i < count; i++) {
+        const Filter& f = filters[i];
+        if ((f.format == kStandard && msg.ext) || (f.format == kExtended && !msg.ext)) {
+            continue;
+        }
+        if ((msg.id & f.mask) == f.acceptance) {
+            filterIndex = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+ACANFDCallBackRoutine ACAN2517FDFilters::callBack(uint8_t index) const {
+    return index < count ? filters[index].callBack : nullptr;
+}
+
+// --- ACAN2517FD ---
+
+ACAN2517FD::ACAN2517FD(const uint8_t inCS, SPIClass& inSPI, const uint8_t inINT) : spi(inSPI), intPin(inINT) {
+    (void)inCS;
+    lastController = this;
+    spi.attachDevice(spiExchange, this);
+    updateInterruptLine();
+}
+
+// INT is open-drain, active low, and asserted while the receive FIFO is
+// not empty and its interrupt is enabled; the library attaches it LOW
+void ACAN2517FD::updateInterruptLine() {
+    if (intPin != 255) {
+        sim::drivePin(intPin, (started && rxInterruptEnabled && controllerRxCount > 0) ? LOW : HIGH);
+    }
+}
+
+ACAN2517FD* ACAN2517FD::instance() {
+    return lastController;
+}
+
+static uint8_t clampFifoDepth(uint8_t depth) {
+    return depth < 1 ? 1 : (depth > SIM_ACAN_FIFO_CAPACITY ? SIM_ACAN_FIFO_CAPACITY : depth);
+}
+
+uint32_t ACAN2517FD::begin(const ACAN2517FDSettings& inSettings, void (*inInterruptServiceRoutine)(void)) {
+    if (inSettings.ramUsage() > SIM_ACAN_RAM_SIZE) {
+        return kControllerRamUsageGreaterThan2048;
+    }
+
+    // Oscillator start-up, then configuration
+    if (sim::nowMicros() < SIM_ACAN_OSC_READY_US) {
+        sim::advanceTo(SIM_ACAN_OSC_READY_US);
+    }
+    sim::advanceMicros(SIM_ACAN_CONFIGURE_US);
+
+    interruptRoutine = inInterruptServiceRoutine;
+    arbitrationBitRate = inSettings.mDesiredArbitrationBitRate;
+    dataBitRate = inSettings.mDesiredArbitrationBitRate * (uint32_t)inSettings.mDataBitRateFactor;
+    txCapacity = inSettings.mDriverTransmitFIFOSize + inSettings.mControllerTransmitFIFOSize;
+    if (txCapacity > SIM_ACAN_TX_CAPACITY) {
+        txCapacity = SIM_ACAN_TX_CAPACITY;
+    }
+    txqCapacity = inSettings.mControllerTXQSize;
+    if (txqCapacity > SIM_ACAN_TX_CAPACITY) {
+        txqCapacity = SIM_ACAN_TX_CAPACITY;
+    }
+    driverRxCapacity = inSettings.mDriverReceiveFIFOSize;
+    if (driverRxCapacity > SIM_ACAN_RX_CAPACITY) {
+        driverRxCapacity = SIM_ACAN_RX_CAPACITY;
+    }
+    mode = inSettings.mRequestedMode;
+
+    // SPI at the highest clock the datasheet allows, 0.85 x SYSCLK / 2
+    static const uint32_t SYSCLK_MHZ[] = { 4, 2, 40, 20, 20, 10, 40, 20 };
+    spiSettings = SPISettings(SYSCLK_MHZ[inSettings.mOscillator] * 1000000u * 17 / 40, MSBFIRST, SPI_MODE0);
+
+    // Message RAM in the controller's order: TXQ, then FIFO1, FIFO2
+    txqPayload = (uint8_t)inSettings.mControllerTXQBufferPayload;
+    rxFifoPayload = (uint8_t)inSettings.mControllerReceiveFIFOPayload;
+    txFifoPayload = (uint8_t)inSettings.mControllerTransmitFIFOPayload;
+    rxFifoDepth = clampFifoDepth(inSettings.mControllerReceiveFIFOSize);
+    txFifoDepth = clampFifoDepth(inSettings.mControllerTransmitFIFOSize);
+    txqBase = 0;
+    rxFifoBase = (uint16_t)(txqCapacity * ACAN2517FDSettings::objectSizeForPayload(inSettings.mControllerTXQBufferPayload));
+    txFifoBase = (uint16_t)(rxFifoBase + rxFifoDepth * ACAN2517FDSettings::objectSizeForPayload(inSettings.mControllerReceiveFIFOPayload));
+    memset(ram, 0, sizeof(ram));
+
+    txHead = 0;
+    txCount = 0;
+    txqHead = 0;
+    txqCount = 0;
+    txFifoHead = 0;
+    rxHead = 0;
+    rxCount = 0;
+    controllerRxTail = 0;
+    controllerRxCount = 0;
+    rxOverflowFlag = false;
+    wireFreeAt = sim::nowMicros();
+    tec = busFault ? 255 : 0;
+    rec = 0;
+    busOffRecoveryAt = UINT64_MAX;
+    rxInterruptEnabled = true;
+    started = true;
+    updateInterruptLine();
+    if (intPin != 255 && interruptRoutine != nullptr) {
+        attachInterrupt(digitalPinToInterrupt(intPin), interruptRoutine, LOW);
+    }
+    return 0;
+}
+
+uint32_t ACAN2517FD::begin(const ACAN2517FDSettings& inSettings, void (*inInterruptServiceRoutine)(void),
+                           const ACAN2517FDFilters& inFilters) {
+    filters = inFilters;
+    hasFilters = true;
+    return begin(inSettings, inInterruptServiceRoutine);
+}
+
+void ACAN2517FD::end() {
+    if (intPin != 255) {
+        detachInterrupt(digitalPinToInterrupt(intPin));
+    }
+    started = false;
+    updateInterruptLine();
+}
+
+uint64_t ACAN2517FD::frameWireMicros(const CANFDMessage& msg) const {
+    // Worst-case bit stuffing, standard or extended identifier
+    const uint32_t idBits = msg.ext ? 29 + 2 : 11;
+    if (msg.type == CANFDMessage::CAN_DATA || msg.type == CANFDMessage::CAN_REMOTE) {
+        const uint32_t payload = (msg.type == CANFDMessage::CAN_REMOTE) ? 0 : 8u * msg.len;
+        const uint32_t stuffable = 23 + idBits + payload;
+        const uint32_t bits = stuffable + stuffable / 4 + 13;
+        return ((uint64_t)bits * 1000000 + arbitrationBitRate - 1) / arbitrationBitRate;
+    }
+
+    // CAN FD: arbitration + ACK/EOF at nominal rate, control/data/CRC at the data rate
+    const uint32_t nominalBits = 1 + idBits + 5 + 12;
+    const uint32_t crcBits = msg.len > 16 ? 21 : 17;
+    const uint32_t dataBits = 1 + 4 + 8u * msg.len + 4 + crcBits + 1;
+    const uint32_t fastRate = (msg.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) ? dataBitRate : arbitrationBitRate;
+    const uint64_t nominalNs = (uint64_t)(nominalBits + nominalBits / 5) * 1000000000ull / arbitrationBitRate;
+    const uint64_t dataNs = (uint64_t)(dataBits + dataBits / 5) * 1000000000ull / fastRate;
+    return (nominalNs + dataNs + 999) / 1000;
+}
+
+bool ACAN2517FD::isBusOff() {
+    // Automatic recovery, checked whenever the firmware looks
+    if (tec == 255 && !busFault && sim::nowMicros() >= busOffRecoveryAt) {
+        tec = 0;
+        rec = 0;
+        busOffRecoveryAt = UINT64_MAX;
+        setOperationMode(mode);
+    }
+    return tec == 255;
+}
+
+void ACAN2517FD::retireTransmitted() {
+    isBusOff();
+    const uint64_t now = sim::nowMicros();
+    while (txCount > 0 && txDone[txHead] <= now) {
+        if (wireHook != nullptr) {
+            wireHook(txMessage[txHead], txEnqueued[txHead], txStart[txHead], txDone[txHead]);
+        }
+        txHead = (uint16_t)((txHead + 1) % SIM_ACAN_TX_CAPACITY);
+        txCount--;
+    }
+    while (txqCount > 0 && txqDone[txqHead] <= now) {
+        if (wireHook != nullptr) {
+            const CANFDMessage& msg = txqMessage[txqHead];
+            wireHook(msg, txqEnqueued[txqHead], txqDone[txqHead] - frameWireMicros(msg), txqDone[txqHead]);
+        }
+        txqHead = (uint16_t)((txqHead + 1) % SIM_ACAN_TX_CAPACITY);
+        txqCount--;
+    }
+}
+
+bool ACAN2517FD::sendViaTXQ(const CANFDMessage& inMessage, bool onBus, uint64_t now) {
+    if (txqCount >= txqCapacity) {
+        rejected++;
+        return false;
+    }
+
+    const uint64_t wire = frameWireMicros(inMessage);
+    uint64_t done = UINT64_MAX;
+    if (onBus) {
+        // Waits only for earlier TXQ frames, or the FIFO frame already on the wire
+        uint64_t busyUntil = now;
+        if (txqCount > 0) {
+            const uint64_t last = txqDone[(txqHead + txqCount - 1) % SIM_ACAN_TX_CAPACITY];
+            busyUntil = last > busyUntil ? last : busyUntil;
+        } else if (txCount > 0 && txStart[txHead] <= now) {
+            busyUntil = txDone[txHead] > busyUntil ? txDone[txHead] : busyUntil;
+        }
+        done = busyUntil + wire;
+
+        // FIFO frames not yet started move back by this frame
+        for (uint16_t i = 0; i < txCount; i++) {
+            const uint16_t slot = (uint16_t)((txHead + i) % SIM_ACAN_TX_CAPACITY);
+            if (txStart[slot] >= busyUntil) {
+                txStart[slot] += wire;
+                txDone[slot] += wire;
+            }
+        }
+        wireFreeAt = wireFreeAt > busyUntil ? wireFreeAt + wire : done;
+    }
+
+    const uint16_t slot = (uint16_t)((txqHead + txqCount) % SIM_ACAN_TX_CAPACITY);
+    txqDone[slot] = done;
+    txqEnqueued[slot] = now;
+    txqMessage[slot] = inMessage;
+    txqCount++;
+    lastDone = done;
+    return true;
+}
+
+void ACAN2517FD::chargeLibraryTransfer(uint16_t ramBytes) {
+    // The library's register sequence for one message: a status or
+    // interrupt register, the FIFO user address, the object, then UINC
+    spi.beginTransaction(spiSettings);
+    spi.transfer(nullptr, nullptr, 2 + 4);
+    spi.transfer(nullptr, nullptr, 2 + 4);
+    spi.transfer(nullptr, nullptr, 2 + ramBytes);
+    spi.transfer(nullptr, nullptr, 2 + 1);
+    spi.endTransaction();
+}
+
+static uint16_t objectRamBytes(const CANFDMessage& msg) {
+    return (uint16_t)(8 + ((msg.len + 3) & ~3));
+}
+
+bool ACAN2517FD::enqueueTransmit(const CANFDMessage& inMessage) {
+    retireTransmitted();
+    const uint64_t now = sim::nowMicros();
+    const bool onBus = (mode == ACAN2517FDSettings::NormalFD || mode == ACAN2517FDSettings::Normal20B ||
+                        mode == ACAN2517FDSettings::InternalLoopBack ||
+                        mode == ACAN2517FDSettings::ExternalLoopBack) && tec != 255;
+    if (inMessage.idx == 255) {
+        if (!sendViaTXQ(inMessage, onBus, now)) {
+            return false;
+        }
+    } else {
+        if (txCount >= txCapacity) {
+            rejected++;
+            return false;
+        }
+
+        // Frames queued while off the bus wait until the controller is back
+        const uint64_t start = wireFreeAt > now ? wireFreeAt : now;
+        const uint64_t done = onBus ? start + frameWireMicros(inMessage) : UINT64_MAX;
+        if (onBus) {
+            wireFreeAt = done;
+        }
+
+        const uint16_t slot = (uint16_t)((txHead + txCount) % SIM_ACAN_TX_CAPACITY);
+        txStart[slot] = start;
+        txDone[slot] = done;
+        txEnqueued[slot] = now;
+        txMessage[slot] = inMessage;
+        txCount++;
+        if (txCount > txPeak) {
+            txPeak = txCount;
+        }
+        txFifoHead = (uint8_t)((txFifoHead + 1) % txFifoDepth);
+        lastDone = done;
+    }
+    sent++;
+
+    if (txHook != nullptr) {
+        txHook(inMessage, now);
+    }
+    return true;
+}
+
+bool ACAN2517FD::tryToSend(const CANFDMessage& inMessage) {
+    const uint8_t payload = (uint8_t)(ACAN2517FDSettings::objectSizeForPayload(
+        (ACAN2517FDSettings::PayloadSize)(inMessage.idx == 255 ? txqPayload : txFifoPayload)) - 8);
+    if (!started || !inMessage.isValid() || inMessage.len > payload) {
+        rejected++;
+        return false;
+    }
+    if (!enqueueTransmit(inMessage)) {
+        return false;
+    }
+    chargeLibraryTransfer(objectRamBytes(inMessage));
+    return true;
+}
+
+uint16_t ACAN2517FD::pendingTransmitCount() {
+    retireTransmitted();
+    return txCount + txqCount;
+}
+
+// --- Message objects (DS20005688, Figure 4-2) ---
+
+#define SIM_OBJ_IDE (1u << 4)
+#define SIM_OBJ_RTR (1u << 5)
+#define SIM_OBJ_BRS (1u << 6)
+#define SIM_OBJ_FDF (1u << 7)
+
+static void putWord(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t getWord(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void encodeObject(const CANFDMessage& msg, uint8_t filterHit, uint8_t* object) {
+    const uint32_t id = msg.ext ? (((msg.id >> 18) & 0x7FF) | ((msg.id & 0x3FFFF) << 11)) : (msg.id & 0x7FF);
+    uint32_t flags = dlcOfLength(msg.len) | ((uint32_t)filterHit << 11);
+    if (msg.ext) flags |= SIM_OBJ_IDE;
+    if (msg.type == CANFDMessage::CAN_REMOTE) flags |= SIM_OBJ_RTR;
+    if (msg.type == CANFDMessage::CANFD_NO_BIT_RATE_SWITCH) flags |= SIM_OBJ_FDF;
+    if (msg.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) flags |= SIM_OBJ_FDF | SIM_OBJ_BRS;
+    putWord(object, id);
+    putWord(object + 4, flags);
+    memcpy(object + 8, msg.data, msg.len);
+}
+
+static void decodeObject(const uint8_t* object, CANFDMessage& msg) {
+    const uint32_t id = getWord(object);
+    const uint32_t flags = getWord(object + 4);
+    msg.ext = (flags & SIM_OBJ_IDE) != 0;
+    msg.id = msg.ext ? (((id & 0x7FF) << 18) | ((id >> 11) & 0x3FFFF)) : (id & 0x7FF);
+    if (flags & SIM_OBJ_FDF) {
+        msg.type = (flags & SIM_OBJ_BRS) ? CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH : CANFDMessage::CANFD_NO_BIT_RATE_SWITCH;
+    } else {
+        msg.type = (flags & SIM_OBJ_RTR) ? CANFDMessage::CAN_REMOTE : CANFDMessage::CAN_DATA;
+    }
+    msg.len = lengthOfDlc((uint8_t)(flags & 0x0F), (flags & SIM_OBJ_FDF) != 0);
+    msg.idx = 0;
+    memcpy(msg.data, object + 8, msg.len);
+}
+
+bool ACAN2517FD::injectReceive(const CANFDMessage& msg) {
+    if (!started || isBusOff()) {
+        return false;
+    }
+
+    CANFDMessage copy = msg;
+    if (hasFilters) {
+        uint8_t index = 0;
+        if (!filters.matches(msg, index)) {
+            return false;
+        }
+        copy.idx = index;
+    }
+
+    const uint32_t objectSize = ACAN2517FDSettings::objectSizeForPayload((ACAN2517FDSettings::PayloadSize)rxFifoPayload);
+    if (copy.len > objectSize - 8) {
+        return false;
+    }
+    if (controllerRxCount >= rxFifoDepth) {
+        rxOverflowFlag = true;
+        rxOverflows++;
+        return false;
+    }
+
+    const uint8_t slot = (uint8_t)((controllerRxTail + controllerRxCount) % rxFifoDepth);
+    controllerRx[slot] = copy;
+    encodeObject(copy, copy.idx, &ram[rxFifoBase + slot * objectSize]);
+    controllerRxCount++;
+    updateInterruptLine();
+    return true;
+}
+
+bool ACAN2517FD::available() {
+    return rxCount > 0;
+}
+
+bool ACAN2517FD::receive(CANFDMessage& outMessage) {
+    if (rxCount == 0) {
+        return false;
+    }
+    outMessage = rxFifo[rxHead];
+    rxHead = (uint16_t)((rxHead + 1) % SIM_ACAN_RX_CAPACITY);
+    rxCount--;
+
+    // As the library: a full driver buffer had the receive interrupt
+    // disabled, the first message taken out enables it again
+    if (!rxInterruptEnabled) {
+        rxInterruptEnabled = true;
+        updateInterruptLine();
+    }
+    return true;
+}
+
+bool ACAN2517FD::dispatchReceivedMessage(const ACANFDCallBackRoutine inFilterMatchCallBack) {
+    CANFDMessage message;
+    if (!receive(message)) {
+        return false;
+    }
+    const ACANFDCallBackRoutine callBack = filters.callBack(message.idx);
+    if (inFilterMatchCallBack != nullptr) {
+        inFilterMatchCallBack(message);
+    }
+    if (callBack != nullptr) {
+        callBack(message);
+    }
+    return true;
+}
+
+void ACAN2517FD::isr() {
+    isr_core();
+}
+
+bool ACAN2517FD::isr_core() {
+    retireTransmitted();
+
+    // Controller receive FIFO into the driver buffer, one message at a time
+    bool handled = false;
+    while (controllerRxCount > 0 && rxCount < driverRxCapacity) {
+        const CANFDMessage& msg = controllerRx[controllerRxTail];
+        rxFifo[(rxHead + rxCount) % SIM_ACAN_RX_CAPACITY] = msg;
+        rxCount++;
+        if (rxCount > rxPeak) {
+            rxPeak = rxCount;
+        }
+        chargeLibraryTransfer(objectRamBytes(msg));
+        controllerRxTail = (uint8_t)((controllerRxTail + 1) % rxFifoDepth);
+        controllerRxCount--;
+        handled = true;
+    }
+    if (controllerRxCount > 0 && rxCount >= driverRxCapacity) {
+        rxInterruptEnabled = false;
+    }
+    updateInterruptLine();
+
+    // The final interrupt register read that finds nothing left
+    spi.beginTransaction(spiSettings);
+    spi.transfer(nullptr, nullptr, 2 + 4);
+    spi.endTransaction();
+    return handled;
+}
+
+// --- SPI device: FIFO registers and message RAM ---
+
+#define SIM_SPI_READ 0x3
+#define SIM_SPI_WRITE 0x2
+#define SIM_REG_C1CON 0x000
+#define SIM_REG_FIFO_BASE 0x050            // C1TXQCON, then 12 bytes per FIFO
+#define SIM_RAM_START 0x400
+
+void ACAN2517FD::spiExchange(void* context, const uint8_t* tx, uint8_t* rx, size_t count) {
+    ACAN2517FD* self = (ACAN2517FD*)context;
+    if (count < 2) {
+        return;
+    }
+    const uint8_t command = tx[0] >> 4;
+    const uint16_t address = (uint16_t)(((tx[0] & 0x0F) << 8) | tx[1]);
+    if (rx != nullptr) {
+        rx[0] = 0;
+        rx[1] = 0;
+    }
+    for (size_t i = 2; i < count; i++) {
+        const uint16_t at = (uint16_t)(address + i - 2);
+        if (command == SIM_SPI_READ) {
+            const uint8_t value = self->readByte(at);
+            if (rx != nullptr) {
+                rx[i] = value;
+            }
+        } else if (command == SIM_SPI_WRITE) {
+            self->writeByte(at, tx[i]);
+        }
+    }
+}
+
+uint32_t ACAN2517FD::readRegister(uint16_t address) {
+    if (address == SIM_REG_C1CON) {
+        return (txqCapacity > 0 ? (1u << 20) : 0) | ((uint32_t)mode << 21);
+    }
+    if (address < SIM_REG_FIFO_BASE || address >= SIM_REG_FIFO_BASE + 12 * 4) {
+        return 0;
+    }
+
+    retireTransmitted();
+    const uint8_t fifo = (uint8_t)((address - SIM_REG_FIFO_BASE) / 12);
+    const uint8_t reg = (uint8_t)((address - SIM_REG_FIFO_BASE) % 12);
+    if (fifo == 0) {
+        // TXQ: configuration and occupancy only
+        const uint32_t con = (1u << 7) | ((uint32_t)(txqCapacity > 0 ? txqCapacity - 1 : 0) << 24) |
+                             ((uint32_t)txqPayload << 29);
+        const uint32_t sta = (txqCount < txqCapacity ? 1u : 0) | (txqCount == 0 ? 4u : 0);
+        return reg == 0 ? con : (reg == 4 ? sta : txqBase);
+    }
+    if (fifo == SIM_ACAN_RECEIVE_FIFO) {
+        const uint32_t objectSize = ACAN2517FDSettings::objectSizeForPayload((ACAN2517FDSettings::PayloadSize)rxFifoPayload);
+        const uint8_t head = (uint8_t)((controllerRxTail + controllerRxCount) % rxFifoDepth);
+        const uint32_t con = 1u | ((uint32_t)(rxFifoDepth - 1) << 24) | ((uint32_t)rxFifoPayload << 29);
+        const uint32_t sta = (controllerRxCount > 0 ? 1u : 0) | (controllerRxCount * 2 >= rxFifoDepth ? 2u : 0) |
+                             (controllerRxCount == rxFifoDepth ? 4u : 0) | (rxOverflowFlag ? 8u : 0) |
+                             ((uint32_t)head << 8);
+        return reg == 0 ? con : (reg == 4 ? sta : rxFifoBase + controllerRxTail * objectSize);
+    }
+    if (fifo == SIM_ACAN_TRANSMIT_FIFO) {
+        const uint32_t objectSize = ACAN2517FDSettings::objectSizeForPayload((ACAN2517FDSettings::PayloadSize)txFifoPayload);
+        const uint8_t pending = (uint8_t)(txCount < txFifoDepth ? txCount : txFifoDepth);
+        const uint8_t next = (uint8_t)((txFifoHead + txFifoDepth - pending) % txFifoDepth);
+        const uint32_t con = (1u << 7) | ((uint32_t)(txFifoDepth - 1) << 24) | ((uint32_t)txFifoPayload << 29);
+        const uint32_t sta = (pending < txFifoDepth ? 1u : 0) | (pending * 2 <= txFifoDepth ? 2u : 0) |
+                             (pending == 0 ? 4u : 0) | ((uint32_t)next << 8);
+        return reg == 0 ? con : (reg == 4 ? sta : txFifoBase + txFifoHead * objectSize);
+    }
+    return 0;   // Unused FIFO, reset value
+}
+
+uint8_t ACAN2517FD::readByte(uint16_t address) {
+    if (address >= SIM_RAM_START && address < SIM_RAM_START + SIM_ACAN_RAM_SIZE) {
+        return ram[address - SIM_RAM_START];
+    }
+    return (uint8_t)(readRegister((uint16_t)(address & ~3)) >> (8 * (address & 3)));
+}
+
+void ACAN2517FD::writeByte(uint16_t address, uint8_t value) {
+    if (address >= SIM_RAM_START && address < SIM_RAM_START + SIM_ACAN_RAM_SIZE) {
+        ram[address - SIM_RAM_START] = value;
+        return;
+    }
+
+    // FIFOCON byte 1: UINC (bit 8), TXREQ (bit 9), FRESET (bit 10)
+    const uint16_t rxCon = SIM_REG_FIFO_BASE + 12 * SIM_ACAN_RECEIVE_FIFO;
+    const uint16_t txCon = SIM_REG_FIFO_BASE + 12 * SIM_ACAN_TRANSMIT_FIFO;
+    if (address == rxCon + 1 && (value & 0x01) && controllerRxCount > 0) {
+        controllerRxTail = (uint8_t)((controllerRxTail + 1) % rxFifoDepth);
+        controllerRxCount--;
+        updateInterruptLine();
+    } else if (address == txCon + 1 && (value & 0x04)) {
+        resetTransmitFifo();
+    } else if (address == txCon + 1 && (value & 0x01)) {
+        commitTransmitObject();
+    } else if (address == rxCon + 4 && !(value & 0x08)) {
+        rxOverflowFlag = false;
+    }
+}
+
+void ACAN2517FD::commitTransmitObject() {
+    const uint32_t objectSize = ACAN2517FDSettings::objectSizeForPayload((ACAN2517FDSettings::PayloadSize)txFifoPayload);
+    CANFDMessage msg;
+    decodeObject(&ram[txFifoBase + txFifoHead * objectSize], msg);
+    if (!started || !msg.isValid()) {
+        rejected++;
+        return;
+    }
+    enqueueTransmit(msg);
+}
+
+void ACAN2517FD::resetTransmitFifo() {
+    // The frame on the wire completes; everything behind it is dropped
+    retireTransmitted();
+    const uint64_t now = sim::nowMicros();
+    uint8_t dropped = 0;
+    while (txCount > 0) {
+        const uint16_t last = (uint16_t)((txHead + txCount - 1) % SIM_ACAN_TX_CAPACITY);
+        if (txStart[last] <= now && txDone[last] != UINT64_MAX) {
+            break;
+        }
+        txCount--;
+        dropped++;
+    }
+    aborted += dropped;
+    txFifoHead = (uint8_t)((txFifoHead + txFifoDepth - dropped % txFifoDepth) % txFifoDepth);
+
+    // The wire is free once the frame in progress and the TXQ are done
+    uint64_t freeAt = now;
+    const uint64_t fifoDone = txCount > 0 ? txDone[(txHead + txCount - 1) % SIM_ACAN_TX_CAPACITY] : 0;
+    const uint64_t txqLast = txqCount > 0 ? txqDone[(txqHead + txqCount - 1) % SIM_ACAN_TX_CAPACITY] : 0;
+    if (fifoDone != UINT64_MAX && fifoDone > freeAt) {
+        freeAt = fifoDone;
+    }
+    if (txqLast != UINT64_MAX && txqLast > freeAt) {
+        freeAt = txqLast;
+    }
+    wireFreeAt = freeAt < wireFreeAt ? freeAt : wireFreeAt;
+}
+
+void ACAN2517FD::poll() {
+    isr_core();
+}
+
+void ACAN2517FD::setErrorCounters(uint8_t txErrors, uint8_t rxErrors) {
+    tec = txErrors;
+    rec = rxErrors;
+}
+
+uint32_t ACAN2517FD::errorCounters() {
+    isBusOff();
+    // Same layout as the C1TREC register
+    uint32_t value = (uint32_t)rec | ((uint32_t)tec << 8);
+    if (tec >= 96 || rec >= 96) value |= 1u << 16;  // EWARN
+    if (rec >= 96) value |= 1u << 17;               // RXWARN
+    if (tec >= 96) value |= 1u << 18;               // TXWARN
+    if (rec >= 128) value |= 1u << 19;              // RXBP
+    if (tec >= 128) value |= 1u << 20;              // TXBP
+    if (tec == 255) value |= 1u << 21;              // TXBO
+    return value;
+}
+
+ACAN2517FDSettings::OperationMode ACAN2517FD::currentOperationMode() {
+    return mode;
+}
+
+void ACAN2517FD::setOperationMode(ACAN2517FDSettings::OperationMode newMode) {
+    mode = newMode;
+    if (mode == ACAN2517FDSettings::NormalFD || mode == ACAN2517FDSettings::Normal20B) {
+        // Anything held while off the bus starts draining now
+        wireFreeAt = sim::nowMicros();
+        for (uint16_t i = 0; i < txqCount; i++) {
+            wireFreeAt += 135;
+            txqDone[(txqHead + i) % SIM_ACAN_TX_CAPACITY] = wireFreeAt;
+        }
+        for (uint16_t i = 0; i < txCount; i++) {
+            const uint16_t slot = (uint16_t)((txHead + i) % SIM_ACAN_TX_CAPACITY);
+            txStart[slot] = wireFreeAt;
+            wireFreeAt += 135;
+            txDone[slot] = wireFreeAt;
+        }
+    }
+}
+
+bool ACAN2517FD::recoverFromRestrictedOperationMode() {
+    if (mode == ACAN2517FDSettings::RestrictedOperation) {
+        setOperationMode(ACAN2517FDSettings::NormalFD);
+        return true;
+    }
+    return false;
+}
+
+void ACAN2517FD::setBusFault(bool faulted) {
+    const uint64_t now = sim::nowMicros();
+    retireTransmitted();
+    busFault = faulted;
+    if (!faulted) {
+        if (tec == 255) {
+            busOffRecoveryAt = now + (128u * 11u * 1000000ull + arbitrationBitRate - 1) / arbitrationBitRate;
+        }
+        return;
+    }
+
+    // Everything not yet on the wire waits for the recovery
+    tec = 255;
+    busOffRecoveryAt = UINT64_MAX;
+    for (uint16_t i = 0; i < txqCount; i++) {
+        txqDone[(txqHead + i) % SIM_ACAN_TX_CAPACITY] = UINT64_MAX;
+    }
+    for (uint16_t i = 0; i < txCount; i++) {
+        const uint16_t slot = (uint16_t)((txHead + i) % SIM_ACAN_TX_CAPACITY);
+        if (txStart[slot] >= now) {
+            txStart[slot] = UINT64_MAX;
+            txDone[slot] = UINT64_MAX;
+        }
+    }
+    wireFreeAt = now;
+}
+
+void ACAN2517FD::resetChip() {
+    mode = ACAN2517FDSettings::Configuration;
+    txHead = 0;
+    txCount = 0;
+    txqHead = 0;
+    txqCount = 0;
+    txFifoHead = 0;
+    controllerRxTail = 0;
+    controllerRxCount = 0;
+    tec = busFault ? 255 : 0;
+    rec = 0;
+    busOffRecoveryAt = UINT64_MAX;
+    memset(ram, 0, sizeof(ram));
+    updateInterruptLine();
+}
@@ -0,0 +1,415 @@
+/**
+ * @file arduino_sim.cpp
+ * @brief Simulated clock, GPIO, Serial and SPI for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "Arduino.h"
+#include "SPI.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+static uint64_t simNowMicros = 0;
+static sim::InterruptSource* interruptSource = nullptr;
+static bool firingInterrupts = false;
+static EventResponder* dmaEvent = nullptr;      // SPI DMA transfer in flight
+static uint64_t dmaDoneAt = UINT64_MAX;
+static int interruptNesting = 0;
+static uint8_t pinLevels[64] = { 0 };
+static uint8_t pinModes[64] = { 0 };
+static bool pinDriven[64] = { false };
+
+struct PinInterrupt {
+    void (*function)(void);
+    int mode;
+    bool running;
+    bool pending;       // Raised while interrupts were off
+};
+static PinInterrupt pinInterrupts[64] = {};
+
+static bool levelActive(uint8_t pin) {
+    const PinInterrupt& irq = pinInterrupts[pin];
+    return (irq.mode == LOW || irq.mode == HIGH) && pinLevels[pin] == irq.mode;
+}
+
+// Runs the handler of a pin whose interrupt is due; a level interrupt is
+// served until its line is released or it is detached
+static void servicePin(uint8_t pin) {
+    PinInterrupt& irq = pinInterrupts[pin];
+    if (irq.function == nullptr || irq.running) {
+        return;
+    }
+    if (interruptNesting > 0) {
+        irq.pending = true;
+        return;
+    }
+    irq.running = true;
+    irq.pending = false;
+    irq.function();
+    uint32_t passes = 1;
+    while (irq.function != nullptr && levelActive(pin)) {
+        if (++passes > SIM_LEVEL_INTERRUPT_PASSES) {
+            fprintf(stderr, "sim: interrupt on pin %u still asserted after %u handler passes (livelock)\n",
+                    pin, (unsigned)SIM_LEVEL_INTERRUPT_PASSES);
+            abort();
+        }
+        irq.function();
+    }
+    irq.running = false;
+}
+
+SimSerial Serial;
+SPIClass SPI;
+
+namespace sim {
+
+uint64_t nowMicros() {
+    return simNowMicros;
+}
+
+void setInterruptSource(InterruptSource* source) {
+    interruptSource = source;
+}
+
+void advanceTo(uint64_t us) {
+    // Handlers that advance time themselves must not re-enter the source.
+    // DMA completions interleave with its events in time order.
+    if (!firingInterrupts) {
+        firingInterrupts = true;
+        for (;;) {
+            const uint64_t source = interruptSource != nullptr ? interruptSource->nextEventMicros() : UINT64_MAX;
+            const uint64_t next = source < dmaDoneAt ? source : dmaDoneAt;
+            if (next > us) {
+                break;
+            }
+            if (next > simNowMicros) {
+                simNowMicros = next;
+            }
+            if (next == dmaDoneAt) {
+                EventResponder* event = dmaEvent;
+                dmaEvent = nullptr;
+                dmaDoneAt = UINT64_MAX;
+                event->triggerEvent();
+            } else {
+                interruptSource->fire(simNowMicros);
+            }
+        }
+        firingInterrupts = false;
+    }
+    if (us > simNowMicros) {
+        simNowMicros = us;
+    }
+}
+
+void advanceMicros(uint64_t us) {
+    advanceTo(simNowMicros + us);
+}
+
+void resetClock() {
+    simNowMicros = 0;
+}
+
+void drivePin(uint8_t pin, uint8_t level) {
+    if (pin >= sizeof(pinLevels)) {
+        return;
+    }
+    const uint8_t before = pinLevels[pin];
+    pinLevels[pin] = level ? HIGH : LOW;
+    pinDriven[pin] = true;
+
+    const int mode = pinInterrupts[pin].mode;
+    const bool edge = (mode == CHANGE && before != pinLevels[pin]) ||
+                      (mode == RISING && before == LOW && pinLevels[pin] == HIGH) ||
+                      (mode == FALLING && before == HIGH && pinLevels[pin] == LOW);
+    if (edge || levelActive(pin)) {
+        servicePin(pin);
+    }
+}
+
+} // namespace sim
+
+uint32_t millis() {
+    return (uint32_t)(simNowMicros / 1000);
+}
+
+uint32_t micros() {
+    return (uint32_t)simNowMicros;
+}
+
+uint32_t simCycleCount() {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const uint64_t nanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    return (uint32_t)(nanos * (F_CPU_ACTUAL / 1000000) / 1000);
+}
+
+// Teensy 4 starts every interrupt at priority 128
+static uint8_t nvicPriorities[160];
+static bool nvicPrioritySet[160];
+
+void simNvicSetPriority(uint32_t irq, uint8_t priority) {
+    if (irq < sizeof(nvicPriorities)) {
+        nvicPriorities[irq] = priority;
+        nvicPrioritySet[irq] = true;
+    }
+}
+
+uint8_t simNvicGetPriority(uint32_t irq) {
+    if (irq >= sizeof(nvicPriorities)) {
+        return 0;
+    }
+    return nvicPrioritySet[irq] ? nvicPriorities[irq] : 128;
+}
+
+void delay(uint32_t ms) {
+    sim::advanceMicros((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    sim::advanceMicros(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < sizeof(pinModes)) {
+        pinModes[pin] = mode;
+        // Pull-ups read high until something drives the pin
+        if (mode == INPUT_PULLUP && !pinDriven[pin]) {
+            pinLevels[pin] = HIGH;
+        }
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < sizeof(pinLevels)) {
+        pinLevels[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+void noInterrupts() {
+    interruptNesting++;
+}
+
+void interrupts() {
+    if (interruptNesting > 0) {
+        interruptNesting--;
+    }
+    for (uint8_t pin = 0; interruptNesting == 0 && pin < sizeof(pinLevels); pin++) {
+        if (pinInterrupts[pin].pending) {
+            servicePin(pin);
+        }
+    }
+}
+
+void attachInterrupt(uint8_t pin, void (*function)(void), int mode) {
+    if (pin >= sizeof(pinLevels)) {
+        return;
+    }
+    pinInterrupts[pin].function = function;
+    pinInterrupts[pin].mode = mode;
+    if (levelActive(pin)) {
+        servicePin(pin);
+    }
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < sizeof(pinLevels)) {
+        pinInterrupts[pin].function = nullptr;
+        pinInterrupts[pin].pending = false;
+    }
+}
+
+// --- Serial ---
+
+void SimSerial::begin(uint32_t baud) {
+    (void)baud;
+}
+
+SimSerial::operator bool() const {
+    return connected;
+}
+
+size_t SimSerial::write(const uint8_t* buf, size_t len) {
+    written += len;
+    if (echo) {
+        fwrite(buf, 1, len, stderr);
+    }
+    return len;
+}
+
+size_t SimSerial::print(const char* s) {
+    return write((const uint8_t*)s, strlen(s));
+}
+
+size_t SimSerial::print(char c) {
+    return write((const uint8_t*)&c, 1);
+}
+
+size_t SimSerial::print(long n, int base) {
+    char text[24];
+    if (base == HEX) {
+        snprintf(text, sizeof(text), "%lX", (unsigned long)n);
+    } else {
+        snprintf(text, sizeof(text), "%ld", n);
+    }
+    return print(text);
+}
+
+size_t SimSerial::print(unsigned long n, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", n);
+    return print(text);
+}
+
+size_t SimSerial::print(int n, int base) {
+    return print((long)n, base);
+}
+
+size_t SimSerial::print(unsigned int n, int base) {
+    return print((unsigned long)n, base);
+}
+
+size_t SimSerial::print(double n, int digits) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", digits, n);
+    return print(text);
+}
+
+size_t SimSerial::println() {
+    return print("\r\n");
+}
+
+size_t SimSerial::println(const char* s) {
+    return print(s) + println();
+}
+
+size_t SimSerial::println(char c) {
+    return print(c) + println();
+}
+
+size_t SimSerial::println(int n, int base) {
+    return print(n, base) + println();
+}
+
+size_t SimSerial::println(unsigned int n, int base) {
+    return print(n, base) + println();
+}
+
+size_t SimSerial::println(long n, int base) {
+    return print(n, base) + println();
+}
+
+size_t SimSerial::println(unsigned long n, int base) {
+    return print(n, base) + println();
+}
+
+size_t SimSerial::println(double n, int digits) {
+    return print(n, digits) + println();
+}
+
+void SimSerial::setEcho(bool enabled) {
+    echo = enabled;
+}
+
+void SimSerial::setConnected(bool isConnected) {
+    connected = isConnected;
+}
+
+uint32_t SimSerial::bytesWritten() const {
+    return written;
+}
+
+// --- SPI ---
+
+void SPIClass::begin() {
+}
+
+void SPIClass::end() {
+}
+
+void SPIClass::beginTransaction(const SPISettings& settings) {
+    clock = settings.clock != 0 ? settings.clock : 4000000;
+    transactions++;
+}
+
+void SPIClass::endTransaction() {
+}
+
+void SPIClass::usingInterrupt(uint8_t interruptNumber) {
+    (void)interruptNumber;
+}
+
+void SPIClass::attachDevice(DeviceExchange exchange, void* context) {
+    device = exchange;
+    deviceContext = context;
+}
+
+void SPIClass::exchange(const void* txBuffer, void* rxBuffer, size_t count) {
+    if (device != nullptr && txBuffer != nullptr) {
+        device(deviceContext, (const uint8_t*)txBuffer, (uint8_t*)rxBuffer, count);
+    } else if (rxBuffer != nullptr) {
+        if (txBuffer != nullptr) {
+            memcpy(rxBuffer, txBuffer, count);
+        } else {
+            memset(rxBuffer, 0, count);
+        }
+    }
+    bytes += count;
+    chipSelects++;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    bytes++;
+    cpu += 8000000000ull / clock;
+    return data;
+}
+
+void SPIClass::transfer(const void* txBuffer, void* rxBuffer, size_t count) {
+    exchange(txBuffer, rxBuffer, count);
+    cpu += SIM_SPI_FRAME_OVERHEAD_NS + (uint64_t)count * 8000000000ull / clock;
+}
+
+bool SPIClass::transfer(const void* txBuffer, void* rxBuffer, size_t count, EventResponderRef event) {
+    // The device sees the bytes at once, but the completion interrupt only
+    // comes once the clock has moved past the last of them; the CPU only
+    // pays for starting the transfer
+    exchange(txBuffer, rxBuffer, count);
+    dmaBytes += count;
+    cpu += SIM_SPI_FRAME_OVERHEAD_NS + SIM_SPI_DMA_START_NS;
+    const uint64_t wireMicros = ((uint64_t)count * 8000000ull + clock - 1) / clock;
+    dmaEvent = &event;
+    dmaDoneAt = sim::nowMicros() + (wireMicros > 0 ? wireMicros : 1);
+    return true;
+}
+
+uint32_t SPIClass::bytesTransferred() const {
+    return bytes;
+}
+
+uint32_t SPIClass::transactionCount() const {
+    return transactions;
+}
+
+uint32_t SPIClass::chipSelectCount() const {
+    return chipSelects;
+}
+
+uint32_t SPIClass::dmaBytesTransferred() const {
+    return dmaBytes;
+}
+
+uint64_t SPIClass::cpuNanos() const {
+    return cpu;
+}
+
+void SPIClass::resetStatistics() {
+    bytes = 0;
+    transactions = 0;
+    chipSelects = 0;
+    dmaBytes = 0;
+    cpu = 0;
+}
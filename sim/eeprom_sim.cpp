@@ -0,0 +1,39 @@
+/**
+ * @file eeprom_sim.cpp
+ * @brief EEPROM stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass() : written(0) {
+    erase();
+}
+
+uint8_t EEPROMClass::read(int idx) const {
+    return idx >= 0 && idx < SIM_EEPROM_SIZE ? cells[idx] : 0xFF;
+}
+
+void EEPROMClass::write(int idx, uint8_t value) {
+    if (idx >= 0 && idx < SIM_EEPROM_SIZE) {
+        cells[idx] = value;
+        written++;
+    }
+}
+
+void EEPROMClass::update(int idx, uint8_t value) {
+    if (read(idx) != value) {
+        write(idx, value);
+    }
+}
+
+void EEPROMClass::erase() {
+    memset(cells, 0xFF, sizeof(cells));
+}
+
+uint32_t EEPROMClass::bytesWritten() const {
+    return written;
+}
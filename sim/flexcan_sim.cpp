@@ -0,0 +1,272 @@
+/**
+ * @file flexcan_sim.cpp
+ * @brief In-process FlexCAN_T4 stand-in for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "FlexCAN_T4.h"
+#include "sim_clock.h"
+#include <string.h>
+
+static FlexCANSimBus* registeredBuses[3] = { nullptr, nullptr, nullptr };
+
+void (*FlexCANSimBus::txHook)(CAN_DEV_TABLE bus, const CAN_message_t& msg) = nullptr;
+
+static int busIndex(CAN_DEV_TABLE bus) {
+    switch (bus) {
+        case CAN1: return 0;
+        case CAN2: return 1;
+        case CAN3: return 2;
+    }
+    return 0;
+}
+
+FlexCANSimBus* FlexCANSimBus::find(CAN_DEV_TABLE bus) {
+    return registeredBuses[busIndex(bus)];
+}
+
+void FlexCANSimBus::begin() {
+    sim::advanceMicros(SIM_FLEXCAN_BEGIN_US);
+    registeredBuses[busIndex(busAddress)] = this;
+    started = true;
+    reset();
+}
+
+void FlexCANSimBus::reset() {
+    // Soft reset: mailboxes back to the default split, error counters
+    // cleared; on a bus that is still faulted the controller is off again
+    // with its first frame
+    tec = busFault ? 255 : 0;
+    rec = 0;
+    errorQueued = busFault;
+    setMaxMB(16);
+}
+
+void FlexCANSimBus::setBaudRate(uint32_t baud) {
+    baudRate = baud;
+}
+
+void FlexCANSimBus::setMaxMB(uint8_t last) {
+    maxMB = last > SIM_FLEXCAN_MAX_MB ? SIM_FLEXCAN_MAX_MB : last;
+    resetMailboxes();
+}
+
+void FlexCANSimBus::resetMailboxes() {
+    // Same default split as the library: lower half RX (first quarter
+    // standard IDs, second quarter extended), upper half TX
+    for (uint8_t i = 0; i < SIM_FLEXCAN_MAX_MB; i++) {
+        mailboxes[i].kind = FILTER_ACCEPT_ALL;
+        mailboxes[i].isTx = (i >= maxMB / 2);
+        mailboxes[i].extended = (i >= maxMB / 4);
+        mailboxes[i].interruptEnabled = true;
+        mailboxes[i].handler = nullptr;
+    }
+}
+
+int FlexCANSimBus::setMB(FLEXCAN_MAILBOX mb, FLEXCAN_RXTX mode, FLEXCAN_IDE ide) {
+    if (mb >= maxMB) {
+        return 0;
+    }
+    mailboxes[mb].isTx = (mode == TX);
+    mailboxes[mb].extended = (ide == EXT);
+    mailboxes[mb].kind = FILTER_ACCEPT_ALL;
+    return 1;
+}
+
+void FlexCANSimBus::enableMBInterrupts(bool status) {
+    mbInterrupts = status;
+}
+
+void FlexCANSimBus::enableMBInterrupt(FLEXCAN_MAILBOX mb, bool status) {
+    if (mb < SIM_FLEXCAN_MAX_MB) {
+        mailboxes[mb].interruptEnabled = status;
+    }
+}
+
+void FlexCANSimBus::onReceive(_MB_ptr handler) {
+    mainHandler = handler;
+}
+
+void FlexCANSimBus::onReceive(FLEXCAN_MAILBOX mb, _MB_ptr handler) {
+    if (mb < SIM_FLEXCAN_MAX_MB) {
+        mailboxes[mb].handler = handler;
+    }
+}
+
+void FlexCANSimBus::setMBFilter(FLEXCAN_FLTEN input) {
+    for (uint8_t i = 0; i < maxMB; i++) {
+        setMBFilter((FLEXCAN_MAILBOX)i, input);
+    }
+}
+
+void FlexCANSimBus::setMBFilter(FLEXCAN_MAILBOX mb, FLEXCAN_FLTEN input) {
+    if (mb < maxMB && !mailboxes[mb].isTx) {
+        mailboxes[mb].kind = (input == ACCEPT_ALL) ? FILTER_ACCEPT_ALL : FILTER_REJECT;
+    }
+}
+
+bool FlexCANSimBus::setMBFilter(FLEXCAN_MAILBOX mb, uint32_t id1) {
+    return setMBFilter(mb, id1, id1);
+}
+
+bool FlexCANSimBus::setMBFilter(FLEXCAN_MAILBOX mb, uint32_t id1, uint32_t id2) {
+    if (mb >= maxMB || mailboxes[mb].isTx) {
+        return false;
+    }
+    mailboxes[mb].kind = FILTER_LIST;
+    mailboxes[mb].a = id1;
+    mailboxes[mb].b = id2;
+    return true;
+}
+
+bool FlexCANSimBus::setMBFilterRange(FLEXCAN_MAILBOX mb, uint32_t id1, uint32_t id2) {
+    if (mb >= maxMB || mailboxes[mb].isTx || id1 > id2) {
+        return false;
+    }
+    mailboxes[mb].kind = FILTER_RANGE;
+    mailboxes[mb].a = id1;
+    mailboxes[mb].b = id2;
+    return true;
+}
+
+bool FlexCANSimBus::setMBUserFilter(FLEXCAN_MAILBOX mb, uint32_t id1, uint32_t mask) {
+    if (mb >= maxMB || mailboxes[mb].isTx) {
+        return false;
+    }
+    mailboxes[mb].kind = FILTER_MASK;
+    mailboxes[mb].a = id1 & mask;
+    mailboxes[mb].b = mask;
+    return true;
+}
+
+void FlexCANSimBus::mailboxStatus() {
+}
+
+bool FlexCANSimBus::matches(const Mailbox& box, const CAN_message_t& msg) const {
+    // A mailbox only ever receives its own ID format
+    if ((bool)msg.flags.extended != box.extended) {
+        return false;
+    }
+    switch (box.kind) {
+        case FILTER_ACCEPT_ALL: return true;
+        case FILTER_REJECT: return false;
+        case FILTER_LIST: return msg.id == box.a || msg.id == box.b;
+        case FILTER_RANGE: return msg.id >= box.a && msg.id <= box.b;
+        case FILTER_MASK: return (msg.id & box.b) == box.a;
+    }
+    return false;
+}
+
+bool FlexCANSimBus::deliver(const CAN_message_t& msg) {
+    if (!started || isBusOff()) {
+        rejected++;
+        return false;
+    }
+
+    for (uint8_t i = 0; i < maxMB; i++) {
+        const Mailbox& box = mailboxes[i];
+        if (box.isTx || !matches(box, msg)) {
+            continue;
+        }
+
+        accepted++;
+        CAN_message_t copy = msg;
+        copy.mb = (int8_t)i;
+        copy.bus = (uint8_t)(busIndex(busAddress) + 1);
+
+        // Mailbox interrupt: mailbox-specific handler first, then the main one
+        if (mbInterrupts && box.interruptEnabled) {
+            if (box.handler != nullptr) {
+                box.handler(copy);
+            } else if (mainHandler != nullptr) {
+                mainHandler(copy);
+            }
+        }
+        return true;
+    }
+
+    rejected++;
+    return false;
+}
+
+int FlexCANSimBus::write(const CAN_message_t& msg) {
+    if (isBusOff()) {
+        return 0;
+    }
+    written++;
+    if (txHook != nullptr) {
+        txHook(busAddress, msg);
+    }
+    return 1;
+}
+
+int FlexCANSimBus::write(FLEXCAN_MAILBOX mb, const CAN_message_t& msg) {
+    (void)mb;
+    return write(msg);
+}
+
+int FlexCANSimBus::read(CAN_message_t& msg) {
+    (void)msg;
+    return 0;
+}
+
+uint64_t FlexCANSimBus::events() {
+    return 0;
+}
+
+uint16_t FlexCANSimBus::getRXQueueCount() {
+    return 0;
+}
+
+uint16_t FlexCANSimBus::getTXQueueCount() {
+    return 0;
+}
+
+void FlexCANSimBus::setErrorCounters(uint8_t txErrors, uint8_t rxErrors) {
+    tec = txErrors;
+    rec = rxErrors;
+    errorQueued = true;
+}
+
+void FlexCANSimBus::setBusFault(bool faulted) {
+    busFault = faulted;
+    if (faulted) {
+        tec = 255;
+        errorQueued = true;
+    }
+}
+
+uint32_t FlexCANSimBus::readECR() const {
+    return (uint32_t)tec | ((uint32_t)rec << 8);
+}
+
+uint32_t FlexCANSimBus::readESR1() const {
+    // FLTCONF (5:4): 00 active, 01 passive, 1x bus off; TEC saturates at
+    // 255 here, which stands for the bus-off threshold
+    return tec == 255 ? 0x20 : ((tec >= 128 || rec >= 128) ? 0x10 : 0);
+}
+
+bool FlexCANSimBus::error(CAN_error_t& error, bool printDetails) {
+    (void)printDetails;
+    if (!errorQueued) {
+        return false;
+    }
+    errorQueued = false;
+    error.TX_ERR_COUNTER = tec;
+    error.RX_ERR_COUNTER = rec;
+    // TEC saturates at 255 here; treat that as the bus-off threshold
+    if (tec == 255) {
+        strcpy(error.FLT_CONF, "Bus off");
+    } else if (tec >= 128 || rec >= 128) {
+        strcpy(error.FLT_CONF, "Error Passive");
+    } else {
+        strcpy(error.FLT_CONF, "Error Active");
+    }
+    error.TX_WRN = tec >= 96;
+    error.RX_WRN = rec >= 96;
+
+    error.ESR1 = readESR1();
+    error.ECR = (uint16_t)readECR();
+    return true;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file sim_clock.h
+ * @brief Simulated microsecond clock for the native build
+ * @author SIRI Electrical Team
+ * @date 2025
+ *
+ * micros()/millis() read this clock and delay() advances it, so blocking
+ * waits in the firmware show up as latency without actually sleeping.
+ */
+
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+
+namespace sim {
+
+// Something that raises "interrupts" at known simulated times. Whenever the
+// clock moves forward it fires every event that falls inside the step, at
+// that event's own timestamp, so ISRs can land in the middle of a delay().
+class InterruptSource {
+public:
+    virtual ~InterruptSource() {}
+    virtual uint64_t nextEventMicros() = 0;   // UINT64_MAX when idle
+    virtual void fire(uint64_t nowMicros) = 0;
+};
+
+void setInterruptSource(InterruptSource* source);
+
+// Current simulated time in microseconds since boot
+uint64_t nowMicros();
+
+// Move simulated time forward (never backwards)
+void advanceMicros(uint64_t us);
+void advanceTo(uint64_t us);
+
+// Restart the clock at zero
+void resetClock();
+
+} // namespace sim
+
+#endif // SIM_CLOCK_H
@@ -0,0 +1,219 @@
+/**
+ * @file bus_supervisor.cpp
+ * @brief CAN error state tracking and rate-limited bus recovery
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "bus_supervisor.h"
+#include "trace.h"
+#include <string.h>
+
+static const uint8_t BUS_RECORDS_PER_BUS = 5;
+
+BusSupervisor busSupervisor;
+
+static uint16_t saturate16(uint32_t value) {
+    return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+BusSupervisor::BusSupervisor() {
+    memset(buses, 0, sizeof(buses));
+    for (uint8_t bus = 0; bus < DIAG_BUS_COUNT; ++bus) {
+        buses[bus].backoffMs = HAT_BUS_RECOVERY_MIN_MS;
+    }
+}
+
+uint8_t BusSupervisor::classify(const BusErrorState_t& state) {
+    if (state.offline) {
+        return BUS_STATE_OFFLINE;
+    }
+    if (state.busOff) {
+        return BUS_STATE_BUS_OFF;
+    }
+    if (state.tec >= 128 || state.rec >= 128) {
+        return BUS_STATE_PASSIVE;
+    }
+    if (state.tec >= 96 || state.rec >= 96) {
+        return BUS_STATE_WARNING;
+    }
+    return BUS_STATE_ACTIVE;
+}
+
+bool BusSupervisor::isDown(uint8_t state) {
+    return state == BUS_STATE_BUS_OFF || state == BUS_STATE_OFFLINE;
+}
+
+uint8_t BusSupervisor::update(uint8_t bus, const BusErrorState_t& state, uint32_t lostFrames, uint32_t nowMicros) {
+    if (bus >= DIAG_BUS_COUNT) {
+        return BUS_ACTION_NONE;
+    }
+    BusHealth_t& health = buses[bus];
+    const uint8_t next = classify(state);
+
+    // The time since the last poll is charged to the state it found
+    if (health.polled) {
+        const uint32_t elapsed = nowMicros - health.lastPollMicros;
+        if (health.state >= BUS_STATE_PASSIVE) {
+            health.degradedMicros += elapsed;
+        }
+        if (isDown(health.state)) {
+            health.downMicros += elapsed;
+        }
+        // Degraded at either end of the interval: the fault cost these frames
+        if (health.state >= BUS_STATE_PASSIVE || next >= BUS_STATE_PASSIVE) {
+            health.framesLost += lostFrames - health.lastLost;
+        }
+    }
+    health.polled = true;
+    health.lastPollMicros = nowMicros;
+    health.lastLost = lostFrames;
+    health.tec = state.tec;
+    health.rec = state.rec;
+    if (state.tec > health.peakTec) {
+        health.peakTec = state.tec;
+    }
+    if (state.rec > health.peakRec) {
+        health.peakRec = state.rec;
+    }
+
+    if (next != health.state) {
+        const uint8_t data[5] = { bus, health.state, next, state.tec, state.rec };
+        TRACE_EVENT(TRACE_EVENT_BUS, bus, data, sizeof(data));
+        health.transitions++;
+        if (isDown(next) && !isDown(health.state)) {
+            health.busOffs++;
+            health.downSinceMicros = nowMicros;
+            health.episodeAttempts = 0;
+        } else if (!isDown(next) && isDown(health.state)) {
+            const uint32_t episode = nowMicros - health.downSinceMicros;
+            if (episode > health.longestDownMicros) {
+                health.longestDownMicros = episode;
+            }
+            health.upSinceMicros = nowMicros;
+        }
+        health.state = next;
+    }
+
+    if (!isDown(health.state)) {
+        if (nowMicros - health.upSinceMicros >= HAT_BUS_RECOVERY_STABLE_MS * 1000UL) {
+            health.backoffMs = HAT_BUS_RECOVERY_MIN_MS;
+        }
+        return BUS_ACTION_NONE;
+    }
+    return nextAction(health, nowMicros);
+}
+
+uint8_t BusSupervisor::nextAction(BusHealth_t& health, uint32_t nowMicros) {
+    // A bus-off first gets the chance to end by itself
+    if (health.state == BUS_STATE_BUS_OFF && nowMicros - health.downSinceMicros < HAT_BUS_OFF_HOLDOFF_MS * 1000UL) {
+        return BUS_ACTION_NONE;
+    }
+    // Spacing holds across episodes, so a flapping bus is limited too
+    if (health.recoveries > 0 && nowMicros - health.lastAttemptMicros < health.spacingMs * 1000UL) {
+        return BUS_ACTION_NONE;
+    }
+    return health.episodeAttempts == 0 ? BUS_ACTION_RESTART : BUS_ACTION_REINIT;
+}
+
+void BusSupervisor::recoveryDone(uint8_t bus, uint8_t action, bool ok, uint32_t nowMicros) {
+    if (bus >= DIAG_BUS_COUNT || action == BUS_ACTION_NONE) {
+        return;
+    }
+    BusHealth_t& health = buses[bus];
+    health.recoveries++;
+    if (action == BUS_ACTION_REINIT) {
+        health.reinits++;
+    }
+    if (!ok) {
+        health.failures++;
+    }
+    if (health.episodeAttempts < 0xFF) {
+        health.episodeAttempts++;
+    }
+    health.lastAttemptMicros = nowMicros;
+    health.spacingMs = health.backoffMs;
+    health.backoffMs = health.backoffMs * 2 < HAT_BUS_RECOVERY_MAX_MS ? health.backoffMs * 2 : HAT_BUS_RECOVERY_MAX_MS;
+
+    const uint8_t data[3] = { bus, action, ok };
+    TRACE_EVENT(TRACE_EVENT_BUS_RECOVERY, bus, data, sizeof(data));
+}
+
+bool BusSupervisor::getRecord(uint8_t index, uint32_t& value, uint16_t& aux) const {
+    const uint8_t bus = index / BUS_RECORDS_PER_BUS;
+    if (bus >= DIAG_BUS_COUNT) {
+        return false;
+    }
+    const BusHealth_t& health = buses[bus];
+    switch (index % BUS_RECORDS_PER_BUS) {
+        case 0:
+            value = health.state;
+            aux = (uint16_t)((health.tec << 8) | health.rec);
+            break;
+        case 1:
+            value = (uint32_t)(health.degradedMicros / 1000);
+            aux = (uint16_t)((health.peakTec << 8) | health.peakRec);
+            break;
+        case 2:
+            value = (uint32_t)(health.downMicros / 1000);
+            aux = saturate16(health.busOffs);
+            break;
+        case 3:
+            value = health.longestDownMicros / 1000;
+            aux = saturate16(health.recoveries);
+            break;
+        default:
+            value = health.framesLost;
+            aux = saturate16(health.failures);
+            break;
+    }
+    return true;
+}
+
+uint8_t BusSupervisor::getState(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].state : BUS_STATE_ACTIVE;
+}
+
+uint8_t BusSupervisor::getPeakTec(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].peakTec : 0;
+}
+
+uint8_t BusSupervisor::getPeakRec(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].peakRec : 0;
+}
+
+uint32_t BusSupervisor::getTransitionCount(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].transitions : 0;
+}
+
+uint32_t BusSupervisor::getBusOffCount(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].busOffs : 0;
+}
+
+uint32_t BusSupervisor::getRecoveryCount(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].recoveries : 0;
+}
+
+uint32_t BusSupervisor::getReinitCount(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].reinits : 0;
+}
+
+uint32_t BusSupervisor::getRecoveryFailures(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].failures : 0;
+}
+
+uint32_t BusSupervisor::getDegradedMillis(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? (uint32_t)(buses[bus].degradedMicros / 1000) : 0;
+}
+
+uint32_t BusSupervisor::getDownMillis(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? (uint32_t)(buses[bus].downMicros / 1000) : 0;
+}
+
+uint32_t BusSupervisor::getLongestDownMillis(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].longestDownMicros / 1000 : 0;
+}
+
+uint32_t BusSupervisor::getFramesLost(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].framesLost : 0;
+}
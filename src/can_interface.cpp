@@ -9,127 +9,542 @@
 #include "message_construction.h"
 #include "hat_config.h"
 #include "hardware_map.h"
+#include "trace.h"
+#include "filter_planner.h"
+#include "component_ctrl.h"
+#include "state_machine.h"
+#include "diagnostics.h"
+#include "param_registry.h"
+#include <atomic>
 #include <FlexCAN_T4.h>
 #include "Arduino.h"
 
 
-// Pointer for function for callback
-CANInterface *CANInterfaceInstance = nullptr;
+// Jetson drive setpoints, published from the receive callback
+DriveSetpointStore driveSetpoints;
 
-float angular_vel[4] = {0};
-float steering_angle[4] = {0};
+// Links by FlexCAN bus number, for handlers that answer on the receiving link
+CANInterfaceBase* CANInterfaceBase::links[4] = { nullptr, nullptr, nullptr, nullptr };
 
-// FlexCAN instance
-FlexCAN_T4<CAN3, RX_SIZE_256, TX_SIZE_16> can;
+// Format of the last drive command from the Jetson, for HAT_JETSON_FORMAT_AUTO
+std::atomic<uint8_t> CANInterfaceBase::peerFormat(HAT_JETSON_FORMAT_FLOAT);
 
-//Callback function
-void canSniffCallback(const CAN_message_t &msg) {
-    CAN_message_t msg_copy = msg;
-    if (CANInterfaceInstance != nullptr) {
-        CANInterfaceInstance->receiveMessage(msg_copy);
+// Diagnostics slots per link
+typedef struct {
+    uint8_t bus;
+    uint8_t isr;
+    uint8_t rxQueue;
+    uint8_t txQueue;
+} LinkDiagSlots_t;
+
+static const LinkDiagSlots_t LINK_DIAG_SLOTS[CAN_LINK_COUNT] = {
+    { DIAG_BUS_JETSON, DIAG_ISR_JETSON_RX, DIAG_QUEUE_JETSON_RX, DIAG_QUEUE_JETSON_TX },
+    { DIAG_BUS_JETSON_AUX, DIAG_ISR_JETSON_AUX_RX, DIAG_QUEUE_JETSON_AUX_RX, DIAG_QUEUE_JETSON_AUX_TX },
+};
+
+// Setpoints are only taken while the HAT is armed, and each one taken
+// counts as operator activity for the state timeout
+static bool acceptDriveCommand() {
+    HATStateMachine* stateMachine = HATStateMachineInstance;
+    if (stateMachine == nullptr || !stateMachine->isCommandAllowed(HAT_CMD_DRIVE)) {
+        return false;
     }
+    stateMachine->resetTimeout();
+    return true;
 }
 
-// Constructor implementation
-CANInterface::CANInterface() {
-    CANInterfaceInstance=this;
-    Serial.begin(HAT_SERIAL_BAUD_RATE);
-    can.begin();
-    can.setBaudRate(CAN_BAUDRATE);
-    can.enableMBInterrupts();
-    can.onReceive(canSniffCallback);
+// Jetson bus message handlers - run in the FlexCAN interrupt
+static void onDriveCommand(const CAN_message_t &msg, uint8_t wheel) {
+    if (!acceptDriveCommand()) {
+        return;
+    }
+
+    // Dispatched straight from the mailbox interrupt, so now is the arrival time
+    const DrivePayload_t payload = decodeDrivePayload(msg.buf);
+    const uint32_t now = micros();
+    driveSetpoints.publish(wheel, payload.angular_vel, payload.steering_angle, now);
+    diagnostics.markBoot(DIAG_BOOT_FIRST_COMMAND, now);
+    CANInterfaceBase::notePeerFormat(HAT_JETSON_FORMAT_FLOAT);
 }
 
-CANInterface::~CANInterface() {
-    // Destructor implementation
+static void onCompactDriveCommand(const CAN_message_t &msg, uint8_t frame) {
+    if (!acceptDriveCommand()) {
+        return;
+    }
+
+    // Both wheels of the frame share one arrival time
+    DrivePayload_t payload[DRIVE_COMPACT_WHEELS_PER_FRAME];
+    const uint8_t count = decodeCompactDrivePayload(msg.buf, msg.len, payload);
+    const uint32_t now = micros();
+    for (uint8_t i = 0; i < count; ++i) {
+        const uint8_t wheel = frame * DRIVE_COMPACT_WHEELS_PER_FRAME + i;
+        if (wheel < HatProfile::wheelCount) {
+            driveSetpoints.publish(wheel, payload[i].angular_vel, payload[i].steering_angle, now);
+        }
+    }
+    if (count > 0) {
+        diagnostics.markBoot(DIAG_BOOT_FIRST_COMMAND, now);
+        CANInterfaceBase::notePeerFormat(HAT_JETSON_FORMAT_COMPACT);
+    }
 }
 
-// Initialize CAN interface
-bool CANInterface::initialize() {
-    //Reject everything first
-    can.setMBFilter(REJECT_ALL);
+static void onEmergencyMessage(const CAN_message_t &msg, uint8_t arg) {
+    TRACE_EVENT(TRACE_EVENT_JETSON_RX, msg.id, msg.buf, msg.len);
+}
 
-    //Wheel position / velocity message IDs
-    can.setMBFilterRange(MB0, 0x200, 0x2FF);
-    can.setMBFilterRange(MB1, 0x200, 0x2FF);
-    can.setMBFilterRange(MB2, 0x200, 0x2FF);
-    can.setMBFilterRange(MB3, 0x200, 0x2FF);
+// Stop and shutdown act here, in the interrupt, not on the next loop() pass
+static void onEmergencyStop(const CAN_message_t &msg, uint8_t arg) {
+    if (ComponentControllerInstance != nullptr) {
+        ComponentControllerInstance->emergencyStop();
+    }
+    if (HATStateMachineInstance != nullptr) {
+        HATStateMachineInstance->handleEmergency();
+    }
+    TRACE_EVENT(TRACE_EVENT_JETSON_RX, msg.id, msg.buf, msg.len);
+}
 
-    //Emergency messages
-    can.setMBFilter(MB4, MSG_TYPE_EMERGENCY_STOP);
-    can.setMBFilter(MB5, MSG_TYPE_EMERGENCY_BATTERY);
-    can.setMBFilter(MB6, MSG_TYPE_EMERGENCY_THERMAL);
-    can.setMBFilter(MB7, MSG_TYPE_SYSTEM_SHUTDOWN);
+// Lock, unlock, arm, disarm and reset from the Jetson; arg is the event
+static void onStateRequest(const CAN_message_t &msg, uint8_t event) {
+    if (HATStateMachineInstance != nullptr && HATStateMachineInstance->isCommandAllowed(hatIdType(msg.id))) {
+        HATStateMachineInstance->processEvent((StateMachineEvent_t)event, AUTHORITY_BASE_STATION);
+    }
+    TRACE_EVENT(TRACE_EVENT_JETSON_RX, msg.id, msg.buf, msg.len);
+}
 
-    can.setMBFilterRange(MB8, 0x00, 0x7FF);
+// Answered by serviceDiagnostics() on the link the request came in on
+static void onDiagnosticRequest(const CAN_message_t &msg, uint8_t arg) {
+    CANInterfaceBase* link = CANInterfaceBase::forBus(msg.bus);
+    if (link != nullptr) {
+        link->postDiagnosticRequest(msg);
+    }
+}
+
+// Carried out by serviceConfig() on the link the request came in on
+static void onConfigRequest(const CAN_message_t &msg, uint8_t arg) {
+    CANInterfaceBase* link = CANInterfaceBase::forBus(msg.bus);
+    if (link != nullptr) {
+        link->postConfigRequest(msg);
+    }
+}
+
+// Standard ID -> handler table, generated from JETSON_STD_MESSAGES
+typedef CanDispatchTable<CAN_message_t, CAN_STD_ID_COUNT, JETSON_STD_MESSAGE_COUNT> JetsonDispatchTable;
 
-    can.mailboxStatus();
+#define JETSON_MESSAGE_ROUTE(name, id, handler, arg, mailbox) { (id), (handler), (arg) },
+static constexpr JetsonDispatchTable::Route JETSON_ROUTES[] = {
+    JETSON_STD_MESSAGES(JETSON_MESSAGE_ROUTE)
+};
+#undef JETSON_MESSAGE_ROUTE
 
-    // Initialise the wheel_pos to 0 and the steering positions to 0
-    for (int i = 0; i < 4; ++i) {
-        angular_vel[i] = 0;
-        steering_angle[i] = 0;
+static constexpr JetsonDispatchTable jetsonDispatch(JETSON_ROUTES);
+
+// Every wheel of the HAT profile has its drive command routed to it
+static constexpr bool driveRoutesMatchProfile() {
+    for (uint8_t wheel = 0; wheel < HatProfile::wheelCount; ++wheel) {
+        const int route = jetsonDispatch.routeOf(HatProfile::wheels[wheel].commandId);
+        if (route < 0 || JETSON_ROUTES[route].handler != onDriveCommand || JETSON_ROUTES[route].arg != wheel) {
+            return false;
+        }
     }
+    return true;
+}
+static_assert(driveRoutesMatchProfile(), "JETSON_STD_MESSAGES drive entries must match the HAT profile");
 
+// ... and so has every compact frame, to the first wheel it carries
+static constexpr bool compactRoutesMatchProfile() {
+    for (uint8_t frame = 0; frame < HatProfile::compactFrameCount; ++frame) {
+        const int route = jetsonDispatch.routeOf(HatProfile::compactCommandIds[frame]);
+        if (route < 0 || JETSON_ROUTES[route].handler != onCompactDriveCommand || JETSON_ROUTES[route].arg != frame) {
+            return false;
+        }
+    }
     return true;
 }
+static_assert(compactRoutesMatchProfile(), "JETSON_STD_MESSAGES compact drive entries must match the HAT profile");
+
+#define JETSON_MESSAGE_MAILBOX(name, id, handler, arg, mailbox) (mailbox),
+static constexpr uint8_t JETSON_MAILBOX_POLICY[] = {
+    JETSON_STD_MESSAGES(JETSON_MESSAGE_MAILBOX)
+};
+#undef JETSON_MESSAGE_MAILBOX
+
+// Extended HAT message type -> handler table, generated from JETSON_EXT_MESSAGES
+typedef CanDispatchTable<CAN_message_t, 256, JETSON_EXT_MESSAGE_COUNT> JetsonExtDispatchTable;
+
+#define JETSON_EXT_MESSAGE_ROUTE(name, type, handler, arg) { (type), (handler), (arg) },
+static constexpr JetsonExtDispatchTable::Route JETSON_EXT_ROUTES[] = {
+    JETSON_EXT_MESSAGES(JETSON_EXT_MESSAGE_ROUTE)
+};
+#undef JETSON_EXT_MESSAGE_ROUTE
 
-bool CANInterface::sendMessage(const CAN_message_t& message) {
-    // Send CAN message
-    CAN_message_t messageCopy = message;
-    for (int i = 0; i < 4; ++i) {
-        messageCopy.len = 8;
-        if (i == 0) {
-            messageCopy.id = PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_LEFT_ENCODER;
-        } else if (i == 1) {
-            messageCopy.id = PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_RIGHT_ENCODER;
-        } else if (i == 2) {
-            messageCopy.id = PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_LEFT_ENCODER;
-        } else if (i == 3) {
-            messageCopy.id = PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_RIGHT_ENCODER;
+static constexpr JetsonExtDispatchTable jetsonExtDispatch(JETSON_EXT_ROUTES);
+
+static_assert(HAT_JETSON_EXT_RX_MAILBOXES >= 1 && HAT_JETSON_EXT_RX_MAILBOXES < HAT_JETSON_RX_MAILBOXES,
+              "HAT_JETSON_EXT_RX_MAILBOXES must leave room for standard IDs");
+static const uint8_t JETSON_STD_RX_MAILBOXES = HAT_JETSON_RX_MAILBOXES - HAT_JETSON_EXT_RX_MAILBOXES;
+
+// Pending diagnostic request word:
+// source << 24 | count << 16 | first << 8 | valid << 7 | page, 0 when idle
+static const uint32_t DIAG_REQUEST_VALID = 0x80;
+
+CANInterfaceBase::CANInterfaceBase(uint8_t busNumber, uint8_t link, uint8_t txRoles)
+    : busNumber(busNumber), link(link), txRoles(txRoles),
+      diagBus(LINK_DIAG_SLOTS[link].bus), diagIsr(LINK_DIAG_SLOTS[link].isr),
+      diagRxQueue(LINK_DIAG_SLOTS[link].rxQueue), diagTxQueue(LINK_DIAG_SLOTS[link].txQueue),
+      filterPlan(), extFilterPlan(), dedicatedMailboxes(0), unroutedFrames(0), pendingDiagRequest(0),
+      configRequests(), configHead(0), configTail(0), droppedConfigRequests(0) {
+    links[busNumber & 3] = this;
+}
+
+CANInterfaceBase::~CANInterfaceBase() {
+    if (links[busNumber & 3] == this) {
+        links[busNumber & 3] = nullptr;
+    }
+}
+
+CANInterfaceBase* CANInterfaceBase::forBus(uint8_t busNumber) {
+    return busNumber < 4 ? links[busNumber] : nullptr;
+}
+
+bool CANInterfaceBase::planMailboxes(MailboxSetup_t (&mailboxes)[HAT_JETSON_MAILBOXES]) {
+    // Dedicated mailboxes (emergency messages) take the lowest numbers, so
+    // they win arbitration for the interrupt and never share a filter
+    uint8_t mb = 0;
+    uint32_t sharedIds[JETSON_STD_MESSAGE_COUNT];
+    uint8_t sharedCount = 0;
+    for (uint8_t i = 0; i < JETSON_STD_MESSAGE_COUNT; ++i) {
+        if (JETSON_MAILBOX_POLICY[i] == JETSON_RX_DEDICATED && mb + 1 < JETSON_STD_RX_MAILBOXES) {
+            mailboxes[mb++] = { MAILBOX_RX_STD_EXACT, JETSON_ROUTES[i].key, CAN_STD_ID_MASK };
+        } else {
+            sharedIds[sharedCount++] = JETSON_ROUTES[i].key;
         }
+    }
+    dedicatedMailboxes = mb;
+
+    // Everything else shares the remaining receive mailboxes as ID/mask filters
+    bool ok = true;
+    if (sharedCount > 0) {
+        ok = planFilters(sharedIds, sharedCount, 11, JETSON_STD_RX_MAILBOXES - mb, filterPlan);
+        for (uint8_t i = 0; ok && i < filterPlan.count; ++i, ++mb) {
+            mailboxes[mb] = { MAILBOX_RX_STD_MASK, filterPlan.filters[i].id, filterPlan.filters[i].mask };
+        }
+    }
+
+    // Unused receive mailboxes stay closed
+    for (; mb < JETSON_STD_RX_MAILBOXES; ++mb) {
+        mailboxes[mb] = { MAILBOX_RX_STD_CLOSED, 0, 0 };
+    }
 
-        floatToBytes(steering_angle[i], messageCopy.buf);
-        floatToBytes(angular_vel[i], messageCopy.buf + 4);
-        can.write(messageCopy);
+    // Extended IDs are planned on target << 8 | type; priority and source
+    // (the upper 13 bits) stay outside the masks, so they are don't-care
+    uint32_t extKeys[JETSON_EXT_MESSAGE_COUNT];
+    for (uint8_t i = 0; i < JETSON_EXT_MESSAGE_COUNT; ++i) {
+        extKeys[i] = ((uint32_t)HAT_NODE_ID << 8) | JETSON_EXT_ROUTES[i].key;
+    }
+    ok = planFilters(extKeys, JETSON_EXT_MESSAGE_COUNT, 16, HAT_JETSON_EXT_RX_MAILBOXES, extFilterPlan) && ok;
+    for (uint8_t i = 0; i < HAT_JETSON_EXT_RX_MAILBOXES; ++i, ++mb) {
+        if (i < extFilterPlan.count) {
+            mailboxes[mb] = { MAILBOX_RX_EXT_MASK, extFilterPlan.filters[i].id, extFilterPlan.filters[i].mask };
+        } else {
+            mailboxes[mb] = { MAILBOX_RX_EXT_CLOSED, 0, 0 };
+        }
+    }
+    for (; mb < HAT_JETSON_MAILBOXES; ++mb) {
+        mailboxes[mb] = { MAILBOX_TX, 0, 0 };
     }
-    return true; 
+
+    const char* name = link == CAN_LINK_PRIMARY ? "jetson" : "jetson aux";
+    reportFilterPlan(name, filterPlan, dedicatedMailboxes);
+    reportFilterPlan(link == CAN_LINK_PRIMARY ? "jetson ext" : "jetson aux ext", extFilterPlan, 0);
+    return ok;
 }
 
-bool CANInterface::receiveMessage(CAN_message_t& message) {
-    // Receive CAN message
+void CANInterfaceBase::registerDiagnostics() {
+    // Everything this bus receives or sends is counted per ID
+    diagnostics.setBitRate(diagBus, CAN_BAUDRATE, 1);
+    for (uint8_t i = 0; i < JETSON_STD_MESSAGE_COUNT; ++i) {
+        diagnostics.registerId(diagBus, JETSON_ROUTES[i].key, false);
+    }
+    for (uint8_t i = 0; i < JETSON_EXT_MESSAGE_COUNT; ++i) {
+        diagnostics.registerId(diagBus, ((uint32_t)HAT_NODE_ID << 8) | JETSON_EXT_ROUTES[i].key, true);
+    }
+    for (uint8_t i = 0; i < HatProfile::wheelCount; ++i) {
+        diagnostics.registerId(diagBus, HatProfile::wheels[i].encoderId, false);
+    }
+    for (uint8_t i = 0; i < HatProfile::compactFrameCount; ++i) {
+        diagnostics.registerId(diagBus, HatProfile::compactEncoderIds[i], false);
+    }
+    diagnostics.registerId(diagBus,
+                           encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, CAN_BROADCAST_ADDR, MSG_TYPE_HEARTBEAT),
+                           true);
+#if HAT_TELEMETRY_AGGREGATION
+    diagnostics.registerId(diagBus,
+                           encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, CAN_BROADCAST_ADDR, MSG_TYPE_TELEMETRY_SENSOR),
+                           true);
+#endif
+}
 
-    float theta = 0.0f;
-    float omega = 0.0f;
+uint8_t CANInterfaceBase::buildDriveTelemetry(const DriveTelemetry_t& telemetry,
+                                              CAN_message_t (&frames)[HatProfile::wheelCount]) const {
+    if (getTelemetryFormat() == HAT_JETSON_FORMAT_COMPACT) {
+        // Two wheels per frame; the last one may carry a single wheel
+        for (uint8_t frame = 0; frame < HatProfile::compactFrameCount; ++frame) {
+            DrivePayload_t wheels[DRIVE_COMPACT_WHEELS_PER_FRAME];
+            uint8_t count = 0;
+            for (uint8_t wheel = frame * DRIVE_COMPACT_WHEELS_PER_FRAME;
+                 wheel < HatProfile::wheelCount && count < DRIVE_COMPACT_WHEELS_PER_FRAME; ++wheel) {
+                wheels[count++] = { telemetry.steering_angle[wheel], telemetry.angular_vel[wheel] };
+            }
+            frames[frame].id = HatProfile::compactEncoderIds[frame];
+            frames[frame].len = encodeCompactDrivePayload(wheels, count, frames[frame].buf);
+        }
+        return HatProfile::compactFrameCount;
+    }
 
-    for (int i = 0; i < message.len; i++) {
-    Serial.print(message.buf[i], HEX);
-    Serial.print(" ");
+    for (uint8_t i = 0; i < HatProfile::wheelCount; ++i) {
+        frames[i].id = HatProfile::wheels[i].encoderId;
+        frames[i].len = 8;
+        encodeDrivePayload({ telemetry.steering_angle[i], telemetry.angular_vel[i] }, frames[i].buf);
     }
-    Serial.println();
+    return HatProfile::wheelCount;
+}
 
-    memcpy(&theta, message.buf, sizeof(float));
-    memcpy(&omega, message.buf + sizeof(float), sizeof(float));
+void CANInterfaceBase::notePeerFormat(uint8_t format) {
+    peerFormat.store(format, std::memory_order_relaxed);
+}
 
-    Serial.println(theta);
-    Serial.println(omega); 
+uint8_t CANInterfaceBase::getTelemetryFormat() {
+#if HAT_JETSON_TELEMETRY_FORMAT == HAT_JETSON_FORMAT_AUTO
+    return peerFormat.load(std::memory_order_relaxed);
+#else
+    return HAT_JETSON_TELEMETRY_FORMAT;
+#endif
+}
 
-    if (message.id == (PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_LEFT)) {
-        angular_vel[0] = omega;
-        steering_angle[0] = theta;
-    } else if (message.id == (PRIORITY_DRIVE | MESSAGE_DRIVE_FRONT_RIGHT)) {
-        angular_vel[1] = omega;
-        steering_angle[1] = theta;
-    } else if (message.id == (PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_LEFT)) {
-        angular_vel[2] = omega;
-        steering_angle[2] = theta;
-    } else if (message.id == (PRIORITY_DRIVE | MESSAGE_DRIVE_REAR_RIGHT)) {
-        angular_vel[3] = omega;
-        steering_angle[3] = theta;
+void CANInterfaceBase::buildTelemetrySummary(const TelemetrySummary_t& summary, CAN_message_t& frame) const {
+    // Broadcast, layout in message_construction.h
+    frame.id = encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, CAN_BROADCAST_ADDR, MSG_TYPE_TELEMETRY_SENSOR);
+    frame.flags.extended = 1;
+    memset(frame.buf, 0, sizeof(frame.buf));
+    frame.len = encodeTelemetrySummary(summary, frame.buf);
+}
+
+void CANInterfaceBase::buildHeartbeat(HAT_State_t state, uint32_t uptimeMs, CAN_message_t& heartbeat) const {
+    // Broadcast: [0] state, [1-3] reserved, [4-7] uptime in ms (little endian)
+    heartbeat.id = encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, CAN_BROADCAST_ADDR, MSG_TYPE_HEARTBEAT);
+    heartbeat.flags.extended = 1;
+    heartbeat.len = 8;
+    memset(heartbeat.buf, 0, sizeof(heartbeat.buf));
+    heartbeat.buf[0] = (uint8_t)state;
+    memcpy(heartbeat.buf + 4, &uptimeMs, sizeof(uptimeMs));
+}
+
+bool CANInterfaceBase::receiveMessage(CAN_message_t& message) {
+    // Receive CAN message - runs in the FlexCAN interrupt, so no Serial here
+    TRACE_FRAME(TRACE_EVENT_JETSON_RX, message.id, message.buf, message.len);
+
+    diagnostics.countRx(diagBus, message.id, message.flags.extended, message.len);
+
+    // One table lookup whatever the number of messages
+    bool routed;
+    if (message.flags.extended) {
+        routed = hatIdTarget(message.id) == HAT_NODE_ID && jetsonExtDispatch.dispatch(hatIdType(message.id), message);
+    } else {
+        routed = jetsonDispatch.dispatch(message.id, message);
+    }
+    if (!routed) {
+        unroutedFrames = unroutedFrames + 1;
+        return false;
+    }
+    return true;
+}
+
+void CANInterfaceBase::postDiagnosticRequest(const CAN_message_t& msg) {
+    if (msg.len < 3) {
+        return;
+    }
+    // A newer request replaces one not yet answered
+    pendingDiagRequest.store(((uint32_t)hatIdSource(msg.id) << 24) | ((uint32_t)msg.buf[2] << 16) |
+                             ((uint32_t)msg.buf[1] << 8) | DIAG_REQUEST_VALID | (msg.buf[0] & 0x7F),
+                             std::memory_order_relaxed);
+}
+
+bool CANInterfaceBase::takeDiagnosticRequest(uint8_t& page, uint8_t& first, uint8_t& count, uint8_t& requester) {
+    const uint32_t request = pendingDiagRequest.exchange(0, std::memory_order_relaxed);
+    if ((request & DIAG_REQUEST_VALID) == 0) {
+        return false;
+    }
+
+    page = (uint8_t)(request & 0x7F);
+    first = (uint8_t)(request >> 8);
+    count = (uint8_t)(request >> 16);
+    requester = (uint8_t)(request >> 24);
+    if (count == 0 || count > HAT_DIAG_MAX_RECORDS) {
+        count = HAT_DIAG_MAX_RECORDS;
+    }
+    return true;
+}
+
+bool CANInterfaceBase::buildDiagnosticResponse(uint8_t page, uint8_t index, uint8_t requester,
+                                               CAN_message_t& response) const {
+    // One record per frame: [0] page, [1] index, [2-5] value, [6-7] aux
+    uint32_t value = 0;
+    uint16_t aux = 0;
+    if (!diagnostics.getRecord(page, index, value, aux)) {
+        return false;
+    }
+    response.id = encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, requester, MSG_TYPE_DIAGNOSTIC_RESP);
+    response.flags.extended = 1;
+    response.len = 8;
+    response.buf[0] = page;
+    response.buf[1] = index;
+    memcpy(response.buf + 2, &value, sizeof(value));
+    memcpy(response.buf + 6, &aux, sizeof(aux));
+    return true;
+}
+
+static_assert((HAT_CONFIG_REQUEST_QUEUE & (HAT_CONFIG_REQUEST_QUEUE - 1)) == 0 && HAT_CONFIG_REQUEST_QUEUE <= 128,
+              "HAT_CONFIG_REQUEST_QUEUE must be a power of two");
+
+void CANInterfaceBase::postConfigRequest(const CAN_message_t& msg) {
+    // Unlike diagnostics, every request is carried out; a full ring drops
+    // the new one, and the Jetson sees no answer
+    const uint8_t head = configHead.load(std::memory_order_relaxed);
+    if ((uint8_t)(head - configTail.load(std::memory_order_acquire)) >= HAT_CONFIG_REQUEST_QUEUE) {
+        droppedConfigRequests = droppedConfigRequests + 1;
+        return;
+    }
+    configRequests[head & (HAT_CONFIG_REQUEST_QUEUE - 1)] = msg;
+    configHead.store((uint8_t)(head + 1), std::memory_order_release);
+}
+
+bool CANInterfaceBase::takeConfigRequest(CAN_message_t& request) {
+    const uint8_t tail = configTail.load(std::memory_order_relaxed);
+    if (tail == configHead.load(std::memory_order_acquire)) {
+        return false;
+    }
+    request = configRequests[tail & (HAT_CONFIG_REQUEST_QUEUE - 1)];
+    configTail.store((uint8_t)(tail + 1), std::memory_order_release);
+    return true;
+}
+
+// One response frame: [0] ID, [1] status, [2] type, [3] request, [4-7] value
+static void buildConfigResponse(uint8_t requester, uint8_t request, uint8_t id, uint8_t status, int8_t index,
+                                CAN_message_t& response) {
+    response.id = encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, requester, MSG_TYPE_PARAM_RESPONSE);
+    response.flags.extended = 1;
+    response.len = 8;
+    memset(response.buf, 0, sizeof(response.buf));
+    response.buf[0] = id;
+    response.buf[1] = status;
+    response.buf[3] = request;
+    if (index >= 0) {
+        const uint32_t value = paramRegistry.getStaged((uint8_t)index);
+        response.buf[2] = ParamRegistry::info((uint8_t)index).type;
+        memcpy(response.buf + 4, &value, sizeof(value));
+    }
+}
+
+uint8_t CANInterfaceBase::handleConfigRequest(const CAN_message_t& request, CAN_message_t* responses,
+                                              uint8_t max) const {
+    const uint8_t type = hatIdType(request.id);
+    const uint8_t requester = hatIdSource(request.id);
+    const uint8_t id = type == MSG_TYPE_CONFIG_SET || type == MSG_TYPE_CONFIG_GET
+        ? (request.len > 0 ? request.buf[0] : 0) : CONFIG_ID_STORE;
+    if (max == 0) {
+        return 0;
+    }
+
+    // Changes only where the state tables allow them (nothing can move)
+    if (HATStateMachineInstance != nullptr && !HATStateMachineInstance->isCommandAllowed(type)) {
+        buildConfigResponse(requester, type, id, CONFIG_STATUS_DENIED, ParamRegistry::find(id), responses[0]);
+        return 1;
     }
 
-    Serial.println(angular_vel[0]);
+    switch (type) {
+        case MSG_TYPE_CONFIG_SET: {
+            const int8_t index = request.len >= 5 ? ParamRegistry::find(id) : -1;
+            uint32_t raw = 0;
+            memcpy(&raw, request.buf + 1, sizeof(raw));
+            const uint8_t status = index >= 0 ? paramRegistry.set((uint8_t)index, raw) : CONFIG_STATUS_UNKNOWN;
+            buildConfigResponse(requester, type, id, status, index, responses[0]);
+            return 1;
+        }
 
+        case MSG_TYPE_CONFIG_GET: {
+            uint8_t count = request.len > 1 ? request.buf[1] : 0;
+            if (count == 0 || count > max) {
+                count = max;
+            }
+            uint8_t filled = 0;
+            for (uint8_t index = 0; index < HAT_PARAM_COUNT && filled < count; ++index) {
+                const uint8_t paramId = ParamRegistry::info(index).id;
+                if (paramId >= id) {
+                    buildConfigResponse(requester, type, paramId, CONFIG_STATUS_OK, (int8_t)index, responses[filled++]);
+                }
+            }
+            if (filled == 0) {
+                buildConfigResponse(requester, type, id, CONFIG_STATUS_UNKNOWN, -1, responses[filled++]);
+            }
+            return filled;
+        }
+
+        case MSG_TYPE_CONFIG_SAVE: {
+            // Answered by takeSaveResponse() once the image is written
+            const uint8_t status = paramRegistry.save(link, requester);
+            if (status == CONFIG_STATUS_OK) {
+                return 0;
+            }
+            buildConfigResponse(requester, type, id, status, -1, responses[0]);
+            return 1;
+        }
+
+        case MSG_TYPE_CONFIG_LOAD: {
+            uint8_t status = CONFIG_STATUS_OK;
+            if (request.len > 0 && request.buf[0] == CONFIG_LOAD_DEFAULTS) {
+                paramRegistry.loadDefaults();
+            } else {
+                status = paramRegistry.load();
+            }
+            buildConfigResponse(requester, type, id, status, -1, responses[0]);
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
 
+bool CANInterfaceBase::takeSaveResponse(CAN_message_t& response) const {
+    uint8_t requester = 0;
+    uint8_t status = CONFIG_STATUS_OK;
+    if (!paramRegistry.takeSaveResult(link, requester, status)) {
+        return false;
+    }
+    buildConfigResponse(requester, MSG_TYPE_CONFIG_SAVE, CONFIG_ID_STORE, status, -1, response);
     return true;
-}
\ No newline at end of file
+}
+
+uint32_t CANInterfaceBase::getDroppedConfigCount() const {
+    return droppedConfigRequests;
+}
+
+void CANInterfaceBase::countTx(const CAN_message_t& msg, bool ok) {
+    diagnostics.countTx(diagBus, msg.id, msg.flags.extended, msg.len, ok);
+}
+
+uint32_t CANInterfaceBase::getUnroutedCount() const {
+    return unroutedFrames;
+}
+
+const FilterPlan_t& CANInterfaceBase::getFilterPlan() const {
+    return filterPlan;
+}
+
+const FilterPlan_t& CANInterfaceBase::getExtFilterPlan() const {
+    return extFilterPlan;
+}
+
+uint8_t CANInterfaceBase::getDedicatedMailboxCount() const {
+    return dedicatedMailboxes;
+}
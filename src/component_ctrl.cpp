@@ -8,35 +8,204 @@
 #include "component_ctrl.h"
 #include "hat_config.h"
 #include "hardware_map.h"
+#include "hat_profile.h"
 #include "ACAN2517FD.h"
-#include "hardware_map.h"
 #include "can_interface.h"
+#include "trace.h"
+#include "filter_planner.h"
+#include "diagnostics.h"
+#include "state_machine.h"
 #include "Arduino.h"
 
+// MCP2517FD C1TREC: transmitter bus-off (DS20005688, Register 3-18)
+#define MCP_TREC_TXBO (1UL << 21)
+
 ACAN2517FD* canController = nullptr; //Pointer to the component pin for dynamic initialization
+MCP2517FDTransport* periphTransport = nullptr;  // Transmit and receive FIFO traffic, see initialize()
+
+// For the FlexCAN emergency stop handler
+ComponentController *ComponentControllerInstance = nullptr;
+
+// C++14 needs the out-of-line definition once the table is indexed at run time
+constexpr HatWheel_t DriveHatProfile::wheels[];
+constexpr uint32_t DriveHatProfile::compactCommandIds[];
+constexpr uint32_t DriveHatProfile::compactEncoderIds[];
+
+// CAN FD data phase: arbitration at CAN_BAUDRATE, data at CAN_FD_BAUDRATE.
+// The HAT's 20 MHz MCP2517FD crystal tops out at x4; x8 needs 40 MHz.
+static_assert(CAN_FD_DATA_BITRATE_FACTOR == 1 || CAN_FD_DATA_BITRATE_FACTOR == 2 ||
+              CAN_FD_DATA_BITRATE_FACTOR == 4,
+              "CAN_FD_BAUDRATE must be 1, 2 or 4 times CAN_BAUDRATE with the 20 MHz oscillator");
+static const ACAN2517FDSettings::DataBitRateFactor FD_DATA_BITRATE_FACTOR =
+    static_cast<ACAN2517FDSettings::DataBitRateFactor>(CAN_FD_DATA_BITRATE_FACTOR);
+
+// MCP2517FD INT, attached LOW by the library; the transport masks and
+// re-attaches it while the SPI bus is claimed
+static void periphInterrupt() {
+    const uint32_t start = ARM_DWT_CYCCNT;
+    periphTransport->isr();
+    diagnostics.recordIsr(DIAG_ISR_PERIPH, ARM_DWT_CYCCNT - start);
+}
+
+static bool isBitRateSwitched(const CANFDMessage &msg) {
+    return msg.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH;
+}
+
+// ODrive encoder feedback, filled by drainReceive()
+DriveTelemetryStore driveTelemetry;
+TelemetryAggregator telemetryAggregator;
 
-ComponentController::ComponentController() {
-    // Constructor implementation
+// Peripheral bus message handlers - run from drainReceive() in loop context
+// The stores and this table are per build, so they follow HatProfile
+static void onEncoderEstimates(const CANFDMessage &msg, uint8_t arg) {
+    float pos = 0.0f;
+    float vel = 0.0f;
+    if (!parseEncoderEstimatesMsg(msg, pos, vel)) {
+        return;
+    }
+
+    const uint8_t node = odriveIdNode(msg.id);
+    const int8_t driveWheel = driveWheelOfNode(node);
+    const int8_t steerWheel = steerWheelOfNode(node);
+    if (driveWheel >= 0) {
+        driveTelemetry.recordDrive((uint8_t)driveWheel, pos, vel);
+        telemetryAggregator.record((uint8_t)(TELEMETRY_SIGNAL_DRIVE_VEL + driveWheel), vel);
+    } else if (steerWheel >= 0) {
+        driveTelemetry.recordSteer((uint8_t)steerWheel, pos);
+        telemetryAggregator.record((uint8_t)(TELEMETRY_SIGNAL_STEER_ANGLE + steerWheel), pos);
+    }
 }
 
-ComponentController::~ComponentController() {
+// ODrive command -> handler table, generated from PERIPH_ODRIVE_MESSAGES
+typedef CanDispatchTable<CANFDMessage, ODRIVE_CMD_COUNT, PERIPH_ODRIVE_MESSAGE_COUNT> PeriphDispatchTable;
+
+#define PERIPH_MESSAGE_ROUTE(name, cmd, handler, arg) { (cmd), (handler), (arg) },
+static constexpr PeriphDispatchTable::Route PERIPH_ROUTES[] = {
+    PERIPH_ODRIVE_MESSAGES(PERIPH_MESSAGE_ROUTE)
+};
+#undef PERIPH_MESSAGE_ROUTE
+
+static constexpr PeriphDispatchTable periphDispatch(PERIPH_ROUTES);
+
+static const SetpointTuning_t DEFAULT_TUNING = {
+    HAT_SETPOINT_VEL_EPSILON, HAT_SETPOINT_POS_EPSILON, HAT_SETPOINT_REFRESH_MS,
+    HAT_SETPOINT_STALE_MS, HAT_SETPOINT_STALE_DECEL
+};
+
+template <typename Profile>
+ComponentControllerT<Profile>::ComponentControllerT()
+    : txState(), setpointReceived(), setpointStale(), outputVelocity(), lastUpdateMicros(0), shaper(),
+      tuning(DEFAULT_TUNING), shaping(HAT_SETPOINT_SHAPING), spiBatching(HAT_PERIPH_SPI_BATCHED), txQueue(), framesSuppressed(0), framesFailed(0),
+      framesReceived(0), framesUnrouted(0), filterPlan(), estopLatched(false),
+      estopFramesSent(0), estopFramesFailed(0), estopHandled(false) {
+    ComponentControllerInstance = this;
+    buildDriveFrameTable();
+
+    // Nothing from the Jetson yet
+    for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+        setpointStale[i] = true;
+        shaper.setLimits(i, Profile::wheels[i].limits);
+    }
+}
+
+template <typename Profile>
+ComponentControllerT<Profile>::~ComponentControllerT() {
     // Destructor implementation
 }
 
-bool ComponentController::initialize() {
+template <typename Profile>
+void ComponentControllerT<Profile>::setSpiBatching(bool batched) {
+    spiBatching = batched;
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::initialize() {
     SPI.begin();
+    // The FlexCAN interrupt of every Jetson link sends emergency stops on
+    // this SPI bus, so each is held off for the duration of every other
+    // transaction
+    SPI.usingInterrupt(flexcanIrq(HAT_JETSON_CAN_BUS));
+    #if HAT_JETSON_AUX_ENABLED
+    SPI.usingInterrupt(flexcanIrq(HAT_JETSON_AUX_CAN_BUS));
+    #endif
+    // Likewise the MCP2517FD interrupt, so a receive drain never finds a
+    // transmit batch in the middle of its DMA transfers
+    SPI.usingInterrupt(digitalPinToInterrupt(INT_PIN));
     canController = new ACAN2517FD(SPI_CS, SPI, INT_PIN);
 
+    // Setpoints and ODrive feedback go through the transport, which
+    // batches them once the library has configured the FIFOs
+    periphTransport = new MCP2517FDTransport(*canController, SPI_CS, SPI, INT_PIN, periphInterrupt);
+
+    // Accept only the ODrive commands we handle, and only from our nodes
+    uint32_t ids[PERIPH_ODRIVE_MESSAGE_COUNT * 2 * Profile::wheelCount];
+    uint8_t idCount = 0;
+    for (size_t i = 0; i < periphDispatch.size(); ++i) {
+        const uint8_t cmd = (uint8_t)periphDispatch.keyAt(i);
+        for (uint8_t wheel = 0; wheel < Profile::wheelCount; ++wheel) {
+            ids[idCount++] = encodeODriveId(cmd, Profile::wheels[wheel].driveNode);
+            ids[idCount++] = encodeODriveId(cmd, Profile::wheels[wheel].steerNode);
+        }
+    }
+    planFilters(ids, idCount, 11, HAT_PERIPH_RX_FILTERS, filterPlan);
+    reportFilterPlan("peripheral", filterPlan, 0);
+
+    // Everything this bus receives or sends is counted per ID
+    diagnostics.setBitRate(DIAG_BUS_PERIPH, CAN_BAUDRATE, CAN_FD_DATA_BITRATE_FACTOR);
+    for (uint8_t i = 0; i < idCount; ++i) {
+        diagnostics.registerId(DIAG_BUS_PERIPH, ids[i], false);
+    }
+    for (uint8_t i = 0; i < frameCount; ++i) {
+        diagnostics.registerId(DIAG_BUS_PERIPH, driveFrames[i].id, driveFrames[i].ext);
+        diagnostics.registerId(DIAG_BUS_PERIPH, estopFrames[i].id, estopFrames[i].ext);
+    }
+    diagnostics.registerId(DIAG_BUS_PERIPH,
+                           encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, CAN_BROADCAST_ADDR, MSG_TYPE_PACKED_SETPOINTS),
+                           true);
+
+    return startController();
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::startController() {
     ACAN2517FDSettings settings (ACAN2517FDSettings::OSC_20MHz,
-                               CAN_BAUDRATE, ACAN2517FDSettings::DATA_BITRATE_x1) ;
+                               CAN_BAUDRATE, FD_DATA_BITRATE_FACTOR) ;
 
     //settings.mRequestedMode = ACAN2517FDSettings::InternalLoopBack;
 
-    const uint32_t errorCode = canController->begin(settings, [] { canController->isr(); }) ;
+    // The interrupt moves whole batches from the controller FIFO into this
+    // buffer; drainReceive() empties it every drive cycle
+    settings.mDriverReceiveFIFOSize = HAT_PERIPH_RX_BUFFER_SIZE;
+
+    // ODrive feedback is classic CAN: 8-byte objects keep a receive burst
+    // at 16 bytes per frame, and the receive FIFO within message RAM
+    settings.mControllerReceiveFIFOPayload = ACAN2517FDSettings::PAYLOAD_8;
+
+    // Outgoing frames wait in txQueue, where they can still be coalesced or
+    // dropped; the controller only ever holds one set of setpoints
+    settings.mDriverTransmitFIFOSize = 0;
+    settings.mControllerTransmitFIFOSize = HAT_PERIPH_TX_HW_DEPTH;
+    settings.mControllerTransmitFIFOPriority = 0;
+
+    // Emergency stops use the TXQ, which the controller serves first
+    settings.mControllerTXQSize = HAT_PERIPH_TXQ_DEPTH;
+    settings.mControllerTXQBufferPriority = 31;
+
+    ACAN2517FDFilters filters;
+    for (uint8_t i = 0; i < filterPlan.count; ++i) {
+        filters.appendFilter(ACAN2517FDFilters::kStandard, filterPlan.filters[i].mask,
+                             filterPlan.filters[i].id, nullptr);
+    }
+
+    const uint32_t errorCode = canController->begin(settings, periphInterrupt, filters) ;
 
     if (errorCode != 0) {
     Serial.print("ACAN error: 0x");
     Serial.println(errorCode, HEX);
+    } else if (!periphTransport->begin(spiBatching) && spiBatching) {
+        #if HAT_DEBUG_ENABLED
+        Serial.println("MCP2517FD FIFOs not found, SPI per frame");
+        #endif
     }
 
     bool returnable = (errorCode == 0);
@@ -45,51 +214,450 @@ bool ComponentController::initialize() {
     
 }
 
-void ComponentController::update(std::array<CANFDMessage, 8> msg) {
-    // Velocity control
-    const uint8_t nodeMapDrive[4] = {
-        NODE_DRIVE_FL,
-        NODE_DRIVE_FR,
-        NODE_DRIVE_RL,
-        NODE_DRIVE_RR
-    };
+template <typename Profile>
+bool ComponentControllerT<Profile>::readBusErrors(BusErrorState_t& state) {
+    // Library register reads: never in the middle of a transmit batch, and
+    // one bus claim each so the receive interrupt is held off briefly
+    if (canController == nullptr || !periphTransport->acquireBus()) {
+        return false;
+    }
+    const uint32_t trec = canController->errorCounters();
+    periphTransport->releaseBus();
+    if (!periphTransport->acquireBus()) {
+        return false;
+    }
+    const ACAN2517FDSettings::OperationMode mode = canController->currentOperationMode();
+    periphTransport->releaseBus();
+
+    // C1TREC: REC in 7:0, TEC in 15:8, TXBO in bit 21
+    state.rec = (uint8_t)trec;
+    state.tec = (uint8_t)(trec >> 8);
+    state.busOff = (trec & MCP_TREC_TXBO) != 0;
+    state.offline = mode != ACAN2517FDSettings::NormalFD && mode != ACAN2517FDSettings::Normal20B;
+    return true;
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::recoverBus(uint8_t action) {
+    if (canController == nullptr || !periphTransport->acquireBus()) {
+        return false;
+    }
+
+    // Restricted operation (after a system error) is the one mode the
+    // library can leave in place; anything else takes a new begin(). That
+    // waits on the oscillator and mode changes, so it runs unclaimed, with
+    // the FIFOs handed back to the library first and no batch in flight.
+    bool ok;
+    if (action == BUS_ACTION_RESTART) {
+        ok = canController->recoverFromRestrictedOperationMode();
+        periphTransport->releaseBus();
+    } else {
+        periphTransport->suspend();
+        periphTransport->releaseBus();
+        canController->end();
+        ok = startController();
+    }
+
+    BusErrorState_t state;
+    if (!ok || !readBusErrors(state) || state.busOff || state.offline) {
+        return false;
+    }
+
+    // The setpoint store is untouched; every setpoint goes out again on the
+    // next cycle, as the controller may have dropped what it held. A stop
+    // latched meanwhile is sent again the same way.
+    for (uint8_t slot = 0; slot < frameCount; ++slot) {
+        txState[slot].sentOnce = false;
+    }
+    if (estopLatched.load(std::memory_order_acquire)) {
+        emergencyStop();
+        estopHandled = false;
+    }
+    return true;
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::buildDriveFrameTable() {
+    for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+        driveFrames[velocitySlot(i)] = buildVelocityMsg(Profile::wheels[i].driveNode, 0.0f, 0.0f);
+        driveFrames[positionSlot(i)] = buildPositionMsg(Profile::wheels[i].steerNode, 0.0f, 0.0f);
+        estopFrames[velocitySlot(i)] = buildEstopMsg(Profile::wheels[i].driveNode);
+        estopFrames[positionSlot(i)] = buildEstopMsg(Profile::wheels[i].steerNode);
+    }
+    for (uint8_t i = 0; i < frameCount; ++i) {
+        estopFrames[i].idx = 255;   // ACAN2517FD: send through the TXQ
+    }
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::shouldSend(const SetpointTxState_t& state, float value, float epsilon,
+                                     uint32_t nowMicros) const {
+    if (!state.sentOnce) {
+        return true;
+    }
+    // Written so a NaN always counts as a change
+    if (!(fabsf(value - state.lastSentValue) <= epsilon)) {
+        return true;
+    }
+    return (nowMicros - state.lastSentMicros) >= (uint32_t)tuning.refreshMs * 1000UL;
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::sendSetpoint(uint8_t slot, float value, float epsilon, uint32_t nowMicros) {
+    SetpointTxState_t& state = txState[slot];
+
+    if (!shouldSend(state, value, epsilon, nowMicros)) {
+        framesSuppressed++;
+        return;
+    }
+
+    // Patch the setpoint in place; the rest of the frame never changes.
+    // A setpoint still queued for this node and command is replaced.
+    CANFDMessage& frame = driveFrames[slot];
+    floatToBytes(value, frame.data);
+
+    if (txQueue.enqueue(frame, TX_CLASS_DRIVE, nowMicros + HAT_PERIPH_TX_SETPOINT_DEADLINE_US, true, slot)) {
+        state.lastSentValue = value;
+        state.lastSentMicros = nowMicros;
+        state.sentOnce = true;
+    } else {
+        // Left dirty, so it is retried next cycle
+        framesFailed++;
+    }
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::checkFreshness(uint8_t wheel, uint32_t receivedMicros, uint32_t nowMicros) {
+    // A new arrival clears the latch; once stale, the age is no longer
+    // trusted, as it wraps with micros() after ~71 minutes
+    if (receivedMicros != setpointReceived[wheel]) {
+        setpointReceived[wheel] = receivedMicros;
+        setpointStale[wheel] = false;
+    }
+    const uint32_t age = nowMicros - receivedMicros;
+    if (!setpointStale[wheel] && age > (uint32_t)tuning.staleMs * 1000UL) {
+        setpointStale[wheel] = true;
+    }
+    diagnostics.recordSetpointAge(wheel, age, setpointStale[wheel]);
+    return !setpointStale[wheel];
+}
+
+template <typename Profile>
+float ComponentControllerT<Profile>::staleVelocity(uint8_t wheel, uint32_t elapsedMicros) const {
+#if HAT_SETPOINT_STALE_POLICY == HAT_STALE_POLICY_RAMP
+    const float step = tuning.staleDecel * (float)elapsedMicros * 1e-6f;
+    const float velocity = outputVelocity[wheel];
+    if (velocity > step) {
+        return velocity - step;
+    }
+    if (velocity < -step) {
+        return velocity + step;
+    }
+    return 0.0f;
+#else
+    return 0.0f;
+#endif
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::placeSteering(uint8_t wheel) {
+    // The first shaped move starts from where the steering is, or else from
+    // what it was last told
+    float measured = 0.0f;
+    if (driveTelemetry.getSteerPosition(wheel, measured)) {
+        shaper.setPosition(wheel, measured);
+    } else if (txState[positionSlot(wheel)].sentOnce) {
+        shaper.setPosition(wheel, txState[positionSlot(wheel)].lastSentValue);
+    }
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::update(const DriveSetpoints_t& setpoints) {
+    // setpoints is one consistent snapshot of all four wheels
+    const uint32_t now = micros();
+    const uint32_t elapsed = now - lastUpdateMicros;
+    lastUpdateMicros = now;
+
+    if (estopLatched.load(std::memory_order_acquire)) {
+        holdEmergencyStop(now);
+        return;
+    }
+
+    // Setpoints that expired in the queue never reached the ODrive: resend
+    const uint32_t expired = txQueue.takeExpiredTags();
+    for (uint8_t slot = 0; slot < frameCount; ++slot) {
+        if (expired & (1UL << slot)) {
+            txState[slot].sentOnce = false;
+        }
+    }
+
+    bool anyFresh = false;
+    for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+        float position = setpoints.steering_angle[i];
+        if (setpoints.received_us[i] == 0) {
+            // No setpoint yet, or dropped on leaving POWER_ARMED: steering
+            // holds what it was last told rather than snapping to 0 rad
+            position = txState[positionSlot(i)].lastSentValue;
+        }
+        const bool fresh = checkFreshness(i, setpoints.received_us[i], now);
+        anyFresh = anyFresh || fresh;
+        if (!fresh && HAT_SETPOINT_STALE_POLICY == HAT_STALE_POLICY_SUPPRESS) {
+            continue;
+        }
 
-    const uint8_t nodeMapSteer[4] = {
-        NODE_STEER_FL,
-        NODE_STEER_FR,
-        NODE_STEER_RL,
-        NODE_STEER_RR
-    };
+        if (shaping && setpoints.received_us[i] != 0) {
+            if (!shaper.isPrimed(i)) {
+                placeSteering(i);
+            }
+            // Steering goes on toward the last setpoint even once stale
+            shaper.track(i, setpoints.angular_vel[i], position, setpoints.received_us[i], now);
+            shaper.step(i, now, elapsed);
+            position = shaper.getPosition(i);
+        }
 
+        if (!fresh) {
+            // Steering keeps its last position while the wheel slows down
+            outputVelocity[i] = staleVelocity(i, elapsed);
+            shaper.setVelocity(i, outputVelocity[i]);
+        } else if (shaping) {
+            outputVelocity[i] = shaper.getVelocity(i);
+        } else {
+            outputVelocity[i] = setpoints.angular_vel[i];
+        }
+        sendSetpoint(velocitySlot(i), outputVelocity[i], tuning.velocityEpsilon, now);
+        sendSetpoint(positionSlot(i), position, tuning.positionEpsilon, now);
+    }
 
-    for (int i = 0; i < 4; ++i) {
+    if (txQueue.flush(*periphTransport, now) > 0 && anyFresh) {
+        diagnostics.markBoot(DIAG_BOOT_FIRST_FORWARD, now);
+    }
+}
 
-        CANFDMessage vel = buildVelocityMsg(
-            nodeMapDrive[i],
-            angular_vel[i],
-            0.0f
-        );
+template <typename Profile>
+uint8_t ComponentControllerT<Profile>::drainReceive(uint8_t maxFrames) {
+    uint8_t drained = 0;
+    CANFDMessage frame;
 
-        delay(1);
+    while (drained < maxFrames && periphTransport->receive(frame)) {
+        drained++;
+        framesReceived++;
+        TRACE_FRAME(TRACE_EVENT_PERIPH_RX, frame.id, frame.data, frame.len);
+        diagnostics.countRx(DIAG_BUS_PERIPH, frame.id, frame.ext, frame.len, isBitRateSwitched(frame));
 
-        bool ok_vel = canController->tryToSend(vel);
-        if (!ok_vel) {
-            Serial.println("CAN TX Failure");
+        if (frame.ext || !periphDispatch.dispatch(odriveIdCmd(frame.id), frame)) {
+            framesUnrouted++;
         }
+    }
+    return drained;
+}
 
-        CANFDMessage pos = buildPositionMsg(
-            nodeMapSteer[i],
-            steering_angle[i],
-            0.0f
-        );
+template <typename Profile>
+bool ComponentControllerT<Profile>::sendPackedSetpoints(const PackedSetpoint_t* entries, uint8_t count) {
+    // Only for peripherals that accept packed frames - ODrives stay on
+    // buildVelocityMsg/buildPositionMsg. Chunks share one ID, so they are
+    // queued without coalescing.
+    if (estopLatched.load(std::memory_order_acquire)) {
+        return false;
+    }
+    const uint32_t now = micros();
+    bool ok = true;
+    while (count > 0) {
+        const uint8_t chunk = count < PACKED_SETPOINT_MAX_ENTRIES ? count : PACKED_SETPOINT_MAX_ENTRIES;
+        CANFDMessage packed = buildPackedSetpointMsg(entries, chunk);
+        if (!txQueue.enqueue(packed, TX_CLASS_DRIVE, now + HAT_PERIPH_TX_SETPOINT_DEADLINE_US, false)) {
+            ok = false;
+        }
+        entries += chunk;
+        count -= chunk;
+    }
+    txQueue.flush(*periphTransport, now);
+    return ok;
+}
 
-        bool ok_pos = canController->tryToSend(pos);
-        if (!ok_pos) {
-            Serial.println("CAN TX Failure");
+template <typename Profile>
+void ComponentControllerT<Profile>::emergencyStop() {
+    // Interrupt context: only the latch and the TXQ, never txQueue. A repeated
+    // stop message resends the Estops, in case the TXQ was full last time.
+    estopLatched.store(true, std::memory_order_release);
+    if (canController == nullptr) {
+        return;
+    }
+    for (uint8_t i = 0; i < frameCount; ++i) {
+        const CANFDMessage& frame = estopFrames[i];
+        const bool ok = canController->tryToSend(frame);
+        diagnostics.countTx(DIAG_BUS_PERIPH, frame.id, frame.ext, frame.len, ok);
+        if (ok) {
+            estopFramesSent.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            estopFramesFailed.fetch_add(1, std::memory_order_relaxed);
+            TRACE_ERROR(TRACE_EVENT_PERIPH_TX_FAIL, frame.id, frame.data, frame.len);
         }
     }
 }
 
-void ComponentController::emergencyStop() {
-    // Emergency stop all components
-}
\ No newline at end of file
+template <typename Profile>
+bool ComponentControllerT<Profile>::clearEmergencyStop() {
+    // The stop handler latches before it moves the state machine, in one
+    // interrupt, so with interrupts off both are seen or neither is
+    noInterrupts();
+    const bool stopped = HATStateMachineInstance == nullptr ||
+                         HATStateMachineInstance->getCurrentState() == STATE_EMERGENCY_STOP;
+    if (!stopped) {
+        estopLatched.store(false, std::memory_order_release);
+    }
+    interrupts();
+    if (stopped) {
+        return false;
+    }
+
+    // Zero velocity was the last drive command; every setpoint goes out again
+    estopHandled = false;
+    for (uint8_t slot = 0; slot < frameCount; ++slot) {
+        txState[slot].sentOnce = false;
+    }
+    return true;
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::holdEmergencyStop(uint32_t nowMicros) {
+    // Once per latch: drop every queued setpoint, in txQueue and in the
+    // controller's transmit FIFO, and leave zero velocity as the last drive
+    // command, so nothing moves when the axes are re-armed. The FIFO goes
+    // first or its setpoints would follow the Estops onto the wire; while a
+    // batch holds the bus that waits for the next cycle.
+    if (!estopHandled) {
+        txQueue.clear();
+        if (!periphTransport->abortTransmit()) {
+            return;
+        }
+        for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+            txQueue.enqueue(buildVelocityMsg(Profile::wheels[i].driveNode, 0.0f, 0.0f), TX_CLASS_EMERGENCY,
+                            nowMicros + HAT_PERIPH_TX_SETPOINT_DEADLINE_US, false);
+            outputVelocity[i] = 0.0f;
+            shaper.setVelocity(i, 0.0f);
+        }
+        estopHandled = true;
+    }
+    txQueue.flush(*periphTransport, nowMicros);
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::isSetpointStale(uint8_t wheel) const {
+    return wheel < Profile::wheelCount && setpointStale[wheel];
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::setSetpointShaping(bool enabled) {
+    // Shaping picks up from what was last commanded
+    if (enabled && !shaping) {
+        for (uint8_t i = 0; i < Profile::wheelCount; ++i) {
+            shaper.setVelocity(i, outputVelocity[i]);
+        }
+    }
+    shaping = enabled;
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::isSetpointShaping() const {
+    return shaping;
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::setWheelLimits(uint8_t wheel, const WheelLimits_t& limits) {
+    if (wheel < Profile::wheelCount) {
+        shaper.setLimits(wheel, limits);
+    }
+}
+
+template <typename Profile>
+const SetpointShaper& ComponentControllerT<Profile>::getSetpointShaper() const {
+    return shaper;
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::setSetpointTuning(const SetpointTuning_t& newTuning) {
+    tuning = newTuning;
+    diagnostics.setSetpointStaleLimit(newTuning.staleMs);
+}
+
+template <typename Profile>
+const SetpointTuning_t& ComponentControllerT<Profile>::getSetpointTuning() const {
+    return tuning;
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::isEmergencyStopped() const {
+    return estopLatched.load(std::memory_order_acquire);
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getEstopFramesSent() const {
+    return estopFramesSent.load(std::memory_order_relaxed);
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getEstopFramesFailed() const {
+    return estopFramesFailed.load(std::memory_order_relaxed);
+}
+
+template <typename Profile>
+void ComponentControllerT<Profile>::recordQueueDepths() {
+    diagnostics.recordQueueDepth(DIAG_QUEUE_PERIPH_RX, periphTransport->getReceivePeakCount(),
+                                 HAT_PERIPH_RX_BUFFER_SIZE);
+    diagnostics.recordQueueDepth(DIAG_QUEUE_PERIPH_TX, txQueue.getPeakCount(), HAT_PERIPH_TX_QUEUE_SIZE);
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getFramesSent() const {
+    return txQueue.getSentCount();
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getFramesSuppressed() const {
+    return framesSuppressed;
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getFramesFailed() const {
+    return framesFailed;
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getFramesCoalesced() const {
+    return txQueue.getCoalescedCount();
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getFramesExpired() const {
+    return txQueue.getExpiredCount();
+}
+
+template <typename Profile>
+bool ComponentControllerT<Profile>::isSpiBatched() const {
+    return periphTransport != nullptr && periphTransport->isBatched();
+}
+
+template <typename Profile>
+SpiTransportStats_t ComponentControllerT<Profile>::getSpiStats() const {
+    if (periphTransport == nullptr) {
+        return SpiTransportStats_t();
+    }
+    return periphTransport->getStats();
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getFramesReceived() const {
+    return framesReceived;
+}
+
+template <typename Profile>
+uint32_t ComponentControllerT<Profile>::getFramesUnrouted() const {
+    return framesUnrouted;
+}
+
+template <typename Profile>
+const FilterPlan_t& ComponentControllerT<Profile>::getFilterPlan() const {
+    return filterPlan;
+}
+
+template class ComponentControllerT<HatProfile>;
@@ -0,0 +1,386 @@
+/**
+ * @file diagnostics.cpp
+ * @brief Bridge metrics: per-ID counters, bus load, ISR timing, queue peaks, setpoint ages
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "diagnostics.h"
+#include "bus_supervisor.h"
+#include "message_construction.h"
+#include "Arduino.h"
+
+static_assert((HAT_DIAG_HASH_SLOTS & (HAT_DIAG_HASH_SLOTS - 1)) == 0,
+              "HAT_DIAG_HASH_SLOTS must be a power of two");
+static_assert(HAT_DIAG_MAX_IDS < HAT_DIAG_HASH_SLOTS && HAT_DIAG_MAX_IDS < 255,
+              "HAT_DIAG_MAX_IDS must be below HAT_DIAG_HASH_SLOTS and 255");
+
+static const uint32_t DIAG_HASH_MASK = HAT_DIAG_HASH_SLOTS - 1;
+static const uint32_t DIAG_KEY_PERIPH = 0x80000000u;
+static const uint32_t DIAG_KEY_EXTENDED = 0x40000000u;
+static const uint8_t DIAG_RECORDS_PER_BUS = 3;
+static const uint8_t DIAG_RECORDS_PER_WHEEL = 3;
+
+BridgeDiagnostics diagnostics;
+
+static uint32_t hashKey(uint32_t key) {
+    return (key * 2654435761u) >> 16;
+}
+
+static uint16_t saturate16(uint32_t value) {
+    return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+BridgeDiagnostics::BridgeDiagnostics()
+    : ids(), idCount(0), slots(), buses(), isrs(), queuePeak(), queueCapacity(), setpointAges(),
+      setpointStaleMs(HAT_SETPOINT_STALE_MS), bootMicros(), windowStartMicros(0), windowOpen(false) {
+}
+
+uint32_t BridgeDiagnostics::makeKey(uint8_t bus, uint32_t id, bool extended) {
+    // HAT extended IDs are counted by target and type only
+    if (extended) {
+        id &= 0xFFFF;
+    }
+    return (bus == DIAG_BUS_PERIPH ? DIAG_KEY_PERIPH : 0) | (extended ? DIAG_KEY_EXTENDED : 0) |
+           (id & CAN_EXT_ID_MASK);
+}
+
+int BridgeDiagnostics::findIndex(uint32_t key) const {
+    uint32_t slot = hashKey(key) & DIAG_HASH_MASK;
+    for (uint32_t probe = 0; probe < HAT_DIAG_HASH_SLOTS; probe++) {
+        const uint8_t entry = slots[slot].load(std::memory_order_acquire);
+        if (entry == 0) {
+            return -1;
+        }
+        if (ids[entry - 1].key == key) {
+            return entry - 1;
+        }
+        slot = (slot + 1) & DIAG_HASH_MASK;
+    }
+    return -1;
+}
+
+bool BridgeDiagnostics::registerId(uint8_t bus, uint32_t id, bool extended) {
+    const uint32_t key = makeKey(bus, id, extended);
+    if (findIndex(key) >= 0) {
+        return true;
+    }
+    const uint8_t index = idCount.load(std::memory_order_relaxed);
+    if (index >= HAT_DIAG_MAX_IDS) {
+        return false;
+    }
+
+    // Fill the entry first; publishing the slot makes it visible to the ISR
+    ids[index].key = key;
+    idCount.store(index + 1, std::memory_order_relaxed);
+    uint32_t slot = hashKey(key) & DIAG_HASH_MASK;
+    while (slots[slot].load(std::memory_order_relaxed) != 0) {
+        slot = (slot + 1) & DIAG_HASH_MASK;
+    }
+    slots[slot].store(index + 1, std::memory_order_release);
+    return true;
+}
+
+void BridgeDiagnostics::setBitRate(uint8_t bus, uint32_t nominalBitRate, uint8_t dataBitRateFactor) {
+    if (bus < DIAG_BUS_COUNT) {
+        buses[bus].bitRate = nominalBitRate;
+        buses[bus].dataFactor = dataBitRateFactor > 0 ? dataBitRateFactor : 1;
+    }
+}
+
+uint32_t BridgeDiagnostics::frameBits(uint8_t bus, uint8_t len, bool extended, bool fd) const {
+    // Worst-case stuffing, in bit times at the nominal rate
+    const uint32_t idBits = extended ? 29 + 2 : 11;
+    if (!fd) {
+        const uint32_t stuffable = 23 + idBits + 8u * len;
+        return stuffable + stuffable / 4 + 13;
+    }
+    const uint32_t nominalBits = 1 + idBits + 5 + 12;
+    const uint32_t crcBits = len > 16 ? 21 : 17;
+    const uint32_t dataBits = 1 + 4 + 8u * len + 4 + crcBits + 1;
+    return nominalBits + nominalBits / 5 + (dataBits + dataBits / 5) / buses[bus].dataFactor;
+}
+
+void BridgeDiagnostics::countRx(uint8_t bus, uint32_t id, bool extended, uint8_t len, bool fd) {
+    if (bus >= DIAG_BUS_COUNT) {
+        return;
+    }
+    buses[bus].wireBits.fetch_add(frameBits(bus, len, extended, fd), std::memory_order_relaxed);
+
+    const int index = findIndex(makeKey(bus, id, extended));
+    if (index >= 0) {
+        ids[index].rx.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        buses[bus].otherRx.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void BridgeDiagnostics::countTx(uint8_t bus, uint32_t id, bool extended, uint8_t len, bool ok, bool fd) {
+    if (bus >= DIAG_BUS_COUNT) {
+        return;
+    }
+    if (ok) {
+        buses[bus].wireBits.fetch_add(frameBits(bus, len, extended, fd), std::memory_order_relaxed);
+    } else {
+        buses[bus].txFailed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const int index = findIndex(makeKey(bus, id, extended));
+    if (index < 0) {
+        buses[bus].otherTx.fetch_add(1, std::memory_order_relaxed);
+    } else if (ok) {
+        ids[index].tx.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        ids[index].txFailed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void BridgeDiagnostics::recordIsr(uint8_t isr, uint32_t cycles) {
+    if (isr >= DIAG_ISR_COUNT) {
+        return;
+    }
+    IsrHistogram_t& histogram = isrs[isr];
+
+    const int log2 = cycles > 0 ? 31 - __builtin_clz(cycles) : 0;
+    int bucket = log2 - DIAG_ISR_BUCKET_SHIFT;
+    bucket = bucket < 0 ? 0 : (bucket >= DIAG_ISR_BUCKETS ? DIAG_ISR_BUCKETS - 1 : bucket);
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t seen = histogram.maxCycles.load(std::memory_order_relaxed);
+    while (cycles > seen &&
+           !histogram.maxCycles.compare_exchange_weak(seen, cycles, std::memory_order_relaxed)) {
+    }
+}
+
+void BridgeDiagnostics::recordQueueDepth(uint8_t queue, uint16_t depth, uint16_t capacity) {
+    if (queue >= DIAG_QUEUE_COUNT) {
+        return;
+    }
+    queueCapacity[queue] = capacity;
+    uint16_t seen = queuePeak[queue].load(std::memory_order_relaxed);
+    while (depth > seen &&
+           !queuePeak[queue].compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {
+    }
+}
+
+void BridgeDiagnostics::setSetpointStaleLimit(uint16_t staleMs) {
+    setpointStaleMs = staleMs;
+}
+
+void BridgeDiagnostics::recordSetpointAge(uint8_t wheel, uint32_t ageMicros, bool stale) {
+    if (wheel >= DRIVE_WHEEL_COUNT) {
+        return;
+    }
+    SetpointAge_t& age = setpointAges[wheel];
+    if (stale) {
+        age.staleCycles++;
+        if (!age.stale) {
+            age.staleEvents++;
+        }
+    } else {
+        age.totalAgeMicros += ageMicros;
+        age.freshCycles++;
+        if (ageMicros > age.maxAgeMicros) {
+            age.maxAgeMicros = ageMicros;
+        }
+    }
+    age.stale = stale;
+}
+
+void BridgeDiagnostics::sample(uint32_t nowMicros) {
+    if (!windowOpen) {
+        for (uint8_t i = 0; i < DIAG_BUS_COUNT; i++) {
+            buses[i].windowStartBits = buses[i].wireBits.load(std::memory_order_relaxed);
+        }
+        windowStartMicros = nowMicros;
+        windowOpen = true;
+        return;
+    }
+
+    const uint32_t elapsed = nowMicros - windowStartMicros;
+    if (elapsed < (uint32_t)HAT_DIAG_WINDOW_MS * 1000UL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < DIAG_BUS_COUNT; i++) {
+        BusCounters_t& bus = buses[i];
+        const uint32_t bits = bus.wireBits.load(std::memory_order_relaxed);
+        const uint64_t busBits = (uint64_t)bus.bitRate * elapsed / 1000000ULL;
+        const uint64_t permille = busBits > 0 ? (uint64_t)(bits - bus.windowStartBits) * 1000ULL / busBits : 0;
+        bus.utilisationPermille = (uint16_t)(permille > 1000 ? 1000 : permille);
+        bus.windowStartBits = bits;
+    }
+    windowStartMicros = nowMicros;
+}
+
+void BridgeDiagnostics::markBoot(uint8_t phase, uint32_t nowMicros) {
+    if (phase >= DIAG_BOOT_PHASE_COUNT) {
+        return;
+    }
+    // Every Jetson command lands here, so the common case is one load
+    if (bootMicros[phase].load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    // 0 means not reached, so a phase at the very first microsecond reads 1
+    uint32_t unset = 0;
+    bootMicros[phase].compare_exchange_strong(unset, nowMicros != 0 ? nowMicros : 1, std::memory_order_relaxed);
+}
+
+bool BridgeDiagnostics::getRecord(uint8_t page, uint8_t index, uint32_t& value, uint16_t& aux) const {
+    value = 0;
+    aux = 0;
+    const uint8_t registered = idCount.load(std::memory_order_acquire);
+
+    switch (page) {
+        case DIAG_PAGE_SUMMARY:
+            if (index != 0) {
+                return false;
+            }
+            value = millis();
+            aux = registered;
+            return true;
+
+        case DIAG_PAGE_ID:
+        case DIAG_PAGE_ID_RX:
+        case DIAG_PAGE_ID_TX:
+            if (index >= registered) {
+                return false;
+            }
+            if (page == DIAG_PAGE_ID) {
+                value = ids[index].key;
+            } else if (page == DIAG_PAGE_ID_RX) {
+                value = ids[index].rx.load(std::memory_order_relaxed);
+            } else {
+                value = ids[index].tx.load(std::memory_order_relaxed);
+                aux = saturate16(ids[index].txFailed.load(std::memory_order_relaxed));
+            }
+            return true;
+
+        case DIAG_PAGE_BUS: {
+            const uint8_t bus = index / DIAG_RECORDS_PER_BUS;
+            if (bus >= DIAG_BUS_COUNT) {
+                return false;
+            }
+            const BusCounters_t& counters = buses[bus];
+            switch (index % DIAG_RECORDS_PER_BUS) {
+                case 0:
+                    value = counters.utilisationPermille;
+                    aux = saturate16(counters.bitRate / 1000);
+                    break;
+                case 1:
+                    value = counters.txFailed.load(std::memory_order_relaxed);
+                    break;
+                default:
+                    value = counters.otherRx.load(std::memory_order_relaxed);
+                    aux = saturate16(counters.otherTx.load(std::memory_order_relaxed));
+                    break;
+            }
+            return true;
+        }
+
+        case DIAG_PAGE_ISR: {
+            const uint8_t isr = index / (DIAG_ISR_BUCKETS + 1);
+            const uint8_t bucket = index % (DIAG_ISR_BUCKETS + 1);
+            if (isr >= DIAG_ISR_COUNT) {
+                return false;
+            }
+            if (bucket < DIAG_ISR_BUCKETS) {
+                value = isrs[isr].buckets[bucket].load(std::memory_order_relaxed);
+                aux = (uint16_t)(bucket == 0 ? 0 : bucket + DIAG_ISR_BUCKET_SHIFT);
+            } else {
+                value = isrs[isr].maxCycles.load(std::memory_order_relaxed);
+                aux = (uint16_t)(F_CPU_ACTUAL / 1000000);
+            }
+            return true;
+        }
+
+        case DIAG_PAGE_QUEUE:
+            if (index >= DIAG_QUEUE_COUNT) {
+                return false;
+            }
+            value = queuePeak[index].load(std::memory_order_relaxed);
+            aux = queueCapacity[index];
+            return true;
+
+        case DIAG_PAGE_SETPOINT_AGE: {
+            const uint8_t wheel = index / DIAG_RECORDS_PER_WHEEL;
+            if (wheel >= DRIVE_WHEEL_COUNT) {
+                return false;
+            }
+            const SetpointAge_t& age = setpointAges[wheel];
+            switch (index % DIAG_RECORDS_PER_WHEEL) {
+                case 0:
+                    value = getSetpointMeanAge(wheel);
+                    aux = age.stale ? 1 : 0;
+                    break;
+                case 1:
+                    value = age.maxAgeMicros;
+                    aux = saturate16(age.staleEvents);
+                    break;
+                default:
+                    value = age.staleCycles;
+                    aux = setpointStaleMs;
+                    break;
+            }
+            return true;
+        }
+
+        case DIAG_PAGE_BOOT:
+            if (index >= DIAG_BOOT_PHASE_COUNT) {
+                return false;
+            }
+            value = bootMicros[index].load(std::memory_order_relaxed);
+            aux = (uint16_t)(HAT_FAST_BOOT ? 1 : 0);
+            return true;
+
+        case DIAG_PAGE_BUS_HEALTH:
+            // Kept by the supervisor, which owns the recovery state
+            return busSupervisor.getRecord(index, value, aux);
+
+        default:
+            return false;
+    }
+}
+
+uint8_t BridgeDiagnostics::getIdCount() const {
+    return idCount.load(std::memory_order_relaxed);
+}
+
+uint16_t BridgeDiagnostics::getUtilisationPermille(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].utilisationPermille : 0;
+}
+
+uint32_t BridgeDiagnostics::getIsrMaxCycles(uint8_t isr) const {
+    return isr < DIAG_ISR_COUNT ? isrs[isr].maxCycles.load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t BridgeDiagnostics::getTxFailures(uint8_t bus) const {
+    return bus < DIAG_BUS_COUNT ? buses[bus].txFailed.load(std::memory_order_relaxed) : 0;
+}
+
+uint16_t BridgeDiagnostics::getQueuePeak(uint8_t queue) const {
+    return queue < DIAG_QUEUE_COUNT ? queuePeak[queue].load(std::memory_order_relaxed) : 0;
+}
+
+uint32_t BridgeDiagnostics::getSetpointMeanAge(uint8_t wheel) const {
+    if (wheel >= DRIVE_WHEEL_COUNT || setpointAges[wheel].freshCycles == 0) {
+        return 0;
+    }
+    return (uint32_t)(setpointAges[wheel].totalAgeMicros / setpointAges[wheel].freshCycles);
+}
+
+uint32_t BridgeDiagnostics::getSetpointMaxAge(uint8_t wheel) const {
+    return wheel < DRIVE_WHEEL_COUNT ? setpointAges[wheel].maxAgeMicros : 0;
+}
+
+uint32_t BridgeDiagnostics::getSetpointStaleEvents(uint8_t wheel) const {
+    return wheel < DRIVE_WHEEL_COUNT ? setpointAges[wheel].staleEvents : 0;
+}
+
+uint32_t BridgeDiagnostics::getSetpointStaleCycles(uint8_t wheel) const {
+    return wheel < DRIVE_WHEEL_COUNT ? setpointAges[wheel].staleCycles : 0;
+}
+
+uint32_t BridgeDiagnostics::getBootMicros(uint8_t phase) const {
+    return phase < DIAG_BOOT_PHASE_COUNT ? bootMicros[phase].load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file filter_planner.cpp
+ * @brief Acceptance-filter planning for the FlexCAN mailboxes and MCP2517FD
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "filter_planner.h"
+#include <string.h>
+#include "hat_config.h"
+#include "Arduino.h"
+
+// Working-set limit for the lossless stage
+static const uint16_t FILTER_PLAN_MAX_CUBES = 256;
+
+static uint32_t idSpaceMask(uint8_t idBits) {
+    return idBits >= 32 ? 0xFFFFFFFFu : ((1u << idBits) - 1u);
+}
+
+// Number of IDs a filter accepts: 2 ^ (don't-care bits)
+static uint32_t filterCover(const CanFilter_t& filter, uint8_t idBits) {
+    const uint32_t free = idSpaceMask(idBits) & ~filter.mask;
+    return 1u << __builtin_popcount(free);
+}
+
+static CanFilter_t mergeFilters(const CanFilter_t& a, const CanFilter_t& b) {
+    CanFilter_t merged;
+    merged.mask = a.mask & b.mask & ~(a.id ^ b.id);
+    merged.id = a.id & merged.mask;
+    return merged;
+}
+
+static bool filterAccepts(const CanFilter_t& filter, uint32_t id) {
+    return (id & filter.mask) == filter.id;
+}
+
+bool planFilters(const uint32_t* ids, uint8_t count, uint8_t idBits, uint8_t maxFilters,
+                 FilterPlan_t& plan) {
+    memset(&plan, 0, sizeof(plan));
+    plan.idBits = idBits;
+    if (count == 0 || count > FILTER_PLAN_MAX_IDS || maxFilters == 0) {
+        return false;
+    }
+
+    // One exact filter per distinct ID
+    const uint32_t space = idSpaceMask(idBits);
+    for (uint8_t i = 0; i < count; i++) {
+        const uint32_t id = ids[i] & space;
+        bool duplicate = false;
+        for (uint8_t j = 0; j < plan.count; j++) {
+            duplicate = duplicate || plan.filters[j].id == id;
+        }
+        if (!duplicate) {
+            plan.filters[plan.count].id = id;
+            plan.filters[plan.count].mask = space;
+            plan.count++;
+        }
+    }
+    plan.handledIds = plan.count;
+
+    // Lossless stage (Quine-McCluskey): combine same-mask filters one bit
+    // apart level by level; those never combined are prime. Then cover the
+    // IDs greedily with the primes that take the most still-uncovered IDs.
+    static CanFilter_t level[FILTER_PLAN_MAX_CUBES];
+    static CanFilter_t nextLevel[FILTER_PLAN_MAX_CUBES];
+    static CanFilter_t primes[FILTER_PLAN_MAX_CUBES];
+    static bool combined[FILTER_PLAN_MAX_CUBES];
+    uint16_t levelCount = plan.count;
+    uint16_t primeCount = 0;
+    bool overflow = false;
+    memcpy(level, plan.filters, plan.count * sizeof(CanFilter_t));
+
+    while (levelCount > 0 && !overflow) {
+        uint16_t nextCount = 0;
+        memset(combined, 0, sizeof(combined));
+        for (uint16_t a = 0; a < levelCount; a++) {
+            for (uint16_t b = a + 1; b < levelCount; b++) {
+                if (level[a].mask != level[b].mask || __builtin_popcount(level[a].id ^ level[b].id) != 1) {
+                    continue;
+                }
+                combined[a] = true;
+                combined[b] = true;
+                const CanFilter_t cube = mergeFilters(level[a], level[b]);
+                bool seen = false;
+                for (uint16_t k = 0; k < nextCount && !seen; k++) {
+                    seen = nextLevel[k].id == cube.id && nextLevel[k].mask == cube.mask;
+                }
+                if (!seen) {
+                    if (nextCount == FILTER_PLAN_MAX_CUBES) {
+                        overflow = true;
+                        break;
+                    }
+                    nextLevel[nextCount++] = cube;
+                }
+            }
+        }
+        for (uint16_t a = 0; a < levelCount && !overflow; a++) {
+            if (!combined[a]) {
+                if (primeCount == FILTER_PLAN_MAX_CUBES) {
+                    overflow = true;
+                    break;
+                }
+                primes[primeCount++] = level[a];
+            }
+        }
+        memcpy(level, nextLevel, nextCount * sizeof(CanFilter_t));
+        levelCount = nextCount;
+    }
+
+    // If the table overflowed, the exact per-ID filters are kept as they are
+    if (!overflow) {
+        const uint8_t idCount = plan.count;
+        uint32_t handled[FILTER_PLAN_MAX_IDS];
+        bool covered[FILTER_PLAN_MAX_IDS] = {};
+        for (uint8_t i = 0; i < idCount; i++) {
+            handled[i] = plan.filters[i].id;
+        }
+
+        plan.count = 0;
+        for (uint8_t remaining = idCount; remaining > 0;) {
+            uint16_t best = 0;
+            uint8_t bestGain = 0;
+            for (uint16_t p = 0; p < primeCount; p++) {
+                uint8_t gain = 0;
+                for (uint8_t i = 0; i < idCount; i++) {
+                    gain += (!covered[i] && filterAccepts(primes[p], handled[i])) ? 1 : 0;
+                }
+                if (gain > bestGain) {
+                    bestGain = gain;
+                    best = p;
+                }
+            }
+            for (uint8_t i = 0; i < idCount; i++) {
+                if (!covered[i] && filterAccepts(primes[best], handled[i])) {
+                    covered[i] = true;
+                    remaining--;
+                }
+            }
+            plan.filters[plan.count++] = primes[best];
+        }
+    }
+
+    // Over budget: cheapest lossy merge each round
+    while (plan.count > maxFilters) {
+        uint8_t bestI = 0;
+        uint8_t bestJ = 1;
+        int64_t bestCost = INT64_MAX;
+        for (uint8_t i = 0; i < plan.count; i++) {
+            for (uint8_t j = i + 1; j < plan.count; j++) {
+                const CanFilter_t candidate = mergeFilters(plan.filters[i], plan.filters[j]);
+                const int64_t cost = (int64_t)filterCover(candidate, idBits) -
+                                     filterCover(plan.filters[i], idBits) -
+                                     filterCover(plan.filters[j], idBits);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        plan.filters[bestI] = mergeFilters(plan.filters[bestI], plan.filters[bestJ]);
+        plan.filters[bestJ] = plan.filters[--plan.count];
+
+        // The wider filter may now swallow others outright
+        uint8_t k = 0;
+        while (k < plan.count) {
+            const CanFilter_t& wide = plan.filters[bestI];
+            if (k != bestI && (plan.filters[k].mask & wide.mask) == wide.mask &&
+                filterAccepts(wide, plan.filters[k].id)) {
+                plan.filters[k] = plan.filters[--plan.count];
+                if (bestI == plan.count) {
+                    bestI = k;
+                }
+                continue;
+            }
+            k++;
+        }
+    }
+
+    // Lossy merges can leave partial overlaps, so count standard IDs one by
+    // one; for extended IDs the sum of covers is an upper bound
+    uint32_t accepted = 0;
+    if (idBits <= 11) {
+        for (uint32_t id = 0; id <= space; id++) {
+            accepted += filterPlanAccepts(plan, id) ? 1 : 0;
+        }
+    } else {
+        for (uint8_t i = 0; i < plan.count; i++) {
+            accepted += filterCover(plan.filters[i], idBits);
+        }
+    }
+    plan.extraIds = accepted - plan.handledIds;
+    return true;
+}
+
+bool filterPlanAccepts(const FilterPlan_t& plan, uint32_t id) {
+    for (uint8_t i = 0; i < plan.count; i++) {
+        if (filterAccepts(plan.filters[i], id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+float filterPlanRejectionRate(const FilterPlan_t& plan, uint16_t dedicatedIds) {
+    const float space = (float)idSpaceMask(plan.idBits) + 1.0f;
+    return 1.0f - (float)(plan.handledIds + plan.extraIds + dedicatedIds) / space;
+}
+
+void reportFilterPlan(const char* bus, const FilterPlan_t& plan, uint8_t dedicated) {
+#if HAT_DEBUG_ENABLED
+    Serial.print("filters ");
+    Serial.print(bus);
+    Serial.print(": ");
+    Serial.print(dedicated);
+    Serial.print(" dedicated + ");
+    Serial.print(plan.count);
+    Serial.print(" mask, ");
+    Serial.print(plan.handledIds);
+    Serial.print(" IDs handled, ");
+    Serial.print(plan.extraIds);
+    Serial.print(" extra accepted, ");
+    Serial.print(filterPlanRejectionRate(plan, dedicated) * 100.0f, 2);
+    Serial.println("% of ID space rejected");
+    for (uint8_t i = 0; i < plan.count; i++) {
+        Serial.print("  id=0x");
+        Serial.print(plan.filters[i].id, HEX);
+        Serial.print(" mask=0x");
+        Serial.println(plan.filters[i].mask, HEX);
+    }
+#endif
+}
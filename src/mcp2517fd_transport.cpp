@@ -0,0 +1,468 @@
+/**
+ * @file mcp2517fd_transport.cpp
+ * @brief Batched SPI access to the MCP2517FD transmit and receive FIFOs
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "mcp2517fd_transport.h"
+#include "Arduino.h"
+#include <string.h>
+
+// SPI instructions (DS20005688, section 4): 4-bit command, 12-bit address
+#define MCP_SPI_WRITE 0x2
+#define MCP_SPI_READ 0x3
+
+// Registers
+#define MCP_REG_C1CON 0x000
+#define MCP_REG_C1TEFCON 0x040
+#define MCP_REG_C1TXQCON 0x050             // FIFO m control at 0x050 + 12 * m
+#define MCP_FIFO_STRIDE 12
+#define MCP_FIFOS_SEARCHED 3               // The library uses FIFO1 and FIFO2
+#define MCP_RAM_START 0x400
+#define MCP_RAM_SIZE 2048
+
+#define MCP_C1CON_STEF (1UL << 19)
+#define MCP_C1CON_TXQEN (1UL << 20)
+#define MCP_FIFOCON_RXTSEN (1UL << 5)      // Also TEFTSEN in C1TEFCON
+#define MCP_FIFOCON_TXEN (1UL << 7)
+#define MCP_FIFOCON_UINC 0x01              // In FIFOCON byte 1
+#define MCP_FIFOCON_TXREQ 0x02
+#define MCP_FIFOCON_FRESET 0x04
+#define MCP_FIFOSTA_NOT_FULL_EMPTY 0x01    // TFNRFNIF: transmit not full / receive not empty
+#define MCP_FIFOSTA_FULL_EMPTY 0x04        // TFERFFIF: transmit empty / receive full
+
+// Message object flags word (T1/R1)
+#define MCP_OBJ_IDE (1UL << 4)
+#define MCP_OBJ_RTR (1UL << 5)
+#define MCP_OBJ_BRS (1UL << 6)
+#define MCP_OBJ_FDF (1UL << 7)
+#define MCP_OBJ_FILHIT_SHIFT 11
+
+static const uint8_t PAYLOAD_BYTES[8] = { 8, 12, 16, 20, 24, 32, 48, 64 };
+static const uint8_t DLC_LENGTHS[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+static_assert((HAT_PERIPH_RX_BUFFER_SIZE & (HAT_PERIPH_RX_BUFFER_SIZE - 1)) == 0,
+              "HAT_PERIPH_RX_BUFFER_SIZE must be a power of two");
+
+static uint32_t getWord(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putWord(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static void putInstruction(uint8_t* p, uint8_t command, uint16_t address) {
+    p[0] = (uint8_t)((command << 4) | ((address >> 8) & 0x0F));
+    p[1] = (uint8_t)address;
+}
+
+static uint8_t dlcOfLength(uint8_t len) {
+    uint8_t dlc = 0;
+    while (dlc < 15 && DLC_LENGTHS[dlc] < len) {
+        dlc++;
+    }
+    return dlc;
+}
+
+// ID word layout shared by transmit and receive objects: SID in 10:0,
+// EID in 28:11 for extended frames
+static uint32_t objectIdOf(const CANFDMessage& frame) {
+    return frame.ext ? (((frame.id >> 18) & 0x7FF) | ((frame.id & 0x3FFFF) << 11)) : (frame.id & 0x7FF);
+}
+
+static void decodeReceiveObject(const uint8_t* object, uint8_t dataOffset, CANFDMessage& frame) {
+    const uint32_t id = getWord(object);
+    const uint32_t flags = getWord(object + 4);
+    frame.ext = (flags & MCP_OBJ_IDE) != 0;
+    frame.id = frame.ext ? (((id & 0x7FF) << 18) | ((id >> 11) & 0x3FFFF)) : (id & 0x7FF);
+    if (flags & MCP_OBJ_FDF) {
+        frame.type = (flags & MCP_OBJ_BRS) ? CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH
+                                           : CANFDMessage::CANFD_NO_BIT_RATE_SWITCH;
+        frame.len = DLC_LENGTHS[flags & 0x0F];
+    } else {
+        frame.type = (flags & MCP_OBJ_RTR) ? CANFDMessage::CAN_REMOTE : CANFDMessage::CAN_DATA;
+        frame.len = (flags & 0x0F) > 8 ? 8 : (uint8_t)(flags & 0x0F);
+    }
+    frame.idx = (uint8_t)((flags >> MCP_OBJ_FILHIT_SHIFT) & 0x1F);   // As the library: matching filter
+    memcpy(frame.data, object + dataOffset, frame.type == CANFDMessage::CAN_REMOTE ? 0 : frame.len);
+}
+
+MCP2517FDTransport::MCP2517FDTransport(ACAN2517FD& controller, uint8_t csPin, SPIClass& spi, uint8_t intPin,
+                                       void (*interruptHandler)(void))
+    : controller(controller), csPin(csPin), spi(spi),
+      settings(HAT_PERIPH_SPI_CLOCK_HZ, MSBFIRST, SPI_MODE0), batched(false), txFifo(), rxFifo(),
+      busy(false), drainPending(false), intPin(intPin), interruptHandler(interruptHandler), intMasked(false),
+      txSegmentLength(), txSegmentCount(0), txSegmentNext(0),
+      rxHead(0), rxTail(0), rxPeak(0), stats() {
+}
+
+bool MCP2517FDTransport::begin(bool batched) {
+    // Located either way: abortTransmit() needs the transmit FIFO with the
+    // library in charge too
+    this->batched = false;
+    spi.beginTransaction(settings);
+    const bool found = locateFifos();
+    spi.endTransaction();
+    if (!found) {
+        txFifo = FifoLayout_t();
+        return false;
+    }
+    if (!batched) {
+        return false;
+    }
+
+#if HAT_PERIPH_SPI_DMA
+    dmaEvent.setContext(this);
+    dmaEvent.attachImmediate(onDmaComplete);
+#endif
+    this->batched = true;
+    return true;
+}
+
+bool MCP2517FDTransport::isBatched() const {
+    return batched;
+}
+
+bool MCP2517FDTransport::locateFifos() {
+    // Message RAM is allocated in order TEF, TXQ, FIFO1, FIFO2, ... so every
+    // FIFO's base follows from the sizes configured before it
+    uint8_t con[4];
+    uint8_t tef[4];
+    uint8_t fifos[MCP_FIFO_STRIDE * (MCP_FIFOS_SEARCHED + 1)];
+    readRegisters(MCP_REG_C1CON, con, sizeof(con));
+    readRegisters(MCP_REG_C1TEFCON, tef, sizeof(tef));
+    readRegisters(MCP_REG_C1TXQCON, fifos, sizeof(fifos));
+
+    uint32_t address = MCP_RAM_START;
+    const uint32_t c1con = getWord(con);
+    if (c1con & MCP_C1CON_STEF) {
+        const uint32_t tefcon = getWord(tef);
+        address += (((tefcon >> 24) & 0x1F) + 1) * ((tefcon & MCP_FIFOCON_RXTSEN) ? 12 : 8);
+    }
+    if (c1con & MCP_C1CON_TXQEN) {
+        const uint32_t txqcon = getWord(fifos);
+        address += (((txqcon >> 24) & 0x1F) + 1) * (8 + PAYLOAD_BYTES[txqcon >> 29]);
+    }
+
+    bool txFound = false;
+    bool rxFound = false;
+    for (uint8_t m = 1; m <= MCP_FIFOS_SEARCHED; ++m) {
+        const uint32_t fifocon = getWord(&fifos[MCP_FIFO_STRIDE * m]);
+        const bool transmit = (fifocon & MCP_FIFOCON_TXEN) != 0;
+        FifoLayout_t layout;
+        layout.control = (uint16_t)(MCP_REG_C1TXQCON + MCP_FIFO_STRIDE * m);
+        layout.ramBase = (uint16_t)address;
+        layout.depth = (uint8_t)(((fifocon >> 24) & 0x1F) + 1);
+        layout.dataOffset = (!transmit && (fifocon & MCP_FIFOCON_RXTSEN)) ? 12 : 8;
+        layout.objectSize = (uint8_t)(layout.dataOffset + PAYLOAD_BYTES[fifocon >> 29]);
+        address += (uint32_t)layout.depth * layout.objectSize;
+
+        if (transmit && !txFound) {
+            txFifo = layout;
+            txFound = true;
+        } else if (!transmit && !rxFound) {
+            rxFifo = layout;
+            rxFound = true;
+        }
+    }
+
+    static_assert(HAT_PERIPH_RX_BURST_BYTES >= 8 + 4 + MCP2517FD_MAX_PAYLOAD,
+                  "a receive burst must hold at least one object");
+    return txFound && rxFound && address <= MCP_RAM_START + MCP_RAM_SIZE;
+}
+
+bool MCP2517FDTransport::claim() {
+    bool expected = false;
+    return busy.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+void MCP2517FDTransport::release() {
+    busy.store(false, std::memory_order_release);
+
+    // A receive interrupt that found the bus taken left its drain to us
+    while (drainPending.load(std::memory_order_acquire) && claim()) {
+        drainPending.store(false, std::memory_order_relaxed);
+        spi.beginTransaction(settings);
+        drainReceiveFifo();
+        spi.endTransaction();
+        busy.store(false, std::memory_order_release);
+    }
+    unmaskInterrupt();
+}
+
+bool MCP2517FDTransport::acquireBus() {
+    // An interrupt between the claim and the mask masks itself
+    if (!claim()) {
+        return false;
+    }
+    maskInterrupt();
+    return true;
+}
+
+void MCP2517FDTransport::releaseBus() {
+    release();
+}
+
+void MCP2517FDTransport::suspend() {
+    batched = false;
+    txFifo.depth = 0;
+}
+
+bool MCP2517FDTransport::abortTransmit() {
+    if (txFifo.depth == 0) {
+        return true;
+    }
+    if (!acquireBus()) {
+        return false;
+    }
+
+    // FRESET with TXREQ clear: pending objects are dropped and the FIFO is
+    // empty again a few SYSCLK cycles later, well before the next status
+    // read can follow this frame
+    spi.beginTransaction(settings);
+    writeFifoControl(txFifo, MCP_FIFOCON_FRESET);
+    spi.endTransaction();
+    releaseBus();
+    return true;
+}
+
+void MCP2517FDTransport::maskInterrupt() {
+    detachInterrupt(digitalPinToInterrupt(intPin));
+    intMasked.store(true, std::memory_order_release);
+}
+
+void MCP2517FDTransport::unmaskInterrupt() {
+    // Re-attaching with INT still low takes the interrupt straight away,
+    // which finds the bus free now
+    if (intMasked.exchange(false, std::memory_order_acq_rel)) {
+        attachInterrupt(digitalPinToInterrupt(intPin), interruptHandler, LOW);
+    }
+}
+
+void MCP2517FDTransport::transfer(uint8_t* buffer, uint16_t length) {
+    // One instruction, one chip-select frame, blocking
+    digitalWrite(csPin, LOW);
+    spi.transfer(buffer, buffer, length);
+    digitalWrite(csPin, HIGH);
+    stats.spiBytes += length;
+    stats.chipSelects++;
+}
+
+void MCP2517FDTransport::readRegisters(uint16_t address, uint8_t* data, uint8_t length) {
+    uint8_t buffer[2 + MCP_FIFO_STRIDE * (MCP_FIFOS_SEARCHED + 1)];
+    putInstruction(buffer, MCP_SPI_READ, address);
+    memset(&buffer[2], 0, length);
+    transfer(buffer, (uint16_t)(2 + length));
+    memcpy(data, &buffer[2], length);
+}
+
+void MCP2517FDTransport::writeFifoControl(const FifoLayout_t& fifo, uint8_t flags) {
+    uint8_t buffer[3];
+    putInstruction(buffer, MCP_SPI_WRITE, (uint16_t)(fifo.control + 1));
+    buffer[2] = flags;
+    transfer(buffer, sizeof(buffer));
+}
+
+uint8_t MCP2517FDTransport::sendBatch(const CANFDMessage* const* frames, uint8_t count) {
+    if (!batched) {
+        // The library refuses once its FIFO is full
+        uint8_t sent = 0;
+        while (sent < count && controller.tryToSend(*frames[sent])) {
+            sent++;
+        }
+        return sent;
+    }
+    if (count == 0 || !claim()) {
+        return 0;
+    }
+
+    // Free slots and the head from one read of FIFOSTA and FIFOUA
+    spi.beginTransaction(settings);
+    uint8_t regs[8];
+    readRegisters((uint16_t)(txFifo.control + 4), regs, sizeof(regs));
+    const uint32_t status = getWord(regs);
+    const uint8_t head = (uint8_t)((getWord(regs + 4) + MCP_RAM_START - txFifo.ramBase) / txFifo.objectSize);
+    uint8_t room = 0;
+    if (status & MCP_FIFOSTA_FULL_EMPTY) {
+        room = txFifo.depth;
+    } else if (status & MCP_FIFOSTA_NOT_FULL_EMPTY) {
+        const uint8_t next = (uint8_t)((status >> 8) & 0x1F);
+        room = (uint8_t)(txFifo.depth - (head + txFifo.depth - next) % txFifo.depth);
+    }
+    if (room > HAT_PERIPH_TX_HW_DEPTH) {
+        room = HAT_PERIPH_TX_HW_DEPTH;
+    }
+
+    // Every object is built before the first byte goes out, so the caller's
+    // frames are free again on return
+    uint8_t taken = 0;
+    while (taken < count && taken < room) {
+        const CANFDMessage& frame = *frames[taken];
+        if (!frame.isValid() || frame.len > txFifo.objectSize - 8) {
+            break;
+        }
+        uint32_t flags = dlcOfLength(frame.len);
+        if (frame.ext) flags |= MCP_OBJ_IDE;
+        if (frame.type == CANFDMessage::CAN_REMOTE) flags |= MCP_OBJ_RTR;
+        if (frame.type == CANFDMessage::CANFD_NO_BIT_RATE_SWITCH) flags |= MCP_OBJ_FDF;
+        if (frame.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) flags |= MCP_OBJ_FDF | MCP_OBJ_BRS;
+
+        // RAM is written in whole words
+        const uint8_t dataBytes = (uint8_t)((frame.len + 3) & ~3);
+        uint8_t* segment = txSegments[taken];
+        putInstruction(segment, MCP_SPI_WRITE,
+                       (uint16_t)(txFifo.ramBase + ((head + taken) % txFifo.depth) * txFifo.objectSize));
+        putWord(segment + 2, objectIdOf(frame));
+        putWord(segment + 6, flags);
+        memset(segment + 10, 0, dataBytes);
+        memcpy(segment + 10, frame.data, frame.len);
+        txSegmentLength[taken] = (uint8_t)(10 + dataBytes);
+        taken++;
+    }
+
+    if (taken == 0) {
+        spi.endTransaction();
+        release();
+        return 0;
+    }
+    stats.txFrames += taken;
+    stats.txBatches++;
+    txSegmentCount = taken;
+    txSegmentNext = 0;
+    writeSegment();
+    return taken;
+}
+
+void MCP2517FDTransport::writeSegment() {
+    uint8_t* segment = txSegments[txSegmentNext];
+    const uint8_t length = txSegmentLength[txSegmentNext];
+    stats.spiBytes += length;
+    stats.chipSelects++;
+    digitalWrite(csPin, LOW);
+#if HAT_PERIPH_SPI_DMA
+    stats.dmaBytes += length;
+    spi.transfer(segment, nullptr, length, dmaEvent);
+#else
+    spi.transfer(segment, nullptr, length);
+    segmentWritten();
+#endif
+}
+
+#if HAT_PERIPH_SPI_DMA
+void MCP2517FDTransport::onDmaComplete(EventResponder& event) {
+    static_cast<MCP2517FDTransport*>(event.getContext())->segmentWritten();
+}
+#endif
+
+void MCP2517FDTransport::segmentWritten() {
+    // DMA completion interrupt: the object is in RAM, so it can be queued
+    // (the controller starts sending while the next one is written)
+    digitalWrite(csPin, HIGH);
+    writeFifoControl(txFifo, MCP_FIFOCON_UINC | MCP_FIFOCON_TXREQ);
+    txSegmentNext++;
+    if (txSegmentNext < txSegmentCount) {
+        writeSegment();
+        return;
+    }
+    spi.endTransaction();
+    release();
+}
+
+void MCP2517FDTransport::isr() {
+    if (!batched) {
+        controller.isr();
+        return;
+    }
+
+    // While a transmit batch holds the bus, its completion drains instead.
+    // INT stays low until then, so it is masked; claiming again after that
+    // catches a holder that released before the mask took effect and would
+    // otherwise leave it masked.
+    drainPending.store(true, std::memory_order_release);
+    if (!claim()) {
+        maskInterrupt();
+        if (!claim()) {
+            return;
+        }
+    }
+    drainPending.store(false, std::memory_order_relaxed);
+    spi.beginTransaction(settings);
+    drainReceiveFifo();
+    spi.endTransaction();
+    release();
+}
+
+void MCP2517FDTransport::drainReceiveFifo() {
+    // One pass: INT is level-triggered (the library attaches it LOW), so a
+    // frame that arrives meanwhile raises the interrupt again
+    uint8_t regs[8];
+    readRegisters((uint16_t)(rxFifo.control + 4), regs, sizeof(regs));
+    const uint32_t status = getWord(regs);
+    if ((status & MCP_FIFOSTA_NOT_FULL_EMPTY) == 0) {
+        return;
+    }
+
+    // FIFOUA is the tail, FIFOCI the head
+    const uint8_t tail = (uint8_t)((getWord(regs + 4) + MCP_RAM_START - rxFifo.ramBase) / rxFifo.objectSize);
+    const uint8_t head = (uint8_t)((status >> 8) & 0x1F);
+    uint8_t pending = (status & MCP_FIFOSTA_FULL_EMPTY) ? rxFifo.depth
+                                                        : (uint8_t)((head + rxFifo.depth - tail) % rxFifo.depth);
+    const uint8_t contiguous = (uint8_t)(rxFifo.depth - tail);
+    const uint8_t fits = (uint8_t)(HAT_PERIPH_RX_BURST_BYTES / rxFifo.objectSize);
+    pending = pending < contiguous ? pending : contiguous;
+    pending = pending < fits ? pending : fits;
+    if (pending == 0) {
+        pending = 1;
+    }
+
+    // Every pending object up to the end of the FIFO in one burst
+    const uint16_t length = (uint16_t)(pending * rxFifo.objectSize);
+    putInstruction(rxBurst, MCP_SPI_READ, (uint16_t)(rxFifo.ramBase + tail * rxFifo.objectSize));
+    memset(&rxBurst[2], 0, length);
+    transfer(rxBurst, (uint16_t)(2 + length));
+    stats.rxBursts++;
+    stats.rxFrames += pending;
+
+    for (uint8_t i = 0; i < pending; ++i) {
+        const uint16_t at = rxHead.load(std::memory_order_relaxed);
+        const uint16_t depth = (uint16_t)(at - rxTail.load(std::memory_order_acquire));
+        if (depth >= HAT_PERIPH_RX_BUFFER_SIZE) {
+            stats.rxDropped++;
+        } else {
+            decodeReceiveObject(&rxBurst[2 + i * rxFifo.objectSize], rxFifo.dataOffset,
+                                rxBuffer[at % HAT_PERIPH_RX_BUFFER_SIZE]);
+            rxHead.store((uint16_t)(at + 1), std::memory_order_release);
+            if (depth + 1 > rxPeak) {
+                rxPeak = (uint16_t)(depth + 1);
+            }
+        }
+        writeFifoControl(rxFifo, MCP_FIFOCON_UINC);
+    }
+}
+
+bool MCP2517FDTransport::receive(CANFDMessage& frame) {
+    if (!batched) {
+        return controller.receive(frame);
+    }
+    const uint16_t tail = rxTail.load(std::memory_order_relaxed);
+    if (tail == rxHead.load(std::memory_order_acquire)) {
+        return false;
+    }
+    frame = rxBuffer[tail % HAT_PERIPH_RX_BUFFER_SIZE];
+    rxTail.store((uint16_t)(tail + 1), std::memory_order_release);
+    return true;
+}
+
+uint16_t MCP2517FDTransport::getReceivePeakCount() const {
+    // Without batching the library keeps the high-water mark
+    return batched ? rxPeak : controller.driverReceiveFIFOPeakCount();
+}
+
+const SpiTransportStats_t& MCP2517FDTransport::getStats() const {
+    return stats;
+}
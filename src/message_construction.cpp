@@ -6,6 +6,7 @@
  */
 
 #include "message_construction.h"
+#include "hat_config.h"
 #include "Arduino.h"
 
 void floatToBytes(float f, uint8_t *out) {
@@ -13,12 +14,143 @@ void floatToBytes(float f, uint8_t *out) {
     for (int i = 0; i < 4; i++) out[i] = p[i];
 }
 
-CANFDMessage buildVelocityMsg(uint8_t node_id, float vel, float torque_ff = 0.0f) {
+void encodeDrivePayload(const DrivePayload_t &payload, uint8_t *out) {
+    floatToBytes(payload.steering_angle, &out[0]);
+    floatToBytes(payload.angular_vel,    &out[4]);
+}
+
+DrivePayload_t decodeDrivePayload(const uint8_t *in) {
+    DrivePayload_t payload;
+    memcpy(&payload.steering_angle, &in[0], sizeof(float));
+    memcpy(&payload.angular_vel,    &in[4], sizeof(float));
+    return payload;
+}
+
+int16_t encodeCompactField(float value, float scale) {
+    // Written so NaN falls through to 0
+    const float scaled = value / scale;
+    if (scaled >= 32767.0f) {
+        return 32767;
+    }
+    if (scaled <= -32767.0f) {
+        return -32767;
+    }
+    if (!(scaled == scaled)) {
+        return 0;
+    }
+    return (int16_t)lroundf(scaled);
+}
+
+float decodeCompactField(int16_t raw, float scale) {
+    return (float)raw * scale;
+}
+
+uint8_t encodeCompactDrivePayload(const DrivePayload_t *wheels, uint8_t count, uint8_t *out) {
+    // Returns the frame length: 4 bytes per wheel, at most two wheels
+    if (count > DRIVE_COMPACT_WHEELS_PER_FRAME) {
+        count = DRIVE_COMPACT_WHEELS_PER_FRAME;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        const int16_t angle = encodeCompactField(wheels[i].steering_angle, DRIVE_COMPACT_ANGLE_SCALE);
+        const int16_t vel = encodeCompactField(wheels[i].angular_vel, DRIVE_COMPACT_VEL_SCALE);
+        uint8_t *field = &out[i * DRIVE_COMPACT_WHEEL_SIZE];
+        field[0] = (uint8_t)angle;
+        field[1] = (uint8_t)((uint16_t)angle >> 8);
+        field[2] = (uint8_t)vel;
+        field[3] = (uint8_t)((uint16_t)vel >> 8);
+    }
+    return count * DRIVE_COMPACT_WHEEL_SIZE;
+}
+
+uint8_t decodeCompactDrivePayload(const uint8_t *in, uint8_t len, DrivePayload_t *wheels) {
+    // Returns the number of wheels in a frame of len bytes
+    uint8_t count = len / DRIVE_COMPACT_WHEEL_SIZE;
+    if (count > DRIVE_COMPACT_WHEELS_PER_FRAME) {
+        count = DRIVE_COMPACT_WHEELS_PER_FRAME;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t *field = &in[i * DRIVE_COMPACT_WHEEL_SIZE];
+        const int16_t angle = (int16_t)(field[0] | (field[1] << 8));
+        const int16_t vel = (int16_t)(field[2] | (field[3] << 8));
+        wheels[i].steering_angle = decodeCompactField(angle, DRIVE_COMPACT_ANGLE_SCALE);
+        wheels[i].angular_vel = decodeCompactField(vel, DRIVE_COMPACT_VEL_SCALE);
+    }
+    return count;
+}
+
+float telemetrySignalScale(uint8_t signal) {
+    return signal < TELEMETRY_SIGNAL_DRIVE_VEL ? DRIVE_COMPACT_ANGLE_SCALE : DRIVE_COMPACT_VEL_SCALE;
+}
+
+uint8_t telemetrySummaryLength(uint8_t fields) {
+    uint8_t count = 0;
+    for (uint8_t bit = 0; bit < 4; bit++) {
+        if (fields & (1u << bit)) {
+            count++;
+        }
+    }
+    if (count > TELEMETRY_SUMMARY_MAX_FIELDS) {
+        count = TELEMETRY_SUMMARY_MAX_FIELDS;
+    }
+    return TELEMETRY_SUMMARY_HEADER_SIZE + 2 * count;
+}
+
+uint8_t encodeTelemetrySummary(const TelemetrySummary_t &summary, uint8_t *out) {
+    // Returns the frame length; fields past the third are left out
+    const float values[4] = { summary.min, summary.max, summary.mean, summary.last };
+    const float scale = telemetrySignalScale(summary.signal);
+    uint8_t fields = 0;
+    uint8_t len = TELEMETRY_SUMMARY_HEADER_SIZE;
+    for (uint8_t bit = 0; bit < 4 && len < CAN_MAX_DATA_LENGTH; bit++) {
+        if ((summary.fields & (1u << bit)) == 0) {
+            continue;
+        }
+        const int16_t raw = encodeCompactField(values[bit], scale);
+        out[len] = (uint8_t)raw;
+        out[len + 1] = (uint8_t)((uint16_t)raw >> 8);
+        len += 2;
+        fields |= (uint8_t)(1u << bit);
+    }
+    out[0] = (uint8_t)((summary.signal & 0x0F) | (fields << 4));
+    out[1] = (uint8_t)(summary.count > 0xFF ? 0xFF : summary.count);
+    return len;
+}
+
+bool decodeTelemetrySummary(const uint8_t *in, uint8_t len, TelemetrySummary_t &summary) {
+    // Fields not in the frame read as 0
+    if (len < TELEMETRY_SUMMARY_HEADER_SIZE) {
+        return false;
+    }
+    summary.signal = in[0] & 0x0F;
+    summary.fields = in[0] >> 4;
+    summary.count = in[1];
+    // All four fields cannot be in one frame
+    if (summary.signal >= TELEMETRY_SIGNAL_COUNT || summary.fields == 0x0F ||
+        len < telemetrySummaryLength(summary.fields)) {
+        return false;
+    }
+    float values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const float scale = telemetrySignalScale(summary.signal);
+    uint8_t offset = TELEMETRY_SUMMARY_HEADER_SIZE;
+    for (uint8_t bit = 0; bit < 4; bit++) {
+        if (summary.fields & (1u << bit)) {
+            values[bit] = decodeCompactField((int16_t)(in[offset] | (in[offset + 1] << 8)), scale);
+            offset += 2;
+        }
+    }
+    summary.min = values[0];
+    summary.max = values[1];
+    summary.mean = values[2];
+    summary.last = values[3];
+    return true;
+}
+
+CANFDMessage buildVelocityMsg(uint8_t node_id, float vel, float torque_ff) {
     CANFDMessage m;
 
-    const uint8_t cmd = 0x0C; // Set_Input_Vel
-    m.id  = (cmd << 5) | node_id;
+    m.id  = encodeODriveId(ODRIVE_CMD_SET_INPUT_VEL, node_id);
     m.ext = false;
+    m.type = CANFDMessage::CAN_DATA; // ODrives only speak classic CAN
     m.len = 8;
 
     floatToBytes(vel,       &m.data[0]);
@@ -27,16 +159,103 @@ CANFDMessage buildVelocityMsg(uint8_t node_id, float vel, float torque_ff = 0.0f
     return m;
 }
 
-CANFDMessage buildPositionMsg(uint8_t node_id, float pos, float vel_ff = 0.0f) {
+CANFDMessage buildPositionMsg(uint8_t node_id, float pos, float vel_ff) {
     CANFDMessage m;
 
-    const uint8_t cmd = 0x0B; // Set_Input_Pos
-    m.id  = (cmd << 5) | node_id;
+    m.id  = encodeODriveId(ODRIVE_CMD_SET_INPUT_POS, node_id);
     m.ext = false;
+    m.type = CANFDMessage::CAN_DATA; // ODrives only speak classic CAN
     m.len = 8;
 
     floatToBytes(pos,    &m.data[0]);
     floatToBytes(vel_ff, &m.data[4]);
 
     return m;
-}
\ No newline at end of file
+}
+
+CANFDMessage buildEstopMsg(uint8_t node_id) {
+    CANFDMessage m;
+
+    m.id  = encodeODriveId(ODRIVE_CMD_ESTOP, node_id);
+    m.ext = false;
+    m.type = CANFDMessage::CAN_DATA;
+    m.len = 0;
+
+    return m;
+}
+
+CANFDMessage buildEncoderEstimatesMsg(uint8_t node_id, float pos, float vel) {
+    // Sent by the ODrives; built here for loopback and the native rig
+    CANFDMessage m;
+
+    m.id  = encodeODriveId(ODRIVE_CMD_GET_ENCODER_ESTIMATES, node_id);
+    m.ext = false;
+    m.type = CANFDMessage::CAN_DATA;
+    m.len = 8;
+
+    floatToBytes(pos, &m.data[0]);
+    floatToBytes(vel, &m.data[4]);
+
+    return m;
+}
+
+bool parseEncoderEstimatesMsg(const CANFDMessage &m, float &pos, float &vel) {
+    if (m.ext || m.len < 8 || odriveIdCmd(m.id) != ODRIVE_CMD_GET_ENCODER_ESTIMATES) {
+        return false;
+    }
+    memcpy(&pos, &m.data[0], sizeof(float));
+    memcpy(&vel, &m.data[4], sizeof(float));
+    return true;
+}
+
+CANFDMessage buildPackedSetpointMsg(const PackedSetpoint_t *entries, uint8_t count) {
+    CANFDMessage m;
+
+    if (count > PACKED_SETPOINT_MAX_ENTRIES) {
+        count = PACKED_SETPOINT_MAX_ENTRIES;
+    }
+
+    m.id  = encodeHatId(CAN_PRIORITY_TEMPLATE, HAT_NODE_ID, CAN_BROADCAST_ADDR, MSG_TYPE_PACKED_SETPOINTS);
+    m.ext = true;
+    m.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH;
+    m.len = PACKED_SETPOINT_HEADER_SIZE + count * PACKED_SETPOINT_ENTRY_SIZE;
+
+    m.data[0] = PACKED_SETPOINT_VERSION;
+    m.data[1] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t *entry = &m.data[PACKED_SETPOINT_HEADER_SIZE + i * PACKED_SETPOINT_ENTRY_SIZE];
+        entry[0] = entries[i].node_id;
+        entry[1] = entries[i].cmd;
+        floatToBytes(entries[i].value,       &entry[2]);
+        floatToBytes(entries[i].feedforward, &entry[6]);
+    }
+
+    // Round up to the next valid CAN FD length, zero filled
+    m.pad();
+
+    return m;
+}
+
+uint8_t parsePackedSetpointMsg(const CANFDMessage &m, PackedSetpoint_t *out, uint8_t max_entries) {
+    if (m.len < PACKED_SETPOINT_HEADER_SIZE || m.data[0] != PACKED_SETPOINT_VERSION) {
+        return 0;
+    }
+
+    uint8_t count = m.data[1];
+    if (count > max_entries) {
+        count = max_entries;
+    }
+    if (PACKED_SETPOINT_HEADER_SIZE + count * PACKED_SETPOINT_ENTRY_SIZE > m.len) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t *entry = &m.data[PACKED_SETPOINT_HEADER_SIZE + i * PACKED_SETPOINT_ENTRY_SIZE];
+        out[i].node_id = entry[0];
+        out[i].cmd = entry[1];
+        memcpy(&out[i].value, &entry[2], sizeof(float));
+        memcpy(&out[i].feedforward, &entry[6], sizeof(float));
+    }
+
+    return count;
+}
@@ -13,7 +13,6 @@
  */
 
 #include "hat_config.h"
-#include <array>
 #include "ACAN2517FD.h"
 #include "SPI.h"
 #include "message_construction.h"
@@ -21,23 +20,63 @@
 #include "component_ctrl.h"
 #include "hardware_map.h"
 #include "motor_control.h"
+#include "trace.h"
+#include "diagnostics.h"
+#include "param_registry.h"
+#include "bus_supervisor.h"
 #include "Arduino.h"
 
 // Global objects
-CANInterface canInterface;
+CANInterface canInterface(CAN_LINK_PRIMARY, HAT_JETSON_TX_ROLES);
+#if HAT_JETSON_AUX_ENABLED
+AuxCANInterface auxCanInterface(CAN_LINK_AUX, HAT_JETSON_AUX_TX_ROLES);
+#endif
 HATStateMachine stateMachine;
 ComponentController componentController;
 
-// Timing variables
-unsigned long lastHeartbeat = 0;
-unsigned long lastTelemetry = 0;
-unsigned long lastStateCheck = 0;
+// Fixed-rate task scheduler (drive TX, state, telemetry, heartbeat, diagnostics, bus monitor, LEDs)
+TaskScheduler scheduler;
+
+// Tasks whose period is a runtime parameter
+static int8_t driveTxTaskId = -1;
+static int8_t telemetryTaskId = -1;
+static int8_t heartbeatTaskId = -1;
 
 void setup() {
-    // Initialize serial communication
+    diagnostics.markBoot(DIAG_BOOT_SETUP, micros());
+
+    // Initialize serial communication (USB: begin() does not wait for a host)
     Serial.begin(HAT_SERIAL_BAUD_RATE);
-    delay(10000);
+    waitForSerialMonitor();
+    diagnostics.markBoot(DIAG_BOOT_SERIAL, micros());
+
+    // Saved parameters, if there is a valid image; the defaults otherwise
+    paramRegistry.load();
+    paramRegistry.apply();
+
+    // Initialize hardware
+    initializeHardware();
+
+    // Every wheel at zero until the Jetson commands otherwise; done once,
+    // before any link can publish into the store
+    driveSetpoints.clear();
+    
+    // Initialize subsystems
+    initializeSubsystems();
+
+    // Register periodic tasks and release them; the first drive cycle
+    // forwards whatever the Jetson sent while the MCP2517FD came up
+    if (!initializeScheduler()) {
+        #if HAT_DEBUG_ENABLED
+        Serial.println("ERROR: Scheduler task table full (HAT_SCHEDULER_MAX_TASKS)");
+        #endif
+        handleInitializationError();
+        return;
+    }
+    applyParameters();
+    diagnostics.markBoot(DIAG_BOOT_SCHEDULED, micros());
     
+    // The banner waits until both buses are running
     #if HAT_DEBUG_ENABLED
     Serial.println("=== SIRI DriveHAT Starting ===");
     Serial.print("HAT Name: ");
@@ -46,36 +85,33 @@ void setup() {
     Serial.println(HAT_VERSION);
     Serial.print("Node ID: 0x");
     Serial.println(HAT_NODE_ID, HEX);
-    #endif
-    
-    // Initialize hardware
-    initializeHardware();
-    
-    // Initialize subsystems
-    initializeSubsystems();
-    
-    #if HAT_DEBUG_ENABLED
     Serial.println("=== Initialization Complete ===");
     #endif
 }
 
-void loop() {
-    unsigned long currentTime = millis();
-    
-    // Process CAN messages
-    std::array<CANFDMessage, 8> msg = processCANMessages();
-    
-    // Update state machine
-    updateStateMachine(currentTime);
-    
-    // Update components
-    updateComponents(msg);
-    
-    // Handle status indicators
-    updateStatusIndicators();
+void waitForSerialMonitor() {
+    #if HAT_FAST_BOOT
+    // Unstrapped (pulled up), boot goes straight on
+    pinMode(PIN_DEBUG_STRAP, INPUT_PULLUP);
+    delayMicroseconds(10);
+    if (digitalRead(PIN_DEBUG_STRAP) == HIGH) {
+        return;
+    }
+    #endif
 
-    // Small delay to prevent overwhelming the system
-    delay(1);
+    // Goes on as soon as the monitor opens the port
+    const uint32_t start = millis();
+    while (!Serial && millis() - start < HAT_BOOT_SERIAL_WAIT_MS) {
+        delay(1);
+    }
+}
+
+void loop() {
+    // Run every task whose release time has passed; never blocks
+    if (scheduler.run(micros()) == 0) {
+        // Idle: lowest priority work only
+        traceDrain(HAT_TRACE_DRAIN_BUDGET);
+    }
 }
 
 void initializeHardware() {
@@ -87,7 +123,18 @@ void initializeHardware() {
 }
 
 void initializeSubsystems() {
-    // Initialize CAN interface
+    // Initialize state machine first: state commands are handled from the
+    // FlexCAN interrupt as soon as the Jetson link is up
+    if (!stateMachine.initialize()) {
+        #if HAT_DEBUG_ENABLED
+        Serial.println("ERROR: State machine initialization failed");
+        #endif
+        handleInitializationError();
+        return;
+    }
+
+    // Initialize CAN interface. FlexCAN setup does not block, so the Jetson
+    // link receives (and stores setpoints) while the MCP2517FD comes up.
     if (!canInterface.initialize()) {
         #if HAT_DEBUG_ENABLED
         Serial.println("ERROR: CAN interface initialization failed");
@@ -96,17 +143,21 @@ void initializeSubsystems() {
         handleInitializationError();
         return;
     }
-    
-    // Initialize state machine
-    if (!stateMachine.initialize()) {
+
+    #if HAT_JETSON_AUX_ENABLED
+    if (!auxCanInterface.initialize()) {
         #if HAT_DEBUG_ENABLED
-        Serial.println("ERROR: State machine initialization failed");
+        Serial.println("ERROR: Auxiliary CAN interface initialization failed");
         #endif
         handleInitializationError();
         return;
     }
+    #endif
+    diagnostics.markBoot(DIAG_BOOT_JETSON_UP, micros());
     
-    // Initialize component controller
+    // Initialize component controller. begin() waits for the MCP2517FD
+    // oscillator and mode change; its crystal has been starting since
+    // power-on, so most of that wait is already over.
     if (!componentController.initialize()) {
         #if HAT_DEBUG_ENABLED
         Serial.println("ERROR: Component controller initialization failed");
@@ -114,59 +165,255 @@ void initializeSubsystems() {
         handleInitializationError();
         return;
     }
+    diagnostics.markBoot(DIAG_BOOT_PERIPH_UP, micros());
+}
+
+bool initializeScheduler() {
+    // Registration order is priority order; addTask() is -1 once the table
+    // is full, and a task missing from it would silently never run
+    bool registered = true;
+    driveTxTaskId = scheduler.addTask("drive_tx", driveTxTask, paramRegistry.get(PARAM_DRIVE_TX_INTERVAL_US));
+    registered &= driveTxTaskId >= 0;
+    registered &= scheduler.addTask("state", stateTask, HAT_STATE_INTERVAL_MS * 1000UL) >= 0;
+    telemetryTaskId = scheduler.addTask("telemetry", telemetryTask,
+                                        paramRegistry.get(PARAM_TELEMETRY_INTERVAL_MS) * 1000UL);
+    registered &= telemetryTaskId >= 0;
+    #if HAT_TELEMETRY_AGGREGATION
+    registered &= scheduler.addTask("summaries", telemetrySummaryTask, HAT_AGG_TICK_MS * 1000UL) >= 0;
+    #endif
+    heartbeatTaskId = scheduler.addTask("heartbeat", heartbeatTask,
+                                        paramRegistry.get(PARAM_HEARTBEAT_INTERVAL_MS) * 1000UL);
+    registered &= heartbeatTaskId >= 0;
+    registered &= scheduler.addTask("diagnostics", diagnosticsTask, HAT_DIAG_INTERVAL_MS * 1000UL) >= 0;
+    registered &= scheduler.addTask("bus_monitor", busMonitorTask, HAT_BUS_POLL_INTERVAL_MS * 1000UL) >= 0;
+    registered &= scheduler.addTask("status_led", statusLedTask, HAT_STATUS_LED_INTERVAL_MS * 1000UL) >= 0;
+    if (!registered) {
+        return false;
+    }
+
+    scheduler.start(micros());
+    return true;
 }
 
+void driveTxTask(uint32_t nowMicros) {
+    // Parameter changes staged since the last cycle, all at once
+    if (paramRegistry.apply()) {
+        applyParameters();
+    }
 
-std::array<CANFDMessage, 8> processCANMessages() {
-    std::array<CANFDMessage, 8> messages;
+    // Pull ODrive feedback off the peripheral bus
+    processPeripheralMessages();
 
-    // --- Node ID mapping (example) ---
-    static constexpr uint8_t driveNode[4] = {
-        NODE_DRIVE_FL,
-        NODE_DRIVE_FR,
-        NODE_DRIVE_RL,
-        NODE_DRIVE_RR
-    };
+    // Process CAN messages
+    const DriveSetpoints_t& setpoints = processCANMessages();
 
-    static constexpr uint8_t steerNode[4] = {
-        NODE_STEER_FL,
-        NODE_STEER_FR,
-        NODE_STEER_RL,
-        NODE_STEER_RR
-    };
+    // Update components
+    updateComponents(setpoints);
+}
 
-    // --- DRIVE VELOCITY MESSAGES (index 0–3) ---
-    for (int i = 0; i < 4; ++i) {
-        messages[i] = buildVelocityMsg(
-            driveNode[i],       // CAN node ID
-            angular_vel[i],     // float velocity (rad/s)
-            0.0f                // torque FF
-        );
+void stateTask(uint32_t nowMicros) {
+    // Update state machine
+    updateStateMachine();
+}
+
+void telemetryTask(uint32_t nowMicros) {
+    // Forward encoder feedback to the Jetson, all wheels at one timestamp
+    DriveTelemetry_t telemetry;
+    if (driveTelemetry.snapshot(telemetry, nowMicros)) {
+        canInterface.sendDriveTelemetry(telemetry);
+        #if HAT_JETSON_AUX_ENABLED
+        auxCanInterface.sendDriveTelemetry(telemetry);
+        #endif
     }
+}
 
-    // --- STEERING POSITION MESSAGES (index 4–7) ---
-    for (int i = 0; i < 4; ++i) {
-        messages[4 + i] = buildPositionMsg(
-            steerNode[i],        // CAN node ID
-            steering_angle[i]    // float position (radians)
-        );
+void telemetrySummaryTask(uint32_t nowMicros) {
+    // Windows closed together go out back to back, on every telemetry link
+    TelemetrySummary_t summaries[TELEMETRY_SIGNAL_COUNT];
+    const uint8_t count = telemetryAggregator.collect(nowMicros, summaries, TELEMETRY_SIGNAL_COUNT);
+    if (count > 0) {
+        canInterface.sendTelemetrySummaries(summaries, count);
+        #if HAT_JETSON_AUX_ENABLED
+        auxCanInterface.sendTelemetrySummaries(summaries, count);
+        #endif
     }
+}
 
-    return messages;
+void heartbeatTask(uint32_t nowMicros) {
+    canInterface.sendHeartbeat(stateMachine.getCurrentState(), millis());
+    #if HAT_JETSON_AUX_ENABLED
+    auxCanInterface.sendHeartbeat(stateMachine.getCurrentState(), millis());
+    #endif
+
+    #if HAT_DEBUG_ENABLED
+    reportSchedulerStats();
+    reportBootTimeline();
+    #endif
 }
 
+void diagnosticsTask(uint32_t nowMicros) {
+    diagnostics.sample(nowMicros);
+    componentController.recordQueueDepths();
+    canInterface.recordQueueDepths();
 
-void updateStateMachine(unsigned long currentTime) {
-    // Check for state timeouts
-    if (currentTime - lastStateCheck >= HAT_STATE_TIMEOUT_MS) {
-        stateMachine.handleTimeout();
-        lastStateCheck = currentTime;
+    // At most HAT_DIAG_MAX_RECORDS frames, only when the Jetson asked
+    canInterface.serviceDiagnostics();
+
+    // Config requests are staged here and applied by the next drive cycle;
+    // a save goes to EEPROM one word per period
+    paramRegistry.serviceStore();
+    canInterface.serviceConfig();
+
+    #if HAT_JETSON_AUX_ENABLED
+    auxCanInterface.recordQueueDepths();
+    auxCanInterface.serviceDiagnostics();
+    auxCanInterface.serviceConfig();
+    #endif
+}
+
+void busMonitorTask(uint32_t nowMicros) {
+    // Frames a link could not send (refused, or expired in the peripheral
+    // queue) count against the fault that was up
+    busSupervisor.poll(DIAG_BUS_JETSON, canInterface, diagnostics.getTxFailures(DIAG_BUS_JETSON), nowMicros);
+    busSupervisor.poll(DIAG_BUS_PERIPH, componentController, diagnostics.getTxFailures(DIAG_BUS_PERIPH), nowMicros);
+    #if HAT_JETSON_AUX_ENABLED
+    busSupervisor.poll(DIAG_BUS_JETSON_AUX, auxCanInterface, diagnostics.getTxFailures(DIAG_BUS_JETSON_AUX), nowMicros);
+    #endif
+}
+
+void statusLedTask(uint32_t nowMicros) {
+    // Handle status indicators
+    updateStatusIndicators();
+}
+
+const DriveSetpoints_t& processCANMessages() {
+    // One consistent copy of all four wheels for this control cycle, kept
+    // in place so the TX path reads it by reference
+    static DriveSetpoints_t setpoints;
+    driveSetpoints.snapshot(setpoints);
+
+    return setpoints;
+}
+
+void processPeripheralMessages() {
+    // Bounded, so a burst of feedback cannot stall the drive cycle
+    componentController.drainReceive(HAT_PERIPH_RX_DRAIN_BUDGET);
+}
+
+void updateStateMachine() {
+    // State change hooks and timeouts (called every HAT_STATE_INTERVAL_MS)
+    stateMachine.update();
+
+    // Setpoints stop being taken once the HAT leaves POWER_ARMED; the last
+    // ones are dropped too, so the wheels ramp to zero rather than holding
+    // them until they are stale, steering stays where it is, and re-arming
+    // starts from rest
+    static bool wasArmed = false;
+    const HAT_State_t state = stateMachine.getCurrentState();
+    const bool armed = state == STATE_POWER_ARMED;
+    if (wasArmed && !armed) {
+        driveSetpoints.clear();
+    }
+    wasArmed = armed;
+
+    // The stop stays latched until the state machine is out of
+    // EMERGENCY_STOP and back on (a RESET, which may already be followed by
+    // an ARM) - never in POWER_OFF
+    if (state != STATE_EMERGENCY_STOP && state != STATE_POWER_OFF && componentController.isEmergencyStopped()) {
+        componentController.clearEmergencyStop();
     }
 }
 
-void updateComponents(std::array<CANFDMessage, 8> msg) {
+void updateComponents(const DriveSetpoints_t& setpoints) {
     // Update component states based on current HAT state
-    componentController.update(msg);
+    componentController.update(setpoints);
+}
+
+// Only for a task that was registered
+static void setTaskPeriod(int8_t taskId, uint32_t periodMicros) {
+    if (taskId >= 0) {
+        scheduler.setPeriod((uint8_t)taskId, periodMicros);
+    }
+}
+
+void applyParameters() {
+    // Output rates and the state timeout
+    setTaskPeriod(driveTxTaskId, paramRegistry.get(PARAM_DRIVE_TX_INTERVAL_US));
+    setTaskPeriod(telemetryTaskId, paramRegistry.get(PARAM_TELEMETRY_INTERVAL_MS) * 1000UL);
+    setTaskPeriod(heartbeatTaskId, paramRegistry.get(PARAM_HEARTBEAT_INTERVAL_MS) * 1000UL);
+    stateMachine.setTimeout(paramRegistry.get(PARAM_STATE_TIMEOUT_MS));
+
+    // Setpoint suppression, staleness and shaping limits
+    SetpointTuning_t tuning;
+    tuning.velocityEpsilon = paramRegistry.getFloat(PARAM_SETPOINT_VEL_EPSILON);
+    tuning.positionEpsilon = paramRegistry.getFloat(PARAM_SETPOINT_POS_EPSILON);
+    tuning.refreshMs = (uint16_t)paramRegistry.get(PARAM_SETPOINT_REFRESH_MS);
+    tuning.staleMs = (uint16_t)paramRegistry.get(PARAM_SETPOINT_STALE_MS);
+    tuning.staleDecel = paramRegistry.getFloat(PARAM_SETPOINT_STALE_DECEL);
+    componentController.setSetpointTuning(tuning);
+
+    WheelLimits_t limits;
+    limits.maxDriveAccel = paramRegistry.getFloat(PARAM_SHAPER_DRIVE_ACCEL);
+    limits.maxSteerRate = paramRegistry.getFloat(PARAM_SHAPER_STEER_RATE);
+    limits.maxSteerAccel = paramRegistry.getFloat(PARAM_SHAPER_STEER_ACCEL);
+    for (uint8_t wheel = 0; wheel < HatProfile::wheelCount; wheel++) {
+        componentController.setWheelLimits(wheel, limits);
+    }
+
+    // Telemetry summaries, one setting per signal group
+    TelemetrySignalConfig_t steer;
+    steer.intervalMs = (uint16_t)paramRegistry.get(PARAM_AGG_STEER_INTERVAL_MS);
+    steer.fields = (uint8_t)paramRegistry.get(PARAM_AGG_STEER_FIELDS);
+    steer.budgetBytes = (uint16_t)paramRegistry.get(PARAM_AGG_STEER_BUDGET);
+    TelemetrySignalConfig_t drive;
+    drive.intervalMs = (uint16_t)paramRegistry.get(PARAM_AGG_DRIVE_INTERVAL_MS);
+    drive.fields = (uint8_t)paramRegistry.get(PARAM_AGG_DRIVE_FIELDS);
+    drive.budgetBytes = (uint16_t)paramRegistry.get(PARAM_AGG_DRIVE_BUDGET);
+    for (uint8_t signal = 0; signal < TELEMETRY_SIGNAL_COUNT; signal++) {
+        telemetryAggregator.setSignalConfig(signal, signal < TELEMETRY_SIGNAL_DRIVE_VEL ? steer : drive);
+    }
+}
+
+void reportBootTimeline() {
+    // Once, after the first setpoint has been forwarded
+    static bool reported = false;
+    if (reported || diagnostics.getBootMicros(DIAG_BOOT_FIRST_FORWARD) == 0) {
+        return;
+    }
+    reported = true;
+
+    static const char* const PHASES[DIAG_BOOT_PHASE_COUNT] = {
+        "setup", "serial", "jetson_up", "periph_up", "scheduled", "first_command", "first_forward"
+    };
+    Serial.print("boot");
+    for (uint8_t phase = 0; phase < DIAG_BOOT_PHASE_COUNT; phase++) {
+        Serial.print(" ");
+        Serial.print(PHASES[phase]);
+        Serial.print("=");
+        Serial.print(diagnostics.getBootMicros(phase));
+        Serial.print("us");
+    }
+    Serial.println();
+}
+
+void reportSchedulerStats() {
+    for (uint8_t i = 0; i < scheduler.getTaskCount(); i++) {
+        const TaskStats_t& stats = scheduler.getStats(i);
+        Serial.print("sched ");
+        Serial.print(scheduler.getTaskName(i));
+        Serial.print(" runs=");
+        Serial.print(stats.runs);
+        Serial.print(" late_max=");
+        Serial.print(stats.maxLatenessMicros);
+        Serial.print("us interval=");
+        Serial.print(stats.runs > 1 ? stats.minIntervalMicros : 0);
+        Serial.print("-");
+        Serial.print(stats.maxIntervalMicros);
+        Serial.print("us exec_max=");
+        Serial.print(stats.maxExecMicros);
+        Serial.print("us overruns=");
+        Serial.println(stats.overruns);
+    }
 }
 
 void updateStatusIndicators() {
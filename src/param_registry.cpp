@@ -0,0 +1,298 @@
+/**
+ * @file param_registry.cpp
+ * @brief Runtime parameters: typed table, staged changes, EEPROM image
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "param_registry.h"
+#include <stddef.h>
+#include <string.h>
+#include <EEPROM.h>
+
+#define PARAM_INFO(name, id, type, def, min, max) { #name, (id), (type), (float)(def), (float)(min), (float)(max) },
+static const ParamInfo_t PARAM_TABLE[HAT_PARAM_COUNT] = {
+    HAT_PARAMS(PARAM_INFO)
+};
+#undef PARAM_INFO
+
+// The ID and type of every entry, for the image signature
+#define PARAM_LAYOUT(name, id, type, def, min, max) (id), (type),
+static constexpr uint8_t PARAM_LAYOUT_BYTES[] = {
+    HAT_PARAMS(PARAM_LAYOUT)
+};
+#undef PARAM_LAYOUT
+
+static constexpr uint32_t crc32Step(uint32_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+    }
+    return crc;
+}
+
+static constexpr uint32_t layoutSignature() {
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (uint16_t i = 0; i < sizeof(PARAM_LAYOUT_BYTES); ++i) {
+        crc = crc32Step(crc, PARAM_LAYOUT_BYTES[i]);
+    }
+    return ~crc;
+}
+
+// CONFIG_GET walks the table in order
+static constexpr bool idsAscending() {
+    for (uint16_t i = 2; i < sizeof(PARAM_LAYOUT_BYTES); i += 2) {
+        if (PARAM_LAYOUT_BYTES[i] <= PARAM_LAYOUT_BYTES[i - 2]) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(idsAscending(), "HAT_PARAMS IDs must be unique and in ascending order");
+static_assert(PARAM_LAYOUT_BYTES[2 * (HAT_PARAM_COUNT - 1)] != CONFIG_ID_STORE,
+              "CONFIG_ID_STORE is not a parameter ID");
+
+ParamRegistry paramRegistry;
+
+// EEPROM image at HAT_PARAM_EEPROM_ADDR
+#define PARAM_STORE_MAGIC 0x5048          // "HP"
+#define PARAM_STORE_VERSION 1
+
+typedef struct {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;
+    uint32_t layout;                // layoutSignature() of the build that wrote it
+    uint32_t values[HAT_PARAM_COUNT];
+    uint32_t crc;                   // CRC-32 of everything above
+} ParamImage_t;
+
+static_assert(HAT_PARAM_EEPROM_ADDR + sizeof(ParamImage_t) <= HAT_PARAM_EEPROM_SIZE,
+              "the parameter image does not fit the EEPROM");
+static_assert(sizeof(ParamImage_t) == sizeof(uint32_t) * (HAT_PARAM_COUNT + 3),
+              "ParamRegistry::storeImage must hold one ParamImage_t");
+
+#define PARAM_STORE_WORDS (HAT_PARAM_COUNT + 3)
+
+static uint32_t imageCrc(const ParamImage_t& image) {
+    const uint8_t* bytes = (const uint8_t*)&image;
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (size_t i = 0; i < offsetof(ParamImage_t, crc); ++i) {
+        crc = crc32Step(crc, bytes[i]);
+    }
+    return ~crc;
+}
+
+// A raw word read back as the parameter's type, for range checks
+static float rawValue(uint8_t index, uint32_t raw) {
+    switch (PARAM_TABLE[index].type) {
+        case PARAM_TYPE_U8:
+            return raw <= 0xFF ? (float)raw : -1.0f;
+        case PARAM_TYPE_U16:
+            return raw <= 0xFFFF ? (float)raw : -1.0f;
+        case PARAM_TYPE_F32: {
+            float value;
+            memcpy(&value, &raw, sizeof(value));
+            return value;
+        }
+        default:
+            return (float)raw;
+    }
+}
+
+static bool inRange(uint8_t index, uint32_t raw) {
+    // Written so a NaN is out of range
+    const float value = rawValue(index, raw);
+    return value >= PARAM_TABLE[index].min && value <= PARAM_TABLE[index].max;
+}
+
+ParamRegistry::ParamRegistry()
+    : pending(false), fromStore(false), applies(0), rejected(0), storeImage(), storeNext(PARAM_STORE_WORDS),
+      storeOwner(0), storeRequester(0), storeStatus(CONFIG_STATUS_OK), storeDone(false) {
+    for (uint8_t i = 0; i < HAT_PARAM_COUNT; ++i) {
+        staged[i] = encode(i, PARAM_TABLE[i].defaultValue);
+        active[i] = staged[i];
+    }
+}
+
+int8_t ParamRegistry::find(uint8_t id) {
+    for (uint8_t i = 0; i < HAT_PARAM_COUNT; ++i) {
+        if (PARAM_TABLE[i].id == id) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+int8_t ParamRegistry::findByName(const char* name) {
+    for (uint8_t i = 0; i < HAT_PARAM_COUNT; ++i) {
+        if (strcmp(PARAM_TABLE[i].name, name) == 0) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+const ParamInfo_t& ParamRegistry::info(uint8_t index) {
+    return PARAM_TABLE[index < HAT_PARAM_COUNT ? index : 0];
+}
+
+uint32_t ParamRegistry::encode(uint8_t index, float value) {
+    if (index < HAT_PARAM_COUNT && PARAM_TABLE[index].type == PARAM_TYPE_F32) {
+        uint32_t raw;
+        memcpy(&raw, &value, sizeof(raw));
+        return raw;
+    }
+    return value > 0.0f ? (uint32_t)(value + 0.5f) : 0;
+}
+
+uint8_t ParamRegistry::set(uint8_t index, uint32_t raw) {
+    if (index >= HAT_PARAM_COUNT) {
+        rejected++;
+        return CONFIG_STATUS_UNKNOWN;
+    }
+    if (!inRange(index, raw)) {
+        rejected++;
+        return CONFIG_STATUS_RANGE;
+    }
+    if (staged[index] != raw) {
+        staged[index] = raw;
+        pending = true;
+    }
+    return CONFIG_STATUS_OK;
+}
+
+uint32_t ParamRegistry::getStaged(uint8_t index) const {
+    return index < HAT_PARAM_COUNT ? staged[index] : 0;
+}
+
+void ParamRegistry::loadDefaults() {
+    for (uint8_t i = 0; i < HAT_PARAM_COUNT; ++i) {
+        staged[i] = encode(i, PARAM_TABLE[i].defaultValue);
+    }
+    pending = true;
+    fromStore = false;
+}
+
+uint8_t ParamRegistry::load() {
+    // Half an image would fail its CRC anyway
+    if (isSaving()) {
+        return CONFIG_STATUS_DENIED;
+    }
+    ParamImage_t image;
+    EEPROM.get(HAT_PARAM_EEPROM_ADDR, image);
+    if (image.magic != PARAM_STORE_MAGIC || image.version != PARAM_STORE_VERSION ||
+        image.count != HAT_PARAM_COUNT || image.layout != layoutSignature() || image.crc != imageCrc(image)) {
+        fromStore = false;
+        return CONFIG_STATUS_STORE;
+    }
+
+    // All or nothing: one bad value and the image is not used
+    for (uint8_t i = 0; i < HAT_PARAM_COUNT; ++i) {
+        if (!inRange(i, image.values[i])) {
+            fromStore = false;
+            return CONFIG_STATUS_STORE;
+        }
+    }
+    memcpy(staged, image.values, sizeof(staged));
+    pending = true;
+    fromStore = true;
+    return CONFIG_STATUS_OK;
+}
+
+uint8_t ParamRegistry::save(uint8_t owner, uint8_t requester) {
+    if (isSaving()) {
+        return CONFIG_STATUS_DENIED;
+    }
+    ParamImage_t image;
+    memset(&image, 0, sizeof(image));
+    image.magic = PARAM_STORE_MAGIC;
+    image.version = PARAM_STORE_VERSION;
+    image.count = HAT_PARAM_COUNT;
+    image.layout = layoutSignature();
+    memcpy(image.values, staged, sizeof(image.values));
+    image.crc = imageCrc(image);
+
+    memcpy(storeImage, &image, sizeof(storeImage));
+    storeNext = 0;
+    storeOwner = owner;
+    storeRequester = requester;
+    storeStatus = CONFIG_STATUS_OK;
+    storeDone = false;
+    return CONFIG_STATUS_OK;
+}
+
+bool ParamRegistry::serviceStore() {
+    if (!isSaving()) {
+        return false;
+    }
+
+    // put() only rewrites bytes that changed, which saves flash wear; each
+    // word is read back before the next, and the first that differs ends
+    // the save
+    const int address = HAT_PARAM_EEPROM_ADDR + (int)(storeNext * sizeof(uint32_t));
+    EEPROM.put(address, storeImage[storeNext]);
+    uint32_t check = 0;
+    EEPROM.get(address, check);
+    if (check != storeImage[storeNext]) {
+        storeStatus = CONFIG_STATUS_STORE;
+        storeNext = PARAM_STORE_WORDS;
+    } else {
+        storeNext++;
+    }
+    if (isSaving()) {
+        return false;
+    }
+    storeDone = true;
+    return true;
+}
+
+bool ParamRegistry::isSaving() const {
+    return storeNext < PARAM_STORE_WORDS;
+}
+
+bool ParamRegistry::takeSaveResult(uint8_t owner, uint8_t& requester, uint8_t& status) {
+    if (!storeDone || owner != storeOwner) {
+        return false;
+    }
+    storeDone = false;
+    requester = storeRequester;
+    status = storeStatus;
+    return true;
+}
+
+bool ParamRegistry::apply() {
+    if (!pending) {
+        return false;
+    }
+    memcpy(active, staged, sizeof(active));
+    pending = false;
+    applies++;
+    return true;
+}
+
+uint32_t ParamRegistry::get(HatParam_t param) const {
+    return param < HAT_PARAM_COUNT ? active[param] : 0;
+}
+
+float ParamRegistry::getFloat(HatParam_t param) const {
+    const uint32_t raw = get(param);
+    if (param < HAT_PARAM_COUNT && PARAM_TABLE[param].type == PARAM_TYPE_F32) {
+        float value;
+        memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+    return (float)raw;
+}
+
+uint32_t ParamRegistry::getApplyCount() const {
+    return applies;
+}
+
+uint32_t ParamRegistry::getRejectedCount() const {
+    return rejected;
+}
+
+bool ParamRegistry::isLoadedFromStore() const {
+    return fromStore;
+}
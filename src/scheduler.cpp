@@ -0,0 +1,137 @@
+/**
+ * @file scheduler.cpp
+ * @brief Cooperative fixed-rate task scheduler
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "scheduler.h"
+#include <string.h>
+#include "Arduino.h"
+
+static void resetTaskStats(TaskStats_t& stats) {
+    memset(&stats, 0, sizeof(stats));
+    stats.minIntervalMicros = UINT32_MAX;
+}
+
+TaskScheduler::TaskScheduler() : tasks(), taskCount(0) {
+}
+
+int8_t TaskScheduler::addTask(const char* name, TaskFunction_t function, uint32_t periodMicros) {
+    if (taskCount >= HAT_SCHEDULER_MAX_TASKS || function == nullptr || periodMicros == 0) {
+        return -1;
+    }
+
+    Task_t& task = tasks[taskCount];
+    task.name = name;
+    task.function = function;
+    task.periodMicros = periodMicros;
+    task.nextReleaseMicros = 0;
+    task.lastStartMicros = 0;
+    resetTaskStats(task.stats);
+
+    return (int8_t)taskCount++;
+}
+
+void TaskScheduler::setPeriod(uint8_t taskId, uint32_t periodMicros) {
+    if (taskId < taskCount && periodMicros > 0) {
+        tasks[taskId].periodMicros = periodMicros;
+    }
+}
+
+uint32_t TaskScheduler::getPeriod(uint8_t taskId) const {
+    return taskId < taskCount ? tasks[taskId].periodMicros : 0;
+}
+
+void TaskScheduler::start(uint32_t nowMicros) {
+    // Every task is released immediately, then on its own period
+    for (uint8_t i = 0; i < taskCount; i++) {
+        tasks[i].nextReleaseMicros = nowMicros;
+        tasks[i].lastStartMicros = nowMicros;
+        resetTaskStats(tasks[i].stats);
+    }
+}
+
+void TaskScheduler::runTask(Task_t& task, uint32_t nowMicros) {
+    TaskStats_t& stats = task.stats;
+
+    const uint32_t lateness = nowMicros - task.nextReleaseMicros;
+    if (lateness > stats.maxLatenessMicros) {
+        stats.maxLatenessMicros = lateness;
+    }
+    stats.totalLatenessMicros += lateness;
+
+    if (stats.runs > 0) {
+        const uint32_t interval = nowMicros - task.lastStartMicros;
+        if (interval < stats.minIntervalMicros) {
+            stats.minIntervalMicros = interval;
+        }
+        if (interval > stats.maxIntervalMicros) {
+            stats.maxIntervalMicros = interval;
+        }
+    }
+    task.lastStartMicros = nowMicros;
+
+    task.function(nowMicros);
+    stats.runs++;
+
+    const uint32_t exec = micros() - nowMicros;
+    if (exec > stats.maxExecMicros) {
+        stats.maxExecMicros = exec;
+    }
+
+    // Advance by whole periods so the phase is kept; releases that are
+    // already a full period in the past are dropped and counted
+    task.nextReleaseMicros += task.periodMicros;
+    const uint32_t now = micros();
+    if ((int32_t)(now - task.nextReleaseMicros) >= (int32_t)task.periodMicros) {
+        const uint32_t missed = (now - task.nextReleaseMicros) / task.periodMicros;
+        stats.overruns += missed;
+        task.nextReleaseMicros += missed * task.periodMicros;
+    }
+}
+
+uint8_t TaskScheduler::run(uint32_t nowMicros) {
+    uint8_t ran = 0;
+    for (uint8_t i = 0; i < taskCount; i++) {
+        if ((int32_t)(nowMicros - tasks[i].nextReleaseMicros) >= 0) {
+            runTask(tasks[i], nowMicros);
+            ran++;
+            // Later tasks see the time actually spent by earlier ones
+            nowMicros = micros();
+        }
+    }
+    return ran;
+}
+
+uint32_t TaskScheduler::microsUntilNextRelease(uint32_t nowMicros) const {
+    uint32_t soonest = UINT32_MAX;
+    for (uint8_t i = 0; i < taskCount; i++) {
+        const int32_t remaining = (int32_t)(tasks[i].nextReleaseMicros - nowMicros);
+        if (remaining <= 0) {
+            return 0;
+        }
+        if ((uint32_t)remaining < soonest) {
+            soonest = (uint32_t)remaining;
+        }
+    }
+    return soonest;
+}
+
+uint8_t TaskScheduler::getTaskCount() const {
+    return taskCount;
+}
+
+const char* TaskScheduler::getTaskName(uint8_t taskId) const {
+    return taskId < taskCount ? tasks[taskId].name : "";
+}
+
+const TaskStats_t& TaskScheduler::getStats(uint8_t taskId) const {
+    return tasks[taskId < taskCount ? taskId : 0].stats;
+}
+
+void TaskScheduler::resetStats() {
+    for (uint8_t i = 0; i < taskCount; i++) {
+        resetTaskStats(tasks[i].stats);
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * @file setpoint_shaper.cpp
+ * @brief Interpolation and rate limiting of Jetson setpoints at the ODrive rate
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "setpoint_shaper.h"
+#include <math.h>
+#include <string.h>
+#include "hat_config.h"
+
+// Moves value toward target by at most step (step <= 0: no limit)
+static float slew(float value, float target, float step) {
+    if (step <= 0.0f) {
+        return target;
+    }
+    if (target > value + step) {
+        return value + step;
+    }
+    if (target < value - step) {
+        return value - step;
+    }
+    return target;
+}
+
+SetpointShaper::SetpointShaper() {
+    memset(wheels, 0, sizeof(wheels));
+    memset(limits, 0, sizeof(limits));
+}
+
+void SetpointShaper::setLimits(uint8_t wheel, const WheelLimits_t& wheelLimits) {
+    if (wheel < DRIVE_WHEEL_COUNT) {
+        limits[wheel] = wheelLimits;
+    }
+}
+
+const WheelLimits_t& SetpointShaper::getLimits(uint8_t wheel) const {
+    return limits[wheel < DRIVE_WHEEL_COUNT ? wheel : 0];
+}
+
+float SetpointShaper::reference(float start, float target, const WheelShape_t& shape, uint32_t nowMicros) const {
+    const uint32_t into = nowMicros - shape.startMicros;
+    if (shape.intervalMicros == 0 || into >= shape.intervalMicros) {
+        return target;
+    }
+    return start + (target - start) * ((float)into / (float)shape.intervalMicros);
+}
+
+void SetpointShaper::track(uint8_t wheel, float velocity, float position, uint32_t receivedMicros,
+                           uint32_t nowMicros) {
+    if (wheel >= DRIVE_WHEEL_COUNT) {
+        return;
+    }
+    WheelShape_t& shape = wheels[wheel];
+    if (shape.primed && receivedMicros == shape.receivedMicros) {
+        return;
+    }
+
+    // The new segment starts wherever the reference is now, so it never jumps
+    uint32_t interval = 0;
+    if (!shape.primed) {
+        if (!shape.positioned) {
+            shape.position = position;
+            shape.positioned = true;
+        }
+        shape.velocityStart = shape.velocity;
+        shape.positionStart = shape.position;
+    } else {
+        shape.velocityStart = reference(shape.velocityStart, shape.velocityTarget, shape, nowMicros);
+        shape.positionStart = reference(shape.positionStart, shape.positionTarget, shape, nowMicros);
+#if HAT_SHAPER_INTERPOLATE
+        // After a pause there is no rate to follow: go for the target
+        interval = receivedMicros - shape.receivedMicros;
+        if (interval > HAT_SHAPER_INTERP_MAX_US) {
+            interval = 0;
+        }
+#endif
+    }
+
+    shape.velocityTarget = velocity;
+    shape.positionTarget = position;
+    shape.startMicros = nowMicros;
+    shape.intervalMicros = interval;
+    shape.receivedMicros = receivedMicros;
+    shape.primed = true;
+}
+
+void SetpointShaper::step(uint8_t wheel, uint32_t nowMicros, uint32_t elapsedMicros) {
+    if (wheel >= DRIVE_WHEEL_COUNT || !wheels[wheel].primed) {
+        return;
+    }
+    WheelShape_t& shape = wheels[wheel];
+    const WheelLimits_t& limit = limits[wheel];
+
+    // A late or first cycle is not allowed to make up for lost time in one go
+    const float dt = (float)(elapsedMicros < HAT_SHAPER_MAX_STEP_US ? elapsedMicros : HAT_SHAPER_MAX_STEP_US) * 1e-6f;
+    if (dt <= 0.0f) {
+        return;
+    }
+
+    const float velocityRef = reference(shape.velocityStart, shape.velocityTarget, shape, nowMicros);
+    const float positionRef = reference(shape.positionStart, shape.positionTarget, shape, nowMicros);
+
+    shape.velocity = slew(shape.velocity, velocityRef, limit.maxDriveAccel * dt);
+
+    // Steering: the fastest rate that can still stop on the reference,
+    // reached at no more than the acceleration limit
+    const float error = positionRef - shape.position;
+    const float distance = fabsf(error);
+    float rate = distance / dt;
+    if (limit.maxSteerAccel > 0.0f) {
+        rate = fminf(rate, sqrtf(2.0f * limit.maxSteerAccel * distance));
+    }
+    if (limit.maxSteerRate > 0.0f) {
+        rate = fminf(rate, limit.maxSteerRate);
+    }
+    const float accelStep = limit.maxSteerAccel * dt;
+    shape.steerRate = slew(shape.steerRate, error < 0.0f ? -rate : rate, accelStep);
+    shape.position += shape.steerRate * dt;
+
+    // Settle rather than dither around the reference
+    if (fabsf(positionRef - shape.position) <= accelStep * dt && fabsf(shape.steerRate) <= accelStep) {
+        shape.position = positionRef;
+        shape.steerRate = 0.0f;
+    }
+
+    if (shape.velocity != velocityRef || shape.position != positionRef) {
+        shape.limitedCount++;
+    }
+}
+
+float SetpointShaper::getVelocity(uint8_t wheel) const {
+    return wheel < DRIVE_WHEEL_COUNT ? wheels[wheel].velocity : 0.0f;
+}
+
+float SetpointShaper::getPosition(uint8_t wheel) const {
+    return wheel < DRIVE_WHEEL_COUNT ? wheels[wheel].position : 0.0f;
+}
+
+void SetpointShaper::setVelocity(uint8_t wheel, float velocity) {
+    if (wheel >= DRIVE_WHEEL_COUNT) {
+        return;
+    }
+    WheelShape_t& shape = wheels[wheel];
+    shape.velocity = velocity;
+    shape.velocityStart = velocity;
+    shape.velocityTarget = velocity;
+}
+
+void SetpointShaper::setPosition(uint8_t wheel, float position) {
+    if (wheel >= DRIVE_WHEEL_COUNT) {
+        return;
+    }
+    WheelShape_t& shape = wheels[wheel];
+    shape.position = position;
+    shape.positionStart = position;
+    shape.positionTarget = position;
+    shape.steerRate = 0.0f;
+    shape.positioned = true;
+}
+
+bool SetpointShaper::isPrimed(uint8_t wheel) const {
+    return wheel < DRIVE_WHEEL_COUNT && wheels[wheel].primed;
+}
+
+uint32_t SetpointShaper::getLimitedCount(uint8_t wheel) const {
+    return wheel < DRIVE_WHEEL_COUNT ? wheels[wheel].limitedCount : 0;
+}
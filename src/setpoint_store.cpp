@@ -0,0 +1,75 @@
+/**
+ * @file setpoint_store.cpp
+ * @brief Lock-free seqlock store for Jetson drive setpoints
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "setpoint_store.h"
+#include <string.h>
+#include "Arduino.h"
+
+DriveSetpointStore::DriveSetpointStore()
+    : sequence(0), data(), publishCount(0), snapshotCount(0), tornReadCount(0) {
+}
+
+void DriveSetpointStore::beginWrite() {
+    // Odd sequence marks a write in progress
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void DriveSetpointStore::endWrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void DriveSetpointStore::publish(uint8_t wheel, float omega, float theta, uint32_t receivedMicros) {
+    if (wheel >= DRIVE_WHEEL_COUNT) {
+        return;
+    }
+
+    beginWrite();
+    data.angular_vel[wheel] = omega;
+    data.steering_angle[wheel] = theta;
+    data.received_us[wheel] = receivedMicros;
+    endWrite();
+
+    publishCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DriveSetpointStore::clear() {
+    // The ISR is the only other writer, so keep it out for the few stores
+    noInterrupts();
+    beginWrite();
+    memset(&data, 0, sizeof(data));
+    endWrite();
+    interrupts();
+}
+
+void DriveSetpointStore::snapshot(DriveSetpoints_t& out) {
+    for (;;) {
+        const uint32_t before = sequence.load(std::memory_order_acquire);
+        if ((before & 1u) == 0) {
+            memcpy(&out, &data, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        // The ISR published while we were copying - try again
+        tornReadCount++;
+    }
+    snapshotCount++;
+}
+
+uint32_t DriveSetpointStore::getPublishCount() const {
+    return publishCount.load(std::memory_order_relaxed);
+}
+
+uint32_t DriveSetpointStore::getSnapshotCount() const {
+    return snapshotCount;
+}
+
+uint32_t DriveSetpointStore::getTornReadCount() const {
+    return tornReadCount;
+}
@@ -7,99 +7,180 @@
 
 #include "state_machine.h"
 #include "hat_config.h"
+#include "trace.h"
 #include "Arduino.h"
 
-HATStateMachine::HATStateMachine() {
-    // Constructor implementation
+constexpr HATStateTables HAT_BASE_STATE_TABLES = HATStateTables::base();
+
+HATStateMachine *HATStateMachineInstance = nullptr;
+
+// Table dimensions follow the enums
+static_assert(STATE_EMERGENCY_STOP == HAT_STATE_COUNT - 1, "HAT_STATE_COUNT out of date");
+static_assert(AUTHORITY_EMERGENCY == HAT_AUTHORITY_COUNT - 1, "HAT_AUTHORITY_COUNT out of date");
+static_assert(EVENT_TIMEOUT == HAT_EVENT_COUNT - 1, "HAT_EVENT_COUNT out of date");
+
+// A stop must be reachable whatever state the HAT is in
+static_assert(HATStateTables::base().permits(AUTHORITY_EMERGENCY, EVENT_EMERGENCY),
+              "every authority must be able to raise EVENT_EMERGENCY");
+static_assert(HATStateTables::base().nextState(STATE_POWER_ARMED, EVENT_EMERGENCY) == STATE_EMERGENCY_STOP,
+              "EVENT_EMERGENCY must lead to STATE_EMERGENCY_STOP");
+static_assert(!HATStateTables::base().allows(STATE_EMERGENCY_STOP, MSG_TYPE_PACKED_SETPOINTS) &&
+              !HATStateTables::base().allows(STATE_EMERGENCY_STOP, HAT_CMD_DRIVE),
+              "setpoints must not be accepted after an emergency stop");
+
+static const char* const STATE_NAMES[HAT_STATE_COUNT] = {
+    "POWER_OFF", "DISARMED", "LOCKED", "UNLOCKED", "POWER_ARMED", "EMERGENCY_STOP"
+};
+
+HATStateMachine::HATStateMachine(const HATStateTables& tables)
+    : tables(tables), currentState(STATE_DISARMED), transitionCount(0), rejectedEvents(0),
+      stateEntryTime(0), lastActivityTime(0), timeoutMs(HAT_STATE_TIMEOUT_MS), enteredState(STATE_DISARMED), handledTransitions(0) {
+    HATStateMachineInstance = this;
 }
 
 HATStateMachine::~HATStateMachine() {
-    // Destructor implementation
 }
 
 bool HATStateMachine::initialize() {
-    // Initialize state machine
-    return true; // Placeholder
-}
-
-HAT_State_t HATStateMachine::getCurrentState() {
-    // Get current state
-    return STATE_DISARMED; // Initial state after boot, transitions to LOCKED
+    // Boot into DISARMED and wait for the Jetson to lock or unlock the HAT
+    currentState.store(STATE_DISARMED, std::memory_order_relaxed);
+    enteredState = STATE_DISARMED;
+    handledTransitions = transitionCount.load(std::memory_order_relaxed);
+    updateStateTimestamp();
+    resetTimeout();
+    onEnterState(STATE_DISARMED);
+    return true;
+}
+
+void HATStateMachine::update() {
+    const uint32_t transitions = transitionCount.load(std::memory_order_acquire);
+    if (transitions != handledTransitions) {
+        const HAT_State_t state = getCurrentState();
+        handledTransitions = transitions;
+        if (state != enteredState) {
+            onExitState(enteredState);
+            logStateTransition(enteredState, state);
+            enteredState = state;
+            onEnterState(state);
+        }
+    }
+    handleTimeout();
 }
 
 bool HATStateMachine::transitionToState(HAT_State_t newState, Authority_t authority) {
-    // Transition to new state
-    return false; // Placeholder
+    // The first event this authority may raise that leads there
+    const uint8_t from = currentState.load(std::memory_order_relaxed);
+    for (uint8_t event = 0; event < HAT_EVENT_COUNT; event++) {
+        if (tables.nextState(from, event) == newState && tables.permits(authority, event)) {
+            return processEvent((StateMachineEvent_t)event, authority);
+        }
+    }
+    rejectedEvents.fetch_add(1, std::memory_order_relaxed);
+    return false;
 }
 
 bool HATStateMachine::processEvent(StateMachineEvent_t event, Authority_t authority) {
-    // Process state machine event
-    return false; // Placeholder
+    if (!tables.permits(authority, event)) {
+        rejectedEvents.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Retried if an interrupt changed the state between the load and the swap
+    uint8_t from = currentState.load(std::memory_order_relaxed);
+    uint8_t to;
+    do {
+        to = tables.nextState(from, event);
+        if (to == HAT_STATE_NONE) {
+            rejectedEvents.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (to == from) {
+            resetTimeout();
+            return true;
+        }
+    } while (!currentState.compare_exchange_weak(from, to, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed));
+
+    updateStateTimestamp();
+    resetTimeout();
+    transitionCount.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool HATStateMachine::validateAuthority(Authority_t authority, StateMachineEvent_t event) const {
+    return tables.permits(authority, event);
 }
 
-bool HATStateMachine::isCommandAllowed(uint8_t commandType) {
-    // Check if command is allowed in current state
-    return false; // Placeholder
+void HATStateMachine::handleTimeout() {
+    // Operator silence drops an unlocked or armed HAT back to LOCKED
+    const uint32_t idle = millis() - lastActivityTime.load(std::memory_order_relaxed);
+    if (idle >= timeoutMs &&
+        tables.nextState(currentState.load(std::memory_order_relaxed), EVENT_TIMEOUT) != HAT_STATE_NONE) {
+        processEvent(EVENT_TIMEOUT, AUTHORITY_SYSTEM);
+    }
 }
 
-bool HATStateMachine::validateAuthority(Authority_t authority, StateMachineEvent_t event) {
-    // Validate authority for event
-    return false; // Placeholder
+void HATStateMachine::resetTimeout() {
+    lastActivityTime.store(millis(), std::memory_order_relaxed);
 }
 
-void HATStateMachine::handleTimeout() {
-    // Handle state timeout
+void HATStateMachine::setTimeout(uint32_t newTimeoutMs) {
+    timeoutMs = newTimeoutMs;
 }
 
-void HATStateMachine::resetTimeout() {
-    // Reset timeout timer
+uint32_t HATStateMachine::getTimeout() const {
+    return timeoutMs;
 }
 
-uint32_t HATStateMachine::getStateUptime() {
-    // Get time in current state
-    return 0; // Placeholder
+uint32_t HATStateMachine::getStateUptime() const {
+    return millis() - stateEntryTime.load(std::memory_order_relaxed);
 }
 
 void HATStateMachine::handleEmergency() {
-    // Handle emergency condition
+    processEvent(EVENT_EMERGENCY, AUTHORITY_EMERGENCY);
 }
 
 void HATStateMachine::enterSafeMode() {
-    // Enter safe mode
+    // Nothing moves in LOCKED; already safe if the table has no way there
+    processEvent(EVENT_LOCK, AUTHORITY_SYSTEM);
 }
 
-const char* HATStateMachine::getStateName(HAT_State_t state) {
-    // Get state name string
-    return "UNKNOWN"; // Placeholder
+const char* HATStateMachine::getStateName(HAT_State_t state) const {
+    return (uint8_t)state < HAT_STATE_COUNT ? STATE_NAMES[state] : "UNKNOWN";
 }
 
-const char* HATStateMachine::getCurrentStateName() {
-    // Get current state name
-    return "UNKNOWN"; // Placeholder
+const char* HATStateMachine::getCurrentStateName() const {
+    return getStateName(getCurrentState());
 }
 
-void HATStateMachine::onEnterState(HAT_State_t state) {
-    // Virtual function - override in derived classes
+uint32_t HATStateMachine::getTransitionCount() const {
+    return transitionCount.load(std::memory_order_relaxed);
 }
 
-void HATStateMachine::onExitState(HAT_State_t state) {
-    // Virtual function - override in derived classes
+uint32_t HATStateMachine::getRejectedEvents() const {
+    return rejectedEvents.load(std::memory_order_relaxed);
 }
 
-bool HATStateMachine::validateTransition(HAT_State_t from, HAT_State_t to) {
+void HATStateMachine::onEnterState(HAT_State_t state) {
     // Virtual function - override in derived classes
-    return false; // Placeholder
 }
 
-bool HATStateMachine::isValidTransition(HAT_State_t from, HAT_State_t to) {
-    // Check if transition is valid
-    return false; // Placeholder
+void HATStateMachine::onExitState(HAT_State_t state) {
+    // Virtual function - override in derived classes
 }
 
 void HATStateMachine::updateStateTimestamp() {
-    // Update state timestamp
+    stateEntryTime.store(millis(), std::memory_order_relaxed);
 }
 
 void HATStateMachine::logStateTransition(HAT_State_t from, HAT_State_t to) {
-    // Log state transition
-}
\ No newline at end of file
+    const uint8_t states[2] = { (uint8_t)from, (uint8_t)to };
+    TRACE_EVENT(TRACE_EVENT_STATE, HAT_NODE_ID, states, sizeof(states));
+
+    #if HAT_DEBUG_ENABLED
+    Serial.print("State: ");
+    Serial.print(getStateName(from));
+    Serial.print(" -> ");
+    Serial.println(getStateName(to));
+    #endif
+}
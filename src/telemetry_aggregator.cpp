@@ -0,0 +1,179 @@
+/**
+ * @file telemetry_aggregator.cpp
+ * @brief Per-signal windows over ODrive feedback, summarised for the Jetson
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "telemetry_aggregator.h"
+#include <string.h>
+
+static_assert(TELEMETRY_SIGNAL_COUNT <= 16, "the summary frame has four bits of signal");
+
+static const TelemetrySignalConfig_t STEER_DEFAULTS = {
+    HAT_AGG_STEER_INTERVAL_MS, HAT_AGG_STEER_FIELDS, HAT_AGG_STEER_BUDGET
+};
+static const TelemetrySignalConfig_t DRIVE_DEFAULTS = {
+    HAT_AGG_DRIVE_INTERVAL_MS, HAT_AGG_DRIVE_FIELDS, HAT_AGG_DRIVE_BUDGET
+};
+
+// Any non-empty mask short of all four fields fits one frame
+static_assert(TELEMETRY_SUMMARY_MAX_FIELDS == 3, "fieldsFit() assumes three fields per frame");
+static bool fieldsFit(uint8_t fields) {
+    return fields != 0 && fields < 0x0F;
+}
+
+TelemetryAggregator::TelemetryAggregator() {
+    memset(windows, 0, sizeof(windows));
+    for (uint8_t signal = 0; signal < TELEMETRY_SIGNAL_COUNT; ++signal) {
+        configs[signal] = signal < TELEMETRY_SIGNAL_DRIVE_VEL ? STEER_DEFAULTS : DRIVE_DEFAULTS;
+        resetWindow(windows[signal]);
+    }
+}
+
+bool TelemetryAggregator::setSignalConfig(uint8_t signal, const TelemetrySignalConfig_t& config) {
+    if (signal >= TELEMETRY_SIGNAL_COUNT || (config.intervalMs != 0 && !fieldsFit(config.fields))) {
+        return false;
+    }
+    configs[signal] = config;
+    return true;
+}
+
+const TelemetrySignalConfig_t& TelemetryAggregator::getSignalConfig(uint8_t signal) const {
+    return configs[signal < TELEMETRY_SIGNAL_COUNT ? signal : 0];
+}
+
+void TelemetryAggregator::record(uint8_t signal, float value) {
+    if (signal >= TELEMETRY_SIGNAL_COUNT || configs[signal].intervalMs == 0 || !(value == value)) {
+        return;
+    }
+    Window_t& window = windows[signal];
+    if (window.count == 0) {
+        window.min = value;
+        window.max = value;
+    } else {
+        if (value < window.min) {
+            window.min = value;
+        }
+        if (value > window.max) {
+            window.max = value;
+        }
+    }
+    window.sum += value;
+    window.last = value;
+    window.count++;
+    window.samples++;
+}
+
+uint8_t TelemetryAggregator::frameBytes(uint8_t fields) {
+    // Extended classic frame with worst-case stuffing, as the bus load
+    // figures in diagnostics.h count it
+    const uint32_t stuffable = 23 + 31 + 8u * telemetrySummaryLength(fields);
+    const uint32_t bits = stuffable + stuffable / 4 + 13;
+    return (uint8_t)((bits + 7) / 8);
+}
+
+bool TelemetryAggregator::spend(uint8_t signal, uint32_t nowMicros) {
+    const TelemetrySignalConfig_t& config = configs[signal];
+    Window_t& window = windows[signal];
+    const float cost = (float)frameBytes(config.fields);
+    if (config.budgetBytes == 0) {
+        window.sentBytes += (uint32_t)cost;
+        return true;
+    }
+
+    window.credit += (float)config.budgetBytes * (float)(nowMicros - window.creditMicros) * 1e-6f;
+    window.creditMicros = nowMicros;
+    const float ceiling = cost * HAT_AGG_BUDGET_BURST;
+    if (window.credit > ceiling) {
+        window.credit = ceiling;
+    }
+    if (window.credit < cost) {
+        return false;
+    }
+    window.credit -= cost;
+    window.sentBytes += (uint32_t)cost;
+    return true;
+}
+
+uint8_t TelemetryAggregator::collect(uint32_t nowMicros, TelemetrySummary_t* out, uint8_t max) {
+    uint8_t count = 0;
+    for (uint8_t signal = 0; signal < TELEMETRY_SIGNAL_COUNT && count < max; ++signal) {
+        const TelemetrySignalConfig_t& config = configs[signal];
+        Window_t& window = windows[signal];
+        if (config.intervalMs == 0) {
+            continue;
+        }
+        if (!window.started) {
+            // The first window, and the budget, start with the first call
+            window.startMicros = nowMicros;
+            window.creditMicros = nowMicros;
+            window.credit = (float)frameBytes(config.fields);
+            window.started = true;
+            continue;
+        }
+
+        const uint32_t interval = (uint32_t)config.intervalMs * 1000UL;
+        if (window.count == 0 || nowMicros - window.startMicros < interval) {
+            continue;
+        }
+        if (!spend(signal, nowMicros)) {
+            if (!window.deferred) {
+                window.deferrals++;
+                window.deferred = true;
+            }
+            continue;
+        }
+
+        TelemetrySummary_t& summary = out[count++];
+        summary.signal = signal;
+        summary.fields = config.fields;
+        summary.count = window.count > 0xFFFF ? 0xFFFF : (uint16_t)window.count;
+        summary.min = window.min;
+        summary.max = window.max;
+        summary.mean = window.sum / (float)window.count;
+        summary.last = window.last;
+        window.summaries++;
+
+        // Keep to the configured rate despite a late tick, but do not try
+        // to catch up after a long gap
+        window.startMicros += interval;
+        if (nowMicros - window.startMicros >= interval) {
+            window.startMicros = nowMicros;
+        }
+        resetWindow(window);
+    }
+    return count;
+}
+
+void TelemetryAggregator::resetWindow(Window_t& window) {
+    window.min = 0.0f;
+    window.max = 0.0f;
+    window.sum = 0.0f;
+    window.last = 0.0f;
+    window.count = 0;
+    window.deferred = false;
+}
+
+void TelemetryAggregator::clear() {
+    for (uint8_t signal = 0; signal < TELEMETRY_SIGNAL_COUNT; ++signal) {
+        resetWindow(windows[signal]);
+        windows[signal].started = false;
+    }
+}
+
+uint32_t TelemetryAggregator::getSampleCount(uint8_t signal) const {
+    return signal < TELEMETRY_SIGNAL_COUNT ? windows[signal].samples : 0;
+}
+
+uint32_t TelemetryAggregator::getSummaryCount(uint8_t signal) const {
+    return signal < TELEMETRY_SIGNAL_COUNT ? windows[signal].summaries : 0;
+}
+
+uint32_t TelemetryAggregator::getDeferredCount(uint8_t signal) const {
+    return signal < TELEMETRY_SIGNAL_COUNT ? windows[signal].deferrals : 0;
+}
+
+uint32_t TelemetryAggregator::getSentBytes(uint8_t signal) const {
+    return signal < TELEMETRY_SIGNAL_COUNT ? windows[signal].sentBytes : 0;
+}
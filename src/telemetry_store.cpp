@@ -0,0 +1,57 @@
+/**
+ * @file telemetry_store.cpp
+ * @brief Latest ODrive encoder feedback for the four drive wheels
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "telemetry_store.h"
+#include <string.h>
+
+DriveTelemetryStore::DriveTelemetryStore() : data(), updateCount(0), steerSeen(0) {
+}
+
+void DriveTelemetryStore::recordDrive(uint8_t wheel, float pos, float vel) {
+    if (wheel >= DRIVE_WHEEL_COUNT) {
+        return;
+    }
+    data.wheel_pos[wheel] = pos;
+    data.angular_vel[wheel] = vel;
+    updateCount++;
+}
+
+void DriveTelemetryStore::recordSteer(uint8_t wheel, float pos) {
+    if (wheel >= DRIVE_WHEEL_COUNT) {
+        return;
+    }
+    data.steering_angle[wheel] = pos;
+    steerSeen |= (uint8_t)(1u << wheel);
+    updateCount++;
+}
+
+void DriveTelemetryStore::clear() {
+    memset(&data, 0, sizeof(data));
+    updateCount = 0;
+    steerSeen = 0;
+}
+
+bool DriveTelemetryStore::snapshot(DriveTelemetry_t& out, uint32_t nowMicros) {
+    if (updateCount == 0) {
+        return false;
+    }
+    memcpy(&out, &data, sizeof(out));
+    out.timestampMicros = nowMicros;
+    return true;
+}
+
+bool DriveTelemetryStore::getSteerPosition(uint8_t wheel, float& pos) const {
+    if (wheel >= DRIVE_WHEEL_COUNT || (steerSeen & (1u << wheel)) == 0) {
+        return false;
+    }
+    pos = data.steering_angle[wheel];
+    return true;
+}
+
+uint32_t DriveTelemetryStore::getUpdateCount() const {
+    return updateCount;
+}
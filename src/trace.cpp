@@ -0,0 +1,141 @@
+/**
+ * @file trace.cpp
+ * @brief Binary trace ring for interrupt-safe logging
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "trace.h"
+#include <atomic>
+#include <string.h>
+#include "Arduino.h"
+
+#if HAT_TRACE_LEVEL > HAT_TRACE_LEVEL_OFF
+
+static_assert((HAT_TRACE_RING_SIZE & (HAT_TRACE_RING_SIZE - 1)) == 0,
+              "HAT_TRACE_RING_SIZE must be a power of two");
+
+static const uint32_t TRACE_MASK = HAT_TRACE_RING_SIZE - 1;
+
+static TraceRecord_t traceRing[HAT_TRACE_RING_SIZE];
+// Per-slot commit marks: (record index + 1) once the slot is fully written
+static std::atomic<uint16_t> traceCommitted[HAT_TRACE_RING_SIZE];
+static std::atomic<uint32_t> traceHead(0);
+static std::atomic<uint32_t> traceTail(0);
+static std::atomic<uint32_t> traceDropped(0);
+static uint32_t traceDroppedReported = 0;
+
+void traceRecord(uint8_t event, uint32_t canId, const uint8_t* data, uint8_t len) {
+    // Reserve a slot. The loop can be preempted by the ISR between the load
+    // and the exchange, hence the CAS rather than a plain increment.
+    uint32_t head = traceHead.load(std::memory_order_relaxed);
+    do {
+        if (head - traceTail.load(std::memory_order_acquire) >= HAT_TRACE_RING_SIZE) {
+            traceDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!traceHead.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed));
+
+    TraceRecord_t& record = traceRing[head & TRACE_MASK];
+    record.timestamp = micros();
+    record.canId = canId;
+    record.event = event;
+    record.len = len;
+    record.sequence = (uint16_t)head;
+    const uint8_t copyLen = len < sizeof(record.data) ? len : sizeof(record.data);
+    if (data != nullptr && copyLen > 0) {
+        memcpy(record.data, data, copyLen);
+    }
+    if (copyLen < sizeof(record.data)) {
+        memset(record.data + copyLen, 0, sizeof(record.data) - copyLen);
+    }
+
+    traceCommitted[head & TRACE_MASK].store((uint16_t)(head + 1), std::memory_order_release);
+}
+
+static const char* traceEventName(uint8_t event) {
+    switch (event) {
+        case TRACE_EVENT_JETSON_RX: return "JETSON_RX";
+        case TRACE_EVENT_JETSON_TX: return "JETSON_TX";
+        case TRACE_EVENT_PERIPH_TX: return "PERIPH_TX";
+        case TRACE_EVENT_PERIPH_TX_FAIL: return "PERIPH_TX_FAIL";
+        case TRACE_EVENT_PERIPH_RX: return "PERIPH_RX";
+        case TRACE_EVENT_STATE: return "STATE";
+        case TRACE_EVENT_BUS: return "BUS";
+        case TRACE_EVENT_BUS_RECOVERY: return "BUS_RECOVERY";
+        default: return "EVENT";
+    }
+}
+
+static void traceEmit(const TraceRecord_t& record) {
+#if HAT_TRACE_STREAM_BINARY
+    Serial.write((const uint8_t*)&record, sizeof(record));
+#else
+    Serial.print(record.timestamp);
+    Serial.print(" us ");
+    Serial.print(traceEventName(record.event));
+    Serial.print(" id=0x");
+    Serial.print(record.canId, HEX);
+    Serial.print(" len=");
+    Serial.print(record.len);
+    const uint8_t shown = record.len < sizeof(record.data) ? record.len : sizeof(record.data);
+    for (uint8_t i = 0; i < shown; i++) {
+        Serial.print(i == 0 ? " : " : " ");
+        if (record.data[i] < 0x10) {
+            Serial.print('0');
+        }
+        Serial.print(record.data[i], HEX);
+    }
+    Serial.println();
+#endif
+}
+
+uint16_t traceDrain(uint16_t maxRecords) {
+    uint16_t drained = 0;
+    uint32_t tail = traceTail.load(std::memory_order_relaxed);
+
+    while (drained < maxRecords) {
+        // Stop at the first slot that is reserved but not yet committed
+        if (traceCommitted[tail & TRACE_MASK].load(std::memory_order_acquire) != (uint16_t)(tail + 1)) {
+            break;
+        }
+        const TraceRecord_t record = traceRing[tail & TRACE_MASK];
+        tail++;
+        traceTail.store(tail, std::memory_order_release);
+
+        traceEmit(record);
+        drained++;
+    }
+
+#if !HAT_TRACE_STREAM_BINARY
+    const uint32_t dropped = traceDropped.load(std::memory_order_relaxed);
+    if (dropped != traceDroppedReported) {
+        Serial.print("trace: ");
+        Serial.print(dropped - traceDroppedReported);
+        Serial.println(" records dropped");
+        traceDroppedReported = dropped;
+    }
+#endif
+
+    return drained;
+}
+
+uint32_t traceDroppedCount() {
+    return traceDropped.load(std::memory_order_relaxed);
+}
+
+#else // HAT_TRACE_LEVEL == HAT_TRACE_LEVEL_OFF
+
+void traceRecord(uint8_t event, uint32_t canId, const uint8_t* data, uint8_t len) {
+}
+
+uint16_t traceDrain(uint16_t maxRecords) {
+    return 0;
+}
+
+uint32_t traceDroppedCount() {
+    return 0;
+}
+
+#endif
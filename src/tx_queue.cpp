@@ -0,0 +1,183 @@
+/**
+ * @file tx_queue.cpp
+ * @brief Priority transmit queue with coalescing and deadlines for the MCP2517FD
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include "tx_queue.h"
+#include "diagnostics.h"
+#include "trace.h"
+
+static_assert(HAT_PERIPH_TX_QUEUE_SIZE > 0 && HAT_PERIPH_TX_QUEUE_SIZE < 255,
+              "HAT_PERIPH_TX_QUEUE_SIZE must fit a uint8_t index");
+
+// Deadline comparisons survive micros() wrapping
+static bool deadlinePassed(uint32_t deadlineMicros, uint32_t nowMicros) {
+    return (int32_t)(nowMicros - deadlineMicros) > 0;
+}
+
+PeripheralTxQueue::PeripheralTxQueue()
+    : entries(), pendingCount(0), peakCount(0), expiredTags(0), sentCount(0), coalescedCount(0),
+      expiredCount(0), rejectedCount(0) {
+}
+
+bool PeripheralTxQueue::moreUrgent(const TxEntry_t& a, const TxEntry_t& b) const {
+    if (a.txClass != b.txClass) {
+        return a.txClass < b.txClass;
+    }
+    return (int32_t)(a.deadlineMicros - b.deadlineMicros) < 0;
+}
+
+int PeripheralTxQueue::findCoalescable(const CANFDMessage& frame) const {
+    for (uint8_t i = 0; i < HAT_PERIPH_TX_QUEUE_SIZE; ++i) {
+        const TxEntry_t& entry = entries[i];
+        if (entry.pending && entry.coalesce && entry.frame.id == frame.id && entry.frame.ext == frame.ext) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PeripheralTxQueue::drop(uint8_t index) {
+    TxEntry_t& entry = entries[index];
+    if (entry.tag < 32) {
+        expiredTags |= 1UL << entry.tag;
+    }
+    entry.pending = false;
+    pendingCount--;
+}
+
+bool PeripheralTxQueue::enqueue(const CANFDMessage& frame, uint8_t txClass, uint32_t deadlineMicros,
+                                bool coalesce, uint8_t tag) {
+    TxEntry_t candidate;
+    candidate.frame = frame;
+    candidate.deadlineMicros = deadlineMicros;
+    candidate.txClass = txClass < TX_CLASS_COUNT ? txClass : TX_CLASS_COUNT - 1;
+    candidate.tag = tag;
+    candidate.coalesce = coalesce;
+    candidate.pending = true;
+
+    // Newest value for this ID replaces the one still waiting
+    int slot = coalesce ? findCoalescable(frame) : -1;
+    if (slot >= 0) {
+        entries[slot] = candidate;
+        coalescedCount++;
+        return true;
+    }
+
+    // Free slot, else the least urgent frame if it is in a lower class
+    int victim = -1;
+    for (uint8_t i = 0; i < HAT_PERIPH_TX_QUEUE_SIZE; ++i) {
+        if (!entries[i].pending) {
+            slot = i;
+            break;
+        }
+        if (victim < 0 || moreUrgent(entries[victim], entries[i])) {
+            victim = i;
+        }
+    }
+    if (slot < 0) {
+        if (entries[victim].txClass <= candidate.txClass) {
+            rejectedCount++;
+            diagnostics.countTx(DIAG_BUS_PERIPH, frame.id, frame.ext, frame.len, false);
+            TRACE_ERROR(TRACE_EVENT_PERIPH_TX_FAIL, frame.id, frame.data, frame.len);
+            return false;
+        }
+        const CANFDMessage& evicted = entries[victim].frame;
+        expiredCount++;
+        diagnostics.countTx(DIAG_BUS_PERIPH, evicted.id, evicted.ext, evicted.len, false);
+        drop((uint8_t)victim);
+        slot = victim;
+    }
+
+    entries[slot] = candidate;
+    pendingCount++;
+    if (pendingCount > peakCount) {
+        peakCount = pendingCount;
+    }
+    return true;
+}
+
+uint8_t PeripheralTxQueue::flush(MCP2517FDTransport& transport, uint32_t nowMicros) {
+    // Late is worse than never for a setpoint: the next one is on its way
+    for (uint8_t i = 0; i < HAT_PERIPH_TX_QUEUE_SIZE; ++i) {
+        if (entries[i].pending && deadlinePassed(entries[i].deadlineMicros, nowMicros)) {
+            const CANFDMessage& frame = entries[i].frame;
+            expiredCount++;
+            diagnostics.countTx(DIAG_BUS_PERIPH, frame.id, frame.ext, frame.len, false);
+            TRACE_EVENT(TRACE_EVENT_PERIPH_TX_FAIL, frame.id, frame.data, frame.len);
+            drop(i);
+        }
+    }
+
+    // Everything pending, in the order it should go out
+    uint8_t order[HAT_PERIPH_TX_QUEUE_SIZE];
+    const CANFDMessage* batch[HAT_PERIPH_TX_QUEUE_SIZE];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < HAT_PERIPH_TX_QUEUE_SIZE; ++i) {
+        if (!entries[i].pending) {
+            continue;
+        }
+        uint8_t at = count++;
+        while (at > 0 && moreUrgent(entries[i], entries[order[at - 1]])) {
+            order[at] = order[at - 1];
+            at--;
+        }
+        order[at] = i;
+    }
+    for (uint8_t i = 0; i < count; ++i) {
+        batch[i] = &entries[order[i]].frame;
+    }
+
+    // Controller FIFO full: the rest waits, and may still be coalesced
+    const uint8_t sent = count > 0 ? transport.sendBatch(batch, count) : 0;
+    for (uint8_t i = 0; i < sent; ++i) {
+        TxEntry_t& entry = entries[order[i]];
+        const CANFDMessage& frame = entry.frame;
+        diagnostics.countTx(DIAG_BUS_PERIPH, frame.id, frame.ext, frame.len, true,
+                            frame.type == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH);
+        TRACE_FRAME(TRACE_EVENT_PERIPH_TX, frame.id, frame.data, frame.len);
+        entry.pending = false;
+        pendingCount--;
+        sentCount++;
+    }
+    return sent;
+}
+
+void PeripheralTxQueue::clear() {
+    for (uint8_t i = 0; i < HAT_PERIPH_TX_QUEUE_SIZE; ++i) {
+        entries[i].pending = false;
+    }
+    pendingCount = 0;
+}
+
+uint32_t PeripheralTxQueue::takeExpiredTags() {
+    const uint32_t tags = expiredTags;
+    expiredTags = 0;
+    return tags;
+}
+
+uint8_t PeripheralTxQueue::getPendingCount() const {
+    return pendingCount;
+}
+
+uint8_t PeripheralTxQueue::getPeakCount() const {
+    return peakCount;
+}
+
+uint32_t PeripheralTxQueue::getSentCount() const {
+    return sentCount;
+}
+
+uint32_t PeripheralTxQueue::getCoalescedCount() const {
+    return coalescedCount;
+}
+
+uint32_t PeripheralTxQueue::getExpiredCount() const {
+    return expiredCount;
+}
+
+uint32_t PeripheralTxQueue::getRejectedCount() const {
+    return rejectedCount;
+}
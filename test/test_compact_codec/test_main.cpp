@@ -0,0 +1,105 @@
+/**
+ * @file test_main.cpp
+ * @brief Unit tests for the compact int16 drive codec (message_construction.h)
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+#include "message_construction.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+static void test_field_round_trip_within_half_lsb(void) {
+    const float angles[] = { 0.0f, 0.00004f, -0.00006f, 1.2345f, -3.0f, 3.2766f };
+    for (uint8_t i = 0; i < sizeof(angles) / sizeof(angles[0]); i++) {
+        const int16_t raw = encodeCompactField(angles[i], DRIVE_COMPACT_ANGLE_SCALE);
+        TEST_ASSERT_FLOAT_WITHIN(DRIVE_COMPACT_ANGLE_SCALE * 0.5f + 1e-6f, angles[i],
+                                 decodeCompactField(raw, DRIVE_COMPACT_ANGLE_SCALE));
+    }
+    const float vels[] = { 0.0f, 0.004f, -12.345f, 250.0f, -327.0f };
+    for (uint8_t i = 0; i < sizeof(vels) / sizeof(vels[0]); i++) {
+        const int16_t raw = encodeCompactField(vels[i], DRIVE_COMPACT_VEL_SCALE);
+        TEST_ASSERT_FLOAT_WITHIN(DRIVE_COMPACT_VEL_SCALE * 0.5f + 1e-4f, vels[i],
+                                 decodeCompactField(raw, DRIVE_COMPACT_VEL_SCALE));
+    }
+}
+
+static void test_field_rounds_to_nearest(void) {
+    TEST_ASSERT_EQUAL_INT16(1, encodeCompactField(0.00006f, DRIVE_COMPACT_ANGLE_SCALE));
+    TEST_ASSERT_EQUAL_INT16(0, encodeCompactField(0.00004f, DRIVE_COMPACT_ANGLE_SCALE));
+    TEST_ASSERT_EQUAL_INT16(-1, encodeCompactField(-0.006f, DRIVE_COMPACT_VEL_SCALE));
+    TEST_ASSERT_EQUAL_INT16(1234, encodeCompactField(12.34f, DRIVE_COMPACT_VEL_SCALE));
+}
+
+static void test_field_saturates_and_sends_nan_as_zero(void) {
+    TEST_ASSERT_EQUAL_INT16(32767, encodeCompactField(DRIVE_COMPACT_ANGLE_MAX, DRIVE_COMPACT_ANGLE_SCALE));
+    TEST_ASSERT_EQUAL_INT16(32767, encodeCompactField(10.0f, DRIVE_COMPACT_ANGLE_SCALE));
+    TEST_ASSERT_EQUAL_INT16(-32767, encodeCompactField(-10.0f, DRIVE_COMPACT_ANGLE_SCALE));
+    TEST_ASSERT_EQUAL_INT16(32767, encodeCompactField(1.0e6f, DRIVE_COMPACT_VEL_SCALE));
+    TEST_ASSERT_EQUAL_INT16(-32767, encodeCompactField(-INFINITY, DRIVE_COMPACT_VEL_SCALE));
+    TEST_ASSERT_EQUAL_INT16(0, encodeCompactField(NAN, DRIVE_COMPACT_VEL_SCALE));
+    TEST_ASSERT_EQUAL_INT16(0, encodeCompactField(NAN, DRIVE_COMPACT_ANGLE_SCALE));
+}
+
+static void test_two_wheel_frame_layout(void) {
+    const DrivePayload_t wheels[2] = { { 0.5f, -20.0f }, { -0.0001f, 1.0f } };
+    uint8_t out[8];
+    memset(out, 0xAA, sizeof(out));
+    TEST_ASSERT_EQUAL_UINT8(8, encodeCompactDrivePayload(wheels, 2, out));
+    // 5000, -2000, -1, 100 little endian
+    const uint8_t expected[8] = { 0x88, 0x13, 0x30, 0xF8, 0xFF, 0xFF, 0x64, 0x00 };
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, sizeof(expected));
+
+    DrivePayload_t decoded[2];
+    TEST_ASSERT_EQUAL_UINT8(2, decodeCompactDrivePayload(out, 8, decoded));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, decoded[0].steering_angle);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, -20.0f, decoded[0].angular_vel);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, -0.0001f, decoded[1].steering_angle);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, decoded[1].angular_vel);
+}
+
+static void test_encode_caps_at_two_wheels(void) {
+    const DrivePayload_t wheels[3] = { { 0.1f, 1.0f }, { 0.2f, 2.0f }, { 0.3f, 3.0f } };
+    uint8_t out[12];
+    memset(out, 0xAA, sizeof(out));
+    TEST_ASSERT_EQUAL_UINT8(8, encodeCompactDrivePayload(wheels, 3, out));
+    for (uint8_t i = 8; i < sizeof(out); i++) {
+        TEST_ASSERT_EQUAL_HEX8(0xAA, out[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT8(4, encodeCompactDrivePayload(wheels, 1, out));
+    TEST_ASSERT_EQUAL_UINT8(0, encodeCompactDrivePayload(wheels, 0, out));
+}
+
+static void test_decode_counts_whole_wheels_only(void) {
+    const DrivePayload_t wheels[2] = { { 1.0f, 10.0f }, { -1.0f, -10.0f } };
+    uint8_t in[8];
+    encodeCompactDrivePayload(wheels, 2, in);
+
+    DrivePayload_t decoded[2] = { { 9.0f, 9.0f }, { 9.0f, 9.0f } };
+    TEST_ASSERT_EQUAL_UINT8(1, decodeCompactDrivePayload(in, 4, decoded));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, decoded[0].steering_angle);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10.0f, decoded[0].angular_vel);
+    TEST_ASSERT_EQUAL_FLOAT(9.0f, decoded[1].steering_angle);
+
+    TEST_ASSERT_EQUAL_UINT8(1, decodeCompactDrivePayload(in, 7, decoded));
+    TEST_ASSERT_EQUAL_UINT8(0, decodeCompactDrivePayload(in, 3, decoded));
+    TEST_ASSERT_EQUAL_UINT8(0, decodeCompactDrivePayload(in, 0, decoded));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_field_round_trip_within_half_lsb);
+    RUN_TEST(test_field_rounds_to_nearest);
+    RUN_TEST(test_field_saturates_and_sends_nan_as_zero);
+    RUN_TEST(test_two_wheel_frame_layout);
+    RUN_TEST(test_encode_caps_at_two_wheels);
+    RUN_TEST(test_decode_counts_whole_wheels_only);
+    return UNITY_END();
+}
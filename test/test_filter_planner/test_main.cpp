@@ -0,0 +1,141 @@
+/**
+ * @file test_main.cpp
+ * @brief Unit tests for the acceptance-filter planner (filter_planner.h)
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include <unity.h>
+#include "filter_planner.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Standard IDs the plan accepts but was not built for, counted one by one
+static uint32_t countExtraStd(const FilterPlan_t& plan, const uint32_t* ids, uint8_t count) {
+    uint32_t extra = 0;
+    for (uint32_t id = 0; id < 0x800; id++) {
+        bool handled = false;
+        for (uint8_t i = 0; i < count; i++) {
+            handled = handled || ids[i] == id;
+        }
+        extra += (!handled && filterPlanAccepts(plan, id)) ? 1 : 0;
+    }
+    return extra;
+}
+
+static void test_one_bit_apart_merge_for_free(void) {
+    const uint32_t ids[] = { 0x210, 0x211, 0x212, 0x213 };
+    FilterPlan_t plan;
+    TEST_ASSERT_TRUE(planFilters(ids, 4, 11, 4, plan));
+    TEST_ASSERT_EQUAL_UINT8(1, plan.count);
+    TEST_ASSERT_EQUAL_HEX32(0x210, plan.filters[0].id);
+    TEST_ASSERT_EQUAL_HEX32(0x7FC, plan.filters[0].mask);
+    TEST_ASSERT_EQUAL_UINT16(4, plan.handledIds);
+    TEST_ASSERT_EQUAL_UINT32(0, plan.extraIds);
+    TEST_ASSERT_FALSE(filterPlanAccepts(plan, 0x214));
+}
+
+static void test_duplicates_count_once(void) {
+    const uint32_t ids[] = { 0x0F0, 0x0F0, 0x0F0 };
+    FilterPlan_t plan;
+    TEST_ASSERT_TRUE(planFilters(ids, 3, 11, 2, plan));
+    TEST_ASSERT_EQUAL_UINT8(1, plan.count);
+    TEST_ASSERT_EQUAL_UINT16(1, plan.handledIds);
+    TEST_ASSERT_EQUAL_HEX32(0x7FF, plan.filters[0].mask);
+    TEST_ASSERT_EQUAL_UINT32(0, plan.extraIds);
+}
+
+static void test_unrelated_ids_keep_exact_filters_within_budget(void) {
+    const uint32_t ids[] = { 0x010, 0x2A5, 0x7F0 };
+    FilterPlan_t plan;
+    TEST_ASSERT_TRUE(planFilters(ids, 3, 11, 3, plan));
+    TEST_ASSERT_EQUAL_UINT8(3, plan.count);
+    TEST_ASSERT_EQUAL_UINT32(0, plan.extraIds);
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(filterPlanAccepts(plan, ids[i]));
+    }
+}
+
+static void test_over_budget_merges_and_counts_extra_ids(void) {
+    const uint32_t ids[] = { 0x010, 0x011, 0x2A5, 0x2A7, 0x7F0, 0x7F8 };
+    for (uint8_t budget = 1; budget <= 4; budget++) {
+        FilterPlan_t plan;
+        TEST_ASSERT_TRUE(planFilters(ids, 6, 11, budget, plan));
+        TEST_ASSERT_LESS_OR_EQUAL(budget, plan.count);
+        for (uint8_t i = 0; i < 6; i++) {
+            TEST_ASSERT_TRUE(filterPlanAccepts(plan, ids[i]));
+        }
+        TEST_ASSERT_EQUAL_UINT32(countExtraStd(plan, ids, 6), plan.extraIds);
+    }
+}
+
+static void test_fewer_filters_never_accept_less(void) {
+    const uint32_t ids[] = { 0x100, 0x104, 0x180, 0x301, 0x302, 0x655, 0x700 };
+    uint32_t previous = 0;
+    for (uint8_t budget = 7; budget >= 1; budget--) {
+        FilterPlan_t plan;
+        TEST_ASSERT_TRUE(planFilters(ids, 7, 11, budget, plan));
+        TEST_ASSERT_GREATER_OR_EQUAL(previous, plan.extraIds);
+        previous = plan.extraIds;
+    }
+}
+
+static void test_extended_keys_bound_extra_ids(void) {
+    // Extended routes are planned on target << 8 | type (16 bits)
+    const uint32_t keys[] = { 0x2014, 0x2040, 0x2041, 0x2042, 0x2043, 0x2030, 0x2035 };
+    FilterPlan_t plan;
+    TEST_ASSERT_TRUE(planFilters(keys, 7, 16, 1, plan));
+    TEST_ASSERT_EQUAL_UINT8(1, plan.count);
+    uint32_t extra = 0;
+    for (uint32_t key = 0; key < 0x10000; key++) {
+        bool handled = false;
+        for (uint8_t i = 0; i < 7; i++) {
+            handled = handled || keys[i] == key;
+        }
+        TEST_ASSERT_TRUE(!handled || filterPlanAccepts(plan, key));
+        extra += (!handled && filterPlanAccepts(plan, key)) ? 1 : 0;
+    }
+    // The sum of covers is an upper bound above 11 bits
+    TEST_ASSERT_GREATER_OR_EQUAL(extra, plan.extraIds);
+    TEST_ASSERT_FALSE(filterPlanAccepts(plan, 0x1014));
+}
+
+static void test_invalid_requests_give_empty_plan(void) {
+    uint32_t ids[FILTER_PLAN_MAX_IDS + 1];
+    for (uint8_t i = 0; i <= FILTER_PLAN_MAX_IDS; i++) {
+        ids[i] = i;
+    }
+    FilterPlan_t plan;
+    TEST_ASSERT_FALSE(planFilters(ids, 0, 11, 4, plan));
+    TEST_ASSERT_EQUAL_UINT8(0, plan.count);
+    TEST_ASSERT_FALSE(planFilters(ids, 4, 11, 0, plan));
+    TEST_ASSERT_EQUAL_UINT8(0, plan.count);
+    TEST_ASSERT_FALSE(planFilters(ids, FILTER_PLAN_MAX_IDS + 1, 11, 4, plan));
+    TEST_ASSERT_EQUAL_UINT8(0, plan.count);
+    TEST_ASSERT_FALSE(filterPlanAccepts(plan, 0));
+}
+
+static void test_rejection_rate_covers_dedicated_ids(void) {
+    const uint32_t ids[] = { 0x123 };
+    FilterPlan_t plan;
+    TEST_ASSERT_TRUE(planFilters(ids, 1, 11, 1, plan));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f - 1.0f / 2048.0f, filterPlanRejectionRate(plan));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f - 5.0f / 2048.0f, filterPlanRejectionRate(plan, 4));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_bit_apart_merge_for_free);
+    RUN_TEST(test_duplicates_count_once);
+    RUN_TEST(test_unrelated_ids_keep_exact_filters_within_budget);
+    RUN_TEST(test_over_budget_merges_and_counts_extra_ids);
+    RUN_TEST(test_fewer_filters_never_accept_less);
+    RUN_TEST(test_extended_keys_bound_extra_ids);
+    RUN_TEST(test_invalid_requests_give_empty_plan);
+    RUN_TEST(test_rejection_rate_covers_dedicated_ids);
+    return UNITY_END();
+}
@@ -0,0 +1,236 @@
+/**
+ * @file test_main.cpp
+ * @brief Unit tests for the parameter registry and its EEPROM image (param_registry.h)
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include <string.h>
+#include <unity.h>
+#include <EEPROM.h>
+#include "param_registry.h"
+#include "message_construction.h"
+
+// Image layout: magic, version, count, layout signature, values, CRC-32
+#define IMAGE_VERSION_OFFSET 2
+#define IMAGE_LAYOUT_OFFSET 4
+#define IMAGE_VALUES_OFFSET 8
+#define IMAGE_CRC_OFFSET (IMAGE_VALUES_OFFSET + 4 * HAT_PARAM_COUNT)
+#define IMAGE_WORDS (HAT_PARAM_COUNT + 3)
+
+void setUp(void) {
+    EEPROM.erase();
+}
+
+void tearDown(void) {
+}
+
+static uint32_t crc32(const uint8_t* bytes, size_t len) {
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= bytes[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t readWord(int offset) {
+    uint32_t word = 0;
+    EEPROM.get(HAT_PARAM_EEPROM_ADDR + offset, word);
+    return word;
+}
+
+// Rewrite the CRC so only the field under test is wrong
+static void resealImage() {
+    uint8_t bytes[IMAGE_CRC_OFFSET];
+    for (int i = 0; i < IMAGE_CRC_OFFSET; i++) {
+        bytes[i] = EEPROM.read(HAT_PARAM_EEPROM_ADDR + i);
+    }
+    const uint32_t crc = crc32(bytes, sizeof(bytes));
+    EEPROM.put(HAT_PARAM_EEPROM_ADDR + IMAGE_CRC_OFFSET, crc);
+}
+
+// Save and run the store task until it finishes; returns the calls it took
+static uint32_t saveAndWait(ParamRegistry& registry) {
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, registry.save(1, 2));
+    uint32_t calls = 0;
+    while (registry.isSaving()) {
+        registry.serviceStore();
+        calls++;
+    }
+    return calls;
+}
+
+static void test_save_is_spread_over_store_calls(void) {
+    ParamRegistry registry;
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, registry.save(1, 7));
+    TEST_ASSERT_TRUE(registry.isSaving());
+    TEST_ASSERT_EQUAL_UINT32(0, EEPROM.bytesWritten());
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_DENIED, registry.save(1, 7));
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_DENIED, registry.load());
+
+    uint8_t requester = 0;
+    uint8_t status = 0xFF;
+    for (uint8_t i = 0; i < IMAGE_WORDS - 1; i++) {
+        TEST_ASSERT_FALSE(registry.serviceStore());
+        TEST_ASSERT_LESS_OR_EQUAL(4u * (i + 1), EEPROM.bytesWritten());
+    }
+    TEST_ASSERT_FALSE(registry.takeSaveResult(1, requester, status));
+    TEST_ASSERT_TRUE(registry.serviceStore());
+    TEST_ASSERT_FALSE(registry.isSaving());
+    TEST_ASSERT_FALSE(registry.serviceStore());
+
+    // Once, and only to the owner that started it
+    TEST_ASSERT_FALSE(registry.takeSaveResult(2, requester, status));
+    TEST_ASSERT_TRUE(registry.takeSaveResult(1, requester, status));
+    TEST_ASSERT_EQUAL_UINT8(7, requester);
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, status);
+    TEST_ASSERT_FALSE(registry.takeSaveResult(1, requester, status));
+}
+
+static void test_image_layout_and_crc(void) {
+    ParamRegistry registry;
+    saveAndWait(registry);
+
+    TEST_ASSERT_EQUAL_HEX16(0x5048, (uint16_t)readWord(0));
+    TEST_ASSERT_EQUAL_UINT8(1, EEPROM.read(HAT_PARAM_EEPROM_ADDR + IMAGE_VERSION_OFFSET));
+    TEST_ASSERT_EQUAL_UINT8(HAT_PARAM_COUNT, EEPROM.read(HAT_PARAM_EEPROM_ADDR + 3));
+
+    // Signature: CRC-32 of the ID and type of every entry, in table order
+#define PARAM_LAYOUT(name, id, type, def, min, max) (id), (type),
+    const uint8_t layout[] = { HAT_PARAMS(PARAM_LAYOUT) };
+#undef PARAM_LAYOUT
+    TEST_ASSERT_EQUAL_HEX32(crc32(layout, sizeof(layout)), readWord(IMAGE_LAYOUT_OFFSET));
+
+    for (uint8_t i = 0; i < HAT_PARAM_COUNT; i++) {
+        TEST_ASSERT_EQUAL_HEX32(registry.getStaged(i), readWord(IMAGE_VALUES_OFFSET + 4 * i));
+    }
+    uint8_t bytes[IMAGE_CRC_OFFSET];
+    for (int i = 0; i < IMAGE_CRC_OFFSET; i++) {
+        bytes[i] = EEPROM.read(HAT_PARAM_EEPROM_ADDR + i);
+    }
+    TEST_ASSERT_EQUAL_HEX32(crc32(bytes, sizeof(bytes)), readWord(IMAGE_CRC_OFFSET));
+}
+
+static void test_round_trip_through_store(void) {
+    ParamRegistry writer;
+    const int8_t telemetry = ParamRegistry::find(0x01);
+    const int8_t epsilon = ParamRegistry::findByName("SETPOINT_VEL_EPSILON");
+    TEST_ASSERT_TRUE(telemetry >= 0);
+    TEST_ASSERT_TRUE(epsilon >= 0);
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, writer.set(telemetry, 50));
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, writer.set(epsilon, ParamRegistry::encode(epsilon, 0.25f)));
+    TEST_ASSERT_EQUAL_UINT32(IMAGE_WORDS, saveAndWait(writer));
+
+    ParamRegistry reader;
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, reader.load());
+    TEST_ASSERT_TRUE(reader.isLoadedFromStore());
+    // Staged only until the next drive cycle applies it
+    TEST_ASSERT_EQUAL_UINT32(HatProfile::telemetryIntervalMs, reader.get(PARAM_TELEMETRY_INTERVAL_MS));
+    TEST_ASSERT_TRUE(reader.apply());
+    TEST_ASSERT_EQUAL_UINT32(50, reader.get(PARAM_TELEMETRY_INTERVAL_MS));
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, reader.getFloat(PARAM_SETPOINT_VEL_EPSILON));
+    for (uint8_t i = 0; i < HAT_PARAM_COUNT; i++) {
+        TEST_ASSERT_EQUAL_HEX32(writer.getStaged(i), reader.getStaged(i));
+    }
+}
+
+static void test_unchanged_image_writes_nothing(void) {
+    ParamRegistry registry;
+    saveAndWait(registry);
+    const uint32_t written = EEPROM.bytesWritten();
+    saveAndWait(registry);
+    TEST_ASSERT_EQUAL_UINT32(written, EEPROM.bytesWritten());
+}
+
+static void test_erased_store_keeps_defaults(void) {
+    ParamRegistry registry;
+    const uint32_t before = registry.getStaged(PARAM_TELEMETRY_INTERVAL_MS);
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_STORE, registry.load());
+    TEST_ASSERT_FALSE(registry.isLoadedFromStore());
+    TEST_ASSERT_FALSE(registry.apply());
+    TEST_ASSERT_EQUAL_UINT32(before, registry.getStaged(PARAM_TELEMETRY_INTERVAL_MS));
+}
+
+static void test_corrupted_image_is_rejected(void) {
+    ParamRegistry writer;
+    writer.set(PARAM_TELEMETRY_INTERVAL_MS, 50);
+    saveAndWait(writer);
+
+    const int value = HAT_PARAM_EEPROM_ADDR + IMAGE_VALUES_OFFSET + 4 * PARAM_TELEMETRY_INTERVAL_MS;
+    EEPROM.write(value, EEPROM.read(value) ^ 0x01);
+    ParamRegistry reader;
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_STORE, reader.load());
+    TEST_ASSERT_FALSE(reader.isLoadedFromStore());
+    TEST_ASSERT_EQUAL_UINT32(HatProfile::telemetryIntervalMs, reader.getStaged(PARAM_TELEMETRY_INTERVAL_MS));
+
+    // Put right again, the same image loads
+    EEPROM.write(value, EEPROM.read(value) ^ 0x01);
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, reader.load());
+}
+
+static void test_other_layout_or_version_is_rejected(void) {
+    ParamRegistry writer;
+    writer.set(PARAM_TELEMETRY_INTERVAL_MS, 50);
+    saveAndWait(writer);
+
+    // A sound image from a build with another table
+    const uint32_t layout = readWord(IMAGE_LAYOUT_OFFSET);
+    const uint32_t otherLayout = layout ^ 0x80000000UL;
+    EEPROM.put(HAT_PARAM_EEPROM_ADDR + IMAGE_LAYOUT_OFFSET, otherLayout);
+    resealImage();
+    ParamRegistry reader;
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_STORE, reader.load());
+    TEST_ASSERT_EQUAL_UINT32(HatProfile::telemetryIntervalMs, reader.getStaged(PARAM_TELEMETRY_INTERVAL_MS));
+
+    EEPROM.put(HAT_PARAM_EEPROM_ADDR + IMAGE_LAYOUT_OFFSET, layout);
+    EEPROM.write(HAT_PARAM_EEPROM_ADDR + IMAGE_VERSION_OFFSET, 2);
+    resealImage();
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_STORE, reader.load());
+
+    EEPROM.write(HAT_PARAM_EEPROM_ADDR + IMAGE_VERSION_OFFSET, 1);
+    resealImage();
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_OK, reader.load());
+}
+
+static void test_out_of_range_value_rejects_whole_image(void) {
+    ParamRegistry writer;
+    writer.set(PARAM_TELEMETRY_INTERVAL_MS, 50);
+    saveAndWait(writer);
+
+    const uint32_t tooFast = 1;
+    EEPROM.put(HAT_PARAM_EEPROM_ADDR + IMAGE_VALUES_OFFSET + 4 * PARAM_DRIVE_TX_INTERVAL_US, tooFast);
+    resealImage();
+    ParamRegistry reader;
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_STORE, reader.load());
+    TEST_ASSERT_FALSE(reader.isLoadedFromStore());
+    TEST_ASSERT_EQUAL_UINT32(HatProfile::telemetryIntervalMs, reader.getStaged(PARAM_TELEMETRY_INTERVAL_MS));
+}
+
+static void test_set_checks_range_and_type(void) {
+    ParamRegistry registry;
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_RANGE, registry.set(PARAM_TELEMETRY_INTERVAL_MS, 5));
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_RANGE, registry.set(PARAM_TELEMETRY_INTERVAL_MS, 0x10000));
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_RANGE,
+                            registry.set(PARAM_SETPOINT_VEL_EPSILON, 0x7FC00000UL));   // NaN
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_STATUS_UNKNOWN, registry.set(HAT_PARAM_COUNT, 0));
+    TEST_ASSERT_EQUAL_UINT32(4, registry.getRejectedCount());
+    TEST_ASSERT_FALSE(registry.apply());
+    TEST_ASSERT_EQUAL_INT8(-1, ParamRegistry::find(0xFE));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_save_is_spread_over_store_calls);
+    RUN_TEST(test_image_layout_and_crc);
+    RUN_TEST(test_round_trip_through_store);
+    RUN_TEST(test_unchanged_image_writes_nothing);
+    RUN_TEST(test_erased_store_keeps_defaults);
+    RUN_TEST(test_corrupted_image_is_rejected);
+    RUN_TEST(test_other_layout_or_version_is_rejected);
+    RUN_TEST(test_out_of_range_value_rejects_whole_image);
+    RUN_TEST(test_set_checks_range_and_type);
+    return UNITY_END();
+}
@@ -0,0 +1,209 @@
+/**
+ * @file test_main.cpp
+ * @brief Unit tests for the telemetry summary frame and its aggregator
+ *        (message_construction.h, telemetry_aggregator.h)
+ * @author SIRI Electrical Team
+ * @date 2025
+ */
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+#include "message_construction.h"
+#include "telemetry_aggregator.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+// Only the given signal is summarised
+static void configureOnly(TelemetryAggregator& agg, uint8_t signal, const TelemetrySignalConfig_t& config) {
+    const TelemetrySignalConfig_t off = { 0, 0, 0 };
+    for (uint8_t s = 0; s < TELEMETRY_SIGNAL_COUNT; s++) {
+        TEST_ASSERT_TRUE(agg.setSignalConfig(s, s == signal ? config : off));
+    }
+}
+
+static void test_summary_round_trip(void) {
+    TelemetrySummary_t summary = { TELEMETRY_SIGNAL_DRIVE_VEL + 2,
+                                   TELEMETRY_FIELD_MIN | TELEMETRY_FIELD_MAX | TELEMETRY_FIELD_MEAN,
+                                   42, -12.5f, 30.25f, 4.01f, 0.0f };
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL_UINT8(8, encodeTelemetrySummary(summary, out));
+    TEST_ASSERT_EQUAL_HEX8(0x76, out[0]);
+    TEST_ASSERT_EQUAL_UINT8(42, out[1]);
+    // -1250 little endian
+    TEST_ASSERT_EQUAL_HEX8(0x1E, out[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xFB, out[3]);
+
+    TelemetrySummary_t decoded;
+    TEST_ASSERT_TRUE(decodeTelemetrySummary(out, 8, decoded));
+    TEST_ASSERT_EQUAL_UINT8(summary.signal, decoded.signal);
+    TEST_ASSERT_EQUAL_UINT8(summary.fields, decoded.fields);
+    TEST_ASSERT_EQUAL_UINT16(42, decoded.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, -12.5f, decoded.min);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 30.25f, decoded.max);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 4.01f, decoded.mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, decoded.last);
+}
+
+static void test_summary_uses_signal_scale_and_saturates_count(void) {
+    TelemetrySummary_t summary = { TELEMETRY_SIGNAL_STEER_ANGLE + 1,
+                                   TELEMETRY_FIELD_MEAN | TELEMETRY_FIELD_LAST,
+                                   1000, 0.0f, 0.0f, 0.1234f, -1.5f };
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL_UINT8(6, encodeTelemetrySummary(summary, out));
+    TEST_ASSERT_EQUAL_UINT8(255, out[1]);
+    TelemetrySummary_t decoded;
+    TEST_ASSERT_TRUE(decodeTelemetrySummary(out, 6, decoded));
+    TEST_ASSERT_FLOAT_WITHIN(DRIVE_COMPACT_ANGLE_SCALE, 0.1234f, decoded.mean);
+    TEST_ASSERT_FLOAT_WITHIN(DRIVE_COMPACT_ANGLE_SCALE, -1.5f, decoded.last);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, decoded.min);
+}
+
+static void test_summary_drops_fields_past_the_third(void) {
+    TelemetrySummary_t summary = { TELEMETRY_SIGNAL_DRIVE_VEL, 0x0F, 3, 1.0f, 2.0f, 3.0f, 4.0f };
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL_UINT8(8, encodeTelemetrySummary(summary, out));
+    TEST_ASSERT_EQUAL_HEX8(0x74, out[0]);
+    TEST_ASSERT_EQUAL_UINT8(8, telemetrySummaryLength(0x0F));
+}
+
+static void test_summary_decode_rejects_bad_frames(void) {
+    TelemetrySummary_t summary = { TELEMETRY_SIGNAL_DRIVE_VEL, 0x07, 3, 1.0f, 2.0f, 3.0f, 0.0f };
+    uint8_t out[8];
+    encodeTelemetrySummary(summary, out);
+    TelemetrySummary_t decoded;
+    TEST_ASSERT_FALSE(decodeTelemetrySummary(out, 1, decoded));
+    TEST_ASSERT_FALSE(decodeTelemetrySummary(out, 7, decoded));
+
+    uint8_t bad[8];
+    memcpy(bad, out, sizeof(bad));
+    bad[0] = (uint8_t)(0x70 | TELEMETRY_SIGNAL_COUNT);
+    TEST_ASSERT_FALSE(decodeTelemetrySummary(bad, 8, decoded));
+    bad[0] = 0xF0;
+    TEST_ASSERT_FALSE(decodeTelemetrySummary(bad, 8, decoded));
+}
+
+static void test_config_rejects_unknown_signal_and_wide_masks(void) {
+    TelemetryAggregator agg;
+    const TelemetrySignalConfig_t wide = { 10, 0x0F, 0 };
+    const TelemetrySignalConfig_t empty = { 10, 0, 0 };
+    const TelemetrySignalConfig_t ok = { 10, 0x07, 0 };
+    TEST_ASSERT_FALSE(agg.setSignalConfig(0, wide));
+    TEST_ASSERT_FALSE(agg.setSignalConfig(0, empty));
+    TEST_ASSERT_FALSE(agg.setSignalConfig(TELEMETRY_SIGNAL_COUNT, ok));
+    TEST_ASSERT_TRUE(agg.setSignalConfig(0, ok));
+    TEST_ASSERT_EQUAL_HEX8(0x07, agg.getSignalConfig(0).fields);
+}
+
+static void test_window_summarises_samples(void) {
+    TelemetryAggregator agg;
+    const uint8_t signal = TELEMETRY_SIGNAL_DRIVE_VEL + 1;
+    const TelemetrySignalConfig_t config = { 10, 0x07, 0 };
+    configureOnly(agg, signal, config);
+
+    TelemetrySummary_t out[TELEMETRY_SIGNAL_COUNT];
+    TEST_ASSERT_EQUAL_UINT8(0, agg.collect(0, out, TELEMETRY_SIGNAL_COUNT));
+    agg.record(signal, 2.0f);
+    agg.record(signal, -4.0f);
+    agg.record(signal, 8.0f);
+    agg.record(signal, NAN);
+    agg.record(signal + 1, 100.0f);
+    TEST_ASSERT_EQUAL_UINT8(0, agg.collect(9999, out, TELEMETRY_SIGNAL_COUNT));
+    TEST_ASSERT_EQUAL_UINT8(1, agg.collect(10000, out, TELEMETRY_SIGNAL_COUNT));
+    TEST_ASSERT_EQUAL_UINT8(signal, out[0].signal);
+    TEST_ASSERT_EQUAL_UINT16(3, out[0].count);
+    TEST_ASSERT_EQUAL_FLOAT(-4.0f, out[0].min);
+    TEST_ASSERT_EQUAL_FLOAT(8.0f, out[0].max);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, out[0].mean);
+    TEST_ASSERT_EQUAL_FLOAT(8.0f, out[0].last);
+    TEST_ASSERT_EQUAL_UINT32(3, agg.getSampleCount(signal));
+    TEST_ASSERT_EQUAL_UINT32(0, agg.getSampleCount(signal + 1));
+
+    // An empty window sends nothing
+    TEST_ASSERT_EQUAL_UINT8(0, agg.collect(20000, out, TELEMETRY_SIGNAL_COUNT));
+    TEST_ASSERT_EQUAL_UINT32(1, agg.getSummaryCount(signal));
+}
+
+static void test_unlimited_budget_sends_every_window(void) {
+    TelemetryAggregator agg;
+    const TelemetrySignalConfig_t config = { 10, 0x07, 0 };
+    configureOnly(agg, 0, config);
+    TelemetrySummary_t out[TELEMETRY_SIGNAL_COUNT];
+    agg.collect(0, out, TELEMETRY_SIGNAL_COUNT);
+    for (uint32_t t = 10000; t <= 1000000; t += 10000) {
+        agg.record(0, 0.5f);
+        TEST_ASSERT_EQUAL_UINT8(1, agg.collect(t, out, TELEMETRY_SIGNAL_COUNT));
+    }
+    TEST_ASSERT_EQUAL_UINT32(100, agg.getSummaryCount(0));
+    TEST_ASSERT_EQUAL_UINT32(0, agg.getDeferredCount(0));
+    TEST_ASSERT_EQUAL_UINT32(100 * TelemetryAggregator::frameBytes(0x07), agg.getSentBytes(0));
+}
+
+static void test_budget_defers_into_wider_windows(void) {
+    TelemetryAggregator agg;
+    const uint8_t signal = TELEMETRY_SIGNAL_DRIVE_VEL;
+    const uint16_t budget = 200;
+    const TelemetrySignalConfig_t config = { 10, 0x07, budget };
+    configureOnly(agg, signal, config);
+    const uint32_t cost = TelemetryAggregator::frameBytes(config.fields);
+
+    TelemetrySummary_t out[TELEMETRY_SIGNAL_COUNT];
+    agg.collect(0, out, TELEMETRY_SIGNAL_COUNT);
+    uint32_t samples = 0;
+    uint32_t summarised = 0;
+    uint16_t widest = 0;
+    for (uint32_t t = 10000; t <= 1000000; t += 10000) {
+        agg.record(signal, (float)t * 1e-6f);
+        samples++;
+        const uint8_t n = agg.collect(t, out, TELEMETRY_SIGNAL_COUNT);
+        for (uint8_t i = 0; i < n; i++) {
+            summarised += out[i].count;
+            widest = out[i].count > widest ? out[i].count : widest;
+        }
+    }
+
+    // One frame of starting credit, then the budget rate; nothing is lost
+    const uint32_t allowed = cost + budget;
+    TEST_ASSERT_LESS_OR_EQUAL(allowed, agg.getSentBytes(signal));
+    TEST_ASSERT_GREATER_OR_EQUAL(allowed - cost, agg.getSentBytes(signal));
+    TEST_ASSERT_EQUAL_UINT32(agg.getSentBytes(signal) / cost, agg.getSummaryCount(signal));
+    TEST_ASSERT_TRUE(agg.getDeferredCount(signal) > 0);
+    TEST_ASSERT_TRUE(widest > 1);
+    TEST_ASSERT_LESS_OR_EQUAL(samples, summarised);
+    TEST_ASSERT_GREATER_OR_EQUAL(samples - widest, summarised);
+}
+
+static void test_budget_banks_at_most_burst_frames(void) {
+    TelemetryAggregator agg;
+    const TelemetrySignalConfig_t config = { 10, 0x0C, 100 };
+    configureOnly(agg, 1, config);
+    TelemetrySummary_t out[TELEMETRY_SIGNAL_COUNT];
+    agg.collect(0, out, TELEMETRY_SIGNAL_COUNT);
+
+    // A long quiet spell banks no more than HAT_AGG_BUDGET_BURST frames
+    uint32_t t = 10000000;
+    uint32_t sent = 0;
+    for (uint8_t i = 0; i < 10; i++, t += 10000) {
+        agg.record(1, 1.0f);
+        sent += agg.collect(t, out, TELEMETRY_SIGNAL_COUNT);
+    }
+    TEST_ASSERT_EQUAL_UINT32(HAT_AGG_BUDGET_BURST, sent);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_summary_round_trip);
+    RUN_TEST(test_summary_uses_signal_scale_and_saturates_count);
+    RUN_TEST(test_summary_drops_fields_past_the_third);
+    RUN_TEST(test_summary_decode_rejects_bad_frames);
+    RUN_TEST(test_config_rejects_unknown_signal_and_wide_masks);
+    RUN_TEST(test_window_summarises_samples);
+    RUN_TEST(test_unlimited_budget_sends_every_window);
+    RUN_TEST(test_budget_defers_into_wider_windows);
+    RUN_TEST(test_budget_banks_at_most_burst_frames);
+    return UNITY_END();
+}